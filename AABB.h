@@ -0,0 +1,68 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <algorithm>
+
+//Axis aligned bounding box. Used in world space by the broadphase to find
+//candidate pairs before running the more expensive SAT checks, and in local
+//space by meshes so colliders don't have to look at every vertex
+struct AABB
+{
+	DirectX::XMFLOAT3 min;
+	DirectX::XMFLOAT3 max;
+
+	AABB()
+		: min(0.0f, 0.0f, 0.0f),
+		max(0.0f, 0.0f, 0.0f)
+	{
+	}
+
+	AABB(DirectX::XMFLOAT3 in_min, DirectX::XMFLOAT3 in_max)
+		: min(in_min),
+		max(in_max)
+	{
+	}
+
+	bool Overlaps(const AABB& other) const
+	{
+		return min.x <= other.max.x && max.x >= other.min.x &&
+			min.y <= other.max.y && max.y >= other.min.y &&
+			min.z <= other.max.z && max.z >= other.min.z;
+	}
+
+	//True if other is completely inside of this box
+	bool Contains(const AABB& other) const
+	{
+		return min.x <= other.min.x && max.x >= other.max.x &&
+			min.y <= other.min.y && max.y >= other.max.y &&
+			min.z <= other.min.z && max.z >= other.max.z;
+	}
+
+	DirectX::XMFLOAT3 GetCenter() const
+	{
+		return DirectX::XMFLOAT3((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f);
+	}
+
+	//Half size along each axis
+	DirectX::XMFLOAT3 GetExtents() const
+	{
+		return DirectX::XMFLOAT3((max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f);
+	}
+
+	//Half the surface area, only used for relative cost comparisons so the factor of 2 isn't needed
+	float Perimeter() const
+	{
+		float x = max.x - min.x;
+		float y = max.y - min.y;
+		float z = max.z - min.z;
+		return x * y + y * z + z * x;
+	}
+
+	static AABB Union(const AABB& a, const AABB& b)
+	{
+		return AABB(
+			DirectX::XMFLOAT3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+			DirectX::XMFLOAT3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)));
+	}
+};
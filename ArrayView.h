@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+//Read only view over a contiguous array someone else owns, lets callers look at
+//CPU side data without copying it. Only valid as long as the owner doesn't resize
+template<typename T>
+struct ArrayView
+{
+	const T* data;
+	size_t count;
+
+	ArrayView()
+		: data(nullptr),
+		count(0)
+	{
+	}
+
+	ArrayView(const T* in_data, size_t in_count)
+		: data(in_data),
+		count(in_count)
+	{
+	}
+
+	ArrayView(const std::vector<T>& vec)
+		: data(vec.empty() ? nullptr : vec.data()),
+		count(vec.size())
+	{
+	}
+
+	const T& operator[](size_t index) const { return data[index]; }
+
+	const T* begin() const { return data; }
+	const T* end() const { return data + count; }
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+};
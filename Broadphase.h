@@ -0,0 +1,51 @@
+#pragma once
+#include "AABB.h"
+
+#include <DirectXMath.h>
+#include <vector>
+
+//Two proxies whose broadphase boxes overlap, proxyA is always the smaller id
+struct BroadphasePair
+{
+	int proxyA;
+	int proxyB;
+};
+
+enum eBroadphaseType
+{
+	BROADPHASE_AABB_TREE = 0,
+	BROADPHASE_SWEEP_AND_PRUNE,
+	BROADPHASE_SPATIAL_HASH,
+
+	BROADPHASE_COUNT,
+};
+
+//Common interface for everything that can narrow colliders down to candidate
+//pairs, so the collision manager can swap between them at runtime
+class Broadphase
+{
+public:
+	virtual ~Broadphase() {}
+
+	//Returns an id that's used to refer to this box from then on
+	virtual int CreateProxy(const AABB& aabb, void* userData) = 0;
+	virtual void DestroyProxy(int proxyId) = 0;
+
+	//Displacement is how far the box moved since last update, backends that
+	//don't predict movement can ignore it. Returns true if the structure changed
+	virtual bool MoveProxy(int proxyId, const AABB& aabb, const DirectX::XMFLOAT3& displacement) = 0;
+
+	virtual void* GetUserData(int proxyId) const = 0;
+	virtual int GetProxyCount() const = 0;
+
+	//Fills outPairs with every overlapping pair of proxies, each pair is only reported once
+	virtual void ComputePairs(std::vector<BroadphasePair>& outPairs) = 0;
+
+	//Fills outProxies with every proxy whose box overlaps aabb. Backends that pad their boxes
+	//can return a few that only touch the padding
+	virtual void QueryAABB(const AABB& aabb, std::vector<int>& outProxies) const = 0;
+
+	virtual void Clear() = 0;
+
+	virtual const char* GetName() const = 0;
+};
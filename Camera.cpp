@@ -1,6 +1,8 @@
 #include "Camera.h"
 #include "Input.h"
 
+#include <cmath>
+
 using namespace DirectX;
 
 Camera::Camera(DirectX::XMFLOAT3 pos, float in_aspectRatio, float in_fov, float in_nearPlane, float in_farPlane)
@@ -65,17 +67,13 @@ void Camera::Update(float dt)
         float mouseMoveX = input.GetMouseXDelta() * mouseMoveSpeed * dt;
         float mouseMoveY = input.GetMouseYDelta() * mouseMoveSpeed * dt;
 
+        //lock movement so doesn't start going upside down. Clamped before turning since the angles
+        //read back from the rotation can't go past straight up to be caught after
+        float pitch = transform.GetRotation().x;
+        float newPitch = fmaxf(-0.95f * XM_PIDIV2, fminf(0.95f * XM_PIDIV2, pitch + mouseMoveY));
+
         //rotaion goes in the opposite order. moving mouse left and right (x dir) moves camera in y
-        transform.Rotate(XMFLOAT3(mouseMoveY, mouseMoveX, 0));
-
-        XMFLOAT3 rotations = transform.GetRotation();
-        //lock movement so doesn't start going upside down
-        if (rotations.x < -0.95f * XM_PIDIV2) {
-            transform.SetRotation(XMFLOAT3(-0.95f * XM_PIDIV2, rotations.y, rotations.z));
-        }
-        else if (rotations.x > 0.95f * XM_PIDIV2) {
-            transform.SetRotation(XMFLOAT3(0.95f * XM_PIDIV2, rotations.y, rotations.z));
-        }
+        transform.Rotate(XMFLOAT3(newPitch - pitch, mouseMoveX, 0));
     }
 
     UpdateViewMatrix();
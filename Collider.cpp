@@ -2,10 +2,20 @@
 
 using namespace DirectX;
 
+unsigned int Collider::s_ignoredLayers[Collider::MAX_LAYERS] = {};
+
 Collider::Collider(std::shared_ptr<Mesh> colliderMesh, Transform* parentTransform)
 	: m_objectMesh(colliderMesh),
 	m_pointsDirty(true),
-	m_halvesDirty(true),
+	m_worldVertsDirty(true),
+	m_proxyId(-1),
+	m_bodyId(-1),
+	m_sleeping(false),
+	m_numContacts(0),
+	m_supportHint(0),
+	m_layer(0),
+	m_isTrigger(false),
+	m_entityId(-1),
 	m_sphere(nullptr)
 {
 	m_transform = Transform();
@@ -17,7 +27,15 @@ Collider::Collider(std::shared_ptr<Mesh> colliderMesh, Transform* parentTransfor
 Collider::Collider(std::shared_ptr<Mesh> colliderMesh, Transform* parentTransform, Transform* sphere)
 	: m_objectMesh(colliderMesh),
 	m_pointsDirty(true),
-	m_halvesDirty(true),
+	m_worldVertsDirty(true),
+	m_proxyId(-1),
+	m_bodyId(-1),
+	m_sleeping(false),
+	m_numContacts(0),
+	m_supportHint(0),
+	m_layer(0),
+	m_isTrigger(false),
+	m_entityId(-1),
 	m_sphere(sphere)
 {
 	m_transform = Transform();
@@ -31,86 +49,55 @@ Collider::~Collider()
 {
 }
 
-//TODO: OPTIMIZEEEEE This func could 100% be optimized better
+//The mesh's local box is cached so this is just the box's center and extents
+//pushed through the world matrix instead of a loop over every vertex
 void Collider::CalcMinMaxPoints() 
 {
 	// Makes sure we don't call this when it's not needed
 	if (!m_pointsDirty) {
-		//return;
+		return;
 	}
 
-	std::vector<Vertex> verts = m_objectMesh->GetVerticies();
-
-	XMFLOAT4 currPos = XMFLOAT4(verts[0].Position.x, verts[0].Position.y, verts[0].Position.z, 1.0f);
-	XMFLOAT4X4 worldMat = m_transform.GetParent()->GetWorldMatrix();
-	
-	XMStoreFloat4(&currPos, XMVector4Transform(XMLoadFloat4(&currPos), XMLoadFloat4x4(&worldMat)));
-
-	l_transformedPositions.clear();
-	l_transformedPositions.push_back(currPos);
-
-	//Inefficient could probs be better done through a compute shader
-	float xMax = currPos.x;
-	float xMin = currPos.x;
-				 
-	float yMax = currPos.y;
-	float yMin = currPos.y;
-				 
-	float zMax = currPos.z;
-	float zMin = currPos.z;
-	for (int i = 1; i < verts.size(); i++)
-	{
-		currPos = XMFLOAT4(verts[i].Position.x, verts[i].Position.y, verts[i].Position.z, 1.0f);
-		XMStoreFloat4(&currPos, XMVector4Transform(XMLoadFloat4(&currPos), XMLoadFloat4x4(&worldMat)));
-		l_transformedPositions.push_back(currPos);
-
-		xMax = currPos.x > xMax ? currPos.x : xMax;
-		xMin = currPos.x < xMin ? currPos.x : xMin;
+	m_worldMatrix = m_transform.GetWorldMatrix();
+	XMMATRIX world = XMLoadFloat4x4(&m_worldMatrix);
 
-		yMax = currPos.y > yMax ? currPos.y : yMax;
-		yMin = currPos.y < yMin ? currPos.y : yMin;
+	const AABB& localBounds = m_objectMesh->GetLocalBounds();
+	XMFLOAT3 localCenter = localBounds.GetCenter();
+	XMFLOAT3 localExtents = localBounds.GetExtents();
 
-		zMax = currPos.z > zMax ? currPos.z : zMax;
-		zMin = currPos.z < zMin ? currPos.z : zMin;
-	}
+	XMVECTOR center = XMVector3Transform(XMLoadFloat3(&localCenter), world);
 
-	XMStoreFloat3(&m_maxPoint, XMVectorSet(xMax, yMax, zMax, 1.0f));
-	XMStoreFloat3(&m_minPoint, XMVectorSet(xMin, yMin, zMin, 1.0f));
+	//Each row of the world matrix is a (scaled) local axis, so the world extents are
+	//the local extents projected onto the world axes
+	XMVECTOR extents = XMVectorAbs(world.r[0]) * localExtents.x
+		+ XMVectorAbs(world.r[1]) * localExtents.y
+		+ XMVectorAbs(world.r[2]) * localExtents.z;
 
-	l_transformedCubeVerts.clear();
-	l_transformedCubeVerts.push_back(m_maxPoint);
-	l_transformedCubeVerts.push_back(m_minPoint);
-	l_transformedCubeVerts.push_back(XMFLOAT3(xMax, yMax, zMin));
-	l_transformedCubeVerts.push_back(XMFLOAT3(xMin, yMax, zMax));
-	l_transformedCubeVerts.push_back(XMFLOAT3(xMax, yMin, zMax));
-	l_transformedCubeVerts.push_back(XMFLOAT3(xMax, yMin, zMin));
-	l_transformedCubeVerts.push_back(XMFLOAT3(xMin, yMax, zMin));
-	l_transformedCubeVerts.push_back(XMFLOAT3(xMin, yMin, zMax));
+	XMStoreFloat3(&m_centerPoint, center);
+	XMStoreFloat3(&m_maxPoint, center + extents);
+	XMStoreFloat3(&m_minPoint, center - extents);
 
-	m_pointsDirty = false;
-}
+	//Same box but oriented, used by SAT
+	const float* localHalves = &localExtents.x;
+	m_worldOBB.center = m_centerPoint;
+	for (int i = 0; i < 3; i++) {
+		float axisScale = XMVectorGetX(XMVector3Length(world.r[i]));
+		m_worldOBB.halfExtents[i] = localHalves[i] * axisScale;
 
-void Collider::CalcHalfDimensions() {
-	if (!m_halvesDirty) {
-		return;
+		if (axisScale > 0.0f) {
+			XMStoreFloat3(&m_worldOBB.axes[i], world.r[i] / axisScale);
+		}
+		else {
+			m_worldOBB.axes[i] = XMFLOAT3(i == 0 ? 1.0f : 0.0f, i == 1 ? 1.0f : 0.0f, i == 2 ? 1.0f : 0.0f);
+		}
 	}
 
-	CalcMinMaxPoints();
-
-	m_halfWidth =  (m_maxPoint.x - m_minPoint.x) / 2.0f;
-	m_halfHeight = (m_maxPoint.y - m_minPoint.y) / 2.0f;
-	m_halfDepth =  (m_maxPoint.z - m_minPoint.z) / 2.0f;
-
-	m_halvesDirty = false;
+	m_pointsDirty = false;
+	m_worldVertsDirty = true;
 }
 
 void Collider::CalcCenterPoint() {
-	CalcHalfDimensions();
-
-	XMFLOAT3 parentPos = m_transform.GetParent()->GetPosition();
-	XMFLOAT3 thisPos = m_transform.GetPosition();
-	m_centerPoint = XMFLOAT3(parentPos.x + thisPos.x, parentPos.y + thisPos.y, parentPos.z + thisPos.z);
-
+	CalcMinMaxPoints();
 
 	m_preCheckRadiusSquared = powf(m_maxPoint.x - m_centerPoint.x, 2.0f) + powf(m_maxPoint.y - m_centerPoint.y, 2.0f) + powf(m_maxPoint.z - m_centerPoint.z, 2.0f);
 
@@ -122,307 +109,94 @@ void Collider::CalcCenterPoint() {
 	}
 }
 
-bool Collider::CheckForCollision(const std::shared_ptr<Collider> other) {
-	//Should be subject to change not a great position to mark this
-	m_pointsDirty = m_transform.IsWorldDirty();
-	m_halvesDirty = m_pointsDirty;
-
-	//Shouldn't be computationally expensive to do this if we maintain the proper dirty booleans
-	CalcCenterPoint();
-	other->CalcCenterPoint();
-
-	float centerSquareDist = powf(m_centerPoint.x - other->m_centerPoint.x, 2.0f) + powf(m_centerPoint.y - other->m_centerPoint.y, 2.0f) + powf(m_centerPoint.z - other->m_centerPoint.z, 2.0f);
-	if (m_preCheckRadiusSquared + other->m_preCheckRadiusSquared <= centerSquareDist) {
-		//return false;
-	}
-
-	return !CheckSATCollision(other);//true;// CheckGJKCollision(other);
-}
+const std::vector<XMFLOAT3>& Collider::GetWorldVertices()
+{
+	CalcMinMaxPoints();
 
-#pragma region SAT collision
+	if (m_worldVertsDirty) {
+		ArrayView<XMFLOAT3> positions = m_objectMesh->GetPositions();
+		XMFLOAT4X4 worldMat = m_transform.GetWorldMatrix();
+		XMMATRIX world = XMLoadFloat4x4(&worldMat);
 
-// Code edited and re-used from an old DSA2 project which I believe referenced a book that I can't seem to find the name of TODO: Cite the book here
-int Collider::CheckSATCollision(const std::shared_ptr<Collider> other) {
-	//XMVECTOR thisUp = XMLoadFloat3( &(m_transform.GetParent()->GetUp()));
-	//XMVECTOR thisForward = XMLoadFloat3( &(m_transform.GetParent()->GetUp()));
-	//XMVECTOR thisRight = XMLoadFloat3( &(m_transform.GetParent()->GetUp()));
-
-	float ra, rb;
-	float R[3][3] = { {0.0f,0.0f,0.0f},{0.0f,0.0f,0.0f},{0.0f,0.0f,0.0f}};
-	float AbsR[3][3] = { {0.0f,0.0f,0.0f},{0.0f,0.0f,0.0f},{0.0f,0.0f,0.0f} };
-
-	//aU and bU are the same as their respective Model Matricies
-	XMFLOAT4X4 world = m_transform.GetWorldMatrix();
-	XMFLOAT4X4 otherWorld = other->m_transform.GetWorldMatrix();
-	XMMATRIX aU = XMMatrixTranspose(XMLoadFloat4x4(&(world)));
-	XMMATRIX bU = XMMatrixTranspose(XMLoadFloat4x4(&(otherWorld)));
-
-	// Compute rotation matrix expressing b in a's coordinate frame
-	for (int i = 0; i < 3; i++)
-		for (int j = 0; j < 3; j++)
-			XMStoreFloat(&R[i][j], XMVector3Dot(aU.r[i], bU.r[j]));
-
-	// Compute translation vector t
-	XMVECTOR vecT = XMLoadFloat3(&other->m_centerPoint) - XMLoadFloat3(&m_centerPoint);
-	// Bring translation into as coordinate frame
-	XMFLOAT3 tempDot;
-	XMStoreFloat(&tempDot.x, XMVector3Dot(vecT, aU.r[0]));
-	XMStoreFloat(&tempDot.y, XMVector3Dot(vecT, aU.r[1]));
-	XMStoreFloat(&tempDot.z, XMVector3Dot(vecT, aU.r[2]));
-	vecT = XMLoadFloat3(&tempDot);
-	XMFLOAT3 vecTLoad;
-	XMStoreFloat3(&vecTLoad, vecT);
-
-	float t[3];
-	t[0] = vecTLoad.x;
-	t[1] = vecTLoad.y;
-	t[2] = vecTLoad.z;
-
-	// Compute common subexpressions. Add in an epsilon term to
-	// counteract arithmetic errors when two edges are parallel and
-	// their cross product is (near) null (see text for details)
-	for (int i = 0; i < 3; i++)
-		for (int j = 0; j < 3; j++)
-			AbsR[i][j] = abs(R[i][j]) + .0000001f;
-
-	float halfWidths[3] = { m_halfWidth, m_halfHeight, m_halfDepth };
-	float otherHalfWidths[3] = { other->m_halfWidth, other->m_halfHeight, other->m_halfDepth };
-	// Test axes L = A0, L = A1, L = A2
-	for (int i = 0; i < 3; i++) {
-		ra = halfWidths[i];
-		rb = otherHalfWidths[0] * AbsR[i][0] + otherHalfWidths[1] * AbsR[i][1] + otherHalfWidths[2] * AbsR[i][2];
-		if (abs(t[i]) > ra + rb) {
-			return 1 + i;
+		l_transformedPositions.resize(positions.size());
+		for (unsigned int i = 0; i < positions.size(); i++) {
+			XMStoreFloat3(&l_transformedPositions[i], XMVector3Transform(XMLoadFloat3(&positions[i]), world));
 		}
-	}
 
-	// Test axes L = B0, L = B1, L = B2
-	for (int i = 0; i < 3; i++) {
-		ra = halfWidths[0] * AbsR[0][i] + halfWidths[1] * AbsR[1][i] + halfWidths[2] * AbsR[2][i];
-		rb = otherHalfWidths[i];
-		if (abs(t[0] * R[0][i] + t[1] * R[1][i] + t[2] * R[2][i]) > ra + rb)
-			return 4 + i;
+		m_worldVertsDirty = false;
 	}
-	// Test axis L = A0 x B0
-	ra =halfWidths[1] * AbsR[2][0] +halfWidths[2] * AbsR[1][0];
-	rb = otherHalfWidths[1] * AbsR[0][2] + otherHalfWidths[2] * AbsR[0][1];
-	if (abs(t[2] * R[1][0] - t[1] * R[2][0]) > ra + rb)
-		return eSATResults::SAT_AXxBX;
-
-	// Test axis L = A0 x B1
-	ra =halfWidths[1] * AbsR[2][1] +halfWidths[2] * AbsR[1][1];
-	rb = otherHalfWidths[0] * AbsR[0][2] + otherHalfWidths[2] * AbsR[0][0];
-	if (abs(t[2] * R[1][1] - t[1] * R[2][1]) > ra + rb)
-		return eSATResults::SAT_AXxBY;
-
-	// Test axis L = A0 x B2
-	ra =halfWidths[1] * AbsR[2][2] +halfWidths[2] * AbsR[1][2];
-	rb = otherHalfWidths[0] * AbsR[0][1] + otherHalfWidths[1] * AbsR[0][0];
-	if (abs(t[2] * R[1][2] - t[1] * R[2][2]) > ra + rb)
-		return eSATResults::SAT_AXxBZ;
-
-	// Test axis L = A1 x B0
-	ra =halfWidths[0] * AbsR[2][0] +halfWidths[2] * AbsR[0][0];
-	rb = otherHalfWidths[1] * AbsR[1][2] + otherHalfWidths[2] * AbsR[1][1];
-	if (abs(t[0] * R[2][0] - t[2] * R[0][0]) > ra + rb)
-		return eSATResults::SAT_AYxBX;
-
-	// Test axis L = A1 x B1
-	ra =halfWidths[0] * AbsR[2][1] +halfWidths[2] * AbsR[0][1];
-	rb = otherHalfWidths[0] * AbsR[1][2] + otherHalfWidths[2] * AbsR[1][0];
-	if (abs(t[0] * R[2][1] - t[2] * R[0][1]) > ra + rb)
-		return eSATResults::SAT_AYxBY;
-
-	// Test axis L = A1 x B2
-	ra =halfWidths[0] * AbsR[2][2] +halfWidths[2] * AbsR[0][2];
-	rb = otherHalfWidths[0] * AbsR[1][1] + otherHalfWidths[1] * AbsR[1][0];
-	if (abs(t[0] * R[2][2] - t[2] * R[0][2]) > ra + rb)
-		return eSATResults::SAT_AYxBZ;
-
-	// Test axis L = A2 x B0
-	ra =halfWidths[0] * AbsR[1][0] +halfWidths[1] * AbsR[0][0];
-	rb = otherHalfWidths[1] * AbsR[2][2] + otherHalfWidths[2] * AbsR[2][1];
-	if (abs(t[1] * R[0][0] - t[0] * R[1][0]) > ra + rb)
-		return eSATResults::SAT_AZxBX;
-
-	// Test axis L = A2 x B1
-	ra =halfWidths[0] * AbsR[1][1] +halfWidths[1] * AbsR[0][1];
-	rb = otherHalfWidths[0] * AbsR[2][2] + otherHalfWidths[2] * AbsR[2][0];
-	if (abs(t[1] * R[0][1] - t[0] * R[1][1]) > ra + rb)
-		return eSATResults::SAT_AZxBY;
-
-	// Test axis L = A2 x B2
-	ra =halfWidths[0] * AbsR[1][2] +halfWidths[1] * AbsR[0][2];
-	rb = otherHalfWidths[0] * AbsR[2][1] + otherHalfWidths[1] * AbsR[2][0];
-	if (abs(t[1] * R[0][2] - t[0] * R[1][2]) > ra + rb)
-		return eSATResults::SAT_AZxBZ;
-
-	//there is no axis test that separates this two objects
-	return eSATResults::SAT_NONE;
-}
-
-#pragma endregion
-
-
-#pragma region GJK collision
-
-bool Collider::CheckGJKCollision(const std::shared_ptr<Collider> other) {
-	std::vector<XMVECTOR> supports;
-	XMVECTOR currSupport = CalcSupport(XMVector3Normalize(XMLoadFloat3(&m_maxPoint))) - other->CalcSupport(-XMVector3Normalize(XMLoadFloat3(&m_maxPoint)));
-	supports.push_back(currSupport);
-
-	XMVECTOR negated = XMVectorNegate(currSupport);
-	XMVECTOR currDir = negated;
-
-	float fADotDir = 0.0f;
 
-	while (true) {
-		XMVECTOR pointA = CalcSupport(currDir) - other->CalcSupport(-(currDir));
-		XMVECTOR aDotDir = XMVector3Dot(pointA, currDir);
-
-		XMStoreFloat(&fADotDir, aDotDir);
-
-		if (fADotDir <= 0) {
-			return false;
-		}
+	return l_transformedPositions;
+}
 
-		supports.push_back(pointA);
+void Collider::UpdateBounds() {
+	m_pointsDirty = BoundsOutOfDate();
 
-		XMFLOAT3 directionPrint;
-		XMStoreFloat3(&directionPrint, currDir);
+	CalcCenterPoint();
+}
 
-		if (DoSimplex(supports, currDir)) {
-			return true;
-		}
+void Collider::SetLayersCollide(int layerA, int layerB, bool collide) {
+	if (layerA < 0 || layerA >= MAX_LAYERS || layerB < 0 || layerB >= MAX_LAYERS) {
+		return;
 	}
 
-	return false;
+	//Both rows so it doesn't matter which collider of a pair gets checked against the other
+	if (collide) {
+		s_ignoredLayers[layerA] &= ~(1u << layerB);
+		s_ignoredLayers[layerB] &= ~(1u << layerA);
+	}
+	else {
+		s_ignoredLayers[layerA] |= 1u << layerB;
+		s_ignoredLayers[layerB] |= 1u << layerA;
+	}
 }
 
-//Finds the point furthest along the direction vector provided
-XMVECTOR Collider::CalcSupport(const XMVECTOR& direction) {
-	XMVECTOR max = XMVector3Dot(XMLoadFloat3(&l_transformedCubeVerts[0]), direction);
-
-	int posIndex = 0;
-
-	for (int i = 1; i < l_transformedCubeVerts.size(); i++) {
-		XMVECTOR currDot = XMVector3Dot(XMLoadFloat3(&l_transformedCubeVerts[i]), direction);
+bool Collider::CheckForCollision(Collider* other) {
+	int separatingAxis = SAT_NONE;
+	return CheckForCollision(other, separatingAxis);
+}
 
-		if (XMVector3Greater(currDot, max)) {
-			max = currDot;
-			posIndex = i;
-		}
+bool Collider::CheckForCollision(Collider* other, int& separatingAxis) {
+	//Bounds are refreshed once per update by the collision manager instead of once per pair
+	float centerSquareDist = powf(m_centerPoint.x - other->m_centerPoint.x, 2.0f) + powf(m_centerPoint.y - other->m_centerPoint.y, 2.0f) + powf(m_centerPoint.z - other->m_centerPoint.z, 2.0f);
+	if (m_preCheckRadiusSquared + other->m_preCheckRadiusSquared <= centerSquareDist) {
+		//return false;
 	}
 
-	return XMLoadFloat3(&l_transformedCubeVerts[posIndex]);
+	separatingAxis = CheckSATCollision(other, separatingAxis);
+	return separatingAxis == SAT_NONE;//true;// CheckGJKCollision(other);
 }
 
-//Implementation based on https://www.youtube.com/watch?v=Qupqu1xe7Io
-
-bool Collider::DoSimplex(std::vector<XMVECTOR>& supports, DirectX::XMVECTOR& direction) {
-	XMVECTOR ao = -supports[0];
-	XMVECTOR zeroVec = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
+#pragma region SAT collision
 
+//The actual test lives on OBB so batches and benchmarks can share it
+int Collider::CheckSATCollision(Collider* other, int firstAxis) {
+	return OBB::TestSAT(m_worldOBB, other->m_worldOBB, firstAxis);
+}
 
-	static auto dotEval = [&ao, &zeroVec](XMVECTOR vecToDot) {
-		return XMVector3Greater(XMVector3Dot(vecToDot, ao), zeroVec);
-	};
+#pragma endregion
 
-	static auto lineCase = [&ao, &supports, &direction]() {
-		XMVECTOR ab = supports[1] - supports[0];
 
-		if (dotEval(ab)) {
-			direction = XMVector3Cross(XMVector3Cross(ab, ao), ab);
-		}
-		else {
-			direction = ao;
-			supports.erase(supports.begin() + 1);
-		}
+#pragma region GJK collision
 
-		return false;
-	};
-
-	static auto triCase = [&ao, &supports, &direction]() {
-		XMVECTOR ab = supports[1] - supports[0];
-		XMVECTOR ac = supports[2] - supports[0];
-		XMVECTOR abc = XMVector3Cross(ab, ac);
-
-		// Plane ABC x Vector AC
-		if (dotEval(XMVector3Cross(abc, ac))) {
-
-			if (dotEval(ac)) {
-				direction = XMVector3Cross(XMVector3Cross(ac, ao), ac);
-				supports.erase(supports.begin() + 1);
-			}
-			else {
-				return lineCase();
-			}
-		}
-		else {
-			if (dotEval(XMVector3Cross(ab, abc))) {
-				return lineCase();
-			}
-			else {
-				if (dotEval(abc)) {
-					direction = abc;
-				}
-				else {
-					direction = -abc;
-					XMVECTOR temp = supports[1];
-					supports[1] = supports[2];
-					supports[2] = temp;
-				}
-			}
-		}
+//Both hulls stay in local space, GJK turns each search direction into the mesh's frame
+//and only transforms the one vertex it picks
+bool Collider::CheckGJKCollision(Collider* other, PenetrationInfo* outPenetration) {
+	ConvexSupport shapeA = GetConvexSupport();
+	ConvexSupport shapeB = other->GetConvexSupport();
 
+	GJKSimplex simplex;
+	if (!GJK::Intersect(shapeA, shapeB, simplex)) {
 		return false;
-	};
-
-	static auto quadCase = [&ao, &supports, &direction]() {
-		XMVECTOR ab = supports[1] - supports[0];
-		XMVECTOR ac = supports[2] - supports[0];
-		XMVECTOR ad = supports[3] - supports[0];
-
-		XMVECTOR abc = XMVector3Cross(ab, ac);
-		XMVECTOR acd = XMVector3Cross(ac, ad);
-		XMVECTOR adb = XMVector3Cross(ad, ab);
-
-		if (dotEval(abc)) {
-			supports.erase(supports.begin() + 3);
-			return triCase();
-		}
-
-		if (dotEval(acd)) {
-			supports.erase(supports.begin() + 1);
-			return triCase();
-		}
-
-		if (dotEval(adb)) {
-			supports.erase(supports.begin() + 2);
-			XMVECTOR temp = supports[1];
-			supports[1] = supports[2];
-			supports[2] = temp;
-			return triCase();
-		}
-
-		return true;
-	};
-
-	switch (supports.size()) {
-	case 2:
-		return lineCase();
-
-	case 3:
-		return triCase();
-
-	case 4:
-		return quadCase();
+	}
 
-	default:
-		break;
+	if (outPenetration && !GJK::Penetration(shapeA, shapeB, simplex, *outPenetration)) {
+		//Just touching or too flat to measure
+		outPenetration->normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+		outPenetration->depth = 0.0f;
 	}
 
-	return false;
+	return true;
 }
 
 #pragma endregion
\ No newline at end of file
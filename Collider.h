@@ -1,41 +1,31 @@
 #pragma once
+#include "AABB.h"
 #include "Transform.h"
 #include "Mesh.h"
+#include "OBB.h"
+#include "GJK.h"
 #include "Camera.h"
 
 #include <memory>
 
-enum eSATResults
+//Layers the scene puts its colliders on, anything past these is free for gameplay to use
+enum eCollisionLayer
 {
-	SAT_NONE = 0,
-
-	SAT_AX,
-	SAT_AY,
-	SAT_AZ,
-
-	SAT_BX,
-	SAT_BY,
-	SAT_BZ,
-
-	SAT_AXxBX,
-	SAT_AXxBY,
-	SAT_AXxBZ,
-
-	SAT_AYxBX,
-	SAT_AYxBY,
-	SAT_AYxBZ,
-
-	SAT_AZxBX,
-	SAT_AZxBY,
-	SAT_AZxBZ,
+	LAYER_DEFAULT = 0,
+	//Level geometry that never moves, never needs testing against itself
+	LAYER_STATIC,
+	//Debug sphere entities and other editor only markers, they collide with nothing
+	LAYER_DEBUG,
+	//Volumes that only report who is inside them
+	LAYER_TRIGGER,
 };
 
 class Collider
 {
 private:
 	std::shared_ptr<Mesh> m_objectMesh;
-	std::vector<DirectX::XMFLOAT4> l_transformedPositions;
-	std::vector<DirectX::XMFLOAT3> l_transformedCubeVerts;
+	//Only filled in when something asks for them, see GetWorldVertices
+	std::vector<DirectX::XMFLOAT3> l_transformedPositions;
 	Transform m_transform;
 
 	static float m_debugSphereMeshRadius;
@@ -44,35 +34,115 @@ private:
 	DirectX::XMFLOAT3 m_minPoint;
 	DirectX::XMFLOAT3 m_centerPoint;
 
-	float m_halfWidth;
-	float m_halfHeight;
-	float m_halfDepth;
+	//Oriented box built from the mesh's local bounds
+	OBB m_worldOBB;
+	//Copy of the transform's world matrix from the last bounds update, GJK turns support directions with it
+	DirectX::XMFLOAT4X4 m_worldMatrix;
 
 	float m_preCheckRadiusSquared;
 
 	bool m_pointsDirty;
-	bool m_halvesDirty;
+	bool m_worldVertsDirty;
+
+	//Id of this collider in the collision manager's broadphase, -1 if not registered
+	int m_proxyId;
+	//Index of the rigid body contacts on this collider push on, -1 if it doesn't have one
+	int m_bodyId;
+	//Set while its body sleeps (or is static and hasn't moved), the collision manager leaves it where it was
+	bool m_sleeping;
+	//How many colliders this is touching, kept up to date by the collision manager's begin/end events
+	int m_numContacts;
+	//Hull vertex the last support search ended on, the next one starts there
+	int m_supportHint;
+	//Which collision layer it's on, scene queries skip it unless this layer's bit is in their mask
+	int m_layer;
+	//Triggers report begin/persist/end events like anything else but never get contacts
+	bool m_isTrigger;
+	//Index of the entity it belongs to in the entity manager, -1 if it isn't on one
+	int m_entityId;
+
+	//Row a has bit b set if layers a and b don't collide. Starts all clear so everything collides
+	static unsigned int s_ignoredLayers[];
 
 	void CalcMinMaxPoints();
-	void CalcHalfDimensions();
 	void CalcCenterPoint();
 
-	int CheckSATCollision(const std::shared_ptr<Collider> other);
+	int CheckSATCollision(Collider* other, int firstAxis = SAT_NONE);
 
-	bool CheckGJKCollision(const std::shared_ptr<Collider> other);
-	DirectX::XMVECTOR CalcSupport(const DirectX::XMVECTOR& direction);
-	bool DoSimplex(std::vector<DirectX::XMVECTOR>& supports, DirectX::XMVECTOR& direction);
 
 	Transform* m_sphere;
 
 public:
+	//Layer masks have a bit per layer
+	static const int MAX_LAYERS = 32;
+	static const unsigned int ALL_LAYERS = 0xffffffffu;
+
 	Collider(std::shared_ptr<Mesh> colliderMesh, Transform* parentTransform);
 	Collider(std::shared_ptr<Mesh> colliderMesh, Transform* parentTransform, Transform* sphere);
 	~Collider();
 
 	std::shared_ptr<Mesh> GetCollisionMesh() { return m_objectMesh; }
 
-	bool CheckForCollision(const std::shared_ptr<Collider> other);
+	bool CheckForCollision(const std::shared_ptr<Collider> other) { return CheckForCollision(other.get()); }
+	bool CheckForCollision(Collider* other);
+	//separatingAxis should hold the axis that separated the pair last time, or SAT_NONE.
+	//It's tested first and gets replaced with this check's result
+	bool CheckForCollision(Collider* other, int& separatingAxis);
+
+	//Exact test against the meshes' convex hulls, for shapes the oriented box only roughly fits.
+	//Fills in outPenetration with EPA's depth and normal (pointing towards other) when given
+	bool CheckGJKCollision(Collider* other, PenetrationInfo* outPenetration = nullptr);
+	//False for a mesh with no vertices, those only ever use the box
+	bool HasConvexHull() const { return !m_objectMesh->GetConvexHull().IsEmpty(); }
+	ConvexSupport GetConvexSupport() { return ConvexSupport(&m_objectMesh->GetConvexHull(), m_worldMatrix, &m_supportHint); }
+
+	//Recalculates the world space bounds, should be called once per update before broadphase
+	void UpdateBounds();
+	//False once the bounds have caught up with the transform, dirtiness reaches down from any parent
+	bool BoundsOutOfDate() const { return m_pointsDirty || m_transform.IsWorldDirty(); }
+	AABB GetWorldAABB() const { return AABB(m_minPoint, m_maxPoint); }
+	const OBB& GetWorldOBB() const { return m_worldOBB; }
+	DirectX::XMFLOAT3 GetCenterPoint() const { return m_centerPoint; }
+	//Child of the owner's transform, only scaled to fit the mesh
+	const Transform* GetTransform() const { return &m_transform; }
+
+	//Every mesh vertex in world space. Transforms the whole mesh the first time it's
+	//called after a move so only use it for queries that really need the exact shape.
+	//Empty if the mesh was made without CPU positions
+	const std::vector<DirectX::XMFLOAT3>& GetWorldVertices();
+
+	int GetProxyId() const { return m_proxyId; }
+	void SetProxyId(int proxyId) { m_proxyId = proxyId; }
+
+	int GetBodyId() const { return m_bodyId; }
+	void SetBodyId(int bodyId) { m_bodyId = bodyId; }
+
+	//0 to MAX_LAYERS - 1, everything starts on layer 0
+	int GetLayer() const { return m_layer; }
+	void SetLayer(int layer) { m_layer = layer < 0 ? 0 : (layer >= MAX_LAYERS ? MAX_LAYERS - 1 : layer); }
+	unsigned int GetLayerBit() const { return 1u << m_layer; }
+
+	//Collision matrix between layers, shared by every collider and always kept symmetric
+	static void SetLayersCollide(int layerA, int layerB, bool collide);
+	static bool DoLayersCollide(int layerA, int layerB) { return !(s_ignoredLayers[layerA] & (1u << layerB)); }
+	//Bits of every layer that collides with layer
+	static unsigned int GetLayerCollisionMask(int layer) { return ~s_ignoredLayers[layer]; }
+	//One lookup and a mask, the collision manager checks this before anything else about a pair
+	static bool ShouldCollide(const Collider* a, const Collider* b) { return !(s_ignoredLayers[a->m_layer] & b->GetLayerBit()); }
+
+	int GetEntityId() const { return m_entityId; }
+	void SetEntityId(int entityId) { m_entityId = entityId; }
+
+	bool IsTrigger() const { return m_isTrigger; }
+	void SetTrigger(bool isTrigger) { m_isTrigger = isTrigger; }
+
+	bool IsSleeping() const { return m_sleeping; }
+	void SetSleeping(bool sleeping) { m_sleeping = sleeping; }
+
+	bool IsColliding() const { return m_numContacts > 0; }
+	int GetNumContacts() const { return m_numContacts; }
+	void AddContact() { m_numContacts++; }
+	void RemoveContact() { m_numContacts--; }
 	void MakePointsDirty() { m_pointsDirty = true; }
 	void MakeHalvesDirty() { m_pointsDirty = true; }
 
@@ -0,0 +1,87 @@
+#include "CollisionEventBuffer.h"
+
+using namespace DirectX;
+
+CollisionEventBuffer::CollisionEventBuffer()
+	: m_readIndex(0),
+	m_contactResets(0),
+	m_numGrowths(0)
+{
+	m_reset[0] = false;
+	m_reset[1] = false;
+	m_steps[0] = 0;
+	m_steps[1] = 0;
+	Reserve(256);
+}
+
+CollisionEventBuffer::~CollisionEventBuffer()
+{
+}
+
+void CollisionEventBuffer::Reserve(int count)
+{
+	l_buffers[0].reserve(count);
+	l_buffers[1].reserve(count);
+}
+
+void CollisionEventBuffer::RecordStep(const CollisionManager& collisionManager)
+{
+	int writeIndex = 1 - m_readIndex;
+	int step = m_steps[writeIndex]++;
+
+	if (collisionManager.NumContactResets() != m_contactResets) {
+		m_contactResets = collisionManager.NumContactResets();
+		MarkReset();
+	}
+
+	for (const CollisionEvent& collisionEvent : collisionManager.GetEvents()) {
+		CollisionRecord record;
+		record.type = collisionEvent.type;
+		record.step = step;
+		record.entityA = collisionEvent.colliderA->GetEntityId();
+		record.entityB = collisionEvent.colliderB->GetEntityId();
+		record.colliderA = collisionEvent.colliderA;
+		record.colliderB = collisionEvent.colliderB;
+		record.normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		record.point = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		record.impulse = 0.0f;
+		record.trigger = collisionEvent.trigger;
+
+		const ContactManifold* manifold = collisionEvent.manifold;
+		if (manifold && manifold->numPoints > 0) {
+			record.normal = manifold->normal;
+
+			//Skipped manifolds still hold the impulses from when they were last solved
+			XMVECTOR point = XMVectorZero();
+			for (int i = 0; i < manifold->numPoints; i++) {
+				point = XMVectorAdd(point, XMLoadFloat3(&manifold->points[i].position));
+				if (manifold->solved) {
+					record.impulse += manifold->points[i].normalImpulse;
+				}
+			}
+			XMStoreFloat3(&record.point, XMVectorScale(point, 1.0f / manifold->numPoints));
+		}
+
+		Add(record);
+	}
+}
+
+void CollisionEventBuffer::Add(const CollisionRecord& record)
+{
+	std::vector<CollisionRecord>& buffer = l_buffers[1 - m_readIndex];
+	if (buffer.size() == buffer.capacity()) {
+		m_numGrowths++;
+	}
+	buffer.push_back(record);
+}
+
+void CollisionEventBuffer::Swap()
+{
+	m_readIndex = 1 - m_readIndex;
+
+	//Whatever was read last frame is done with, clear keeps the capacity
+	int writeIndex = 1 - m_readIndex;
+	l_buffers[writeIndex].clear();
+	m_reset[writeIndex] = false;
+	m_steps[writeIndex] = 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "CollisionManager.h"
+
+#include <DirectXMath.h>
+#include <vector>
+
+//One pair's contact state change (or lack of one) from one physics step, with what the solver did about it
+struct CollisionRecord
+{
+	//Begin is enter, persist is stay and end is exit
+	eCollisionEventType type;
+	//Which step of the frame it came from, 0 is the first
+	int step;
+	//Index in the entity manager of each collider's entity, -1 for colliders that aren't on one
+	int entityA;
+	int entityB;
+	Collider* colliderA;
+	Collider* colliderB;
+	//From a towards b, zero for exits and trigger pairs
+	DirectX::XMFLOAT3 normal;
+	//Middle of the contact points
+	DirectX::XMFLOAT3 point;
+	//Total normal impulse the solver applied to the pair that step, 0 if it wasn't solved (both sides
+	//static or asleep, or a joint between them)
+	float impulse;
+	bool trigger;
+};
+
+//Every collision record from the physics steps of one frame. Steps write into one buffer while
+//gameplay reads the other, Swap hands the written one over and starts writing into the old one.
+//The buffers are cleared without freeing, so once they've grown to fit the busiest frame there
+//are no more allocations. Colliders in a record are only safe to use until colliders are next removed
+class CollisionEventBuffer
+{
+private:
+	std::vector<CollisionRecord> l_buffers[2];
+	//Buffer gameplay reads from, the other one is written
+	int m_readIndex;
+	//Set when contacts were dropped or replaced without sending exits, for each buffer
+	bool m_reset[2];
+	int m_steps[2];
+	//Collision manager's reset count as of the last recorded step
+	int m_contactResets;
+	//Times either buffer had to grow, stays put once the frame sizes settle
+	int m_numGrowths;
+
+public:
+	CollisionEventBuffer();
+	~CollisionEventBuffer();
+
+	//Room in both buffers up front, so a known scene never allocates
+	void Reserve(int count);
+
+	//Records every event from the collision manager's last update as part of the current step.
+	//Run after the contact solve so the manifolds hold this step's impulses
+	void RecordStep(const CollisionManager& collisionManager);
+	void Add(const CollisionRecord& record);
+	//Readers should forget anything they worked out from earlier records
+	void MarkReset() { m_reset[1 - m_readIndex] = true; }
+
+	//Publishes what's been written since the last swap, and clears the other buffer to write into
+	void Swap();
+
+	const std::vector<CollisionRecord>& GetRecords() const { return l_buffers[m_readIndex]; }
+	int NumRecords() const { return static_cast<int>(l_buffers[m_readIndex].size()); }
+	//Steps that went into the published records
+	int NumSteps() const { return m_steps[m_readIndex]; }
+	//Contact counts were fixed up without records (a broadphase switch or a snapshot restore)
+	//since the previous publish, anything tracking enters and exits should start over
+	bool WasReset() const { return m_reset[m_readIndex]; }
+	int NumGrowths() const { return m_numGrowths; }
+	int GetCapacity() const { return static_cast<int>(l_buffers[0].capacity() + l_buffers[1].capacity()); }
+};
@@ -0,0 +1,644 @@
+#include "CollisionManager.h"
+#include "DynamicAABBTree.h"
+#include "SceneQuery.h"
+#include "SpatialHashGrid.h"
+#include "SweepAndPrune.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+std::shared_ptr<CollisionManager> CollisionManager::s_instance;
+
+namespace
+{
+	//How far apart manifold points can be and still be kept, so contacts don't flicker as resting bodies settle
+	const float CONTACT_MARGIN = 0.02f;
+
+	//Proxies are padded by half the margin each, so a pair the broadphase reports can be up to the
+	//whole margin apart and still get speculative contacts
+	AABB GetProxyBounds(const Collider* collider)
+	{
+		const AABB& bounds = collider->GetWorldAABB();
+		float padding = CONTACT_MARGIN * 0.5f;
+		return AABB(
+			XMFLOAT3(bounds.min.x - padding, bounds.min.y - padding, bounds.min.z - padding),
+			XMFLOAT3(bounds.max.x + padding, bounds.max.y + padding, bounds.max.z + padding));
+	}
+
+	bool PairLess(const BroadphasePair& a, const BroadphasePair& b)
+	{
+		return a.proxyA < b.proxyA || (a.proxyA == b.proxyA && a.proxyB < b.proxyB);
+	}
+
+	//Same order as PairLess, colliderA always has the smaller proxy id
+	bool ManifoldLess(const ContactManifold* a, const ContactManifold* b)
+	{
+		BroadphasePair pairA = { a->colliderA->GetProxyId(), a->colliderB->GetProxyId() };
+		BroadphasePair pairB = { b->colliderA->GetProxyId(), b->colliderB->GetProxyId() };
+		return PairLess(pairA, pairB);
+	}
+}
+
+CollisionManager::CollisionManager()
+	: m_broadphase(CreateBroadphase(BROADPHASE_AABB_TREE)),
+	m_broadphaseType(BROADPHASE_AABB_TREE),
+	m_useBatchedSAT(true),
+	m_useConvexHulls(true),
+	m_narrowphaseUpdate(0),
+	m_numContactPoints(0),
+	m_deterministic(false),
+	m_satTests(0),
+	m_satCachedAxisTests(0),
+	m_satCacheEarlyOuts(0),
+	m_gjkTests(0),
+	m_sleepingPairs(0),
+	m_filteredPairs(0),
+	m_triggerPairs(0),
+	m_contactResets(0)
+{
+}
+
+//Not needed atm
+CollisionManager::~CollisionManager()
+{
+}
+
+std::shared_ptr<CollisionManager> CollisionManager::GetInstance()
+{
+	if (!s_instance.get()) {
+		std::shared_ptr<CollisionManager> newInstance(new CollisionManager());
+		s_instance = newInstance;
+	}
+
+	return s_instance;
+}
+
+std::unique_ptr<Broadphase> CollisionManager::CreateBroadphase(eBroadphaseType type)
+{
+	switch (type)
+	{
+	case BROADPHASE_SWEEP_AND_PRUNE:
+		return std::unique_ptr<Broadphase>(new SweepAndPrune());
+	case BROADPHASE_SPATIAL_HASH:
+		return std::unique_ptr<Broadphase>(new SpatialHashGrid());
+	case BROADPHASE_AABB_TREE:
+	default:
+		return std::unique_ptr<Broadphase>(new DynamicAABBTree());
+	}
+}
+
+unsigned long long CollisionManager::PairKey(const BroadphasePair& pair)
+{
+	return (static_cast<unsigned long long>(pair.proxyA) << 32) | static_cast<unsigned int>(pair.proxyB);
+}
+
+CollisionManager::PairCacheEntry& CollisionManager::GetPairCacheEntry(const BroadphasePair& pair)
+{
+	auto inserted = m_pairCache.insert(std::make_pair(PairKey(pair), PairCacheEntry()));
+	PairCacheEntry& entry = inserted.first->second;
+	if (inserted.second) {
+		entry.separatingAxis = SAT_NONE;
+	}
+
+	entry.lastUpdate = m_narrowphaseUpdate;
+	return entry;
+}
+
+void CollisionManager::PrunePairCache()
+{
+	//Everything left from before this update belongs to pairs the broadphase dropped
+	if (m_pairCache.size() <= static_cast<size_t>(m_satTests + m_sleepingPairs)) {
+		return;
+	}
+
+	for (auto it = m_pairCache.begin(); it != m_pairCache.end();) {
+		if (it->second.lastUpdate != m_narrowphaseUpdate) {
+			it = m_pairCache.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void CollisionManager::AddCollider(std::shared_ptr<Collider> collider)
+{
+	//Already registered
+	if (!collider || collider->GetProxyId() != -1) {
+		return;
+	}
+
+	collider->UpdateBounds();
+	collider->SetProxyId(m_broadphase->CreateProxy(GetProxyBounds(collider.get()), collider.get()));
+	l_colliders.push_back(collider);
+	SceneQuery::GetInstance()->AddCollider(collider.get());
+}
+
+void CollisionManager::RemoveCollider(std::shared_ptr<Collider> collider)
+{
+	if (!collider || collider->GetProxyId() == -1) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < l_colliders.size(); i++) {
+		if (l_colliders[i] == collider) {
+			//Order doesn't matter so swap with the back to avoid shifting everything
+			l_colliders[i] = l_colliders.back();
+			l_colliders.pop_back();
+			break;
+		}
+	}
+
+	//Forget any contacts it had, its proxy id is about to be reused
+	int proxyId = collider->GetProxyId();
+	for (int i = static_cast<int>(l_collidingPairs.size()) - 1; i >= 0; i--) {
+		const BroadphasePair& pair = l_collidingPairs[i];
+		if (pair.proxyA == proxyId || pair.proxyB == proxyId) {
+			GetPairCollider(pair.proxyA == proxyId ? pair.proxyB : pair.proxyA)->RemoveContact();
+			collider->RemoveContact();
+			l_collidingPairs.erase(l_collidingPairs.begin() + i);
+		}
+	}
+
+	//Its cached pairs go too, the next collider given this id must not pick up their axis or manifold
+	for (auto it = m_pairCache.begin(); it != m_pairCache.end();) {
+		int proxyA = static_cast<int>(it->first >> 32);
+		int proxyB = static_cast<int>(it->first & 0xffffffffu);
+		if (proxyA == proxyId || proxyB == proxyId) {
+			//Nothing from this update can be left pointing at the manifold
+			ContactManifold* manifold = &it->second.manifold;
+			auto listed = std::find(l_manifolds.begin(), l_manifolds.end(), manifold);
+			if (listed != l_manifolds.end()) {
+				m_numContactPoints -= manifold->numPoints;
+				l_manifolds.erase(listed);
+			}
+			for (CollisionEvent& collisionEvent : l_events) {
+				if (collisionEvent.manifold == manifold) {
+					collisionEvent.manifold = nullptr;
+				}
+			}
+			it = m_pairCache.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	m_broadphase->DestroyProxy(proxyId);
+	collider->SetProxyId(-1);
+	SceneQuery::GetInstance()->RemoveCollider(collider.get());
+}
+
+void CollisionManager::UpdateCollisions()
+{
+	UpdateBroadphase();
+	RunNarrowphase();
+	UpdateEvents();
+	SceneQuery::GetInstance()->MarkBoundsDirty();
+}
+
+void CollisionManager::QueryAABB(const AABB& aabb, std::vector<Collider*>& outColliders)
+{
+	m_broadphase->QueryAABB(aabb, l_queryProxies);
+
+	outColliders.clear();
+	for (int proxyId : l_queryProxies) {
+		outColliders.push_back(GetPairCollider(proxyId));
+	}
+}
+
+void CollisionManager::SetBroadphaseType(eBroadphaseType type)
+{
+	if (type == m_broadphaseType) {
+		return;
+	}
+
+	ClearContacts();
+	l_candidatePairs.clear();
+
+	m_broadphase = CreateBroadphase(type);
+	m_broadphaseType = type;
+
+	for (auto& collider : l_colliders) {
+		collider->SetProxyId(m_broadphase->CreateProxy(GetProxyBounds(collider.get()), collider.get()));
+		//Sleeping pairs are only carried over if they were touching last update, which was just forgotten
+		collider->SetSleeping(false);
+	}
+}
+
+void CollisionManager::ClearContacts()
+{
+	for (auto& pair : l_collidingPairs) {
+		GetPairCollider(pair.proxyA)->RemoveContact();
+		GetPairCollider(pair.proxyB)->RemoveContact();
+	}
+
+	l_collidingPairs.clear();
+	l_prevCollidingPairs.clear();
+	l_events.clear();
+	l_manifolds.clear();
+	m_numContactPoints = 0;
+	m_pairCache.clear();
+	m_contactResets++;
+}
+
+void CollisionManager::UpdateBroadphase()
+{
+	for (auto& collider : l_colliders) {
+		//Hasn't moved, its bounds and proxy are still right
+		if (collider->IsSleeping() || !collider->BoundsOutOfDate()) {
+			continue;
+		}
+
+		XMFLOAT3 oldCenter = collider->GetCenterPoint();
+		collider->UpdateBounds();
+		XMFLOAT3 newCenter = collider->GetCenterPoint();
+
+		XMFLOAT3 displacement = XMFLOAT3(newCenter.x - oldCenter.x, newCenter.y - oldCenter.y, newCenter.z - oldCenter.z);
+		m_broadphase->MoveProxy(collider->GetProxyId(), GetProxyBounds(collider.get()), displacement);
+	}
+
+	m_broadphase->ComputePairs(l_candidatePairs);
+}
+
+void CollisionManager::RunNarrowphase()
+{
+	l_prevCollidingPairs.swap(l_collidingPairs);
+	l_collidingPairs.clear();
+	l_narrowphasePairs.clear();
+	l_narrowphaseCacheEntries.clear();
+	l_manifolds.clear();
+	m_satBatch.Clear();
+
+	m_narrowphaseUpdate++;
+	m_satTests = 0;
+	m_satCachedAxisTests = 0;
+	m_satCacheEarlyOuts = 0;
+	m_gjkTests = 0;
+	m_sleepingPairs = 0;
+	m_filteredPairs = 0;
+	m_triggerPairs = 0;
+	m_numContactPoints = 0;
+
+	for (auto& pair : l_candidatePairs) {
+		Collider* colliderA = GetPairCollider(pair.proxyA);
+		Collider* colliderB = GetPairCollider(pair.proxyB);
+
+		//Layers that never collide, dropped before the pair touches its bounds or the pair cache
+		if (!Collider::ShouldCollide(colliderA, colliderB)) {
+			m_filteredPairs++;
+			continue;
+		}
+
+		//Neither has moved, so the pair is touching exactly when it was last update
+		if (colliderA->IsSleeping() && colliderB->IsSleeping()) {
+			KeepSleepingPair(pair);
+			continue;
+		}
+
+		//Fat boxes overlapping doesn't mean the tight ones do, or that they're even within the margin
+		if (!GetProxyBounds(colliderA).Overlaps(GetProxyBounds(colliderB))) {
+			continue;
+		}
+
+		PairCacheEntry& cacheEntry = GetPairCacheEntry(pair);
+		if (!colliderA->GetWorldAABB().Overlaps(colliderB->GetWorldAABB())) {
+			AddSpeculativePair(pair, cacheEntry);
+			continue;
+		}
+
+		m_satTests++;
+		int cachedAxis = cacheEntry.separatingAxis;
+		if (cachedAxis != SAT_NONE) {
+			m_satCachedAxisTests++;
+		}
+
+		if (!m_useBatchedSAT) {
+			PenetrationInfo hullPenetration;
+			bool colliding = colliderA->CheckForCollision(colliderB, cacheEntry.separatingAxis);
+			//The full test can't come back with the cached axis unless the early out took it
+			if (cachedAxis != SAT_NONE && cacheEntry.separatingAxis == cachedAxis) {
+				m_satCacheEarlyOuts++;
+			}
+
+			if (!colliding) {
+				AddSpeculativePair(pair, cacheEntry);
+			}
+			else if (CheckHulls(colliderA, colliderB, hullPenetration)) {
+				AddCollidingPair(pair, cacheEntry, hullPenetration);
+			}
+			else {
+				//Apart now, so a later contact mustn't warm start from these impulses
+				cacheEntry.manifold.numPoints = 0;
+			}
+			continue;
+		}
+
+		//Still further apart than the margin along the same axis, no need to put it through the batch
+		if (cachedAxis != SAT_NONE && OBB::IsSeparatingAxis(colliderA->GetWorldOBB(), colliderB->GetWorldOBB(), cachedAxis, CONTACT_MARGIN)) {
+			cacheEntry.manifold.numPoints = 0;
+			m_satCacheEarlyOuts++;
+			continue;
+		}
+
+		l_narrowphasePairs.push_back(pair);
+		l_narrowphaseCacheEntries.push_back(&cacheEntry);
+		m_satBatch.AddPair(colliderA->GetWorldOBB(), colliderB->GetWorldOBB());
+	}
+
+	if (m_useBatchedSAT) {
+		PenetrationInfo hullPenetration;
+		m_satBatch.Test(l_satHitMask, l_satAxes);
+		for (int i = 0; i < static_cast<int>(l_narrowphasePairs.size()); i++) {
+			l_narrowphaseCacheEntries[i]->separatingAxis = l_satAxes[i];
+			const BroadphasePair& pair = l_narrowphasePairs[i];
+			if (!OBBPairBatch::IsHit(l_satHitMask, i)) {
+				AddSpeculativePair(pair, *l_narrowphaseCacheEntries[i]);
+			}
+			else if (CheckHulls(GetPairCollider(pair.proxyA), GetPairCollider(pair.proxyB), hullPenetration)) {
+				AddCollidingPair(pair, *l_narrowphaseCacheEntries[i], hullPenetration);
+			}
+			else {
+				l_narrowphaseCacheEntries[i]->manifold.numPoints = 0;
+			}
+		}
+	}
+
+	PrunePairCache();
+
+	//Broadphases don't report pairs in any particular order
+	std::sort(l_collidingPairs.begin(), l_collidingPairs.end(), PairLess);
+	if (m_deterministic) {
+		std::sort(l_manifolds.begin(), l_manifolds.end(), ManifoldLess);
+	}
+}
+
+bool CollisionManager::CheckHulls(Collider* colliderA, Collider* colliderB, PenetrationInfo& outPenetration)
+{
+	outPenetration.depth = 0.0f;
+	if (!m_useConvexHulls || !colliderA->HasConvexHull() || !colliderB->HasConvexHull()) {
+		return true;
+	}
+
+	m_gjkTests++;
+	return colliderA->CheckGJKCollision(colliderB, &outPenetration);
+}
+
+void CollisionManager::AddCollidingPair(const BroadphasePair& pair, PairCacheEntry& cacheEntry, const PenetrationInfo& hullPenetration)
+{
+	l_collidingPairs.push_back(pair);
+
+	Collider* colliderA = GetPairCollider(pair.proxyA);
+	Collider* colliderB = GetPairCollider(pair.proxyB);
+
+	//Triggers only need to know they're overlapping, there's nothing for the solver to push apart
+	if (colliderA->IsTrigger() || colliderB->IsTrigger()) {
+		cacheEntry.manifold.numPoints = 0;
+		m_triggerPairs++;
+		return;
+	}
+
+	UpdateManifold(colliderA, colliderB, cacheEntry, hullPenetration.depth > 0.0f ? &hullPenetration : nullptr);
+}
+
+void CollisionManager::AddSpeculativePair(const BroadphasePair& pair, PairCacheEntry& cacheEntry)
+{
+	Collider* colliderA = GetPairCollider(pair.proxyA);
+	Collider* colliderB = GetPairCollider(pair.proxyB);
+
+	//Nothing to stop for triggers. Hulls are inside their boxes, so the box contacts can stop a hull pair a
+	//little early but never let it through
+	if (colliderA->IsTrigger() || colliderB->IsTrigger()) {
+		cacheEntry.manifold.numPoints = 0;
+		return;
+	}
+
+	UpdateManifold(colliderA, colliderB, cacheEntry);
+}
+
+void CollisionManager::UpdateManifold(Collider* colliderA, Collider* colliderB, PairCacheEntry& cacheEntry, const PenetrationInfo* hullPenetration)
+{
+	//Contact points come from the oriented boxes. Hulls sit inside their boxes, so when they overlap
+	//EPA's normal and depth are the closer fit
+	ContactManifold manifold;
+	if (!ContactManifold::CollideBoxes(colliderA->GetWorldOBB(), colliderB->GetWorldOBB(), manifold, CONTACT_MARGIN)) {
+		cacheEntry.manifold.numPoints = 0;
+		return;
+	}
+
+	if (hullPenetration) {
+		manifold.ApplyPenetration(hullPenetration->normal, hullPenetration->depth, CONTACT_MARGIN);
+	}
+
+	//Keep the impulses of any points that are still there from last update
+	if (cacheEntry.manifold.colliderA == colliderA && cacheEntry.manifold.colliderB == colliderB) {
+		manifold.WarmStart(cacheEntry.manifold);
+	}
+
+	manifold.colliderA = colliderA;
+	manifold.colliderB = colliderB;
+	cacheEntry.manifold = manifold;
+
+	l_manifolds.push_back(&cacheEntry.manifold);
+	m_numContactPoints += manifold.numPoints;
+}
+
+void CollisionManager::KeepSleepingPair(const BroadphasePair& pair)
+{
+	if (!std::binary_search(l_prevCollidingPairs.begin(), l_prevCollidingPairs.end(), pair, PairLess)) {
+		return;
+	}
+
+	l_collidingPairs.push_back(pair);
+
+	//Marks the entry as used so the prune leaves it, the manifold and its impulses are kept as they were
+	PairCacheEntry& cacheEntry = GetPairCacheEntry(pair);
+	if (GetPairCollider(pair.proxyA)->IsTrigger() || GetPairCollider(pair.proxyB)->IsTrigger()) {
+		m_triggerPairs++;
+	}
+	else if (cacheEntry.manifold.numPoints > 0) {
+		l_manifolds.push_back(&cacheEntry.manifold);
+		m_numContactPoints += cacheEntry.manifold.numPoints;
+	}
+	m_sleepingPairs++;
+}
+
+void CollisionManager::UpdateEvents()
+{
+	l_events.clear();
+
+	//Both lists are sorted so a single walk finds what started, continued and stopped
+	unsigned int curr = 0;
+	unsigned int prev = 0;
+	while (curr < l_collidingPairs.size() || prev < l_prevCollidingPairs.size()) {
+		CollisionEvent collisionEvent;
+		const BroadphasePair* pair;
+
+		if (prev >= l_prevCollidingPairs.size() ||
+			(curr < l_collidingPairs.size() && PairLess(l_collidingPairs[curr], l_prevCollidingPairs[prev]))) {
+			pair = &l_collidingPairs[curr++];
+			collisionEvent.type = COLLISION_BEGIN;
+		}
+		else if (curr >= l_collidingPairs.size() || PairLess(l_prevCollidingPairs[prev], l_collidingPairs[curr])) {
+			pair = &l_prevCollidingPairs[prev++];
+			collisionEvent.type = COLLISION_END;
+		}
+		else {
+			pair = &l_collidingPairs[curr++];
+			prev++;
+			collisionEvent.type = COLLISION_PERSIST;
+		}
+
+		collisionEvent.colliderA = GetPairCollider(pair->proxyA);
+		collisionEvent.colliderB = GetPairCollider(pair->proxyB);
+		collisionEvent.trigger = collisionEvent.colliderA->IsTrigger() || collisionEvent.colliderB->IsTrigger();
+		collisionEvent.manifold = nullptr;
+
+		if (collisionEvent.type != COLLISION_END) {
+			auto it = m_pairCache.find(PairKey(*pair));
+			if (it != m_pairCache.end() && it->second.manifold.numPoints > 0) {
+				collisionEvent.manifold = &it->second.manifold;
+			}
+		}
+
+		if (collisionEvent.type == COLLISION_BEGIN) {
+			collisionEvent.colliderA->AddContact();
+			collisionEvent.colliderB->AddContact();
+		}
+		else if (collisionEvent.type == COLLISION_END) {
+			collisionEvent.colliderA->RemoveContact();
+			collisionEvent.colliderB->RemoveContact();
+		}
+
+		l_events.push_back(collisionEvent);
+	}
+}
+
+void CollisionManager::SaveState(PhysicsSnapshot& snapshot) const
+{
+	//Everything below is keyed by proxy id, a restore has to find the same colliders on the same ids
+	std::unordered_map<const Collider*, int> proxyIds;
+	snapshot.Write(static_cast<int>(l_colliders.size()));
+	for (auto& collider : l_colliders) {
+		snapshot.Write(collider->GetProxyId());
+		proxyIds[collider.get()] = collider->GetProxyId();
+	}
+
+	snapshot.Write(m_narrowphaseUpdate);
+	snapshot.Write(static_cast<int>(l_collidingPairs.size()));
+	snapshot.WriteArray(l_collidingPairs.data(), static_cast<int>(l_collidingPairs.size()));
+
+	//The map's own order depends on how it got there, not just what's in it
+	std::vector<unsigned long long> keys;
+	keys.reserve(m_pairCache.size());
+	for (auto& entry : m_pairCache) {
+		keys.push_back(entry.first);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	snapshot.Write(static_cast<int>(keys.size()));
+	for (unsigned long long key : keys) {
+		const PairCacheEntry& entry = m_pairCache.at(key);
+		snapshot.Write(key);
+		snapshot.Write(entry.separatingAxis);
+		snapshot.Write(entry.lastUpdate);
+		WriteManifold(snapshot, entry.manifold, proxyIds);
+	}
+}
+
+bool CollisionManager::RestoreState(PhysicsSnapshot::Reader& reader)
+{
+	int colliderCount;
+	if (!reader.Read(colliderCount) || colliderCount != static_cast<int>(l_colliders.size())) {
+		return false;
+	}
+	for (auto& collider : l_colliders) {
+		int proxyId;
+		if (!reader.Read(proxyId) || proxyId != collider->GetProxyId()) {
+			return false;
+		}
+	}
+
+	unsigned int narrowphaseUpdate;
+	int pairCount;
+	if (!reader.Read(narrowphaseUpdate) || !reader.Read(pairCount) || pairCount < 0) {
+		return false;
+	}
+
+	std::vector<BroadphasePair> collidingPairs(pairCount);
+	int entryCount;
+	if (!reader.ReadArray(collidingPairs.data(), pairCount) || !reader.Read(entryCount) || entryCount < 0) {
+		return false;
+	}
+
+	std::unordered_map<unsigned long long, PairCacheEntry> pairCache;
+	for (int i = 0; i < entryCount; i++) {
+		unsigned long long key;
+		PairCacheEntry entry;
+		if (!reader.Read(key) || !reader.Read(entry.separatingAxis) || !reader.Read(entry.lastUpdate) || !ReadManifold(reader, entry.manifold)) {
+			return false;
+		}
+		pairCache[key] = entry;
+	}
+
+	//All read, nothing from here on can fail
+	ClearContacts();
+	m_pairCache.swap(pairCache);
+	l_collidingPairs.swap(collidingPairs);
+	m_narrowphaseUpdate = narrowphaseUpdate;
+
+	for (auto& pair : l_collidingPairs) {
+		GetPairCollider(pair.proxyA)->AddContact();
+		GetPairCollider(pair.proxyB)->AddContact();
+
+		auto it = m_pairCache.find(PairKey(pair));
+		if (it != m_pairCache.end() && it->second.manifold.numPoints > 0) {
+			l_manifolds.push_back(&it->second.manifold);
+			m_numContactPoints += it->second.manifold.numPoints;
+		}
+	}
+
+	return true;
+}
+
+void CollisionManager::RefreshBounds()
+{
+	XMFLOAT3 noDisplacement = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	for (auto& collider : l_colliders) {
+		collider->UpdateBounds();
+		m_broadphase->MoveProxy(collider->GetProxyId(), GetProxyBounds(collider.get()), noDisplacement);
+	}
+	SceneQuery::GetInstance()->MarkBoundsDirty();
+}
+
+void CollisionManager::WriteManifold(PhysicsSnapshot& snapshot, const ContactManifold& manifold, const std::unordered_map<const Collider*, int>& proxyIds)
+{
+	auto itA = proxyIds.find(manifold.colliderA);
+	auto itB = proxyIds.find(manifold.colliderB);
+	snapshot.Write(itA != proxyIds.end() ? itA->second : -1);
+	snapshot.Write(itB != proxyIds.end() ? itB->second : -1);
+
+	snapshot.Write(manifold.normal);
+	snapshot.WriteArray(manifold.tangents, 2);
+	snapshot.Write(manifold.numPoints);
+	snapshot.WriteArray(manifold.points, manifold.numPoints);
+}
+
+bool CollisionManager::ReadManifold(PhysicsSnapshot::Reader& reader, ContactManifold& outManifold) const
+{
+	int proxyA;
+	int proxyB;
+	if (!reader.Read(proxyA) || !reader.Read(proxyB) ||
+		!reader.Read(outManifold.normal) || !reader.ReadArray(outManifold.tangents, 2) || !reader.Read(outManifold.numPoints)) {
+		return false;
+	}
+	if (outManifold.numPoints < 0 || outManifold.numPoints > ContactManifold::MAX_POINTS) {
+		return false;
+	}
+
+	//Anything that was stale stays unmatched, warm starting only checks the pointers
+	outManifold.colliderA = proxyA >= 0 ? GetPairCollider(proxyA) : nullptr;
+	outManifold.colliderB = proxyB >= 0 ? GetPairCollider(proxyB) : nullptr;
+	return reader.ReadArray(outManifold.points, outManifold.numPoints);
+}
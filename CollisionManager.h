@@ -0,0 +1,209 @@
+#pragma once
+#include "Broadphase.h"
+#include "Collider.h"
+#include "ContactManifold.h"
+#include "OBBPairBatch.h"
+#include "PhysicsSnapshot.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+enum eCollisionEventType
+{
+	COLLISION_BEGIN = 0,
+	COLLISION_PERSIST,
+	COLLISION_END,
+};
+
+//Change in contact state between two colliders since the last update
+struct CollisionEvent
+{
+	eCollisionEventType type;
+	Collider* colliderA;
+	Collider* colliderB;
+	//Either collider is a trigger, the pair overlaps but has no contacts
+	bool trigger;
+	//The pair's contacts for begin and persist, null for end and for pairs without any points
+	const ContactManifold* manifold;
+};
+
+//Owns every registered collider and finds which ones are touching each update.
+//A broadphase narrows the candidates down before SAT is run, so the cost is no
+//longer quadratic in the number of colliders. Which broadphase is used can be
+//swapped at runtime, contacts are diffed against the last update and reported
+//as begin/persist/end events. Every touching pair also gets a contact manifold.
+//Sleeping colliders aren't moved in the broadphase, and a pair of them keeps
+//whatever it was last update without being tested. Pairs whose layers don't
+//collide are thrown out before anything else is looked at, and pairs with a
+//trigger get events but no manifold
+class CollisionManager
+{
+private:
+	static std::shared_ptr<CollisionManager> s_instance;
+
+	std::vector<std::shared_ptr<Collider>> l_colliders;
+	std::unique_ptr<Broadphase> m_broadphase;
+	eBroadphaseType m_broadphaseType;
+
+	//Candidate pairs from the last broadphase pass
+	std::vector<BroadphasePair> l_candidatePairs;
+
+	//Pairs that passed the narrowphase this update and last update, both sorted by proxy ids
+	std::vector<BroadphasePair> l_collidingPairs;
+	std::vector<BroadphasePair> l_prevCollidingPairs;
+
+	//Candidates whose tight boxes overlap, SAT is run on all of them at once
+	bool m_useBatchedSAT;
+	//Pairs whose boxes overlap are checked again with GJK on the meshes' convex hulls
+	bool m_useConvexHulls;
+	OBBPairBatch m_satBatch;
+	std::vector<BroadphasePair> l_narrowphasePairs;
+	std::vector<unsigned int> l_satHitMask;
+	std::vector<unsigned char> l_satAxes;
+
+	//What's remembered about each pair that reaches SAT between updates, keyed by proxy ids.
+	//Pairs that stay apart are nearly always split by the same axis so it gets tried first,
+	//pairs that stay touching keep their manifold so the solver's impulses carry over
+	struct PairCacheEntry
+	{
+		int separatingAxis;
+		unsigned int lastUpdate;
+		ContactManifold manifold;
+	};
+	std::unordered_map<unsigned long long, PairCacheEntry> m_pairCache;
+	//Cache entry for each pair in the SAT batch, so the batch results can be written back
+	std::vector<PairCacheEntry*> l_narrowphaseCacheEntries;
+	unsigned int m_narrowphaseUpdate;
+
+	//Manifolds for every colliding pair this update, they live in the pair cache
+	std::vector<ContactManifold*> l_manifolds;
+	int m_numContactPoints;
+	//Manifolds are sorted by proxy ids instead of left in the order the broadphase found the pairs,
+	//so the solver sees them the same way no matter how the broadphase's insides ended up
+	bool m_deterministic;
+
+	//Stats from the last narrowphase
+	int m_satTests;
+	int m_satCachedAxisTests;
+	int m_satCacheEarlyOuts;
+	int m_gjkTests;
+	int m_sleepingPairs;
+	int m_filteredPairs;
+	int m_triggerPairs;
+	//Times the contacts were thrown out or replaced without events
+	int m_contactResets;
+
+	static unsigned long long PairKey(const BroadphasePair& pair);
+	PairCacheEntry& GetPairCacheEntry(const BroadphasePair& pair);
+	void PrunePairCache();
+
+	//Final say on a pair SAT found overlapping. outPenetration gets how far the hulls overlap from EPA,
+	//or a depth of 0 when they weren't tested or EPA couldn't measure it
+	bool CheckHulls(Collider* colliderA, Collider* colliderB, PenetrationInfo& outPenetration);
+	//Records a pair as touching and builds its contact manifold, warm started from the cached one
+	void AddCollidingPair(const BroadphasePair& pair, PairCacheEntry& cacheEntry, const PenetrationInfo& hullPenetration);
+	//Pair that's apart but within the contact margin. Gets a manifold for the solver so it can't close
+	//the gap in one step, but doesn't count as touching for events
+	void AddSpeculativePair(const BroadphasePair& pair, PairCacheEntry& cacheEntry);
+	//Contacts between the pair's oriented boxes into the cache entry, handed to the solver if there are any.
+	//With a hull penetration the normal and depth come from that instead
+	void UpdateManifold(Collider* colliderA, Collider* colliderB, PairCacheEntry& cacheEntry, const PenetrationInfo* hullPenetration = nullptr);
+	//Carries over a pair between two sleeping colliders without testing it
+	void KeepSleepingPair(const BroadphasePair& pair);
+
+	std::vector<CollisionEvent> l_events;
+
+	//Scratch for QueryAABB
+	std::vector<int> l_queryProxies;
+
+	CollisionManager();
+
+	static std::unique_ptr<Broadphase> CreateBroadphase(eBroadphaseType type);
+
+	void UpdateBroadphase();
+	void RunNarrowphase();
+	void UpdateEvents();
+
+	//Drops every contact without sending end events, used when proxy ids stop meaning anything
+	void ClearContacts();
+
+	//Colliders are written as proxy ids, looked up in proxyIds since a stale manifold can point at one that's gone
+	static void WriteManifold(PhysicsSnapshot& snapshot, const ContactManifold& manifold, const std::unordered_map<const Collider*, int>& proxyIds);
+	bool ReadManifold(PhysicsSnapshot::Reader& reader, ContactManifold& outManifold) const;
+
+public:
+	~CollisionManager();
+
+	static std::shared_ptr<CollisionManager> GetInstance();
+
+	void AddCollider(std::shared_ptr<Collider> collider);
+	void RemoveCollider(std::shared_ptr<Collider> collider);
+
+	//Refreshes collider bounds, finds candidate pairs, runs SAT on them and builds the events
+	void UpdateCollisions();
+
+	//Every collider whose broadphase box overlaps aabb, as of the last UpdateCollisions.
+	//Raycasts, sweeps and exact overlaps go through SceneQuery instead
+	void QueryAABB(const AABB& aabb, std::vector<Collider*>& outColliders);
+
+	//Moves every collider over to a new broadphase, contacts start over from scratch
+	void SetBroadphaseType(eBroadphaseType type);
+	eBroadphaseType GetBroadphaseType() const { return m_broadphaseType; }
+	const char* GetBroadphaseName() const { return m_broadphase->GetName(); }
+
+	//Fixed manifold order, costs a sort per update
+	void SetDeterministic(bool deterministic) { m_deterministic = deterministic; }
+	bool IsDeterministic() const { return m_deterministic; }
+
+	//Writes the contacts and the whole pair cache, everything the next update's results depend on
+	//besides where the colliders are. Cache entries go in sorted by key so the same state always
+	//writes the same bytes
+	void SaveState(PhysicsSnapshot& snapshot) const;
+	//Puts the contacts and cache back, fails without changing anything if the colliders aren't the
+	//same ones on the same proxy ids (switching broadphase renumbers them). Contact counts are fixed
+	//up without sending any events
+	bool RestoreState(PhysicsSnapshot::Reader& reader);
+	//Updates every collider's bounds and proxy from its transform, sleeping ones included
+	void RefreshBounds();
+
+	//Batched SAT runs 4 or 8 pairs at a time with SIMD, off falls back to one Collider check per pair
+	void SetUseBatchedSAT(bool useBatchedSAT) { m_useBatchedSAT = useBatchedSAT; }
+	bool GetUseBatchedSAT() const { return m_useBatchedSAT; }
+
+	//Off treats every collider as its oriented box, which is exact for cubes but loose for anything else
+	void SetUseConvexHulls(bool useConvexHulls) { m_useConvexHulls = useConvexHulls; }
+	bool GetUseConvexHulls() const { return m_useConvexHulls; }
+
+	//Contact manifolds for every pair touching after the last UpdateCollisions call. A solver can
+	//write its impulses into the points, they're handed back next update for warm starting
+	const std::vector<ContactManifold*>& GetManifolds() const { return l_manifolds; }
+	int NumContactPoints() const { return m_numContactPoints; }
+
+	//Events from the last UpdateCollisions call
+	const std::vector<CollisionEvent>& GetEvents() const { return l_events; }
+	//Goes up whenever the contacts change without events, so anything built from the events knows to start over
+	int NumContactResets() const { return m_contactResets; }
+
+	const std::vector<BroadphasePair>& GetCandidatePairs() const { return l_candidatePairs; }
+	Collider* GetPairCollider(int proxyId) const { return static_cast<Collider*>(m_broadphase->GetUserData(proxyId)); }
+
+	int NumColliders() const { return static_cast<int>(l_colliders.size()); }
+	int NumCandidatePairs() const { return static_cast<int>(l_candidatePairs.size()); }
+	int NumCollidingPairs() const { return static_cast<int>(l_collidingPairs.size()); }
+
+	//Pairs that reached SAT last update, how many had a remembered separating axis
+	//and how many of those were still separated by it
+	int NumSATTests() const { return m_satTests; }
+	int NumSATCachedAxisTests() const { return m_satCachedAxisTests; }
+	int NumSATCacheEarlyOuts() const { return m_satCacheEarlyOuts; }
+	//Pairs that went on to GJK after their boxes overlapped
+	int NumGJKTests() const { return m_gjkTests; }
+	//Pairs skipped because both colliders were asleep
+	int NumSleepingPairs() const { return m_sleepingPairs; }
+	//Candidates dropped by the layer matrix, and touching pairs that got no contacts because of a trigger
+	int NumFilteredPairs() const { return m_filteredPairs; }
+	int NumTriggerPairs() const { return m_triggerPairs; }
+	//Fraction of pairs with a remembered axis that only needed that one axis tested
+	float GetSATCacheHitRate() const { return m_satCachedAxisTests > 0 ? static_cast<float>(m_satCacheEarlyOuts) / m_satCachedAxisTests : 0.0f; }
+};
@@ -0,0 +1,482 @@
+#include "ContactManifold.h"
+
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	//A face axis has to be this much shallower than another face axis or an edge pair to win,
+	//so the reference face doesn't flicker between two that are nearly tied
+	const float RELATIVE_TOLERANCE = 0.95f;
+	const float ABSOLUTE_TOLERANCE = 0.005f;
+	//Edge pairs closer to parallel than this are already covered by the face axes
+	const float PARALLEL_EPSILON = .001f;
+
+	//Feature ids 0-3 are the incident face's edges, 4-7 the reference face's side planes
+	const unsigned char FIRST_CLIP_FEATURE = 4;
+	const unsigned int EDGE_CONTACT_FLAG = 1u << 15;
+
+	//Points that lost their feature id can still pick up an old impulse if they're this close to where it was
+	const float WARM_START_DISTANCE = 0.05f;
+
+	//Incident face corner, plus the two edges/side planes it sits on for its feature id
+	struct ClipVertex
+	{
+		XMVECTOR position;
+		unsigned char features[2];
+	};
+
+	//At most one new vertex per side plane on a 4 sided face
+	const int MAX_CLIP_VERTICES = 8;
+
+	unsigned char CommonFeature(const ClipVertex& a, const ClipVertex& b)
+	{
+		for (int i = 0; i < 2; i++) {
+			for (int j = 0; j < 2; j++) {
+				if (a.features[i] == b.features[j]) {
+					return a.features[i];
+				}
+			}
+		}
+
+		return a.features[0];
+	}
+
+	//Sutherland-Hodgman against one plane, keeps the part where dot(normal, p) <= offset
+	int ClipPolygon(const ClipVertex* in, int count, FXMVECTOR normal, float offset, unsigned char planeFeature, ClipVertex* out)
+	{
+		int outCount = 0;
+		for (int i = 0; i < count; i++) {
+			const ClipVertex& v1 = in[i];
+			const ClipVertex& v2 = in[(i + 1) % count];
+			float d1 = XMVectorGetX(XMVector3Dot(normal, v1.position)) - offset;
+			float d2 = XMVectorGetX(XMVector3Dot(normal, v2.position)) - offset;
+
+			if (d1 <= 0.0f) {
+				out[outCount++] = v1;
+			}
+
+			if ((d1 < 0.0f && d2 > 0.0f) || (d1 > 0.0f && d2 < 0.0f)) {
+				ClipVertex& clipped = out[outCount++];
+				clipped.position = XMVectorLerp(v1.position, v2.position, d1 / (d1 - d2));
+				clipped.features[0] = CommonFeature(v1, v2);
+				clipped.features[1] = planeFeature;
+			}
+		}
+
+		return outCount;
+	}
+
+	unsigned int FaceFeatureId(int referenceFace, int incidentFace, bool referenceIsB, const ClipVertex& vertex)
+	{
+		unsigned int low = vertex.features[0] < vertex.features[1] ? vertex.features[0] : vertex.features[1];
+		unsigned int high = vertex.features[0] < vertex.features[1] ? vertex.features[1] : vertex.features[0];
+		return referenceFace | (incidentFace << 3) | ((referenceIsB ? 1u : 0u) << 6) | (low << 7) | (high << 10);
+	}
+
+	float Sign(float value)
+	{
+		return value < 0.0f ? -1.0f : 1.0f;
+	}
+
+	void CopyImpulses(const ContactPoint& from, ContactPoint& to)
+	{
+		to.normalImpulse = from.normalImpulse;
+		to.tangentImpulse[0] = from.tangentImpulse[0];
+		to.tangentImpulse[1] = from.tangentImpulse[1];
+	}
+
+	void ComputeTangents(const XMFLOAT3& normal, XMFLOAT3& outTangent1, XMFLOAT3& outTangent2)
+	{
+		//Cross with whichever world axis is furthest from the normal
+		XMVECTOR n = XMLoadFloat3(&normal);
+		XMVECTOR tangent;
+		if (fabsf(normal.x) >= 0.57735f) {
+			tangent = XMVectorSet(normal.y, -normal.x, 0.0f, 0.0f);
+		}
+		else {
+			tangent = XMVectorSet(0.0f, normal.z, -normal.y, 0.0f);
+		}
+
+		tangent = XMVector3Normalize(tangent);
+		XMStoreFloat3(&outTangent1, tangent);
+		XMStoreFloat3(&outTangent2, XMVector3Cross(n, tangent));
+	}
+
+	//Picks which points to keep when clipping left more than fit: the deepest, the one
+	//furthest from it, then whichever make the biggest area with those
+	int ReducePoints(const ContactPoint* in, int count, ContactPoint* out)
+	{
+		if (count <= ContactManifold::MAX_POINTS) {
+			for (int i = 0; i < count; i++) {
+				out[i] = in[i];
+			}
+			return count;
+		}
+
+		int chosen[ContactManifold::MAX_POINTS];
+
+		chosen[0] = 0;
+		for (int i = 1; i < count; i++) {
+			if (in[i].penetration > in[chosen[0]].penetration) {
+				chosen[0] = i;
+			}
+		}
+		XMVECTOR p0 = XMLoadFloat3(&in[chosen[0]].position);
+
+		float best = -1.0f;
+		for (int i = 0; i < count; i++) {
+			float distance = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&in[i].position) - p0));
+			if (distance > best) {
+				best = distance;
+				chosen[1] = i;
+			}
+		}
+		XMVECTOR p1 = XMLoadFloat3(&in[chosen[1]].position);
+
+		best = -1.0f;
+		for (int i = 0; i < count; i++) {
+			XMVECTOR p = XMLoadFloat3(&in[i].position);
+			float area = XMVectorGetX(XMVector3LengthSq(XMVector3Cross(p1 - p0, p - p0)));
+			if (area > best) {
+				best = area;
+				chosen[2] = i;
+			}
+		}
+		XMVECTOR p2 = XMLoadFloat3(&in[chosen[2]].position);
+
+		best = -1.0f;
+		for (int i = 0; i < count; i++) {
+			XMVECTOR p = XMLoadFloat3(&in[i].position);
+			float area = XMVectorGetX(XMVector3Length(XMVector3Cross(p0 - p, p1 - p)))
+				+ XMVectorGetX(XMVector3Length(XMVector3Cross(p1 - p, p2 - p)))
+				+ XMVectorGetX(XMVector3Length(XMVector3Cross(p2 - p, p0 - p)));
+			if (area > best && i != chosen[0] && i != chosen[1] && i != chosen[2]) {
+				best = area;
+				chosen[3] = i;
+			}
+		}
+
+		for (int i = 0; i < ContactManifold::MAX_POINTS; i++) {
+			out[i] = in[chosen[i]];
+		}
+		return ContactManifold::MAX_POINTS;
+	}
+
+	//Reference face belongs to reference, the incident face is whichever face of incident
+	//points most against it. The incident face gets clipped to the reference face's sides
+	//and everything left below the reference face (or less than margin above it) is a contact
+	bool ClipFaces(const OBB& reference, const OBB& incident, int referenceAxis, FXMVECTOR referenceNormal, bool referenceIsB, float margin, ContactManifold& outManifold)
+	{
+		XMVECTOR refCenter = XMLoadFloat3(&reference.center);
+		XMVECTOR refAxes[3] = { XMLoadFloat3(&reference.axes[0]), XMLoadFloat3(&reference.axes[1]), XMLoadFloat3(&reference.axes[2]) };
+		XMVECTOR incCenter = XMLoadFloat3(&incident.center);
+		XMVECTOR incAxes[3] = { XMLoadFloat3(&incident.axes[0]), XMLoadFloat3(&incident.axes[1]), XMLoadFloat3(&incident.axes[2]) };
+
+		float refSign = Sign(XMVectorGetX(XMVector3Dot(referenceNormal, refAxes[referenceAxis])));
+		int referenceFace = referenceAxis * 2 + (refSign > 0.0f ? 0 : 1);
+
+		int incidentAxis = 0;
+		float bestDot = -1.0f;
+		for (int i = 0; i < 3; i++) {
+			float dot = fabsf(XMVectorGetX(XMVector3Dot(incAxes[i], referenceNormal)));
+			if (dot > bestDot) {
+				bestDot = dot;
+				incidentAxis = i;
+			}
+		}
+		float incSign = -Sign(XMVectorGetX(XMVector3Dot(incAxes[incidentAxis], referenceNormal)));
+		int incidentFace = incidentAxis * 2 + (incSign > 0.0f ? 0 : 1);
+
+		//Incident face corners in order around the face, corner k sits on edges k - 1 and k
+		int u = (incidentAxis + 1) % 3;
+		int v = (incidentAxis + 2) % 3;
+		XMVECTOR faceCenter = incCenter + incAxes[incidentAxis] * (incSign * incident.halfExtents[incidentAxis]);
+		XMVECTOR uExtent = incAxes[u] * incident.halfExtents[u];
+		XMVECTOR vExtent = incAxes[v] * incident.halfExtents[v];
+
+		ClipVertex polygon[2][MAX_CLIP_VERTICES];
+		polygon[0][0].position = faceCenter + uExtent + vExtent;
+		polygon[0][1].position = faceCenter - uExtent + vExtent;
+		polygon[0][2].position = faceCenter - uExtent - vExtent;
+		polygon[0][3].position = faceCenter + uExtent - vExtent;
+		for (int k = 0; k < 4; k++) {
+			polygon[0][k].features[0] = static_cast<unsigned char>((k + 3) % 4);
+			polygon[0][k].features[1] = static_cast<unsigned char>(k);
+		}
+		int count = 4;
+
+		//Side planes of the reference face
+		int current = 0;
+		for (int side = 0; side < 2 && count > 0; side++) {
+			int axis = (referenceAxis + 1 + side) % 3;
+			float centerDot = XMVectorGetX(XMVector3Dot(refAxes[axis], refCenter));
+			float halfExtent = reference.halfExtents[axis];
+
+			count = ClipPolygon(polygon[current], count, refAxes[axis], centerDot + halfExtent,
+				static_cast<unsigned char>(FIRST_CLIP_FEATURE + side * 2), polygon[1 - current]);
+			current = 1 - current;
+			if (count == 0) {
+				break;
+			}
+
+			count = ClipPolygon(polygon[current], count, -refAxes[axis], -centerDot + halfExtent,
+				static_cast<unsigned char>(FIRST_CLIP_FEATURE + side * 2 + 1), polygon[1 - current]);
+			current = 1 - current;
+		}
+
+		float faceOffset = XMVectorGetX(XMVector3Dot(referenceNormal, refCenter)) + reference.halfExtents[referenceAxis];
+
+		ContactPoint candidates[MAX_CLIP_VERTICES];
+		int numCandidates = 0;
+		for (int i = 0; i < count; i++) {
+			const ClipVertex& vertex = polygon[current][i];
+			float depth = faceOffset - XMVectorGetX(XMVector3Dot(referenceNormal, vertex.position));
+			if (depth < -margin) {
+				continue;
+			}
+
+			ContactPoint& point = candidates[numCandidates++];
+			//Halfway between the two surfaces
+			XMStoreFloat3(&point.position, vertex.position + referenceNormal * (depth * 0.5f));
+			point.penetration = depth;
+			point.featureId = FaceFeatureId(referenceFace, incidentFace, referenceIsB, vertex);
+			point.normalImpulse = 0.0f;
+			point.tangentImpulse[0] = 0.0f;
+			point.tangentImpulse[1] = 0.0f;
+		}
+
+		outManifold.numPoints = ReducePoints(candidates, numCandidates, outManifold.points);
+		return outManifold.numPoints > 0;
+	}
+}
+
+void ContactManifold::WarmStart(const ContactManifold& previous)
+{
+	bool used[MAX_POINTS] = {};
+	bool matched[MAX_POINTS] = {};
+
+	for (int i = 0; i < numPoints; i++) {
+		for (int j = 0; j < previous.numPoints; j++) {
+			if (!used[j] && previous.points[j].featureId == points[i].featureId) {
+				CopyImpulses(previous.points[j], points[i]);
+				used[j] = true;
+				matched[i] = true;
+				break;
+			}
+		}
+	}
+
+	//Faces that line up exactly (stacked boxes) swap corners for clipped points from one
+	//update to the next, so fall back on whichever old point is closest
+	for (int i = 0; i < numPoints; i++) {
+		if (matched[i]) {
+			continue;
+		}
+
+		int closest = -1;
+		float closestDistSq = WARM_START_DISTANCE * WARM_START_DISTANCE;
+		for (int j = 0; j < previous.numPoints; j++) {
+			if (used[j]) {
+				continue;
+			}
+
+			float distSq = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&points[i].position) - XMLoadFloat3(&previous.points[j].position)));
+			if (distSq < closestDistSq) {
+				closest = j;
+				closestDistSq = distSq;
+			}
+		}
+
+		if (closest != -1) {
+			CopyImpulses(previous.points[closest], points[i]);
+			used[closest] = true;
+		}
+	}
+}
+
+//Separations use the same setup as OBB::TestSAT but keep the amount for every axis,
+//cross axes are normalized so they can be compared against the face axes
+bool ContactManifold::CollideBoxes(const OBB& a, const OBB& b, ContactManifold& outManifold, float margin)
+{
+	outManifold.numPoints = 0;
+
+	XMVECTOR aU[3] = { XMLoadFloat3(&a.axes[0]), XMLoadFloat3(&a.axes[1]), XMLoadFloat3(&a.axes[2]) };
+	XMVECTOR bU[3] = { XMLoadFloat3(&b.axes[0]), XMLoadFloat3(&b.axes[1]), XMLoadFloat3(&b.axes[2]) };
+	const float* aH = a.halfExtents;
+	const float* bH = b.halfExtents;
+
+	float R[3][3];
+	float AbsR[3][3];
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			R[i][j] = XMVectorGetX(XMVector3Dot(aU[i], bU[j]));
+			AbsR[i][j] = fabsf(R[i][j]) + .0000001f;
+		}
+	}
+
+	XMVECTOR vecT = XMLoadFloat3(&b.center) - XMLoadFloat3(&a.center);
+	float t[3];
+	for (int i = 0; i < 3; i++) {
+		t[i] = XMVectorGetX(XMVector3Dot(vecT, aU[i]));
+	}
+
+	//Largest (least negative) separation for each kind of axis
+	float faceASeparation = -FLT_MAX;
+	int faceAAxis = 0;
+	for (int i = 0; i < 3; i++) {
+		float separation = fabsf(t[i]) - (aH[i] + bH[0] * AbsR[i][0] + bH[1] * AbsR[i][1] + bH[2] * AbsR[i][2]);
+		if (separation > margin) {
+			return false;
+		}
+		if (separation > faceASeparation) {
+			faceASeparation = separation;
+			faceAAxis = i;
+		}
+	}
+
+	float faceBSeparation = -FLT_MAX;
+	int faceBAxis = 0;
+	for (int j = 0; j < 3; j++) {
+		float distance = t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j];
+		float separation = fabsf(distance) - (aH[0] * AbsR[0][j] + aH[1] * AbsR[1][j] + aH[2] * AbsR[2][j] + bH[j]);
+		if (separation > margin) {
+			return false;
+		}
+		if (separation > faceBSeparation) {
+			faceBSeparation = separation;
+			faceBAxis = j;
+		}
+	}
+
+	float edgeSeparation = -FLT_MAX;
+	int edgeAAxis = -1;
+	int edgeBAxis = -1;
+	for (int i = 0; i < 3; i++) {
+		int i1 = (i + 1) % 3;
+		int i2 = (i + 2) % 3;
+
+		for (int j = 0; j < 3; j++) {
+			int j1 = (j + 1) % 3;
+			int j2 = (j + 2) % 3;
+
+			//Axes are unit length so |Ai x Bj| is the sine of the angle between them
+			float length = sqrtf(fmaxf(1.0f - R[i][j] * R[i][j], 0.0f));
+			if (length < PARALLEL_EPSILON) {
+				continue;
+			}
+
+			float ra = aH[i1] * AbsR[i2][j] + aH[i2] * AbsR[i1][j];
+			float rb = bH[j1] * AbsR[i][j2] + bH[j2] * AbsR[i][j1];
+			float distance = t[i2] * R[i1][j] - t[i1] * R[i2][j];
+			float separation = (fabsf(distance) - (ra + rb)) / length;
+			if (separation > margin) {
+				return false;
+			}
+			if (separation > edgeSeparation) {
+				edgeSeparation = separation;
+				edgeAAxis = i;
+				edgeBAxis = j;
+			}
+		}
+	}
+
+	//Prefer a's faces, then b's, then edges, unless the next one is clearly shallower
+	bool referenceIsB = faceBSeparation > RELATIVE_TOLERANCE * faceASeparation + ABSOLUTE_TOLERANCE;
+	float faceSeparation = referenceIsB ? faceBSeparation : faceASeparation;
+	bool useEdges = edgeAAxis != -1 && edgeSeparation > RELATIVE_TOLERANCE * faceSeparation + ABSOLUTE_TOLERANCE;
+
+	XMVECTOR normal;
+	if (useEdges) {
+		normal = XMVector3Normalize(XMVector3Cross(aU[edgeAAxis], bU[edgeBAxis]));
+	}
+	else if (referenceIsB) {
+		normal = bU[faceBAxis];
+	}
+	else {
+		normal = aU[faceAAxis];
+	}
+
+	//Always from a towards b
+	if (XMVectorGetX(XMVector3Dot(normal, vecT)) < 0.0f) {
+		normal = -normal;
+	}
+
+	XMStoreFloat3(&outManifold.normal, normal);
+	ComputeTangents(outManifold.normal, outManifold.tangents[0], outManifold.tangents[1]);
+
+	if (!useEdges) {
+		if (referenceIsB) {
+			return ClipFaces(b, a, faceBAxis, -normal, true, margin, outManifold);
+		}
+		return ClipFaces(a, b, faceAAxis, normal, false, margin, outManifold);
+	}
+
+	//Edge on edge, one point halfway between the closest points of the two edges. Each
+	//edge is the one on its box furthest towards the other box
+	XMVECTOR edgeA = XMLoadFloat3(&a.center);
+	XMVECTOR edgeB = XMLoadFloat3(&b.center);
+	unsigned int edgeSigns = 0;
+	for (int k = 0; k < 3; k++) {
+		if (k != edgeAAxis) {
+			float sign = Sign(XMVectorGetX(XMVector3Dot(aU[k], normal)));
+			edgeA += aU[k] * (sign * aH[k]);
+			edgeSigns = (edgeSigns << 1) | (sign > 0.0f ? 1u : 0u);
+		}
+		if (k != edgeBAxis) {
+			float sign = Sign(XMVectorGetX(XMVector3Dot(bU[k], -normal)));
+			edgeB += bU[k] * (sign * bH[k]);
+			edgeSigns = (edgeSigns << 1) | (sign > 0.0f ? 1u : 0u);
+		}
+	}
+
+	//Closest points between the two edge lines, both directions are unit length
+	XMVECTOR offset = edgeA - edgeB;
+	float dirDot = R[edgeAAxis][edgeBAxis];
+	float aOffset = XMVectorGetX(XMVector3Dot(aU[edgeAAxis], offset));
+	float bOffset = XMVectorGetX(XMVector3Dot(bU[edgeBAxis], offset));
+	float denominator = 1.0f - dirDot * dirDot;
+	float s = (dirDot * bOffset - aOffset) / denominator;
+	float u = (bOffset - dirDot * aOffset) / denominator;
+	s = fmaxf(-aH[edgeAAxis], fminf(s, aH[edgeAAxis]));
+	u = fmaxf(-bH[edgeBAxis], fminf(u, bH[edgeBAxis]));
+
+	XMVECTOR closestA = edgeA + aU[edgeAAxis] * s;
+	XMVECTOR closestB = edgeB + bU[edgeBAxis] * u;
+
+	ContactPoint& point = outManifold.points[0];
+	XMStoreFloat3(&point.position, (closestA + closestB) * 0.5f);
+	point.penetration = -edgeSeparation;
+	point.featureId = EDGE_CONTACT_FLAG | edgeAAxis | (edgeBAxis << 2) | (edgeSigns << 4);
+	point.normalImpulse = 0.0f;
+	point.tangentImpulse[0] = 0.0f;
+	point.tangentImpulse[1] = 0.0f;
+	outManifold.numPoints = 1;
+	return true;
+}
+
+void ContactManifold::ApplyPenetration(const XMFLOAT3& newNormal, float depth, float margin)
+{
+	normal = newNormal;
+	ComputeTangents(normal, tangents[0], tangents[1]);
+
+	float deepest = -FLT_MAX;
+	for (int i = 0; i < numPoints; i++) {
+		deepest = fmaxf(deepest, points[i].penetration);
+	}
+
+	int kept = 0;
+	for (int i = 0; i < numPoints; i++) {
+		float penetration = depth - (deepest - points[i].penetration);
+		if (penetration < -margin) {
+			continue;
+		}
+
+		points[kept] = points[i];
+		points[kept].penetration = penetration;
+		kept++;
+	}
+	numPoints = kept;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "OBB.h"
+
+class Collider;
+
+//One point where two shapes touch. The impulses are what the solver applied here last
+//time, carried over between updates by matching feature ids so it can warm start
+struct ContactPoint
+{
+	DirectX::XMFLOAT3 position;
+	//Negative for points kept because they're within the margin but not quite touching
+	float penetration;
+	//Which parts of the two boxes made this point, stays the same while they stay in the same arrangement
+	unsigned int featureId;
+
+	float normalImpulse;
+	float tangentImpulse[2];
+};
+
+//Everything a solver needs to push two colliders apart. normal points from a towards b
+struct ContactManifold
+{
+	static const int MAX_POINTS = 4;
+
+	Collider* colliderA;
+	Collider* colliderB;
+
+	DirectX::XMFLOAT3 normal;
+	//Friction directions, perpendicular to the normal and each other
+	DirectX::XMFLOAT3 tangents[2];
+
+	ContactPoint points[MAX_POINTS];
+	int numPoints;
+	//Whether the solver took it on in the last step. If not the impulses are still from whenever it
+	//last was, kept to warm start it again, so they aren't what happened this step
+	bool solved;
+
+	//Snapshots write the normal and tangents even with no points, so they can't be left uninitialized
+	ContactManifold()
+		: colliderA(nullptr),
+		colliderB(nullptr),
+		normal(0.0f, 0.0f, 0.0f),
+		numPoints(0),
+		solved(false)
+	{
+		tangents[0] = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+		tangents[1] = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	}
+
+	//Copies the impulses over from last update's manifold for points with the same feature id,
+	//or failing that a point from last update that's very close by
+	void WarmStart(const ContactManifold& previous);
+
+	//Contact points between two oriented boxes. Finds the axis of least penetration, then
+	//either clips the incident face against the reference face (up to 4 points) or finds the
+	//closest points between two edges. Returns false if the boxes aren't touching. Points up
+	//to margin apart are kept with a negative penetration, so a resting box that lifts a
+	//corner slightly doesn't lose that contact and tip over
+	static bool CollideBoxes(const OBB& a, const OBB& b, ContactManifold& outManifold, float margin = 0.0f);
+
+	//Swaps in a normal and depth from a closer fit than the boxes, like EPA on two hulls. The points
+	//keep how much shallower each was than the deepest, which gets depth, and any that end up more
+	//than margin apart are dropped
+	void ApplyPenetration(const DirectX::XMFLOAT3& newNormal, float depth, float margin = 0.0f);
+};
@@ -0,0 +1,470 @@
+#include "ContactSolver.h"
+#include "JobSystem.h"
+#include "SolverBody.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	//Colours a body can have contacts in, one bit each. Contacts that don't fit in any go in one
+	//extra colour that's solved on a single thread
+	const int MAX_COLORS = 32;
+	//Manifolds per job when solving a colour, small enough to spread out but big enough to be worth the hand off
+	const int COLOR_GRAIN = 16;
+	const int STORE_GRAIN = 1024;
+
+	//Velocity of the point r away from the centre of mass of something moving at v and spinning at w
+	void PointVelocity(const float v[3], const float w[3], const XMFLOAT3& r, float out[3])
+	{
+		out[0] = v[0] + w[1] * r.z - w[2] * r.y;
+		out[1] = v[1] + w[2] * r.x - w[0] * r.z;
+		out[2] = v[2] + w[0] * r.y - w[1] * r.x;
+	}
+
+	float Dot(const float a[3], const XMFLOAT3& b)
+	{
+		return a[0] * b.x + a[1] * b.y + a[2] * b.z;
+	}
+
+	//Speed of b's contact point relative to a's along direction
+	float RelativeSpeed(const SolverBody& a, const SolverBody& b, const XMFLOAT3& rA, const XMFLOAT3& rB, const XMFLOAT3& direction)
+	{
+		float velocityA[3];
+		float velocityB[3];
+		PointVelocity(a.velocity, a.angularVelocity, rA, velocityA);
+		PointVelocity(b.velocity, b.angularVelocity, rB, velocityB);
+		return Dot(velocityB, direction) - Dot(velocityA, direction);
+	}
+
+	//Same but for the bias velocities
+	float RelativeBiasSpeed(const SolverBody& a, const SolverBody& b, const XMFLOAT3& rA, const XMFLOAT3& rB, const XMFLOAT3& direction)
+	{
+		float velocityA[3];
+		float velocityB[3];
+		PointVelocity(a.biasVelocity, a.biasAngularVelocity, rA, velocityA);
+		PointVelocity(b.biasVelocity, b.biasAngularVelocity, rB, velocityB);
+		return Dot(velocityB, direction) - Dot(velocityA, direction);
+	}
+
+	//Pushes a and b apart along direction, impulse goes on b and its opposite on a
+	void ApplyPair(SolverBody& a, SolverBody& b, const XMFLOAT3& rA, const XMFLOAT3& rB, const XMFLOAT3& direction, float impulse)
+	{
+		float px = direction.x * impulse;
+		float py = direction.y * impulse;
+		float pz = direction.z * impulse;
+		a.AddImpulse(a.velocity, a.angularVelocity, rA, -px, -py, -pz);
+		b.AddImpulse(b.velocity, b.angularVelocity, rB, px, py, pz);
+	}
+
+	void ApplyBiasPair(SolverBody& a, SolverBody& b, const XMFLOAT3& rA, const XMFLOAT3& rB, const XMFLOAT3& direction, float impulse)
+	{
+		float px = direction.x * impulse;
+		float py = direction.y * impulse;
+		float pz = direction.z * impulse;
+		a.AddImpulse(a.biasVelocity, a.biasAngularVelocity, rA, -px, -py, -pz);
+		b.AddImpulse(b.biasVelocity, b.biasAngularVelocity, rB, px, py, pz);
+	}
+}
+
+ContactSolver::ContactSolver()
+	: m_iterations(10),
+	m_warmStarting(true),
+	m_baumgarte(0.2f),
+	m_slop(0.005f),
+	m_maxCorrectionSpeed(5.0f),
+	m_restitutionThreshold(1.0f),
+	m_islandSplitSize(256),
+	m_numIslandJobs(0),
+	m_numSplitIslands(0),
+	m_numColors(0)
+{
+}
+
+ContactSolver::~ContactSolver()
+{
+}
+
+void ContactSolver::Clear()
+{
+	l_constraints.clear();
+}
+
+void ContactSolver::AddManifold(ContactManifold* manifold, int bodyA, int bodyB, const RigidBodyArrays& bodies, float dt)
+{
+	//Static or asleep on both sides, nothing to move
+	manifold->solved = bodies.IsSimulated(bodyA) || bodies.IsSimulated(bodyB);
+	if (!manifold->solved) {
+		return;
+	}
+
+	SolverBody a;
+	SolverBody b;
+	a.Load(bodies, bodyA);
+	b.Load(bodies, bodyB);
+	XMFLOAT3 centerA = bodies.GetPosition(bodyA);
+	XMFLOAT3 centerB = bodies.GetPosition(bodyB);
+
+	//Friction is the geometric mean of the two bodies', same as Box2D
+	float friction = sqrtf(bodies.Get(BODY_FRICTION)[bodyA] * bodies.Get(BODY_FRICTION)[bodyB]);
+	//Anything bouncy bounces, also like Box2D
+	float restitution = std::max(bodies.Get(BODY_RESTITUTION)[bodyA], bodies.Get(BODY_RESTITUTION)[bodyB]);
+
+	for (int i = 0; i < manifold->numPoints; i++) {
+		ContactPoint& point = manifold->points[i];
+
+		ContactConstraint constraint;
+		constraint.bodyA = bodyA;
+		constraint.bodyB = bodyB;
+		constraint.rA = XMFLOAT3(point.position.x - centerA.x, point.position.y - centerA.y, point.position.z - centerA.z);
+		constraint.rB = XMFLOAT3(point.position.x - centerB.x, point.position.y - centerB.y, point.position.z - centerB.z);
+		constraint.normal = manifold->normal;
+		constraint.tangents[0] = manifold->tangents[0];
+		constraint.tangents[1] = manifold->tangents[1];
+		constraint.friction = friction;
+		constraint.point = &point;
+
+		float k = a.InverseEffectiveMass(constraint.rA, constraint.normal) + b.InverseEffectiveMass(constraint.rB, constraint.normal);
+		constraint.normalMass = k > 0.0f ? 1.0f / k : 0.0f;
+		for (int t = 0; t < 2; t++) {
+			k = a.InverseEffectiveMass(constraint.rA, constraint.tangents[t]) + b.InverseEffectiveMass(constraint.rB, constraint.tangents[t]);
+			constraint.tangentMass[t] = k > 0.0f ? 1.0f / k : 0.0f;
+		}
+
+		//Not touching yet, let them close the gap this step but no further
+		constraint.velocityBias = std::min(point.penetration, 0.0f) / dt;
+		//Bounce back at a fraction of the speed they came in at, measured before the solve changes it.
+		//Points still inside the margin bounce too, otherwise the gap row stops them just short and
+		//there's nothing left to bounce off next step
+		if (restitution > 0.0f) {
+			float approachSpeed = RelativeSpeed(a, b, constraint.rA, constraint.rB, constraint.normal);
+			if (approachSpeed < -m_restitutionThreshold) {
+				constraint.velocityBias = std::max(constraint.velocityBias, -restitution * approachSpeed);
+			}
+		}
+		//Baumgarte stabilization, but into the bias velocities so it only moves the bodies apart
+		//and doesn't leave them with any extra speed (split impulses)
+		constraint.positionBias = std::min(m_baumgarte / dt * std::max(point.penetration - m_slop, 0.0f), m_maxCorrectionSpeed);
+		constraint.biasImpulse = 0.0f;
+
+		if (m_warmStarting) {
+			constraint.normalImpulse = point.normalImpulse;
+			constraint.tangentImpulse[0] = point.tangentImpulse[0];
+			constraint.tangentImpulse[1] = point.tangentImpulse[1];
+		}
+		else {
+			constraint.normalImpulse = 0.0f;
+			constraint.tangentImpulse[0] = 0.0f;
+			constraint.tangentImpulse[1] = 0.0f;
+		}
+
+		l_constraints.push_back(constraint);
+	}
+}
+
+void ContactSolver::Solve(RigidBodyArrays& bodies)
+{
+	int count = NumConstraints();
+	SolveRange(bodies, 0, count);
+	StoreImpulses(0, count);
+}
+
+void ContactSolver::Solve(RigidBodyArrays& bodies, SimulationIslands& islands, JointSolver* joints)
+{
+	int numIslandBuckets = SortIntoJobs(bodies, islands);
+	int numBuckets = static_cast<int>(l_bucketStart.size()) - 1;
+	BuildIslandJobs(numIslandBuckets, joints);
+	JobSystem* jobs = JobSystem::GetInstance().get();
+
+	jobs->ParallelFor(static_cast<int>(l_islandJobs.size()), 1, [&](int begin, int end) {
+		for (int job = begin; job < end; job++) {
+			SolveIslandJob(bodies, l_islandJobs[job], joints);
+		}
+	});
+
+	//Colours have to wait for the one before to finish. Jobs are split between manifolds since
+	//the points of one share both bodies. The last colour is the overflow one if there was one
+	//and goes through ParallelFor like the rest but as a single job
+	int numColors = numBuckets - numIslandBuckets;
+	auto forEachColor = [&](void (ContactSolver::*pass)(RigidBodyArrays&, int, int)) {
+		for (int color = 0; color < numColors; color++) {
+			int firstManifold = l_colorFirstManifold[color];
+			int colorManifolds = l_colorFirstManifold[color + 1] - firstManifold;
+			int grain = color < MAX_COLORS ? COLOR_GRAIN : colorManifolds;
+			jobs->ParallelFor(colorManifolds, grain, [&](int begin, int end) {
+				(this->*pass)(bodies, l_manifoldStart[firstManifold + begin], l_manifoldStart[firstManifold + end]);
+			});
+		}
+	};
+
+	//Joints in the split islands aren't coloured, they're few enough next to the contacts to
+	//go on this thread before the colours start
+	if (joints) {
+		for (int island : l_splitJointIslands) {
+			joints->WarmStart(bodies, joints->GetIslandBegin(island), joints->GetIslandEnd(island));
+		}
+	}
+	if (m_warmStarting) {
+		forEachColor(&ContactSolver::WarmStart);
+	}
+	for (int i = 0; i < m_iterations; i++) {
+		if (joints) {
+			for (int island : l_splitJointIslands) {
+				joints->SolveVelocities(bodies, joints->GetIslandBegin(island), joints->GetIslandEnd(island), (i & 1) != 0);
+			}
+		}
+		forEachColor(&ContactSolver::SolveVelocities);
+	}
+
+	jobs->ParallelFor(NumConstraints(), STORE_GRAIN, [&](int begin, int end) {
+		StoreImpulses(begin, end);
+	});
+	if (joints) {
+		jobs->ParallelFor(joints->NumConstraints(), STORE_GRAIN, [&](int begin, int end) {
+			joints->StoreImpulses(begin, end);
+		});
+	}
+}
+
+void ContactSolver::BuildIslandJobs(int numIslandBuckets, JointSolver* joints)
+{
+	l_islandJobs.resize(numIslandBuckets);
+	for (int bucket = 0; bucket < numIslandBuckets; bucket++) {
+		IslandJob& job = l_islandJobs[bucket];
+		job.contactBegin = l_bucketStart[bucket];
+		job.contactEnd = l_bucketStart[bucket + 1];
+		job.jointBegin = 0;
+		job.jointEnd = 0;
+	}
+
+	l_splitJointIslands.clear();
+	int numJointIslands = joints ? joints->NumIslands() : 0;
+	//l_islandBucket is still indexed by island root from sorting the contacts
+	for (int island = 0; island < numJointIslands; island++) {
+		int bucket = l_islandBucket[joints->GetIslandRoot(island)];
+		if (bucket == -2) {
+			l_splitJointIslands.push_back(island);
+			continue;
+		}
+
+		if (bucket == -1) {
+			IslandJob job;
+			job.contactBegin = 0;
+			job.contactEnd = 0;
+			l_islandJobs.push_back(job);
+			bucket = static_cast<int>(l_islandJobs.size()) - 1;
+		}
+		l_islandJobs[bucket].jointBegin = joints->GetIslandBegin(island);
+		l_islandJobs[bucket].jointEnd = joints->GetIslandEnd(island);
+	}
+	m_numIslandJobs = static_cast<int>(l_islandJobs.size());
+}
+
+int ContactSolver::SortIntoJobs(const RigidBodyArrays& bodies, SimulationIslands& islands)
+{
+	int count = NumConstraints();
+	int bodyCount = bodies.Size();
+
+	//Every constraint has a dynamic body on at least one side, that body's island is the constraint's
+	l_constraintBucket.resize(count);
+	l_islandSize.assign(bodyCount, 0);
+	for (int i = 0; i < count; i++) {
+		const ContactConstraint& constraint = l_constraints[i];
+		int body = bodies.IsStatic(constraint.bodyA) ? constraint.bodyB : constraint.bodyA;
+		int island = islands.GetIsland(body);
+		l_constraintBucket[i] = island;
+		l_islandSize[island]++;
+	}
+
+	//Small islands are numbered in the order they first show up so the jobs come out the same
+	//every time. Big ones are coloured a manifold at a time, the points of a manifold are next
+	//to each other and share both bodies so they all get the manifold's colour
+	l_islandBucket.assign(bodyCount, -1);
+	l_bodyColors.assign(bodyCount, 0);
+	int numIslandBuckets = 0;
+	int numColors = 0;
+	int numSplitIslands = 0;
+	for (int i = 0; i < count; i++) {
+		const ContactConstraint& constraint = l_constraints[i];
+		int island = l_constraintBucket[i];
+
+		if (l_islandSize[island] <= m_islandSplitSize) {
+			if (l_islandBucket[island] == -1) {
+				l_islandBucket[island] = numIslandBuckets++;
+			}
+			l_constraintBucket[i] = l_islandBucket[island];
+			continue;
+		}
+
+		//Colours are stored negative until the number of island buckets is known
+		if (l_islandBucket[island] == -1) {
+			l_islandBucket[island] = -2;
+			numSplitIslands++;
+		}
+
+		const ContactConstraint* previous = i > 0 ? &l_constraints[i - 1] : nullptr;
+		if (previous && previous->bodyA == constraint.bodyA && previous->bodyB == constraint.bodyB && l_constraintBucket[i - 1] < 0) {
+			l_constraintBucket[i] = l_constraintBucket[i - 1];
+			continue;
+		}
+
+		bool staticA = bodies.IsStatic(constraint.bodyA);
+		bool staticB = bodies.IsStatic(constraint.bodyB);
+		unsigned int used = (staticA ? 0 : l_bodyColors[constraint.bodyA]) | (staticB ? 0 : l_bodyColors[constraint.bodyB]);
+
+		int color = 0;
+		while (color < MAX_COLORS && (used & (1u << color))) {
+			color++;
+		}
+		if (color < MAX_COLORS) {
+			if (!staticA) {
+				l_bodyColors[constraint.bodyA] |= 1u << color;
+			}
+			if (!staticB) {
+				l_bodyColors[constraint.bodyB] |= 1u << color;
+			}
+		}
+
+		numColors = std::max(numColors, color + 1);
+		l_constraintBucket[i] = -(color + 1);
+	}
+
+	//Counting sort into the buckets, keeping the original order inside each
+	int numBuckets = numIslandBuckets + numColors;
+	l_bucketStart.assign(numBuckets + 1, 0);
+	for (int i = 0; i < count; i++) {
+		int& bucket = l_constraintBucket[i];
+		if (bucket < 0) {
+			bucket = numIslandBuckets - bucket - 1;
+		}
+		l_bucketStart[bucket + 1]++;
+	}
+	for (int bucket = 0; bucket < numBuckets; bucket++) {
+		l_bucketStart[bucket + 1] += l_bucketStart[bucket];
+	}
+
+	l_sorted.resize(count);
+	l_bucketNext.assign(l_bucketStart.begin(), l_bucketStart.end() - 1);
+	for (int i = 0; i < count; i++) {
+		l_sorted[l_bucketNext[l_constraintBucket[i]]++] = l_constraints[i];
+	}
+	l_constraints.swap(l_sorted);
+
+	//Where each manifold in the colours starts, ending with one past the last constraint. Manifolds
+	//between the same two bodies count as one here, they can't be split up either
+	l_manifoldStart.clear();
+	l_colorFirstManifold.clear();
+	for (int bucket = numIslandBuckets; bucket < numBuckets; bucket++) {
+		l_colorFirstManifold.push_back(static_cast<int>(l_manifoldStart.size()));
+		for (int i = l_bucketStart[bucket]; i < l_bucketStart[bucket + 1]; i++) {
+			const ContactConstraint& constraint = l_constraints[i];
+			if (i == l_bucketStart[bucket] || constraint.bodyA != l_constraints[i - 1].bodyA || constraint.bodyB != l_constraints[i - 1].bodyB) {
+				l_manifoldStart.push_back(i);
+			}
+		}
+	}
+	l_colorFirstManifold.push_back(static_cast<int>(l_manifoldStart.size()));
+	l_manifoldStart.push_back(count);
+
+	m_numIslandJobs = numIslandBuckets;
+	m_numSplitIslands = numSplitIslands;
+	m_numColors = numColors;
+	return numIslandBuckets;
+}
+
+void ContactSolver::SolveRange(RigidBodyArrays& bodies, int begin, int end)
+{
+	if (m_warmStarting) {
+		WarmStart(bodies, begin, end);
+	}
+
+	for (int i = 0; i < m_iterations; i++) {
+		SolveVelocities(bodies, begin, end);
+	}
+}
+
+void ContactSolver::SolveIslandJob(RigidBodyArrays& bodies, const IslandJob& job, JointSolver* joints)
+{
+	if (joints) {
+		joints->WarmStart(bodies, job.jointBegin, job.jointEnd);
+	}
+	if (m_warmStarting) {
+		WarmStart(bodies, job.contactBegin, job.contactEnd);
+	}
+
+	for (int i = 0; i < m_iterations; i++) {
+		//Every other sweep goes back up the joints so chains pass impulses both ways
+		if (joints) {
+			joints->SolveVelocities(bodies, job.jointBegin, job.jointEnd, (i & 1) != 0);
+		}
+		SolveVelocities(bodies, job.contactBegin, job.contactEnd);
+	}
+}
+
+void ContactSolver::WarmStart(RigidBodyArrays& bodies, int begin, int end)
+{
+	for (int i = begin; i < end; i++) {
+		ContactConstraint& constraint = l_constraints[i];
+		SolverBody a;
+		SolverBody b;
+		a.Load(bodies, constraint.bodyA);
+		b.Load(bodies, constraint.bodyB);
+
+		ApplyPair(a, b, constraint.rA, constraint.rB, constraint.normal, constraint.normalImpulse);
+		ApplyPair(a, b, constraint.rA, constraint.rB, constraint.tangents[0], constraint.tangentImpulse[0]);
+		ApplyPair(a, b, constraint.rA, constraint.rB, constraint.tangents[1], constraint.tangentImpulse[1]);
+
+		a.Store(bodies, constraint.bodyA);
+		b.Store(bodies, constraint.bodyB);
+	}
+}
+
+void ContactSolver::SolveVelocities(RigidBodyArrays& bodies, int begin, int end)
+{
+	for (int i = begin; i < end; i++) {
+		ContactConstraint& constraint = l_constraints[i];
+		SolverBody a;
+		SolverBody b;
+		a.Load(bodies, constraint.bodyA);
+		b.Load(bodies, constraint.bodyB);
+
+		//Friction first so the normal row, which matters more, gets the last word
+		float maxFriction = constraint.friction * constraint.normalImpulse;
+		for (int t = 0; t < 2; t++) {
+			const XMFLOAT3& tangent = constraint.tangents[t];
+			float lambda = -constraint.tangentMass[t] * RelativeSpeed(a, b, constraint.rA, constraint.rB, tangent);
+
+			float oldImpulse = constraint.tangentImpulse[t];
+			constraint.tangentImpulse[t] = std::max(-maxFriction, std::min(oldImpulse + lambda, maxFriction));
+			ApplyPair(a, b, constraint.rA, constraint.rB, tangent, constraint.tangentImpulse[t] - oldImpulse);
+		}
+
+		//Contacts can only push, so the total impulse is clamped rather than each change
+		float lambda = constraint.normalMass * (constraint.velocityBias - RelativeSpeed(a, b, constraint.rA, constraint.rB, constraint.normal));
+		float oldImpulse = constraint.normalImpulse;
+		constraint.normalImpulse = std::max(oldImpulse + lambda, 0.0f);
+		ApplyPair(a, b, constraint.rA, constraint.rB, constraint.normal, constraint.normalImpulse - oldImpulse);
+
+		if (constraint.positionBias > 0.0f) {
+			lambda = constraint.normalMass * (constraint.positionBias - RelativeBiasSpeed(a, b, constraint.rA, constraint.rB, constraint.normal));
+			oldImpulse = constraint.biasImpulse;
+			constraint.biasImpulse = std::max(oldImpulse + lambda, 0.0f);
+			ApplyBiasPair(a, b, constraint.rA, constraint.rB, constraint.normal, constraint.biasImpulse - oldImpulse);
+		}
+
+		a.Store(bodies, constraint.bodyA);
+		b.Store(bodies, constraint.bodyB);
+	}
+}
+
+void ContactSolver::StoreImpulses(int begin, int end)
+{
+	for (int i = begin; i < end; i++) {
+		const ContactConstraint& constraint = l_constraints[i];
+		constraint.point->normalImpulse = constraint.normalImpulse;
+		constraint.point->tangentImpulse[0] = constraint.tangentImpulse[0];
+		constraint.point->tangentImpulse[1] = constraint.tangentImpulse[1];
+	}
+}
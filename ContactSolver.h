@@ -0,0 +1,148 @@
+#pragma once
+
+#include "ContactManifold.h"
+#include "JointSolver.h"
+#include "RigidBodyArrays.h"
+#include "SimulationIslands.h"
+
+#include <vector>
+
+//Projected Gauss-Seidel (sequential impulses) solver for contacts. Each contact point
+//is a non-penetration row along the manifold normal plus two friction rows along its
+//tangents, clamped to a box friction cone. Rows are solved one after the other so each
+//sees the velocities the last one left behind, and the impulses found are written back
+//into the manifold points so next step can start from them (warm starting). Penetration
+//is pushed out with a separate impulse on the bodies' bias velocities, which only last
+//for the position update.
+//Given the step's islands, the rows are handed out to the job system instead: islands don't
+//share any bodies, so each small one is solved start to finish as one job. Big islands are
+//split with graph colouring, every contact in a colour touches different bodies so a colour
+//can be solved in parallel, with the colours taken one after the other each iteration.
+//Neither needs locks, and the answer doesn't depend on how many threads ran it.
+//Joints can be handed in too, they're solved with their island's contacts each iteration
+class ContactSolver
+{
+private:
+	//Everything about one contact point that stays the same across iterations. Rows are
+	//visited one at a time and need all of this together, so unlike the bodies these are
+	//kept as an array of structs
+	struct ContactConstraint
+	{
+		int bodyA;
+		int bodyB;
+
+		//Contact point relative to each body's centre of mass
+		DirectX::XMFLOAT3 rA;
+		DirectX::XMFLOAT3 rB;
+		DirectX::XMFLOAT3 normal;
+		DirectX::XMFLOAT3 tangents[2];
+
+		//1 / (J M^-1 J^T) for each row
+		float normalMass;
+		float tangentMass[2];
+		//Normal speed the row aims for at least. Below 0 lets points that aren't touching yet close
+		//the gap, above 0 is a bounce
+		float velocityBias;
+		//Separating speed the bias velocities aim for, pushes out penetration over a few steps
+		float positionBias;
+		float friction;
+
+		float normalImpulse;
+		float tangentImpulse[2];
+		//Starts from 0 every step, pushing apart isn't carried over
+		float biasImpulse;
+
+		//Where the impulses go once the solve is done
+		ContactPoint* point;
+	};
+
+	std::vector<ContactConstraint> l_constraints;
+
+	//Contacts and joints of one island, solved start to finish by one job
+	struct IslandJob
+	{
+		int contactBegin;
+		int contactEnd;
+		int jointBegin;
+		int jointEnd;
+	};
+
+	//Scratch for grouping the constraints into jobs, kept to avoid reallocating each step
+	std::vector<ContactConstraint> l_sorted;
+	std::vector<int> l_constraintBucket;
+	std::vector<int> l_islandSize;
+	std::vector<int> l_islandBucket;
+	//Colours used by the contacts on each body so far, one bit per colour
+	std::vector<unsigned int> l_bodyColors;
+	//Where each bucket starts in l_constraints once sorted, whole islands first then colours
+	std::vector<int> l_bucketStart;
+	std::vector<int> l_bucketNext;
+	//Constraint each coloured manifold starts at, and the first manifold of each colour
+	std::vector<int> l_manifoldStart;
+	std::vector<int> l_colorFirstManifold;
+	std::vector<IslandJob> l_islandJobs;
+	//Joint islands whose contacts were split into colours
+	std::vector<int> l_splitJointIslands;
+
+	int m_iterations;
+	bool m_warmStarting;
+	//Fraction of the penetration (past the slop) fixed each step
+	float m_baumgarte;
+	//Penetration allowed before anything pushes back, keeps resting contacts from jittering
+	float m_slop;
+	//Cap on the bias speed so deep overlaps don't launch things
+	float m_maxCorrectionSpeed;
+	//Approach speed below which contacts don't bounce, so resting ones settle instead of jittering
+	float m_restitutionThreshold;
+	//Islands with more rows than this get coloured instead of solved as one job
+	int m_islandSplitSize;
+
+	//Stats from the last parallel solve
+	int m_numIslandJobs;
+	int m_numSplitIslands;
+	int m_numColors;
+
+	void WarmStart(RigidBodyArrays& bodies, int begin, int end);
+	void SolveVelocities(RigidBodyArrays& bodies, int begin, int end);
+	//Warm start and every iteration for one run of constraints
+	void SolveRange(RigidBodyArrays& bodies, int begin, int end);
+	//Same for an island's contacts and joints together, the joints go first each iteration
+	void SolveIslandJob(RigidBodyArrays& bodies, const IslandJob& job, JointSolver* joints);
+	//Pairs up each island's contacts with its joints, joints in islands without contacts get their own jobs
+	void BuildIslandJobs(int numIslandBuckets, JointSolver* joints);
+	void StoreImpulses(int begin, int end);
+	//Sorts the constraints into whole island jobs followed by colours. Returns how many of the buckets are islands
+	int SortIntoJobs(const RigidBodyArrays& bodies, SimulationIslands& islands);
+
+public:
+	ContactSolver();
+	~ContactSolver();
+
+	//Drops last step's constraints but keeps the memory
+	void Clear();
+	//Turns every point of the manifold into constraints between the two bodies. Contacts
+	//between two bodies that are static or asleep are skipped. Positions and inertia should be
+	//up to date since the lever arms and effective masses are worked out here
+	void AddManifold(ContactManifold* manifold, int bodyA, int bodyB, const RigidBodyArrays& bodies, float dt);
+
+	//Warm start, then the velocity iterations, then hands the impulses back to the manifolds
+	void Solve(RigidBodyArrays& bodies);
+	//Same but split up across the job system's threads. Islands must have had this step's contacts added.
+	//Joints have to be sorted into the same islands first
+	void Solve(RigidBodyArrays& bodies, SimulationIslands& islands, JointSolver* joints = nullptr);
+
+	int NumConstraints() const { return static_cast<int>(l_constraints.size()); }
+
+	void SetIterations(int iterations) { m_iterations = iterations; }
+	int GetIterations() const { return m_iterations; }
+	void SetWarmStarting(bool warmStarting) { m_warmStarting = warmStarting; }
+	bool GetWarmStarting() const { return m_warmStarting; }
+	void SetIslandSplitSize(int islandSplitSize) { m_islandSplitSize = islandSplitSize; }
+	int GetIslandSplitSize() const { return m_islandSplitSize; }
+	void SetRestitutionThreshold(float restitutionThreshold) { m_restitutionThreshold = restitutionThreshold; }
+	float GetRestitutionThreshold() const { return m_restitutionThreshold; }
+
+	int NumIslandJobs() const { return m_numIslandJobs; }
+	int NumSplitIslands() const { return m_numSplitIslands; }
+	int NumColors() const { return m_numColors; }
+};
@@ -0,0 +1,94 @@
+#include "ContinuousCollision.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+ContinuousCollision::ContinuousCollision()
+	: m_skin(0.01f),
+	m_numSwept(0),
+	m_numClamped(0)
+{
+}
+
+ContinuousCollision::~ContinuousCollision()
+{
+}
+
+void ContinuousCollision::Begin()
+{
+	l_sweptBodies.clear();
+	m_numSwept = 0;
+	m_numClamped = 0;
+}
+
+XMFLOAT3 ContinuousCollision::GetDisplacement(const RigidBodyArrays& bodies, int body, float dt)
+{
+	return XMFLOAT3(
+		(bodies.Get(BODY_VELOCITY_X)[body] + bodies.Get(BODY_BIAS_VELOCITY_X)[body]) * dt,
+		(bodies.Get(BODY_VELOCITY_Y)[body] + bodies.Get(BODY_BIAS_VELOCITY_Y)[body]) * dt,
+		(bodies.Get(BODY_VELOCITY_Z)[body] + bodies.Get(BODY_BIAS_VELOCITY_Z)[body]) * dt);
+}
+
+bool ContinuousCollision::NeedsSweep(const RigidBodyArrays& bodies, int body, float dt, XMFLOAT3& outDisplacement)
+{
+	float ccdSpeed = bodies.Get(BODY_CCD_SPEED)[body];
+	if (ccdSpeed <= 0.0f || !bodies.IsSimulated(body)) {
+		return false;
+	}
+
+	outDisplacement = GetDisplacement(bodies, body, dt);
+	float distanceSq = outDisplacement.x * outDisplacement.x + outDisplacement.y * outDisplacement.y + outDisplacement.z * outDisplacement.z;
+	if (distanceSq <= ccdSpeed * ccdSpeed * dt * dt) {
+		return false;
+	}
+
+	m_numSwept++;
+	return true;
+}
+
+void ContinuousCollision::SweepAgainst(const OBB& a, const XMFLOAT3& displacement, const OBB& b, const XMFLOAT3& otherDisplacement, float& earliestTime)
+{
+	XMFLOAT3 relative = XMFLOAT3(
+		displacement.x - otherDisplacement.x,
+		displacement.y - otherDisplacement.y,
+		displacement.z - otherDisplacement.z);
+
+	float time;
+	if (OBB::Sweep(a, b, relative, time) && time > 0.0f) {
+		earliestTime = std::min(earliestTime, time);
+	}
+}
+
+void ContinuousCollision::AddImpact(const RigidBodyArrays& bodies, int body, const XMFLOAT3& displacement, float time)
+{
+	if (time >= 1.0f) {
+		return;
+	}
+
+	//Stop skin short of the hit, measured along the motion
+	float distance = sqrtf(displacement.x * displacement.x + displacement.y * displacement.y + displacement.z * displacement.z);
+	float fraction = std::max(time - m_skin / distance, 0.0f);
+
+	SweptBody swept;
+	swept.body = body;
+	swept.startPosition = bodies.GetPosition(body);
+	swept.fraction = fraction;
+	l_sweptBodies.push_back(swept);
+	m_numClamped++;
+}
+
+void ContinuousCollision::ApplyImpacts(RigidBodyArrays& bodies)
+{
+	float* px = bodies.Get(BODY_POSITION_X);
+	float* py = bodies.Get(BODY_POSITION_Y);
+	float* pz = bodies.Get(BODY_POSITION_Z);
+
+	for (const SweptBody& swept : l_sweptBodies) {
+		int i = swept.body;
+		px[i] = swept.startPosition.x + (px[i] - swept.startPosition.x) * swept.fraction;
+		py[i] = swept.startPosition.y + (py[i] - swept.startPosition.y) * swept.fraction;
+		pz[i] = swept.startPosition.z + (pz[i] - swept.startPosition.z) * swept.fraction;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "OBB.h"
+#include "RigidBodyArrays.h"
+
+#include <DirectXMath.h>
+#include <vector>
+
+//Continuous collision for bodies that have a CCD speed set. Contacts are only found where
+//bodies are at the start of a step, so something small that moves further than its own size
+//in one step can skip straight over a thin wall. A flagged body moving faster than its speed
+//is swept along this step's motion by whoever owns the shapes, and if the sweep hits something
+//the body is pulled back after integration to just short of the first hit. It keeps its
+//velocity, next step the pair is within the contact margin so the narrowphase gives it a
+//speculative contact, and that's what actually stops it (or bounces it).
+//The sweep ignores rotation over the step, and everything else is only checked where it is now
+class ContinuousCollision
+{
+private:
+	struct SweptBody
+	{
+		int body;
+		DirectX::XMFLOAT3 startPosition;
+		//How much of this step's motion the body is allowed
+		float fraction;
+	};
+
+	std::vector<SweptBody> l_sweptBodies;
+
+	//How far short of a hit a body is left. Smaller than the contact margin so the speculative contact is found next step
+	float m_skin;
+
+	//Stats from the last step
+	int m_numSwept;
+	int m_numClamped;
+
+public:
+	ContinuousCollision();
+	~ContinuousCollision();
+
+	//Drops last step's hits
+	void Begin();
+
+	//True if the body is flagged, awake and faster than its CCD speed. outDisplacement is where this step's velocity takes it
+	bool NeedsSweep(const RigidBodyArrays& bodies, int body, float dt, DirectX::XMFLOAT3& outDisplacement);
+	//Where any body's velocity (bias included) takes it this step
+	static DirectX::XMFLOAT3 GetDisplacement(const RigidBodyArrays& bodies, int body, float dt);
+
+	//Earliest time of impact of a's sweep against b (which moves by otherDisplacement), keeps the smaller of that and
+	//earliestTime. Pairs that already overlap at the start are left to the discrete contacts
+	static void SweepAgainst(const OBB& a, const DirectX::XMFLOAT3& displacement, const OBB& b, const DirectX::XMFLOAT3& otherDisplacement, float& earliestTime);
+	//Records the first hit the sweep found, time is the fraction of displacement before it
+	void AddImpact(const RigidBodyArrays& bodies, int body, const DirectX::XMFLOAT3& displacement, float time);
+
+	//Pulls every body that hit something back along its motion. Runs after the positions are integrated
+	void ApplyImpacts(RigidBodyArrays& bodies);
+
+	void SetSkin(float skin) { m_skin = skin; }
+	float GetSkin() const { return m_skin; }
+
+	int NumSweptBodies() const { return m_numSwept; }
+	int NumClampedBodies() const { return m_numClamped; }
+};
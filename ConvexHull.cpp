@@ -0,0 +1,443 @@
+#include "ConvexHull.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	bool PointLess(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		if (a.x != b.x) {
+			return a.x < b.x;
+		}
+		if (a.y != b.y) {
+			return a.y < b.y;
+		}
+		return a.z < b.z;
+	}
+
+	bool PointEqual(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	float Length(const XMFLOAT3& v)
+	{
+		return sqrtf(Dot(v, v));
+	}
+
+	struct HullFace
+	{
+		int verts[3];
+		XMFLOAT3 normal;
+		float offset;
+		//Points in front of this face that still need to be looked at
+		std::vector<int> outside;
+		bool alive;
+		//Last time the flood fill looking for visible faces checked this one
+		int lastChecked;
+	};
+
+	unsigned long long EdgeKey(int a, int b)
+	{
+		return (static_cast<unsigned long long>(a) << 32) | static_cast<unsigned int>(b);
+	}
+
+	//Winds the face so its normal points away from interior
+	HullFace MakeFace(const std::vector<XMFLOAT3>& points, int a, int b, int c, const XMFLOAT3& interior)
+	{
+		HullFace face;
+		face.verts[0] = a;
+		face.verts[1] = b;
+		face.verts[2] = c;
+		face.alive = true;
+		face.lastChecked = -1;
+
+		XMFLOAT3 normal = Cross(Subtract(points[b], points[a]), Subtract(points[c], points[a]));
+		float length = Length(normal);
+		if (length > 0.0f) {
+			normal = XMFLOAT3(normal.x / length, normal.y / length, normal.z / length);
+		}
+
+		if (Dot(normal, Subtract(interior, points[a])) > 0.0f) {
+			normal = XMFLOAT3(-normal.x, -normal.y, -normal.z);
+			face.verts[1] = c;
+			face.verts[2] = b;
+		}
+
+		face.normal = normal;
+		face.offset = Dot(normal, points[a]);
+		return face;
+	}
+
+	float DistanceToFace(const HullFace& face, const XMFLOAT3& point)
+	{
+		return Dot(face.normal, point) - face.offset;
+	}
+
+	//Directed edges of live faces to the face they belong to, the face across an edge owns it reversed
+	void LinkFaceEdges(std::unordered_map<unsigned long long, int>& edgeFaces, const HullFace& face, int index)
+	{
+		for (int e = 0; e < 3; e++) {
+			edgeFaces[EdgeKey(face.verts[e], face.verts[(e + 1) % 3])] = index;
+		}
+	}
+
+	void UnlinkFaceEdges(std::unordered_map<unsigned long long, int>& edgeFaces, const HullFace& face)
+	{
+		for (int e = 0; e < 3; e++) {
+			edgeFaces.erase(EdgeKey(face.verts[e], face.verts[(e + 1) % 3]));
+		}
+	}
+
+	//Puts the point in the outside set of the first face it's in front of, returns false if it's inside all of them
+	bool AssignOutside(std::vector<HullFace>& faces, int firstFace, const std::vector<XMFLOAT3>& points, int point, float epsilon)
+	{
+		for (int f = firstFace; f < static_cast<int>(faces.size()); f++) {
+			if (faces[f].alive && DistanceToFace(faces[f], points[point]) > epsilon) {
+				faces[f].outside.push_back(point);
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+ConvexHull::ConvexHull()
+{
+}
+
+ConvexHull::~ConvexHull()
+{
+}
+
+void ConvexHull::KeepAllPoints(const std::vector<XMFLOAT3>& points)
+{
+	l_vertices = points;
+	l_adjacencyStarts.clear();
+	l_adjacency.clear();
+}
+
+void ConvexHull::Build(const XMFLOAT3* points, unsigned int count, unsigned int stride, int maxVertices)
+{
+	//Meshes repeat positions for every face that shares them, only the unique ones matter
+	std::vector<XMFLOAT3> unique(count);
+	const char* bytes = reinterpret_cast<const char*>(points);
+	for (unsigned int i = 0; i < count; i++) {
+		unique[i] = *reinterpret_cast<const XMFLOAT3*>(bytes + i * stride);
+	}
+
+	std::sort(unique.begin(), unique.end(), PointLess);
+	unique.erase(std::unique(unique.begin(), unique.end(), PointEqual), unique.end());
+
+	int numPoints = static_cast<int>(unique.size());
+	if (numPoints < 4) {
+		KeepAllPoints(unique);
+		return;
+	}
+
+	//Tolerance relative to the size of the mesh so tiny and huge models behave the same
+	float scale = 0.0f;
+	for (const XMFLOAT3& point : unique) {
+		scale = std::max(scale, std::max(fabsf(point.x), std::max(fabsf(point.y), fabsf(point.z))));
+	}
+	float epsilon = std::max(scale, 1.0f) * .00001f;
+
+	//Starting tetrahedron: the two extreme points furthest apart, then the furthest from
+	//their line, then the furthest from that plane
+	int extremes[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int i = 1; i < numPoints; i++) {
+		const float* point = &unique[i].x;
+		for (int axis = 0; axis < 3; axis++) {
+			if (point[axis] < (&unique[extremes[axis * 2]].x)[axis]) {
+				extremes[axis * 2] = i;
+			}
+			if (point[axis] > (&unique[extremes[axis * 2 + 1]].x)[axis]) {
+				extremes[axis * 2 + 1] = i;
+			}
+		}
+	}
+
+	int v0 = 0;
+	int v1 = 0;
+	float bestDistance = -1.0f;
+	for (int i = 0; i < 6; i++) {
+		for (int j = i + 1; j < 6; j++) {
+			float distance = Length(Subtract(unique[extremes[i]], unique[extremes[j]]));
+			if (distance > bestDistance) {
+				bestDistance = distance;
+				v0 = extremes[i];
+				v1 = extremes[j];
+			}
+		}
+	}
+
+	XMFLOAT3 line = Subtract(unique[v1], unique[v0]);
+	float lineLength = Length(line);
+	int v2 = -1;
+	bestDistance = epsilon;
+	for (int i = 0; i < numPoints; i++) {
+		float distance = Length(Cross(Subtract(unique[i], unique[v0]), line)) / lineLength;
+		if (distance > bestDistance) {
+			bestDistance = distance;
+			v2 = i;
+		}
+	}
+
+	//Everything's on a line
+	if (lineLength <= epsilon || v2 == -1) {
+		KeepAllPoints(unique);
+		return;
+	}
+
+	XMFLOAT3 planeNormal = Cross(line, Subtract(unique[v2], unique[v0]));
+	float planeNormalLength = Length(planeNormal);
+	int v3 = -1;
+	bestDistance = epsilon;
+	for (int i = 0; i < numPoints; i++) {
+		float distance = fabsf(Dot(Subtract(unique[i], unique[v0]), planeNormal)) / planeNormalLength;
+		if (distance > bestDistance) {
+			bestDistance = distance;
+			v3 = i;
+		}
+	}
+
+	//Flat, like a quad
+	if (v3 == -1) {
+		KeepAllPoints(unique);
+		return;
+	}
+
+	XMFLOAT3 interior(
+		(unique[v0].x + unique[v1].x + unique[v2].x + unique[v3].x) * 0.25f,
+		(unique[v0].y + unique[v1].y + unique[v2].y + unique[v3].y) * 0.25f,
+		(unique[v0].z + unique[v1].z + unique[v2].z + unique[v3].z) * 0.25f);
+
+	std::vector<HullFace> faces;
+	faces.push_back(MakeFace(unique, v0, v1, v2, interior));
+	faces.push_back(MakeFace(unique, v0, v3, v1, interior));
+	faces.push_back(MakeFace(unique, v0, v2, v3, interior));
+	faces.push_back(MakeFace(unique, v1, v3, v2, interior));
+
+	std::unordered_map<unsigned long long, int> edgeFaces;
+	for (int f = 0; f < static_cast<int>(faces.size()); f++) {
+		LinkFaceEdges(edgeFaces, faces[f], f);
+	}
+
+	for (int i = 0; i < numPoints; i++) {
+		if (i != v0 && i != v1 && i != v2 && i != v3) {
+			AssignOutside(faces, 0, unique, i, epsilon);
+		}
+	}
+
+	int numHullVerts = 4;
+	std::vector<int> visibleFaces;
+	std::vector<int> orphans;
+	std::vector<int> horizon;
+
+	while (numHullVerts < maxVertices) {
+		//Furthest point outside the hull so far, adding the biggest bumps first is what makes stopping early fine
+		int eye = -1;
+		int eyeFace = -1;
+		float eyeDistance = 0.0f;
+		for (int f = 0; f < static_cast<int>(faces.size()); f++) {
+			if (!faces[f].alive) {
+				continue;
+			}
+
+			for (int point : faces[f].outside) {
+				float distance = DistanceToFace(faces[f], unique[point]);
+				if (distance > eyeDistance) {
+					eyeDistance = distance;
+					eye = point;
+					eyeFace = f;
+				}
+			}
+		}
+
+		if (eye == -1) {
+			break;
+		}
+
+		const XMFLOAT3& eyePoint = unique[eye];
+
+		//Every face the new point can see gets replaced. They're found by flooding out from the face
+		//the point was outside of, so they always come out as one patch with a single horizon loop
+		//around it, and only that patch and the faces bordering it get tested
+		visibleFaces.clear();
+		visibleFaces.push_back(eyeFace);
+		faces[eyeFace].lastChecked = numHullVerts;
+		faces[eyeFace].alive = false;
+		horizon.clear();
+		for (unsigned int i = 0; i < visibleFaces.size(); i++) {
+			const HullFace& face = faces[visibleFaces[i]];
+			for (int e = 0; e < 3; e++) {
+				int a = face.verts[e];
+				int b = face.verts[(e + 1) % 3];
+				//Edges whose other face stays are the horizon the new faces hang off. A face flipped
+				//by a degenerate MakeFace can leave an edge with nothing across it, that's horizon too
+				auto across = edgeFaces.find(EdgeKey(b, a));
+				if (across != edgeFaces.end()) {
+					HullFace& neighbour = faces[across->second];
+					if (neighbour.lastChecked != numHullVerts) {
+						neighbour.lastChecked = numHullVerts;
+						if (DistanceToFace(neighbour, eyePoint) > epsilon) {
+							neighbour.alive = false;
+							visibleFaces.push_back(across->second);
+						}
+					}
+					if (!neighbour.alive) {
+						continue;
+					}
+				}
+
+				horizon.push_back(a);
+				horizon.push_back(b);
+			}
+		}
+
+		orphans.clear();
+		for (int f : visibleFaces) {
+			HullFace& face = faces[f];
+			UnlinkFaceEdges(edgeFaces, face);
+			orphans.insert(orphans.end(), face.outside.begin(), face.outside.end());
+			face.outside.clear();
+		}
+
+		int firstNewFace = static_cast<int>(faces.size());
+		for (unsigned int e = 0; e < horizon.size(); e += 2) {
+			faces.push_back(MakeFace(unique, horizon[e], horizon[e + 1], eye, interior));
+			LinkFaceEdges(edgeFaces, faces.back(), static_cast<int>(faces.size()) - 1);
+		}
+
+		//Points the removed faces could see either move onto a new face or are now inside
+		for (int point : orphans) {
+			if (point != eye) {
+				AssignOutside(faces, firstNewFace, unique, point, epsilon);
+			}
+		}
+
+		numHullVerts++;
+	}
+
+	//Only keep the points the hull actually uses, and note which ones share an edge
+	std::vector<int> remap(numPoints, -1);
+	l_vertices.clear();
+	for (const HullFace& face : faces) {
+		if (!face.alive) {
+			continue;
+		}
+
+		for (int v : face.verts) {
+			if (remap[v] == -1) {
+				remap[v] = static_cast<int>(l_vertices.size());
+				l_vertices.push_back(unique[v]);
+			}
+		}
+	}
+
+	std::vector<std::vector<int>> neighbours(l_vertices.size());
+	for (const HullFace& face : faces) {
+		if (!face.alive) {
+			continue;
+		}
+
+		for (int e = 0; e < 3; e++) {
+			int a = remap[face.verts[e]];
+			int b = remap[face.verts[(e + 1) % 3]];
+			neighbours[a].push_back(b);
+			neighbours[b].push_back(a);
+		}
+	}
+
+	l_adjacencyStarts.assign(1, 0);
+	l_adjacency.clear();
+	for (std::vector<int>& list : neighbours) {
+		std::sort(list.begin(), list.end());
+		list.erase(std::unique(list.begin(), list.end()), list.end());
+		l_adjacency.insert(l_adjacency.end(), list.begin(), list.end());
+		l_adjacencyStarts.push_back(static_cast<int>(l_adjacency.size()));
+	}
+
+	l_vertices.shrink_to_fit();
+	l_adjacency.shrink_to_fit();
+}
+
+ArrayView<int> ConvexHull::GetNeighbours(int index) const
+{
+	if (l_adjacency.empty()) {
+		return ArrayView<int>();
+	}
+
+	return ArrayView<int>(&l_adjacency[l_adjacencyStarts[index]], l_adjacencyStarts[index + 1] - l_adjacencyStarts[index]);
+}
+
+int ConvexHull::FindSupportIndex(const XMFLOAT3& direction, int startIndex) const
+{
+	if (l_vertices.empty()) {
+		return -1;
+	}
+
+	//Not a proper hull, check everything
+	if (l_adjacency.empty()) {
+		int bestIndex = 0;
+		float bestDot = -FLT_MAX;
+		for (int i = 0; i < static_cast<int>(l_vertices.size()); i++) {
+			float dot = Dot(l_vertices[i], direction);
+			if (dot > bestDot) {
+				bestDot = dot;
+				bestIndex = i;
+			}
+		}
+
+		return bestIndex;
+	}
+
+	//On a convex hull the furthest vertex is the only one with no neighbour further out,
+	//so keep stepping to the best neighbour until there isn't a better one
+	int current = startIndex >= 0 && startIndex < static_cast<int>(l_vertices.size()) ? startIndex : 0;
+	float currentDot = Dot(l_vertices[current], direction);
+	while (true) {
+		int best = current;
+		int end = l_adjacencyStarts[current + 1];
+		for (int i = l_adjacencyStarts[current]; i < end; i++) {
+			int neighbour = l_adjacency[i];
+			float dot = Dot(l_vertices[neighbour], direction);
+			if (dot > currentDot) {
+				currentDot = dot;
+				best = neighbour;
+			}
+		}
+
+		if (best == current) {
+			return current;
+		}
+		current = best;
+	}
+}
+
+XMFLOAT3 ConvexHull::FindSupport(const XMFLOAT3& direction) const
+{
+	int index = FindSupportIndex(direction);
+	return index >= 0 ? l_vertices[index] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+}
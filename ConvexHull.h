@@ -0,0 +1,44 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "ArrayView.h"
+
+//Convex hull of a mesh in local space, used as its collision shape. Built once with
+//quickhull when the mesh is loaded and shared by every collider using it. Along with
+//the hull's vertices it keeps which ones share an edge, so finding the vertex furthest
+//along a direction can walk uphill from a nearby vertex instead of checking them all
+class ConvexHull
+{
+private:
+	std::vector<DirectX::XMFLOAT3> l_vertices;
+	//Neighbours of vertex i are l_adjacency[l_adjacencyStarts[i]] up to l_adjacency[l_adjacencyStarts[i + 1]].
+	//Empty for flat or tiny point sets that don't make a proper hull, those fall back to a full scan
+	std::vector<int> l_adjacencyStarts;
+	std::vector<int> l_adjacency;
+
+	void KeepAllPoints(const std::vector<DirectX::XMFLOAT3>& points);
+
+public:
+	static const int DEFAULT_MAX_VERTICES = 128;
+
+	ConvexHull();
+	~ConvexHull();
+
+	//Quickhull over the points. It always adds the furthest point left outside, so stopping
+	//at maxVertices still gives a close fit that sits just inside the full hull
+	void Build(const DirectX::XMFLOAT3* points, unsigned int count, unsigned int stride = sizeof(DirectX::XMFLOAT3), int maxVertices = DEFAULT_MAX_VERTICES);
+
+	//Index of the vertex furthest along direction, -1 if the hull is empty. Climbs from
+	//startIndex, so passing in the last answer for a similar direction makes it near constant time
+	int FindSupportIndex(const DirectX::XMFLOAT3& direction, int startIndex = 0) const;
+	DirectX::XMFLOAT3 FindSupport(const DirectX::XMFLOAT3& direction) const;
+
+	ArrayView<DirectX::XMFLOAT3> GetVertices() const { return ArrayView<DirectX::XMFLOAT3>(l_vertices); }
+	const DirectX::XMFLOAT3& GetVertex(int index) const { return l_vertices[index]; }
+	ArrayView<int> GetNeighbours(int index) const;
+	int NumVertices() const { return static_cast<int>(l_vertices.size()); }
+	bool IsEmpty() const { return l_vertices.empty(); }
+	bool HasAdjacency() const { return !l_adjacency.empty(); }
+};
@@ -0,0 +1,458 @@
+#include "DynamicAABBTree.h"
+
+#include <cassert>
+
+using namespace DirectX;
+
+DynamicAABBTree::DynamicAABBTree(float fatMargin, float displacementMultiplier)
+	: m_root(NULL_NODE),
+	m_freeList(NULL_NODE),
+	m_proxyCount(0),
+	m_fatMargin(fatMargin),
+	m_displacementMultiplier(displacementMultiplier)
+{
+}
+
+DynamicAABBTree::~DynamicAABBTree()
+{
+}
+
+void DynamicAABBTree::Clear()
+{
+	l_nodes.clear();
+	m_root = NULL_NODE;
+	m_freeList = NULL_NODE;
+	m_proxyCount = 0;
+}
+
+int DynamicAABBTree::AllocateNode()
+{
+	//Grow the pool and thread the new nodes onto the free list
+	if (m_freeList == NULL_NODE)
+	{
+		int oldSize = static_cast<int>(l_nodes.size());
+		int newSize = oldSize == 0 ? 16 : oldSize * 2;
+		l_nodes.resize(newSize);
+
+		for (int i = oldSize; i < newSize - 1; i++)
+		{
+			l_nodes[i].parent = i + 1;
+			l_nodes[i].height = -1;
+		}
+		l_nodes[newSize - 1].parent = NULL_NODE;
+		l_nodes[newSize - 1].height = -1;
+
+		m_freeList = oldSize;
+	}
+
+	int nodeId = m_freeList;
+	TreeNode& node = l_nodes[nodeId];
+	m_freeList = node.parent;
+
+	node.parent = NULL_NODE;
+	node.child1 = NULL_NODE;
+	node.child2 = NULL_NODE;
+	node.height = 0;
+	node.userData = nullptr;
+
+	return nodeId;
+}
+
+void DynamicAABBTree::FreeNode(int nodeId)
+{
+	l_nodes[nodeId].parent = m_freeList;
+	l_nodes[nodeId].height = -1;
+	m_freeList = nodeId;
+}
+
+AABB DynamicAABBTree::FattenAABB(const AABB& aabb, const XMFLOAT3& displacement) const
+{
+	AABB fat(
+		XMFLOAT3(aabb.min.x - m_fatMargin, aabb.min.y - m_fatMargin, aabb.min.z - m_fatMargin),
+		XMFLOAT3(aabb.max.x + m_fatMargin, aabb.max.y + m_fatMargin, aabb.max.z + m_fatMargin));
+
+	//Stretch the box along the direction of movement so steady movers don't reinsert every frame
+	float dx = m_displacementMultiplier * displacement.x;
+	float dy = m_displacementMultiplier * displacement.y;
+	float dz = m_displacementMultiplier * displacement.z;
+
+	if (dx < 0.0f) fat.min.x += dx; else fat.max.x += dx;
+	if (dy < 0.0f) fat.min.y += dy; else fat.max.y += dy;
+	if (dz < 0.0f) fat.min.z += dz; else fat.max.z += dz;
+
+	return fat;
+}
+
+int DynamicAABBTree::CreateProxy(const AABB& aabb, void* userData)
+{
+	int proxyId = AllocateNode();
+
+	l_nodes[proxyId].aabb = FattenAABB(aabb, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	l_nodes[proxyId].userData = userData;
+
+	InsertLeaf(proxyId);
+	m_proxyCount++;
+
+	return proxyId;
+}
+
+void DynamicAABBTree::DestroyProxy(int proxyId)
+{
+	assert(proxyId >= 0 && proxyId < static_cast<int>(l_nodes.size()));
+	assert(l_nodes[proxyId].IsLeaf());
+
+	RemoveLeaf(proxyId);
+	FreeNode(proxyId);
+	m_proxyCount--;
+}
+
+bool DynamicAABBTree::MoveProxy(int proxyId, const AABB& aabb, const XMFLOAT3& displacement)
+{
+	assert(proxyId >= 0 && proxyId < static_cast<int>(l_nodes.size()));
+	assert(l_nodes[proxyId].IsLeaf());
+
+	if (l_nodes[proxyId].aabb.Contains(aabb))
+		return false;
+
+	RemoveLeaf(proxyId);
+	l_nodes[proxyId].aabb = FattenAABB(aabb, displacement);
+	InsertLeaf(proxyId);
+
+	return true;
+}
+
+void DynamicAABBTree::ComputePairs(std::vector<BroadphasePair>& outPairs)
+{
+	outPairs.clear();
+
+	if (m_root == NULL_NODE)
+		return;
+
+	//Walks the tree against itself instead of running a query per proxy. A node is
+	//checked against itself by checking each child against itself and then the two
+	//children against each other, so every pair of leaves is reached exactly once
+	l_pairStack.clear();
+	l_pairStack.push_back({ m_root, m_root });
+
+	while (!l_pairStack.empty())
+	{
+		NodePair current = l_pairStack.back();
+		l_pairStack.pop_back();
+
+		const TreeNode& nodeA = l_nodes[current.a];
+		const TreeNode& nodeB = l_nodes[current.b];
+
+		if (current.a == current.b)
+		{
+			if (nodeA.IsLeaf())
+				continue;
+
+			l_pairStack.push_back({ nodeA.child1, nodeA.child1 });
+			l_pairStack.push_back({ nodeA.child2, nodeA.child2 });
+			if (l_nodes[nodeA.child1].aabb.Overlaps(l_nodes[nodeA.child2].aabb))
+				l_pairStack.push_back({ nodeA.child1, nodeA.child2 });
+			continue;
+		}
+
+		if (nodeA.IsLeaf() && nodeB.IsLeaf())
+		{
+			outPairs.push_back({ std::min(current.a, current.b), std::max(current.a, current.b) });
+			continue;
+		}
+
+		//Split the bigger node so the boxes being compared stay similar in size. Children
+		//are tested before being pushed since most of them get rejected straight away
+		if (nodeB.IsLeaf() || (!nodeA.IsLeaf() && nodeA.aabb.Perimeter() > nodeB.aabb.Perimeter()))
+		{
+			if (l_nodes[nodeA.child1].aabb.Overlaps(nodeB.aabb))
+				l_pairStack.push_back({ nodeA.child1, current.b });
+			if (l_nodes[nodeA.child2].aabb.Overlaps(nodeB.aabb))
+				l_pairStack.push_back({ nodeA.child2, current.b });
+		}
+		else
+		{
+			if (l_nodes[nodeB.child1].aabb.Overlaps(nodeA.aabb))
+				l_pairStack.push_back({ current.a, nodeB.child1 });
+			if (l_nodes[nodeB.child2].aabb.Overlaps(nodeA.aabb))
+				l_pairStack.push_back({ current.a, nodeB.child2 });
+		}
+	}
+}
+
+void DynamicAABBTree::QueryAABB(const AABB& aabb, std::vector<int>& outProxies) const
+{
+	outProxies.clear();
+	Query(aabb, [&](int proxyId)
+	{
+		outProxies.push_back(proxyId);
+		return true;
+	});
+}
+
+void DynamicAABBTree::InsertLeaf(int leaf)
+{
+	if (m_root == NULL_NODE)
+	{
+		m_root = leaf;
+		l_nodes[m_root].parent = NULL_NODE;
+		return;
+	}
+
+	//Find the best sibling for this leaf by walking down the cheapest branch
+	AABB leafAABB = l_nodes[leaf].aabb;
+	int index = m_root;
+	while (!l_nodes[index].IsLeaf())
+	{
+		int child1 = l_nodes[index].child1;
+		int child2 = l_nodes[index].child2;
+
+		float area = l_nodes[index].aabb.Perimeter();
+
+		AABB combinedAABB = AABB::Union(l_nodes[index].aabb, leafAABB);
+		float combinedArea = combinedAABB.Perimeter();
+
+		//Cost of creating a new parent for this node and the new leaf
+		float cost = 2.0f * combinedArea;
+
+		//Minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		//Cost of descending into child1
+		float cost1;
+		AABB aabb1 = AABB::Union(leafAABB, l_nodes[child1].aabb);
+		if (l_nodes[child1].IsLeaf())
+		{
+			cost1 = aabb1.Perimeter() + inheritanceCost;
+		}
+		else
+		{
+			cost1 = (aabb1.Perimeter() - l_nodes[child1].aabb.Perimeter()) + inheritanceCost;
+		}
+
+		//Cost of descending into child2
+		float cost2;
+		AABB aabb2 = AABB::Union(leafAABB, l_nodes[child2].aabb);
+		if (l_nodes[child2].IsLeaf())
+		{
+			cost2 = aabb2.Perimeter() + inheritanceCost;
+		}
+		else
+		{
+			cost2 = (aabb2.Perimeter() - l_nodes[child2].aabb.Perimeter()) + inheritanceCost;
+		}
+
+		if (cost < cost1 && cost < cost2)
+			break;
+
+		index = cost1 < cost2 ? child1 : child2;
+	}
+
+	int sibling = index;
+
+	//Create a new parent for the leaf and its sibling
+	int oldParent = l_nodes[sibling].parent;
+	int newParent = AllocateNode();
+	l_nodes[newParent].parent = oldParent;
+	l_nodes[newParent].userData = nullptr;
+	l_nodes[newParent].aabb = AABB::Union(leafAABB, l_nodes[sibling].aabb);
+	l_nodes[newParent].height = l_nodes[sibling].height + 1;
+
+	if (oldParent != NULL_NODE)
+	{
+		if (l_nodes[oldParent].child1 == sibling)
+			l_nodes[oldParent].child1 = newParent;
+		else
+			l_nodes[oldParent].child2 = newParent;
+	}
+	else
+	{
+		m_root = newParent;
+	}
+
+	l_nodes[newParent].child1 = sibling;
+	l_nodes[newParent].child2 = leaf;
+	l_nodes[sibling].parent = newParent;
+	l_nodes[leaf].parent = newParent;
+
+	//Walk back up fixing heights and boxes
+	index = l_nodes[leaf].parent;
+	while (index != NULL_NODE)
+	{
+		index = Balance(index);
+
+		int child1 = l_nodes[index].child1;
+		int child2 = l_nodes[index].child2;
+
+		l_nodes[index].height = 1 + std::max(l_nodes[child1].height, l_nodes[child2].height);
+		l_nodes[index].aabb = AABB::Union(l_nodes[child1].aabb, l_nodes[child2].aabb);
+
+		index = l_nodes[index].parent;
+	}
+}
+
+void DynamicAABBTree::RemoveLeaf(int leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = NULL_NODE;
+		return;
+	}
+
+	int parent = l_nodes[leaf].parent;
+	int grandParent = l_nodes[parent].parent;
+	int sibling = l_nodes[parent].child1 == leaf ? l_nodes[parent].child2 : l_nodes[parent].child1;
+
+	if (grandParent != NULL_NODE)
+	{
+		//Destroy the parent and connect the sibling to the grand parent
+		if (l_nodes[grandParent].child1 == parent)
+			l_nodes[grandParent].child1 = sibling;
+		else
+			l_nodes[grandParent].child2 = sibling;
+
+		l_nodes[sibling].parent = grandParent;
+		FreeNode(parent);
+
+		int index = grandParent;
+		while (index != NULL_NODE)
+		{
+			index = Balance(index);
+
+			int child1 = l_nodes[index].child1;
+			int child2 = l_nodes[index].child2;
+
+			l_nodes[index].aabb = AABB::Union(l_nodes[child1].aabb, l_nodes[child2].aabb);
+			l_nodes[index].height = 1 + std::max(l_nodes[child1].height, l_nodes[child2].height);
+
+			index = l_nodes[index].parent;
+		}
+	}
+	else
+	{
+		m_root = sibling;
+		l_nodes[sibling].parent = NULL_NODE;
+		FreeNode(parent);
+	}
+}
+
+int DynamicAABBTree::Balance(int iA)
+{
+	TreeNode* A = &l_nodes[iA];
+	if (A->IsLeaf() || A->height < 2)
+		return iA;
+
+	int iB = A->child1;
+	int iC = A->child2;
+	TreeNode* B = &l_nodes[iB];
+	TreeNode* C = &l_nodes[iC];
+
+	int balance = C->height - B->height;
+
+	//Rotate C up
+	if (balance > 1)
+	{
+		int iF = C->child1;
+		int iG = C->child2;
+		TreeNode* F = &l_nodes[iF];
+		TreeNode* G = &l_nodes[iG];
+
+		//Swap A and C
+		C->child1 = iA;
+		C->parent = A->parent;
+		A->parent = iC;
+
+		//A's old parent should point to C
+		if (C->parent != NULL_NODE)
+		{
+			if (l_nodes[C->parent].child1 == iA)
+				l_nodes[C->parent].child1 = iC;
+			else
+				l_nodes[C->parent].child2 = iC;
+		}
+		else
+		{
+			m_root = iC;
+		}
+
+		//Rotate
+		if (F->height > G->height)
+		{
+			C->child2 = iF;
+			A->child2 = iG;
+			G->parent = iA;
+			A->aabb = AABB::Union(B->aabb, G->aabb);
+			C->aabb = AABB::Union(A->aabb, F->aabb);
+
+			A->height = 1 + std::max(B->height, G->height);
+			C->height = 1 + std::max(A->height, F->height);
+		}
+		else
+		{
+			C->child2 = iG;
+			A->child2 = iF;
+			F->parent = iA;
+			A->aabb = AABB::Union(B->aabb, F->aabb);
+			C->aabb = AABB::Union(A->aabb, G->aabb);
+
+			A->height = 1 + std::max(B->height, F->height);
+			C->height = 1 + std::max(A->height, G->height);
+		}
+
+		return iC;
+	}
+
+	//Rotate B up
+	if (balance < -1)
+	{
+		int iD = B->child1;
+		int iE = B->child2;
+		TreeNode* D = &l_nodes[iD];
+		TreeNode* E = &l_nodes[iE];
+
+		//Swap A and B
+		B->child1 = iA;
+		B->parent = A->parent;
+		A->parent = iB;
+
+		//A's old parent should point to B
+		if (B->parent != NULL_NODE)
+		{
+			if (l_nodes[B->parent].child1 == iA)
+				l_nodes[B->parent].child1 = iB;
+			else
+				l_nodes[B->parent].child2 = iB;
+		}
+		else
+		{
+			m_root = iB;
+		}
+
+		//Rotate
+		if (D->height > E->height)
+		{
+			B->child2 = iD;
+			A->child1 = iE;
+			E->parent = iA;
+			A->aabb = AABB::Union(C->aabb, E->aabb);
+			B->aabb = AABB::Union(A->aabb, D->aabb);
+
+			A->height = 1 + std::max(C->height, E->height);
+			B->height = 1 + std::max(A->height, D->height);
+		}
+		else
+		{
+			B->child2 = iE;
+			A->child1 = iD;
+			D->parent = iA;
+			A->aabb = AABB::Union(C->aabb, D->aabb);
+			B->aabb = AABB::Union(A->aabb, E->aabb);
+
+			A->height = 1 + std::max(C->height, D->height);
+			B->height = 1 + std::max(A->height, E->height);
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
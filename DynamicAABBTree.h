@@ -0,0 +1,123 @@
+#pragma once
+#include "Broadphase.h"
+
+#include <DirectXMath.h>
+#include <vector>
+
+//Dynamic bounding volume hierarchy over fattened AABBs. Leaves are proxies for
+//colliders, internal nodes hold the union of their children. Proxies only get
+//reinserted once their tight box escapes the fat box, so slow movers are
+//almost free to update.
+//Structure is based on the dynamic tree from Box2D (Erin Catto)
+class DynamicAABBTree : public Broadphase
+{
+private:
+	static const int NULL_NODE = -1;
+
+	struct TreeNode
+	{
+		AABB aabb;
+		void* userData;
+
+		//Parent when in the tree, next free node when in the free list
+		int parent;
+		int child1;
+		int child2;
+
+		//Leaf = 0, free node = -1
+		int height;
+
+		bool IsLeaf() const { return child1 == NULL_NODE; }
+	};
+
+	struct NodePair
+	{
+		int a;
+		int b;
+	};
+
+	std::vector<TreeNode> l_nodes;
+	//Scratch stack reused by ComputePairs so it doesn't allocate every update
+	std::vector<NodePair> l_pairStack;
+	//Same for Query. Grows as needed so a deep or lopsided tree is still searched all the way, which
+	//means a query can't be started from another thread or from inside a query's callback
+	mutable std::vector<int> l_queryStack;
+	int m_root;
+	int m_freeList;
+	int m_proxyCount;
+
+	//How far the tight box is padded so small movements don't need a reinsert
+	float m_fatMargin;
+	//How far ahead the fat box is stretched in the direction of movement
+	float m_displacementMultiplier;
+
+	int AllocateNode();
+	void FreeNode(int nodeId);
+
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+
+	//Performs a left or right rotation if node A is imbalanced, returns the new root of the subtree
+	int Balance(int iA);
+
+	AABB FattenAABB(const AABB& aabb, const DirectX::XMFLOAT3& displacement) const;
+
+public:
+	DynamicAABBTree(float fatMargin = 0.1f, float displacementMultiplier = 2.0f);
+	~DynamicAABBTree();
+
+	int CreateProxy(const AABB& aabb, void* userData) override;
+	void DestroyProxy(int proxyId) override;
+
+	//Returns true if the proxy had to be reinserted
+	bool MoveProxy(int proxyId, const AABB& aabb, const DirectX::XMFLOAT3& displacement) override;
+
+	void* GetUserData(int proxyId) const override { return l_nodes[proxyId].userData; }
+	const AABB& GetFatAABB(int proxyId) const { return l_nodes[proxyId].aabb; }
+
+	int GetProxyCount() const override { return m_proxyCount; }
+	int GetHeight() const { return m_root == NULL_NODE ? 0 : l_nodes[m_root].height; }
+
+	void ComputePairs(std::vector<BroadphasePair>& outPairs) override;
+
+	//Calls callback(int proxyId) for every proxy whose fat box overlaps aabb.
+	//Returning false from the callback stops the query early
+	template<typename T>
+	void Query(const AABB& aabb, T&& callback) const;
+	void QueryAABB(const AABB& aabb, std::vector<int>& outProxies) const override;
+
+	void Clear() override;
+
+	const char* GetName() const override { return "AABB Tree"; }
+};
+
+template<typename T>
+inline void DynamicAABBTree::Query(const AABB& aabb, T&& callback) const
+{
+	if (m_root == NULL_NODE)
+		return;
+
+	l_queryStack.clear();
+	l_queryStack.push_back(m_root);
+
+	while (!l_queryStack.empty())
+	{
+		int nodeId = l_queryStack.back();
+		l_queryStack.pop_back();
+		const TreeNode& node = l_nodes[nodeId];
+
+		if (!node.aabb.Overlaps(aabb))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			if (!callback(nodeId))
+				return;
+		}
+		else
+		{
+			l_queryStack.push_back(node.child1);
+			l_queryStack.push_back(node.child2);
+		}
+	}
+}
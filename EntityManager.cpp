@@ -1,8 +1,11 @@
 #include "EntityManager.h"
+#include "CollisionManager.h"
+#include "PhysicsWorld.h"
 
 std::shared_ptr<EntityManager> EntityManager::s_instance;
 
 EntityManager::EntityManager()
+    : m_transformUpdate(0)
 {
     l_entities = std::vector<std::shared_ptr<GameEntity>>();
 }
@@ -28,7 +31,16 @@ bool EntityManager::SetEntity(const int index, std::shared_ptr<GameEntity> entit
         return false;
     }
 
+    CollisionManager::GetInstance()->RemoveCollider(l_entities[index]->GetCollider());
+    CollisionManager::GetInstance()->AddCollider(entity->GetCollider());
+    PhysicsWorld::GetInstance()->RemoveBody(l_entities[index]->GetRigidBody());
+    PhysicsWorld::GetInstance()->AddBody(entity->GetRigidBody());
+
+    if (l_entities[index]->GetCollider()) {
+        l_entities[index]->GetCollider()->SetEntityId(-1);
+    }
     l_entities[index] = entity;
+    RenumberEntities(index);
     return true;
 }
 
@@ -39,12 +51,46 @@ bool EntityManager::InsertEntity(const int index, std::shared_ptr<GameEntity> en
     }
 
     l_entities.insert(l_entities.begin() + index, entity);
+    CollisionManager::GetInstance()->AddCollider(entity->GetCollider());
+    PhysicsWorld::GetInstance()->AddBody(entity->GetRigidBody());
+    RenumberEntities(index);
     return true;
 }
 
 void EntityManager::AddEntity(std::shared_ptr<GameEntity> entity)
 {
     l_entities.push_back(entity);
+    CollisionManager::GetInstance()->AddCollider(entity->GetCollider());
+    PhysicsWorld::GetInstance()->AddBody(entity->GetRigidBody());
+    RenumberEntities(NumEntities() - 1);
+}
+
+void EntityManager::SetEntities(std::vector<std::shared_ptr<GameEntity>> entities)
+{
+    for (auto& entity : l_entities) {
+        CollisionManager::GetInstance()->RemoveCollider(entity->GetCollider());
+        PhysicsWorld::GetInstance()->RemoveBody(entity->GetRigidBody());
+        if (entity->GetCollider()) {
+            entity->GetCollider()->SetEntityId(-1);
+        }
+    }
+
+    l_entities = entities;
+
+    for (auto& entity : l_entities) {
+        CollisionManager::GetInstance()->AddCollider(entity->GetCollider());
+        PhysicsWorld::GetInstance()->AddBody(entity->GetRigidBody());
+    }
+    RenumberEntities(0);
+}
+
+void EntityManager::RenumberEntities(int first)
+{
+    for (int i = first; i < NumEntities(); i++) {
+        if (l_entities[i]->GetCollider()) {
+            l_entities[i]->GetCollider()->SetEntityId(i);
+        }
+    }
 }
 
 void const EntityManager::DrawEntities(bool prepareMat)
@@ -62,9 +108,99 @@ void const EntityManager::DrawEntities(bool prepareMat)
 }
 
 void EntityManager::UpdateEntities(float dt)
+{
+    //Checks every collider against each other in one pass, then pushes apart and moves the rigid bodies.
+    //Runs at a fixed rate no matter the frame rate, so this may be 0 steps or several
+    PhysicsWorld::GetInstance()->Update(dt);
+
+    //Only entities whose contacts started or stopped this frame can need a new colour
+    const CollisionEventBuffer& collisionEvents = PhysicsWorld::GetInstance()->GetCollisionEvents();
+    if (collisionEvents.WasReset()) {
+        RefreshDebugSpheres();
+        return;
+    }
+
+    for (const CollisionRecord& record : collisionEvents.GetRecords())
+    {
+        if (record.type == COLLISION_PERSIST) {
+            continue;
+        }
+
+        if (IndexInBounds(record.entityA)) {
+            l_entities[record.entityA]->UpdateDebugSphere();
+        }
+        if (IndexInBounds(record.entityB)) {
+            l_entities[record.entityB]->UpdateDebugSphere();
+        }
+    }
+}
+
+int EntityManager::UpdateRenderMatrices()
+{
+    int moved = 0;
+    for (auto& entity : l_entities)
+    {
+        moved += entity->RefreshRenderMatrices() ? 1 : 0;
+    }
+    return moved;
+}
+
+int EntityManager::MirrorTransform(const Transform* transform)
+{
+    auto it = m_mirroredTransforms.find(transform);
+    if (it != m_mirroredTransforms.end() && it->second.update == m_transformUpdate) {
+        return it->second.handle;
+    }
+
+    //Parents first, so a new node has something to hang off
+    int parent = transform->GetParent() ? MirrorTransform(transform->GetParent()) : -1;
+
+    bool added = it == m_mirroredTransforms.end();
+    if (added) {
+        MirroredTransform mirrored;
+        mirrored.handle = m_transformStore.Add(parent);
+        it = m_mirroredTransforms.emplace(transform, mirrored).first;
+    }
+    it->second.update = m_transformUpdate;
+
+    //Reparenting marks the transform changed too
+    if (added || transform->HasChangedThisFrame()) {
+        m_transformStore.SetParent(it->second.handle, parent);
+        m_transformStore.SetLocal(it->second.handle, transform->GetPosition(), transform->GetRotationQuat(), transform->GetScale());
+    }
+    return it->second.handle;
+}
+
+void EntityManager::UpdateTransforms()
+{
+    m_transformUpdate++;
+    for (auto& entity : l_entities)
+    {
+        entity->SetTransformHandle(MirrorTransform(entity->GetTransform()));
+        if (entity->GetCollider()) {
+            MirrorTransform(entity->GetCollider()->GetTransform());
+        }
+    }
+
+    //Transforms of entities that were removed or replaced
+    for (auto it = m_mirroredTransforms.begin(); it != m_mirroredTransforms.end();)
+    {
+        if (it->second.update != m_transformUpdate) {
+            m_transformStore.Remove(it->second.handle);
+            it = m_mirroredTransforms.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    m_transformStore.Update();
+}
+
+void EntityManager::RefreshDebugSpheres()
 {
     for (auto& entity : l_entities)
     {
-        entity->Update(dt, l_entities);
+        entity->UpdateDebugSphere();
     }
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include "GameEntity.h"
+#include "TransformStore.h"
 
+#include <unordered_map>
 #include <vector>
 
 
@@ -10,7 +12,25 @@ private:
 	static std::shared_ptr<EntityManager> s_instance;
 	std::vector<std::shared_ptr<GameEntity>> l_entities;
 
+	struct MirroredTransform
+	{
+		int handle;
+		//Last UpdateTransforms that reached it, anything left behind belonged to something that's gone
+		unsigned int update;
+	};
+
+	//World matrices for every entity and collider transform, mirrored from the Transforms each update
+	TransformStore m_transformStore;
+	std::unordered_map<const Transform*, MirroredTransform> m_mirroredTransforms;
+	unsigned int m_transformUpdate;
+
+	//Node for transform, made along with any of its parents the first time. Copies its local
+	//values over if it's new or changed this frame
+	int MirrorTransform(const Transform* transform);
+
 	bool IndexInBounds(const int index) { return index >= 0 && index < l_entities.size(); }
+	//Colliders carry their entity's index so collision records can name it, fixes them up from first onwards
+	void RenumberEntities(int first);
 
 	EntityManager();
 
@@ -23,7 +43,7 @@ public:
 	std::shared_ptr<GameEntity> GetEntity(const int index) { return l_entities[index]; }
 
 	bool SetEntity(const int index, std::shared_ptr<GameEntity> entity);
-	void SetEntities(std::vector<std::shared_ptr<GameEntity>> entities) { l_entities = entities; }
+	void SetEntities(std::vector<std::shared_ptr<GameEntity>> entities);
 	bool InsertEntity(const int index, std::shared_ptr<GameEntity> entity);
 	void AddEntity(std::shared_ptr<GameEntity> entity);
 
@@ -31,5 +51,14 @@ public:
 
 	void const DrawEntities(bool prepareMat = true);
 	void UpdateEntities(float dt);
+	//Refreshes this frame's render matrices, returns how many entities moved since last frame
+	int UpdateRenderMatrices();
+	//Recolours every debug sphere from its collider, the per frame update only touches ones that had an enter or exit
+	void RefreshDebugSpheres();
+
+	//Copies this frame's transform changes into the store and rebuilds the world matrices that moved. Call once
+	//at the end of the update, after everything has moved and before anything is drawn
+	void UpdateTransforms();
+	const TransformStore& GetTransformStore() const { return m_transformStore; }
 };
 
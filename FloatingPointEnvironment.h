@@ -0,0 +1,26 @@
+#pragma once
+
+#include <xmmintrin.h>
+
+//The SSE control register (rounding mode, flush to zero, denormals are zero and which exceptions
+//are masked). Every float the engine touches goes through SSE, DirectXMath included, so this is
+//all that can make the same code give different results. Each thread has its own copy
+namespace FloatingPointEnvironment
+{
+	//Round to nearest, denormals kept, every exception masked. What a new thread starts with
+	const unsigned int DETERMINISTIC = 0x1F80;
+
+	inline unsigned int Get() { return _mm_getcsr(); }
+	inline void Set(unsigned int state) { _mm_setcsr(state); }
+
+	//Switches the calling thread to state until it goes out of scope
+	class Scope
+	{
+	private:
+		unsigned int m_previous;
+
+	public:
+		Scope(unsigned int state) : m_previous(Get()) { Set(state); }
+		~Scope() { Set(m_previous); }
+	};
+}
@@ -0,0 +1,503 @@
+#include "GJK.h"
+
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	//EPA stops once a new support point gets less than this much further out than the closest face
+	const float EPA_TOLERANCE = .0001f;
+	//Anything shorter than this is treated as zero when checking directions and distances
+	const float GJK_EPSILON = .000001f;
+	//Search directions come out of cross products scaled by the simplex's size squared, so
+	//only treat them as zero when they're really tiny or near misses get called touching
+	const float GJK_ZERO_DIRECTION_SQ = 1e-14f;
+
+	struct EPAFace
+	{
+		int a, b, c;
+		XMFLOAT3 normal;
+		float distance;
+	};
+
+	bool SameDirection(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorGetX(XMVector3Dot(a, b)) > 0.0f;
+	}
+
+	XMVECTOR SupportDifference(const ConvexSupport& a, const ConvexSupport& b, FXMVECTOR direction)
+	{
+		return a.Support(direction) - b.Support(-direction);
+	}
+
+	//Winds the face so its normal points away from interior, a point known to be inside the polytope
+	void BuildFace(const XMVECTOR* verts, int a, int b, int c, FXMVECTOR interior, EPAFace& outFace)
+	{
+		XMVECTOR normal = XMVector3Cross(verts[b] - verts[a], verts[c] - verts[a]);
+		float length = XMVectorGetX(XMVector3Length(normal));
+
+		outFace.a = a;
+		outFace.b = b;
+		outFace.c = c;
+
+		//Sliver faces can't be trusted for a direction, keep them out of the running
+		if (length < GJK_EPSILON) {
+			outFace.normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			outFace.distance = FLT_MAX;
+			return;
+		}
+
+		normal /= length;
+		if (SameDirection(normal, interior - verts[a])) {
+			normal = -normal;
+			outFace.b = c;
+			outFace.c = b;
+		}
+
+		XMStoreFloat3(&outFace.normal, normal);
+		outFace.distance = XMVectorGetX(XMVector3Dot(normal, verts[a]));
+	}
+
+	//1 if the face runs from u to v along one of its edges, -1 if it runs from v to u, 0 if it doesn't have the edge
+	int EdgeDirection(const EPAFace& face, int u, int v)
+	{
+		const int corners[3] = { face.a, face.b, face.c };
+		for (int i = 0; i < 3; i++) {
+			int from = corners[i];
+			int to = corners[(i + 1) % 3];
+			if (from == u && to == v) {
+				return 1;
+			}
+			if (from == v && to == u) {
+				return -1;
+			}
+		}
+		return 0;
+	}
+
+	//Slivers have no normal of their own to test the new point against, but they're nearly in the
+	//plane of the faces around them. Winds the sliver to match its neighbours with real normals and
+	//makes it visible if the point isn't behind any of their planes, so it can't be left hanging
+	//off edges that are being replaced. False if it has no such neighbour or they don't agree
+	bool ResolveSliver(const XMVECTOR* verts, EPAFace* faces, int numFaces, int sliver, FXMVECTOR point, bool& outVisible)
+	{
+		EPAFace& face = faces[sliver];
+		bool oriented = false;
+		outVisible = false;
+
+		for (int i = 0; i < numFaces; i++) {
+			const EPAFace& neighbour = faces[i];
+			if (i == sliver || neighbour.distance == FLT_MAX) {
+				continue;
+			}
+
+			const int corners[3] = { face.a, face.b, face.c };
+			int shared = 0;
+			for (int e = 0; e < 3 && shared == 0; e++) {
+				shared = EdgeDirection(neighbour, corners[e], corners[(e + 1) % 3]);
+			}
+			if (shared == 0) {
+				continue;
+			}
+
+			//Faces either side of an edge run along it opposite ways
+			if (shared > 0) {
+				if (oriented) {
+					return false;
+				}
+				int temp = face.b;
+				face.b = face.c;
+				face.c = temp;
+			}
+			oriented = true;
+
+			if (XMVectorGetX(XMVector3Dot(XMLoadFloat3(&neighbour.normal), point - verts[neighbour.a])) >= 0.0f) {
+				outVisible = true;
+			}
+		}
+
+		return oriented;
+	}
+
+	//Removes the edge if its reverse is already there (both faces sharing it are going), otherwise adds it
+	void AddHorizonEdge(int edges[][2], int& numEdges, int a, int b)
+	{
+		for (int i = 0; i < numEdges; i++) {
+			if (edges[i][0] == b && edges[i][1] == a) {
+				edges[i][0] = edges[numEdges - 1][0];
+				edges[i][1] = edges[numEdges - 1][1];
+				numEdges--;
+				return;
+			}
+		}
+
+		edges[numEdges][0] = a;
+		edges[numEdges][1] = b;
+		numEdges++;
+	}
+}
+
+XMVECTOR ConvexSupport::Support(FXMVECTOR direction) const
+{
+	XMMATRIX worldMat = XMLoadFloat4x4(&world);
+
+	//p . d in world space is the local point dotted with each world row dotted with d,
+	//so the local direction is just d against the rows
+	XMFLOAT3 localDirection(
+		XMVectorGetX(XMVector3Dot(worldMat.r[0], direction)),
+		XMVectorGetX(XMVector3Dot(worldMat.r[1], direction)),
+		XMVectorGetX(XMVector3Dot(worldMat.r[2], direction)));
+
+	int index = hull->FindSupportIndex(localDirection, supportHint ? *supportHint : 0);
+	if (supportHint) {
+		*supportHint = index;
+	}
+
+	return XMVector3Transform(XMLoadFloat3(&hull->GetVertex(index)), worldMat);
+}
+
+//Implementation based on https://www.youtube.com/watch?v=Qupqu1xe7Io
+bool GJK::Intersect(const ConvexSupport& a, const ConvexSupport& b, GJKSimplex& outSimplex)
+{
+	XMVECTOR points[4];
+	int count = 0;
+
+	//Start looking from one center towards the other
+	XMVECTOR direction = XMVectorSet(b.world._41 - a.world._41, b.world._42 - a.world._42, b.world._43 - a.world._43, 0.0f);
+	if (XMVectorGetX(XMVector3LengthSq(direction)) < GJK_EPSILON) {
+		direction = XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+	}
+
+	points[0] = SupportDifference(a, b, direction);
+	count = 1;
+	direction = -points[0];
+
+	bool intersecting = false;
+	for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++) {
+		//Origin is right on the simplex, the shapes are just touching
+		if (XMVectorGetX(XMVector3LengthSq(direction)) < GJK_ZERO_DIRECTION_SQ) {
+			intersecting = true;
+			break;
+		}
+
+		XMVECTOR newPoint = SupportDifference(a, b, direction);
+
+		//Couldn't get past the origin, so it's outside the difference
+		if (!SameDirection(newPoint, direction)) {
+			break;
+		}
+
+		//Newest point goes first
+		for (int i = count; i > 0; i--) {
+			points[i] = points[i - 1];
+		}
+		points[0] = newPoint;
+		count++;
+
+		if (DoSimplex(points, count, direction)) {
+			intersecting = true;
+			break;
+		}
+	}
+
+	outSimplex.count = count;
+	for (int i = 0; i < count; i++) {
+		XMStoreFloat3(&outSimplex.points[i], points[i]);
+	}
+
+	return intersecting;
+}
+
+bool GJK::DoSimplex(XMVECTOR points[4], int& count, XMVECTOR& direction)
+{
+	switch (count) {
+	case 2:
+		return LineCase(points, count, direction);
+
+	case 3:
+		return TriangleCase(points, count, direction);
+
+	case 4:
+		return TetrahedronCase(points, count, direction);
+
+	default:
+		break;
+	}
+
+	return false;
+}
+
+bool GJK::LineCase(XMVECTOR points[4], int& count, XMVECTOR& direction)
+{
+	XMVECTOR ab = points[1] - points[0];
+	XMVECTOR ao = -points[0];
+
+	if (SameDirection(ab, ao)) {
+		direction = XMVector3Cross(XMVector3Cross(ab, ao), ab);
+	}
+	else {
+		count = 1;
+		direction = ao;
+	}
+
+	return false;
+}
+
+bool GJK::TriangleCase(XMVECTOR points[4], int& count, XMVECTOR& direction)
+{
+	XMVECTOR a = points[0];
+	XMVECTOR b = points[1];
+	XMVECTOR c = points[2];
+
+	XMVECTOR ab = b - a;
+	XMVECTOR ac = c - a;
+	XMVECTOR ao = -a;
+	XMVECTOR abc = XMVector3Cross(ab, ac);
+
+	// Plane ABC x Vector AC
+	if (SameDirection(XMVector3Cross(abc, ac), ao)) {
+		if (SameDirection(ac, ao)) {
+			points[1] = c;
+			count = 2;
+			direction = XMVector3Cross(XMVector3Cross(ac, ao), ac);
+			return false;
+		}
+
+		count = 2;
+		return LineCase(points, count, direction);
+	}
+
+	if (SameDirection(XMVector3Cross(ab, abc), ao)) {
+		count = 2;
+		return LineCase(points, count, direction);
+	}
+
+	//Above or below the triangle, keep the winding so the normal faces the origin
+	if (SameDirection(abc, ao)) {
+		direction = abc;
+	}
+	else {
+		points[1] = c;
+		points[2] = b;
+		direction = -abc;
+	}
+
+	return false;
+}
+
+bool GJK::TetrahedronCase(XMVECTOR points[4], int& count, XMVECTOR& direction)
+{
+	XMVECTOR a = points[0];
+	XMVECTOR b = points[1];
+	XMVECTOR c = points[2];
+	XMVECTOR d = points[3];
+
+	XMVECTOR ab = b - a;
+	XMVECTOR ac = c - a;
+	XMVECTOR ad = d - a;
+	XMVECTOR ao = -a;
+
+	XMVECTOR abc = XMVector3Cross(ab, ac);
+	XMVECTOR acd = XMVector3Cross(ac, ad);
+	XMVECTOR adb = XMVector3Cross(ad, ab);
+
+	count = 3;
+
+	if (SameDirection(abc, ao)) {
+		return TriangleCase(points, count, direction);
+	}
+
+	if (SameDirection(acd, ao)) {
+		points[1] = c;
+		points[2] = d;
+		return TriangleCase(points, count, direction);
+	}
+
+	if (SameDirection(adb, ao)) {
+		points[1] = d;
+		points[2] = b;
+		return TriangleCase(points, count, direction);
+	}
+
+	//Origin is behind every face
+	count = 4;
+	return true;
+}
+
+bool GJK::Penetration(const ConvexSupport& a, const ConvexSupport& b, const GJKSimplex& simplex, PenetrationInfo& outPenetration)
+{
+	XMVECTOR verts[MAX_EPA_VERTICES];
+	int numVerts = simplex.count;
+	if (numVerts == 0) {
+		return false;
+	}
+
+	for (int i = 0; i < numVerts; i++) {
+		verts[i] = XMLoadFloat3(&simplex.points[i]);
+	}
+
+	//GJK can stop early when the origin sits right on a point, edge or face of the
+	//simplex. Push out in directions that can't be on that feature until it's a tetrahedron
+	const XMVECTOR axes[3] = {
+		XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f),
+		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f),
+		XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f),
+	};
+	while (numVerts < 4) {
+		XMVECTOR directions[6];
+		int numDirections = 0;
+
+		if (numVerts == 1) {
+			for (int i = 0; i < 3; i++) {
+				directions[numDirections++] = axes[i];
+				directions[numDirections++] = -axes[i];
+			}
+		}
+		else if (numVerts == 2) {
+			XMVECTOR line = verts[1] - verts[0];
+			for (int i = 0; i < 3; i++) {
+				XMVECTOR perpendicular = XMVector3Cross(line, axes[i]);
+				directions[numDirections++] = perpendicular;
+				directions[numDirections++] = -perpendicular;
+			}
+		}
+		else {
+			XMVECTOR normal = XMVector3Cross(verts[1] - verts[0], verts[2] - verts[0]);
+			directions[numDirections++] = normal;
+			directions[numDirections++] = -normal;
+		}
+
+		bool added = false;
+		for (int i = 0; i < numDirections && !added; i++) {
+			if (XMVectorGetX(XMVector3LengthSq(directions[i])) < GJK_EPSILON) {
+				continue;
+			}
+
+			XMVECTOR point = SupportDifference(a, b, directions[i]);
+			XMVECTOR offset = point - verts[0];
+
+			//How far the new point is off the current point, line or plane
+			float distance;
+			if (numVerts == 1) {
+				distance = XMVectorGetX(XMVector3Length(offset));
+			}
+			else if (numVerts == 2) {
+				XMVECTOR line = XMVector3Normalize(verts[1] - verts[0]);
+				distance = XMVectorGetX(XMVector3Length(XMVector3Cross(offset, line)));
+			}
+			else {
+				XMVECTOR normal = XMVector3Normalize(XMVector3Cross(verts[1] - verts[0], verts[2] - verts[0]));
+				distance = fabsf(XMVectorGetX(XMVector3Dot(offset, normal)));
+			}
+
+			if (distance > GJK_EPSILON) {
+				verts[numVerts++] = point;
+				added = true;
+			}
+		}
+
+		//Flat difference, there's no depth to measure
+		if (!added) {
+			return false;
+		}
+	}
+
+	XMVECTOR interior = (verts[0] + verts[1] + verts[2] + verts[3]) * 0.25f;
+
+	EPAFace faces[MAX_EPA_FACES];
+	int numFaces = 0;
+	BuildFace(verts, 0, 1, 2, interior, faces[numFaces++]);
+	BuildFace(verts, 0, 3, 1, interior, faces[numFaces++]);
+	BuildFace(verts, 0, 2, 3, interior, faces[numFaces++]);
+	BuildFace(verts, 1, 3, 2, interior, faces[numFaces++]);
+
+	int edges[MAX_EPA_FACES * 3][2];
+	bool visible[MAX_EPA_FACES];
+	int closest = 0;
+
+	for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++) {
+		closest = 0;
+		for (int i = 1; i < numFaces; i++) {
+			if (faces[i].distance < faces[closest].distance) {
+				closest = i;
+			}
+		}
+
+		XMVECTOR normal = XMLoadFloat3(&faces[closest].normal);
+		XMVECTOR point = SupportDifference(a, b, normal);
+		float pointDistance = XMVectorGetX(XMVector3Dot(point, normal));
+
+		//Can't push the closest face out any further, it's on the real boundary
+		if (pointDistance - faces[closest].distance < EPA_TOLERANCE || numVerts == MAX_EPA_VERTICES) {
+			break;
+		}
+
+		//Every face the new point can see goes, what's left around them is the horizon
+		for (int i = 0; i < numFaces; i++) {
+			visible[i] = faces[i].distance != FLT_MAX &&
+				SameDirection(XMLoadFloat3(&faces[i].normal), point - verts[faces[i].a]);
+		}
+
+		//A sliver that can't be placed would leave a hole, the closest face so far has to do
+		bool unresolved = false;
+		for (int i = 0; i < numFaces && !unresolved; i++) {
+			if (faces[i].distance == FLT_MAX) {
+				unresolved = !ResolveSliver(verts, faces, numFaces, i, point, visible[i]);
+			}
+		}
+		if (unresolved) {
+			break;
+		}
+
+		int numEdges = 0;
+		int numVisible = 0;
+		for (int i = 0; i < numFaces; i++) {
+			if (visible[i]) {
+				numVisible++;
+				AddHorizonEdge(edges, numEdges, faces[i].a, faces[i].b);
+				AddHorizonEdge(edges, numEdges, faces[i].b, faces[i].c);
+				AddHorizonEdge(edges, numEdges, faces[i].c, faces[i].a);
+			}
+		}
+
+		//Out of room, the closest face is as good as it gets
+		if (numFaces - numVisible + numEdges > MAX_EPA_FACES) {
+			break;
+		}
+
+		int kept = 0;
+		for (int i = 0; i < numFaces; i++) {
+			if (!visible[i]) {
+				faces[kept++] = faces[i];
+			}
+		}
+		numFaces = kept;
+
+		int newVert = numVerts++;
+		verts[newVert] = point;
+		for (int i = 0; i < numEdges; i++) {
+			BuildFace(verts, edges[i][0], edges[i][1], newVert, interior, faces[numFaces++]);
+		}
+
+		if (numFaces == 0) {
+			return false;
+		}
+	}
+
+	closest = 0;
+	for (int i = 1; i < numFaces; i++) {
+		if (faces[i].distance < faces[closest].distance) {
+			closest = i;
+		}
+	}
+
+	if (faces[closest].distance == FLT_MAX) {
+		return false;
+	}
+
+	outPenetration.normal = faces[closest].normal;
+	outPenetration.depth = faces[closest].distance > 0.0f ? faces[closest].distance : 0.0f;
+	return true;
+}
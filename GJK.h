@@ -0,0 +1,74 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "ConvexHull.h"
+
+//A convex hull placed in the world. Support points are found in the hull's local
+//space by turning the direction around instead of moving every vertex, so only
+//the winning vertex ever gets transformed
+struct ConvexSupport
+{
+	const ConvexHull* hull;
+	DirectX::XMFLOAT4X4 world;
+	//Optional vertex to start the hull's uphill search from, updated with each answer.
+	//Successive directions are close together so the search barely has to move
+	int* supportHint;
+
+	ConvexSupport(const ConvexHull* in_hull, const DirectX::XMFLOAT4X4& in_world, int* in_supportHint = nullptr)
+		: hull(in_hull),
+		world(in_world),
+		supportHint(in_supportHint)
+	{
+	}
+
+	//World space point on the hull furthest along direction
+	DirectX::XMVECTOR Support(DirectX::FXMVECTOR direction) const;
+};
+
+//Points of the Minkowski difference (a - b) GJK ended on, newest first
+struct GJKSimplex
+{
+	DirectX::XMFLOAT3 points[4];
+	int count;
+
+	GJKSimplex()
+		: count(0)
+	{
+	}
+};
+
+//How far two shapes overlap. normal points from a towards b, moving a back along it
+//by depth (or b forward) just separates them
+struct PenetrationInfo
+{
+	DirectX::XMFLOAT3 normal;
+	float depth;
+};
+
+//Gilbert-Johnson-Keerthi intersection test and the expanding polytope algorithm for
+//penetration depth, between any two convex hulls. Everything is kept in fixed size
+//arrays so neither allocates
+class GJK
+{
+public:
+	static const int MAX_ITERATIONS = 64;
+	//EPA gives up refining and returns the best face so far once it hits either limit
+	static const int MAX_EPA_VERTICES = 64;
+	static const int MAX_EPA_FACES = 128;
+
+	//True if the shapes overlap. outSimplex holds the simplex it finished with,
+	//which is what Penetration starts expanding from
+	static bool Intersect(const ConvexSupport& a, const ConvexSupport& b, GJKSimplex& outSimplex);
+
+	//Only meaningful after Intersect returned true for the same shapes
+	static bool Penetration(const ConvexSupport& a, const ConvexSupport& b, const GJKSimplex& simplex, PenetrationInfo& outPenetration);
+
+private:
+	//Works out which part of the simplex is closest to the origin, drops the rest
+	//and picks the next search direction. Returns true once it encloses the origin
+	static bool DoSimplex(DirectX::XMVECTOR points[4], int& count, DirectX::XMVECTOR& direction);
+	static bool LineCase(DirectX::XMVECTOR points[4], int& count, DirectX::XMVECTOR& direction);
+	static bool TriangleCase(DirectX::XMVECTOR points[4], int& count, DirectX::XMVECTOR& direction);
+	static bool TetrahedronCase(DirectX::XMVECTOR points[4], int& count, DirectX::XMVECTOR& direction);
+};
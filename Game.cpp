@@ -2,6 +2,13 @@
 #include "Vertex.h"
 #include "Input.h"
 #include "BufferStructs.h"
+#include "CollisionManager.h"
+#include "JobSystem.h"
+#include "PhysicsBenchmarks.h"
+#include "PhysicsReplay.h"
+#include "PhysicsWorld.h"
+#include "SceneQuery.h"
+#include "TransformBenchmarks.h"
 
 #include "imgui.h"
 #include "imgui_impl_dx11.h"
@@ -13,6 +20,8 @@
 #pragma comment(lib, "d3dcompiler.lib")
 #include <d3dcompiler.h>
 
+#include <cstring>
+
 // For the DirectX Math library
 using namespace DirectX;
 
@@ -305,44 +314,18 @@ void Game::LoadShaders()
 // --------------------------------------------------------
 void Game::CreateBasicGeometry()
 {
-	//load object meshes
-	meshes.push_back(std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cylinder.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/helix.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/quad.obj").c_str(), device, context));
+	//load object meshes, nothing needs the full vertices on the CPU once they're uploaded, only positions for physics
+	meshes.push_back(std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device, context, MESH_CPU_POSITIONS));
+	meshes.push_back(std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cylinder.obj").c_str(), device, context, MESH_CPU_POSITIONS));
+	meshes.push_back(std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/helix.obj").c_str(), device, context, MESH_CPU_POSITIONS));
+	meshes.push_back(std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device, context, MESH_CPU_POSITIONS));
+	meshes.push_back(std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/quad.obj").c_str(), device, context, MESH_CPU_POSITIONS));
   
-	std::vector<Vertex> verts = meshes[3]->GetVerticies();
-
-	XMFLOAT4 currPos = XMFLOAT4(verts[0].Position.x, verts[0].Position.y, verts[0].Position.z, 1.0f);
-
-	//Inefficient could probs be better done through a compute shader
-	float xMax = currPos.x;
-	float xMin = currPos.x;
-
-	float yMax = currPos.y;
-	float yMin = currPos.y;
-
-	float zMax = currPos.z;
-	float zMin = currPos.z;
-	for (int i = 1; i < verts.size(); i++)
-	{
-		currPos = XMFLOAT4(verts[i].Position.x, verts[i].Position.y, verts[i].Position.z, 1.0f);
-
-		xMax = currPos.x > xMax ? currPos.x : xMax;
-		xMin = currPos.x < xMin ? currPos.x : xMin;
-
-		yMax = currPos.y > yMax ? currPos.y : yMax;
-		yMin = currPos.y < yMin ? currPos.y : yMin;
-
-		zMax = currPos.z > zMax ? currPos.z : zMax;
-		zMin = currPos.z < zMin ? currPos.z : zMin;
-	}
-
-	Collider::SetDebugSphereMeshRadius(powf((xMax-xMin) / 2, 2) + powf((yMax - yMin) / 2, 2) + powf((zMax - zMin) / 2, 2));
+	XMFLOAT3 sphereExtents = meshes[3]->GetLocalBounds().GetExtents();
+	Collider::SetDebugSphereMeshRadius(powf(sphereExtents.x, 2) + powf(sphereExtents.y, 2) + powf(sphereExtents.z, 2));
   
 	//toon meshes
-	toonMeshes.push_back(std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/Tree.obj").c_str(), device, context));
+	toonMeshes.push_back(std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/Tree.obj").c_str(), device, context, MESH_CPU_POSITIONS));
 
 	//std::shared_ptr<Mesh> catapult = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/catapult.obj").c_str(), device, context);
 
@@ -382,6 +365,17 @@ void Game::CreateBasicGeometry()
 	m_EntityManager->GetEntity(6)->GetTransform()->Rotate(XMFLOAT3(-1 * XM_PIDIV2, 0, 0));
 	m_EntityManager->GetEntity(6)->GetTransform()->Scale(20);//scale up a bunch to act as floor
 
+	//floor only ever rests things on it, the light marker just reports what passes through it
+	//and debug spheres are drawn but never collide. None of these pairs make it to SAT
+	Collider::SetLayersCollide(LAYER_STATIC, LAYER_STATIC, false);
+	Collider::SetLayersCollide(LAYER_TRIGGER, LAYER_STATIC, false);
+	for (int layer = 0; layer < Collider::MAX_LAYERS; layer++) {
+		Collider::SetLayersCollide(LAYER_DEBUG, layer, false);
+	}
+	m_EntityManager->GetEntity(6)->GetCollider()->SetLayer(LAYER_STATIC);
+	m_EntityManager->GetEntity(7)->GetCollider()->SetLayer(LAYER_TRIGGER);
+	m_EntityManager->GetEntity(7)->GetCollider()->SetTrigger(true);
+
 	//catapult
 	//if (catapult->GetVertexBuffer()) {
 	//	meshes.push_back(catapult);
@@ -654,7 +648,7 @@ void Game::RenderDirectionalShadowMap(XMFLOAT3 dir)
 		std::shared_ptr<GameEntity> entity = m_EntityManager->GetEntity(i);
 
 		//set this game entity's world mat, send to gpu
-		shadowVertexShader->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
+		shadowVertexShader->SetData("world", &entity->GetRenderWorldMatrix(), sizeof(DirectX::XMFLOAT3X4));
 		//copy data over
 		shadowVertexShader->CopyAllBufferData();
 
@@ -739,7 +733,7 @@ void Game::RenderPointShadowMap(DirectX::XMFLOAT3 pos, int index, float range, f
 		std::shared_ptr<GameEntity> entity = m_EntityManager->GetEntity(i);
 
 		//set this game entity's world mat, send to gpu
-		shadowVertexShader->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
+		shadowVertexShader->SetData("world", &entity->GetRenderWorldMatrix(), sizeof(DirectX::XMFLOAT3X4));
 		//copy data over
 		shadowVertexShader->CopyAllBufferData();
 
@@ -776,7 +770,7 @@ void Game::RenderPointShadowMap(DirectX::XMFLOAT3 pos, int index, float range, f
 		std::shared_ptr<GameEntity> entity = m_EntityManager->GetEntity(i);
     
 		//set this game entity's world mat, send to gpu
-		shadowVertexShader->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
+		shadowVertexShader->SetData("world", &entity->GetRenderWorldMatrix(), sizeof(DirectX::XMFLOAT3X4));
 		//copy data over
 		shadowVertexShader->CopyAllBufferData();
 
@@ -812,7 +806,7 @@ void Game::RenderPointShadowMap(DirectX::XMFLOAT3 pos, int index, float range, f
 		std::shared_ptr<GameEntity> entity = m_EntityManager->GetEntity(i);
 
 		//set this game entity's world mat, send to gpu
-		shadowVertexShader->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
+		shadowVertexShader->SetData("world", &entity->GetRenderWorldMatrix(), sizeof(DirectX::XMFLOAT3X4));
 		//copy data over
 		shadowVertexShader->CopyAllBufferData();
 
@@ -850,7 +844,7 @@ void Game::RenderPointShadowMap(DirectX::XMFLOAT3 pos, int index, float range, f
 		std::shared_ptr<GameEntity> entity = m_EntityManager->GetEntity(i);
 
 		//set this game entity's world mat, send to gpu
-		shadowVertexShader->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
+		shadowVertexShader->SetData("world", &entity->GetRenderWorldMatrix(), sizeof(DirectX::XMFLOAT3X4));
 		//copy data over
 		shadowVertexShader->CopyAllBufferData();
 
@@ -886,7 +880,7 @@ void Game::RenderPointShadowMap(DirectX::XMFLOAT3 pos, int index, float range, f
 		std::shared_ptr<GameEntity> entity = m_EntityManager->GetEntity(i);
 
 		//set this game entity's world mat, send to gpu
-		shadowVertexShader->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
+		shadowVertexShader->SetData("world", &entity->GetRenderWorldMatrix(), sizeof(DirectX::XMFLOAT3X4));
 		//copy data over
 		shadowVertexShader->CopyAllBufferData();
 
@@ -922,7 +916,7 @@ void Game::RenderPointShadowMap(DirectX::XMFLOAT3 pos, int index, float range, f
 		std::shared_ptr<GameEntity> entity = m_EntityManager->GetEntity(i);
 
 		//set this game entity's world mat, send to gpu
-		shadowVertexShader->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
+		shadowVertexShader->SetData("world", &entity->GetRenderWorldMatrix(), sizeof(DirectX::XMFLOAT3X4));
 		//copy data over
 		shadowVertexShader->CopyAllBufferData();
 
@@ -998,7 +992,7 @@ void Game::RenderSpotShadowMap(DirectX::XMFLOAT3 pos, DirectX::XMFLOAT3 dir, flo
 		std::shared_ptr<GameEntity> entity = m_EntityManager->GetEntity(i);
 
 		//set this game entity's world mat, send to gpu
-		shadowVertexShader->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
+		shadowVertexShader->SetData("world", &entity->GetRenderWorldMatrix(), sizeof(DirectX::XMFLOAT3X4));
 		//copy data over
 		shadowVertexShader->CopyAllBufferData();
 
@@ -1078,6 +1072,11 @@ void Game::CreateGui(float deltaTime) {
 		}
 
 		ImGui::Text("FPS: %i", lastFrameCount);
+		ImGui::Text("Transforms Changed: %i, %i entities moved, shadow maps %s",
+			static_cast<int>(Transform::GetChangedThisFrame().size()), entitiesMoved, shadowsRedrawn ? "redrawn" : "kept");
+		const TransformStore& transformStore = m_EntityManager->GetTransformStore();
+		ImGui::Text("Transform Store: %i nodes in %i levels, %i world matrices rebuilt last frame",
+			transformStore.Size(), transformStore.NumLevels(), transformStore.NumUpdated());
 
 		ImGui::PushID(1);
 		bool entitiesOpen = ImGui::TreeNode("Entities", "%s", "Entities");
@@ -1104,22 +1103,47 @@ void Game::CreateGui(float deltaTime) {
 				DirectX::XMFLOAT3 position = entityTransform->GetPosition();
 				ImGui::Text("Position: ");
 				ImGui::SameLine();
-				ImGui::DragFloat3("", &position.x, .5f, -D3D11_FLOAT32_MAX, D3D11_FLOAT32_MAX);
-				entityTransform->SetPosition(position);
+				if (ImGui::DragFloat3("", &position.x, .5f, -D3D11_FLOAT32_MAX, D3D11_FLOAT32_MAX)) {
+					entityTransform->SetPosition(position);
+				}
 
-				//Allows for control over rotation of entities
+				//Allows for control over rotation of entities. Angles are worked out from the quaternion,
+				//only set back when dragged so they don't round trip every frame
 				DirectX::XMFLOAT3 rotation = entityTransform->GetEulerAngles();
 				ImGui::Text("Rotation: ");
 				ImGui::SameLine();
-				ImGui::DragFloat3(" ", &rotation.x, .05f, -DirectX::XM_PI, DirectX::XM_PI);
-				entityTransform->SetRotation(rotation);
+				if (ImGui::DragFloat3(" ", &rotation.x, .05f, -DirectX::XM_PI, DirectX::XM_PI)) {
+					entityTransform->SetRotation(rotation);
+				}
 
 				//Allows for control over scale of entities
 				DirectX::XMFLOAT3 scale = entityTransform->GetScale();
 				ImGui::Text("Scale: ");
 				ImGui::SameLine();
-				ImGui::DragFloat3("  ", &scale.x, .25f, 0.0f, D3D11_FLOAT32_MAX);
-				entityTransform->SetScale(scale);
+				if (ImGui::DragFloat3("  ", &scale.x, .25f, 0.0f, D3D11_FLOAT32_MAX)) {
+					entityTransform->SetScale(scale);
+				}
+
+				//0 keeps it static
+				std::shared_ptr<RigidBody> rigidBody = currEntity->GetRigidBody();
+				if (rigidBody)
+				{
+					float mass = rigidBody->GetMass();
+					ImGui::Text("Mass: ");
+					ImGui::SameLine();
+					if (ImGui::DragFloat("    ", &mass, .1f, 0.0f, D3D11_FLOAT32_MAX))
+					{
+						rigidBody->SetMass(mass);
+					}
+
+					float restitution = rigidBody->GetRestitution();
+					ImGui::Text("Restitution: ");
+					ImGui::SameLine();
+					if (ImGui::DragFloat("     ", &restitution, .01f, 0.0f, 1.0f))
+					{
+						rigidBody->SetRestitution(restitution);
+					}
+				}
 
 				int numChildren = entityTransform->GetNumChildren();
 				//First transform is debug sphere
@@ -1335,6 +1359,240 @@ void Game::CreateGui(float deltaTime) {
 		}
 
 		ImGui::PopID();
+
+		ImGui::PushID(5);
+		bool physicsOpen = ImGui::TreeNode("Physics", "%s", "Physics");
+		if (physicsOpen)
+		{
+			std::shared_ptr<CollisionManager> collisionManager = CollisionManager::GetInstance();
+			ImGui::Text("Colliders: %i", collisionManager->NumColliders());
+			ImGui::Text("Candidate Pairs: %i", collisionManager->NumCandidatePairs());
+			ImGui::Text("Colliding Pairs: %i", collisionManager->NumCollidingPairs());
+			ImGui::Text("SAT Tests: %i", collisionManager->NumSATTests());
+			ImGui::Text("Cached Axis Early Outs: %i / %i (%.1f%%)",
+				collisionManager->NumSATCacheEarlyOuts(),
+				collisionManager->NumSATCachedAxisTests(),
+				collisionManager->GetSATCacheHitRate() * 100.0f);
+			ImGui::Text("GJK Tests: %i", collisionManager->NumGJKTests());
+			ImGui::Text("Contact Points: %i", collisionManager->NumContactPoints());
+
+			std::shared_ptr<PhysicsWorld> physicsWorld = PhysicsWorld::GetInstance();
+			ImGui::Text("Bodies: %i", physicsWorld->NumBodies());
+			ImGui::Text("Contact Constraints: %i", physicsWorld->NumContactConstraints());
+			ImGui::Text("Joints: %i (%i solved)", physicsWorld->NumJoints(), physicsWorld->NumJointConstraints());
+			ImGui::Text("Solver: %.3f ms", physicsWorld->GetSolverMs());
+			ImGui::Text("Islands: %i", physicsWorld->NumIslands());
+			ImGui::Text("Sleeping Bodies: %i", physicsWorld->NumSleepingBodies());
+			ImGui::Text("Sleeping Pairs Skipped: %i", collisionManager->NumSleepingPairs());
+			ImGui::Text("Layer Filtered Pairs: %i", collisionManager->NumFilteredPairs());
+			ImGui::Text("Trigger Pairs: %i", collisionManager->NumTriggerPairs());
+			ImGui::Text("Solver Jobs: %i islands, %i split into %i colours",
+				physicsWorld->GetContactSolver().NumIslandJobs(),
+				physicsWorld->GetContactSolver().NumSplitIslands(),
+				physicsWorld->GetContactSolver().NumColors());
+			ImGui::Text("CCD Bodies: %i swept, %i stopped short", physicsWorld->NumSweptBodies(), physicsWorld->NumClampedBodies());
+			ImGui::Text("Steps This Frame: %i (blend %.2f)", physicsWorld->GetLastSubSteps(), physicsWorld->GetInterpolationAlpha());
+
+			const CollisionEventBuffer& collisionEvents = physicsWorld->GetCollisionEvents();
+			int enters = 0;
+			int exits = 0;
+			for (const CollisionRecord& record : collisionEvents.GetRecords()) {
+				enters += record.type == COLLISION_BEGIN ? 1 : 0;
+				exits += record.type == COLLISION_END ? 1 : 0;
+			}
+			ImGui::Text("Collision Records: %i (%i enter, %i exit) from %i steps",
+				collisionEvents.NumRecords(), enters, exits, collisionEvents.NumSteps());
+			ImGui::Text("Record Buffers: room for %i, grown %i times", collisionEvents.GetCapacity(), collisionEvents.NumGrowths());
+
+			//Whatever is straight ahead of the camera, through the scene query tree
+			std::shared_ptr<SceneQuery> sceneQuery = SceneQuery::GetInstance();
+			Transform* cameraTransform = camera->GetTransform();
+			QueryHit lookHit;
+			if (sceneQuery->Raycast(Ray(cameraTransform->GetPosition(), cameraTransform->GetForward(), 1000.0f), lookHit)) {
+				ImGui::Text("Looking At: layer %i collider, %.2f away", lookHit.collider->GetLayer(), lookHit.distance);
+			}
+			else {
+				ImGui::Text("Looking At: nothing");
+			}
+			ImGui::Text("Query Tree: %i colliders, %i nodes, %i rebuilds",
+				sceneQuery->NumColliders(),
+				sceneQuery->GetTree().NumNodes(),
+				sceneQuery->GetTree().NumBuilds());
+
+			float tickRate = physicsWorld->GetTickRate();
+			ImGui::Text("Tick Rate (Hz): ");
+			ImGui::SameLine();
+			if (ImGui::SliderFloat("   ", &tickRate, 10.0f, 240.0f, "%.0f"))
+			{
+				physicsWorld->SetTickRate(tickRate);
+			}
+
+			int maxSubSteps = physicsWorld->GetMaxSubSteps();
+			ImGui::Text("Max Steps Per Frame: ");
+			ImGui::SameLine();
+			if (ImGui::SliderInt("    ", &maxSubSteps, 1, 16))
+			{
+				physicsWorld->SetMaxSubSteps(maxSubSteps);
+			}
+
+			//Order has to match eBroadphaseType
+			const char* broadphaseItems[] = { "AABB Tree", "Sweep and Prune", "Spatial Hash" };
+			int broadphaseType = collisionManager->GetBroadphaseType();
+			ImGui::Text("Broadphase: ");
+			ImGui::SameLine();
+			if (ImGui::Combo(" ", &broadphaseType, broadphaseItems, IM_ARRAYSIZE(broadphaseItems)))
+			{
+				collisionManager->SetBroadphaseType(static_cast<eBroadphaseType>(broadphaseType));
+			}
+
+			bool useBatchedSAT = collisionManager->GetUseBatchedSAT();
+			if (ImGui::Checkbox("Batched SAT", &useBatchedSAT))
+			{
+				collisionManager->SetUseBatchedSAT(useBatchedSAT);
+			}
+
+			bool useConvexHulls = collisionManager->GetUseConvexHulls();
+			if (ImGui::Checkbox("Convex Hulls (GJK)", &useConvexHulls))
+			{
+				collisionManager->SetUseConvexHulls(useConvexHulls);
+			}
+
+			ContactSolver& contactSolver = physicsWorld->GetContactSolver();
+			int solverIterations = contactSolver.GetIterations();
+			ImGui::Text("Solver Iterations: ");
+			ImGui::SameLine();
+			if (ImGui::SliderInt("  ", &solverIterations, 1, 50))
+			{
+				contactSolver.SetIterations(solverIterations);
+			}
+
+			bool warmStarting = contactSolver.GetWarmStarting();
+			if (ImGui::Checkbox("Warm Starting", &warmStarting))
+			{
+				contactSolver.SetWarmStarting(warmStarting);
+			}
+
+			bool sleeping = physicsWorld->GetIslands().GetSleepingEnabled();
+			if (ImGui::Checkbox("Sleeping", &sleeping))
+			{
+				physicsWorld->GetIslands().SetSleepingEnabled(sleeping);
+			}
+
+			bool deterministic = physicsWorld->IsDeterministic();
+			if (ImGui::Checkbox("Deterministic", &deterministic))
+			{
+				physicsWorld->SetDeterministic(deterministic);
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Save Snapshot"))
+			{
+				physicsWorld->SaveSnapshot(physicsSnapshot);
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Restore Snapshot"))
+			{
+				//Fails if bodies were added or removed since it was saved
+				if (!physicsWorld->RestoreSnapshot(physicsSnapshot))
+				{
+					printf("Physics snapshot doesn't match the current bodies\n");
+				}
+			}
+			if (physicsSnapshot.GetSize() > 0)
+			{
+				ImGui::SameLine();
+				ImGui::Text("%zu bytes, hash %016llx", physicsSnapshot.GetSize(), physicsSnapshot.Hash());
+			}
+
+			int physicsThreads = JobSystem::GetInstance()->GetThreadCount();
+			ImGui::Text("Solver Threads: ");
+			ImGui::SameLine();
+			if (ImGui::SliderInt("     ", &physicsThreads, 1, JobSystem::GetHardwareThreads()))
+			{
+				JobSystem::GetInstance()->SetThreadCount(physicsThreads);
+			}
+
+			//Benchmarks block the frame until they finish, results also go to the console
+			if (ImGui::Button("Run Broadphase Benchmark"))
+			{
+				physicsBenchmarkResults = PhysicsBenchmarks::RunBroadphaseBenchmark();
+				printf("%s", physicsBenchmarkResults.c_str());
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Run Spatial Hash Benchmark"))
+			{
+				physicsBenchmarkResults = PhysicsBenchmarks::RunSpatialHashBenchmark();
+				printf("%s", physicsBenchmarkResults.c_str());
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Run SAT Benchmark"))
+			{
+				physicsBenchmarkResults = PhysicsBenchmarks::RunSATBenchmark();
+				printf("%s", physicsBenchmarkResults.c_str());
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Run Stacking Benchmark"))
+			{
+				physicsBenchmarkResults = PhysicsBenchmarks::RunStackingBenchmark();
+				printf("%s", physicsBenchmarkResults.c_str());
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Run Sleeping Benchmark"))
+			{
+				physicsBenchmarkResults = PhysicsBenchmarks::RunSleepingBenchmark();
+				printf("%s", physicsBenchmarkResults.c_str());
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Run Thread Scaling Benchmark"))
+			{
+				physicsBenchmarkResults = PhysicsBenchmarks::RunThreadScalingBenchmark();
+				printf("%s", physicsBenchmarkResults.c_str());
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Run CCD Benchmark"))
+			{
+				physicsBenchmarkResults = PhysicsBenchmarks::RunContinuousCollisionBenchmark();
+				printf("%s", physicsBenchmarkResults.c_str());
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Run Joint Benchmark"))
+			{
+				physicsBenchmarkResults = PhysicsBenchmarks::RunJointBenchmark();
+				printf("%s", physicsBenchmarkResults.c_str());
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Run Scene Query Benchmark"))
+			{
+				physicsBenchmarkResults = PhysicsBenchmarks::RunSceneQueryBenchmark();
+				printf("%s", physicsBenchmarkResults.c_str());
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Run Transform Benchmark"))
+			{
+				physicsBenchmarkResults = TransformBenchmarks::RunHierarchyBenchmark();
+				printf("%s", physicsBenchmarkResults.c_str());
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Run Transform Threads Benchmark"))
+			{
+				physicsBenchmarkResults = TransformBenchmarks::RunThreadScalingBenchmark();
+				printf("%s", physicsBenchmarkResults.c_str());
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Verify Determinism"))
+			{
+				//Runs on the live scene and puts it back where it was afterwards
+				physicsBenchmarkResults = PhysicsReplay::CheckWorld(*physicsWorld, 600);
+				printf("%s", physicsBenchmarkResults.c_str());
+			}
+
+			if (!physicsBenchmarkResults.empty())
+			{
+				ImGui::TextUnformatted(physicsBenchmarkResults.c_str());
+			}
+
+			ImGui::TreePop();
+		}
+		ImGui::PopID();
 		
 
 		// Show the demo window
@@ -1347,7 +1605,8 @@ void Game::CreateGui(float deltaTime) {
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
-	
+	//Anything moved from here until the next frame is what gets redrawn
+	Transform::BeginFrame();
 
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::GetInstance().KeyDown(VK_ESCAPE)) {
@@ -1372,6 +1631,9 @@ void Game::Update(float deltaTime, float totalTime)
 	CreateGui(deltaTime);
 
 	camera->Update(deltaTime);
+
+	//Everything that's going to move this frame has, so the world matrices can be rebuilt in one pass
+	m_EntityManager->UpdateTransforms();
 }
 
 // --------------------------------------------------------
@@ -1417,10 +1679,22 @@ void Game::Draw(float deltaTime, float totalTime)
 	//stuff above needed every frame.
 
 
+	//Only entities whose transform changed this frame fetch new matrices
+	entitiesMoved = m_EntityManager->UpdateRenderMatrices();
+
+	//None of the shadow maps follow the camera, so if nothing in them moved and no light changed
+	//last frame's are still right
+	shadowsRedrawn = entitiesMoved > 0 ||
+		shadowedEntityCount != m_EntityManager->NumEntities() ||
+		shadowedLights.size() != lights.size() ||
+		memcmp(shadowedLights.data(), lights.data(), sizeof(Light) * lights.size()) != 0;
+	shadowedLights = lights;
+	shadowedEntityCount = m_EntityManager->NumEntities();
+
 	//make sure we only render two point maps at max
 	int numPointMaps = 0;
 	//do shadow rendering stuff
-	for (int i = 0; i < lights.size(); i++) {
+	for (int i = 0; shadowsRedrawn && i < lights.size(); i++) {
 		//lights[i].ShadowNumber = -1; //set to -1 so ps knows that it's doesn't use point shadow map
 		if (lights[i].CastsShadows) {
 			if (lights[i].Type == LIGHT_TYPE_DIRECTIONAL) {
@@ -1690,7 +1964,7 @@ void PassShadowObjs() {
 	// '&' is important because it prevents making copies
 	for (auto& entity : renderableEntities) {
 		//set this game entity's world mat, send to gpu
-		shadowVertexShader->SetMatrix4x4("world", entity->GetTransform()->GetWorldMatrix());
+		shadowVertexShader->SetData("world", &entity->GetRenderWorldMatrix(), sizeof(DirectX::XMFLOAT3X4));
 		//copy data over
 		shadowVertexShader->CopyAllBufferData();
 
@@ -7,6 +7,7 @@
 #include "Lights.h"
 #include "Material.h"
 #include "Mesh.h"
+#include "PhysicsSnapshot.h"
 #include "SimpleShader.h"
 #include "Sky.h"
 #include "Transform.h"
@@ -164,6 +165,12 @@ private:
 	DirectX::XMFLOAT4X4 spotShadowViewMat;
 	DirectX::XMFLOAT4X4 spotShadowProjMat;
 
+	//What the shadow maps were last drawn with, they're kept until a light changes or an entity moves
+	std::vector<Light> shadowedLights;
+	int shadowedEntityCount = -1;
+	int entitiesMoved = 0;
+	bool shadowsRedrawn = false;
+
 	//testing stuff for post process
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> ppLightRaysSampler;
 
@@ -173,5 +180,10 @@ private:
 	float lightRaysDecay = 0.98f;
 	float lightRaysExposure = 0.2f;
 	bool enableLightRays = false;
+
+	//output of the last physics benchmark run from the debug ui
+	std::string physicsBenchmarkResults;
+	//physics state saved from the debug ui, restored with the button next to it
+	PhysicsSnapshot physicsSnapshot;
 };
 
@@ -1,6 +1,9 @@
 #include "GameEntity.h"
 
 #include "BufferStructs.h"
+#include "EntityManager.h"
+
+#include <cstring>
 
 bool g_drawDebugSpheresDefault = true;
 
@@ -10,12 +13,20 @@ GameEntity::GameEntity(std::shared_ptr<Mesh> in_mesh, std::shared_ptr<Material>
 	material = in_material;
 	camera = in_camera;
 	transform = Transform();
+	m_renderFrame = 0;
+	m_renderMatricesValid = false;
+	m_renderMatricesMoved = false;
+	m_renderMatricesBlended = false;
+	m_transformHandle = -1;
 
-	m_rigidBody = std::make_shared<RigidBody>(&transform);
 	m_collider = std::make_shared<Collider>(in_mesh, &transform);
+	m_rigidBody = std::make_shared<RigidBody>(&transform, m_collider.get());
 	m_sphere = nullptr;
 	m_drawDebugSphere = g_drawDebugSpheresDefault;
 	m_isDebugSphere = isDebugSphere;
+	if (m_isDebugSphere) {
+		m_collider->SetLayer(LAYER_DEBUG);
+	}
 }
 
 GameEntity::GameEntity(std::shared_ptr<Mesh> in_mesh, std::shared_ptr<Material> in_material, std::shared_ptr<Camera> in_camera, std::shared_ptr<GameEntity> sphere, Microsoft::WRL::ComPtr<ID3D11Device> device)
@@ -24,9 +35,14 @@ GameEntity::GameEntity(std::shared_ptr<Mesh> in_mesh, std::shared_ptr<Material>
 	material = in_material;
 	camera = in_camera;
 	transform = Transform();
+	m_renderFrame = 0;
+	m_renderMatricesValid = false;
+	m_renderMatricesMoved = false;
+	m_renderMatricesBlended = false;
+	m_transformHandle = -1;
 
-	m_rigidBody = std::make_shared<RigidBody>(&transform);
 	m_collider = std::make_shared<Collider>(in_mesh, &transform, sphere->GetTransform());
+	m_rigidBody = std::make_shared<RigidBody>(&transform, m_collider.get());
 
 	//create rasterizer state
 	D3D11_RASTERIZER_DESC shadowRastDesc = {};
@@ -49,9 +65,17 @@ GameEntity::GameEntity(std::shared_ptr<Mesh> in_mesh, std::shared_ptr<Material>
 	material = in_material;
 	camera = in_camera;
 	transform = Transform();
+	m_renderFrame = 0;
+	m_renderMatricesValid = false;
+	m_renderMatricesMoved = false;
+	m_renderMatricesBlended = false;
+	m_transformHandle = -1;
 
 	m_rigidBody = rigidBody;
 	m_collider = collider;
+	if (m_rigidBody && m_collider) {
+		m_rigidBody->SetCollider(m_collider.get());
+	}
 	m_sphere = nullptr;
 	m_drawDebugSphere = g_drawDebugSpheresDefault;
 	m_isDebugSphere = false;
@@ -81,6 +105,58 @@ std::shared_ptr<Material> GameEntity::GetMaterial()
 	return material;
 }
 
+void GameEntity::GetRenderMatrices(DirectX::XMFLOAT3X4& outWorld, DirectX::XMFLOAT3X4& outWorldInvTranspose)
+{
+	//Simulated bodies draw part way between their last two physics steps so they move smoothly
+	//when the frame rate and the physics rate don't line up
+	if (m_rigidBody && m_rigidBody->GetRenderMatrices(outWorld, outWorldInvTranspose))
+	{
+		return;
+	}
+
+	//Everything else comes from the transform store, which is brought up to date once at the end of the update
+	if (m_transformHandle >= 0)
+	{
+		EntityManager::GetInstance()->GetTransformStore().GetWorldMatrices3x4(m_transformHandle, outWorld, outWorldInvTranspose);
+	}
+	else
+	{
+		outWorld = transform.GetWorldMatrix3x4();
+		outWorldInvTranspose = transform.GetWorldInverseTranspose3x4();
+	}
+}
+
+const DirectX::XMFLOAT3X4& GameEntity::GetRenderWorldMatrix()
+{
+	RefreshRenderMatrices();
+	return m_renderWorld;
+}
+
+bool GameEntity::RefreshRenderMatrices()
+{
+	if (m_renderMatricesValid && m_renderFrame == Transform::GetFrame()) {
+		return m_renderMatricesMoved;
+	}
+	m_renderFrame = Transform::GetFrame();
+
+	//Blended poses move every frame, and the frame after one stops the transform's own matrices come back
+	bool blended = m_rigidBody && m_rigidBody->HasRenderPose();
+	bool wasBlended = m_renderMatricesBlended;
+	m_renderMatricesBlended = blended;
+
+	//Nothing above it or on it moved, still the same as last frame
+	if (m_renderMatricesValid && !blended && !wasBlended && !transform.HasChangedThisFrame()) {
+		m_renderMatricesMoved = false;
+		return false;
+	}
+
+	DirectX::XMFLOAT3X4 lastWorld = m_renderWorld;
+	GetRenderMatrices(m_renderWorld, m_renderWorldInvTranspose);
+	m_renderMatricesMoved = !m_renderMatricesValid || memcmp(&lastWorld, &m_renderWorld, sizeof(DirectX::XMFLOAT3X4)) != 0;
+	m_renderMatricesValid = true;
+	return m_renderMatricesMoved;
+}
+
 void GameEntity::Draw()
 {
 	std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader();
@@ -91,8 +167,9 @@ void GameEntity::Draw()
 
 	//set the values for the vertex shader
 	//string names MUST match those in VertexShader.hlsl
-	vs->SetMatrix4x4("world", transform.GetWorldMatrix());
-	vs->SetMatrix4x4("worldInvTranspose", transform.GetWorldInverseTransposeMatrix());
+	RefreshRenderMatrices();
+	vs->SetData("world", &m_renderWorld, sizeof(DirectX::XMFLOAT3X4));
+	vs->SetData("worldInvTranspose", &m_renderWorldInvTranspose, sizeof(DirectX::XMFLOAT3X4));
 	vs->SetMatrix4x4("view", camera->GetViewMatrix());
 	vs->SetMatrix4x4("proj", camera->GetProjectionMatrix());
 	//set pixel shader buffer values
@@ -121,28 +198,13 @@ void GameEntity::Draw()
 	}
 }
 
-void GameEntity::Update(float dt, std::vector<std::shared_ptr<GameEntity>>& collisionEntities)
+void GameEntity::UpdateDebugSphere()
 {
-	if (m_rigidBody)
-	{
-		m_rigidBody->UpdateTransform(dt);
-	}
-
-	// Implement a singleton collision manager allowing for ease of collision checks
 	if (m_collider)
 	{
-		bool colliding = false;
-		for (auto& entity : collisionEntities)
-		{
-			if (entity.get() != this && m_collider->CheckForCollision(entity->GetCollider())) {
-				colliding = true;
-				break;
-			}
-		}
-
 		//Debug collision code
 		if (m_sphere) {
-			if (colliding)
+			if (m_collider->IsColliding())
 			{
 				m_sphere->GetMaterial()->SetColorTint(DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f));
 			}
@@ -27,6 +27,7 @@ public:
 	//get pointer to transform to allow changes outside
 	Transform* GetTransform();
 	std::shared_ptr<Collider> GetCollider() { return m_collider; }
+	std::shared_ptr<RigidBody> GetRigidBody() { return m_rigidBody; }
 
 	//get pointer to material 
 	std::shared_ptr<Material> GetMaterial();
@@ -41,10 +42,22 @@ public:
 	bool ShouldDrawSphere() { return m_drawDebugSphere; }
 	void SetDrawSphere(bool drawDebugSphere) { m_drawDebugSphere = drawDebugSphere; }
 
+	//World matrices to draw with this frame, blended between physics steps for moving bodies
+	//Stored as 3x4 like Transform, which is also what the vertex shaders take
+	void GetRenderMatrices(DirectX::XMFLOAT3X4& outWorld, DirectX::XMFLOAT3X4& outWorldInvTranspose);
+	const DirectX::XMFLOAT3X4& GetRenderWorldMatrix();
+	//Fetches the render matrices once a frame, and only if the transform changed this frame or a body
+	//is blending them. Returns whether they're different from last frame's
+	bool RefreshRenderMatrices();
+
+	//Node mirroring the transform in the EntityManager's TransformStore, -1 until it's first updated
+	void SetTransformHandle(int transformHandle) { m_transformHandle = transformHandle; }
+	int GetTransformHandle() const { return m_transformHandle; }
+
 	//will hold draw code
 	void Draw();
-	//Updates entity and checks for collisions
-	void Update(float dt, std::vector<std::shared_ptr<GameEntity>>& collisionEntities);
+	//Tints the debug sphere based on the collider's state from the last collision update
+	void UpdateDebugSphere();
 private:
 
 	std::shared_ptr<Mesh> mesh;
@@ -59,4 +72,15 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> m_debugRastState;
 	bool m_drawDebugSphere;
 	bool m_isDebugSphere;
+
+	//This frame's render matrices so the shadow passes and the main pass don't each fetch them
+	DirectX::XMFLOAT3X4 m_renderWorld;
+	DirectX::XMFLOAT3X4 m_renderWorldInvTranspose;
+	//Transform frame they were last fetched in, and whether they changed then
+	unsigned int m_renderFrame;
+	bool m_renderMatricesValid;
+	bool m_renderMatricesMoved;
+	bool m_renderMatricesBlended;
+
+	int m_transformHandle;
 };
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "JobSystem.h"
+#include "FloatingPointEnvironment.h"
+
+#include <algorithm>
+
+std::shared_ptr<JobSystem> JobSystem::s_instance;
+const int JobSystem::MAX_THREADS;
+
+namespace
+{
+	//Chunks handed out per thread, a few each so one slow chunk doesn't hold up the rest
+	const int CHUNKS_PER_THREAD = 4;
+}
+
+JobSystem::JobSystem()
+	: m_job(nullptr),
+	m_count(0),
+	m_grain(1),
+	m_next(0),
+	m_generation(0),
+	m_floatState(FloatingPointEnvironment::DETERMINISTIC),
+	m_busyWorkers(0),
+	m_quit(false),
+	m_threadCount(1)
+{
+	SetThreadCount(GetHardwareThreads());
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+
+	for (auto& worker : l_workers) {
+		worker.join();
+	}
+}
+
+std::shared_ptr<JobSystem> JobSystem::GetInstance()
+{
+	if (!s_instance.get()) {
+		std::shared_ptr<JobSystem> newInstance(new JobSystem());
+		s_instance = newInstance;
+	}
+
+	return s_instance;
+}
+
+int JobSystem::GetHardwareThreads()
+{
+	int hardwareThreads = static_cast<int>(std::thread::hardware_concurrency());
+	return std::max(hardwareThreads, 1);
+}
+
+void JobSystem::SetThreadCount(int threadCount)
+{
+	threadCount = std::max(1, std::min(threadCount, MAX_THREADS));
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_threadCount = threadCount;
+	}
+
+	//Workers are never stopped, the ones past the count just stay asleep
+	while (static_cast<int>(l_workers.size()) < threadCount - 1) {
+		int workerIndex = static_cast<int>(l_workers.size());
+		l_workers.push_back(std::thread(&JobSystem::WorkerLoop, this, workerIndex));
+	}
+}
+
+void JobSystem::WorkerLoop(int workerIndex)
+{
+	unsigned int lastGeneration = 0;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_wake.wait(lock, [&]() {
+			return m_quit || (m_generation != lastGeneration && workerIndex < m_threadCount - 1);
+		});
+		if (m_quit) {
+			return;
+		}
+
+		lastGeneration = m_generation;
+		m_busyWorkers++;
+		lock.unlock();
+
+		FloatingPointEnvironment::Set(m_floatState);
+
+		RunChunks();
+
+		lock.lock();
+		m_busyWorkers--;
+		if (m_busyWorkers == 0) {
+			m_done.notify_one();
+		}
+	}
+}
+
+void JobSystem::RunChunks()
+{
+	while (true) {
+		int begin = m_next.fetch_add(m_grain);
+		if (begin >= m_count) {
+			return;
+		}
+
+		(*m_job)(begin, std::min(begin + m_grain, m_count));
+	}
+}
+
+void JobSystem::ParallelFor(int count, int grain, const std::function<void(int, int)>& job)
+{
+	if (count <= 0) {
+		return;
+	}
+
+	grain = std::max(grain, 1);
+	if (m_threadCount == 1 || count <= grain) {
+		job(0, count);
+		return;
+	}
+
+	{
+		//A worker that woke late for the last job could still be on its way out
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [&]() { return m_busyWorkers == 0; });
+		m_job = &job;
+		m_count = count;
+		m_grain = std::max(grain, count / (m_threadCount * CHUNKS_PER_THREAD));
+		m_next = 0;
+		m_floatState = FloatingPointEnvironment::Get();
+		m_generation++;
+	}
+	m_wake.notify_all();
+
+	RunChunks();
+
+	//Every chunk has been taken, the ones still running are on busy workers. A worker that wakes
+	//after this finds the count at 0 and goes straight back to sleep
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [&]() { return m_busyWorkers == 0; });
+	m_job = nullptr;
+	m_count = 0;
+}
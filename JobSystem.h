@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Small pool of worker threads for splitting a loop across cores. ParallelFor hands out
+//chunks of an index range to the workers and the calling thread, and only returns once
+//every chunk is done, so whatever runs before and after it can stay single threaded.
+//Jobs in one call must not touch the same data, there are no locks around anything they do.
+//Workers run with the caller's floating point environment so the result doesn't depend on which thread ran what
+class JobSystem
+{
+private:
+	static std::shared_ptr<JobSystem> s_instance;
+
+	std::vector<std::thread> l_workers;
+	std::mutex m_mutex;
+	//Workers wait on this for a new job, the caller waits on m_done for them to finish it
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	//Current job, only changed under the mutex while no worker is running it
+	const std::function<void(int, int)>* m_job;
+	int m_count;
+	int m_grain;
+	std::atomic<int> m_next;
+	//Goes up once per job so workers can tell they haven't run it yet
+	unsigned int m_generation;
+	//Caller's floating point environment, workers switch to it before running the job
+	unsigned int m_floatState;
+	int m_busyWorkers;
+	bool m_quit;
+
+	//Threads used per job, counting the one that calls ParallelFor
+	int m_threadCount;
+
+	JobSystem();
+
+	void WorkerLoop(int workerIndex);
+	//Takes chunks of the current job until there are none left
+	void RunChunks();
+
+public:
+	//Most threads that can be asked for, more than the machine has is allowed so oversubscribing can be tested
+	static const int MAX_THREADS = 64;
+
+	~JobSystem();
+
+	static std::shared_ptr<JobSystem> GetInstance();
+
+	//Starts or parks workers as needed. 1 runs everything on the calling thread
+	void SetThreadCount(int threadCount);
+	int GetThreadCount() const { return m_threadCount; }
+	//What the hardware reports, at least 1
+	static int GetHardwareThreads();
+
+	//Calls job(begin, end) over [0, count) in chunks of at least grain indices
+	void ParallelFor(int count, int grain, const std::function<void(int, int)>& job);
+};
@@ -0,0 +1,201 @@
+#include "Joint.h"
+#include "PhysicsWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	//Axis saved for joints that don't use one
+	const XMFLOAT3 DEFAULT_AXIS = XMFLOAT3(0.0f, 1.0f, 0.0f);
+
+	int GetBodyIndex(const std::shared_ptr<RigidBody>& body)
+	{
+		return body ? body->GetBodyId() : RigidBodyArrays::STATIC_BODY;
+	}
+
+	XMVECTOR WorldAnchor(const RigidBodyArrays& bodies, int body, const XMFLOAT3& localAnchor)
+	{
+		XMFLOAT3 position = bodies.GetPosition(body);
+		XMFLOAT4 orientation = bodies.GetOrientation(body);
+		return XMLoadFloat3(&position) + XMVector3Rotate(XMLoadFloat3(&localAnchor), XMLoadFloat4(&orientation));
+	}
+
+	std::shared_ptr<Joint> CreateJoint(eJointType type, std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB,
+		const XMFLOAT3& worldAnchorA, const XMFLOAT3& worldAnchorB, const XMFLOAT3& worldAxis)
+	{
+		std::shared_ptr<PhysicsWorld> world = PhysicsWorld::GetInstance();
+		//Frames need the poses in the arrays, adding twice does nothing
+		world->AddBody(bodyA);
+		world->AddBody(bodyB);
+
+		std::shared_ptr<Joint> joint = std::make_shared<Joint>(type, bodyA, bodyB);
+		joint->SetFrame(world->GetBodies(), GetBodyIndex(bodyA), GetBodyIndex(bodyB), worldAnchorA, worldAnchorB, worldAxis);
+		return joint;
+	}
+}
+
+Joint::Joint(eJointType type, std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB)
+	: m_type(type),
+	m_bodyA(bodyA),
+	m_bodyB(bodyB),
+	m_localAnchorA(XMFLOAT3(0.0f, 0.0f, 0.0f)),
+	m_localAnchorB(XMFLOAT3(0.0f, 0.0f, 0.0f)),
+	m_localAxisA(DEFAULT_AXIS),
+	m_localAxisB(DEFAULT_AXIS),
+	m_referenceRotation(XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f)),
+	m_limitEnabled(false),
+	m_lowerLimit(0.0f),
+	m_upperLimit(0.0f),
+	m_motorEnabled(false),
+	m_motorSpeed(0.0f),
+	m_maxMotorForce(0.0f),
+	m_collideConnected(false),
+	m_linearImpulse(XMFLOAT3(0.0f, 0.0f, 0.0f)),
+	m_angularImpulse(XMFLOAT3(0.0f, 0.0f, 0.0f)),
+	m_limitImpulse(0.0f),
+	m_motorImpulse(0.0f),
+	m_jointId(-1)
+{
+}
+
+Joint::~Joint()
+{
+}
+
+std::shared_ptr<Joint> Joint::CreateBallSocket(std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB, const XMFLOAT3& worldAnchor)
+{
+	return CreateJoint(JOINT_BALL_SOCKET, bodyA, bodyB, worldAnchor, worldAnchor, DEFAULT_AXIS);
+}
+
+std::shared_ptr<Joint> Joint::CreateHinge(std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB, const XMFLOAT3& worldAnchor, const XMFLOAT3& worldAxis)
+{
+	return CreateJoint(JOINT_HINGE, bodyA, bodyB, worldAnchor, worldAnchor, worldAxis);
+}
+
+std::shared_ptr<Joint> Joint::CreateSlider(std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB, const XMFLOAT3& worldAnchor, const XMFLOAT3& worldAxis)
+{
+	return CreateJoint(JOINT_SLIDER, bodyA, bodyB, worldAnchor, worldAnchor, worldAxis);
+}
+
+std::shared_ptr<Joint> Joint::CreateDistance(std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB, const XMFLOAT3& worldAnchorA, const XMFLOAT3& worldAnchorB)
+{
+	std::shared_ptr<Joint> joint = CreateJoint(JOINT_DISTANCE, bodyA, bodyB, worldAnchorA, worldAnchorB, DEFAULT_AXIS);
+
+	float length;
+	XMStoreFloat(&length, XMVector3Length(XMLoadFloat3(&worldAnchorB) - XMLoadFloat3(&worldAnchorA)));
+	joint->SetLimits(length, length);
+	joint->SetLimitEnabled(true);
+	return joint;
+}
+
+std::shared_ptr<Joint> Joint::CreateFixed(std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB)
+{
+	XMFLOAT3 anchor = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	int bodyIndex = GetBodyIndex(bodyB);
+	if (bodyIndex >= 0) {
+		anchor = PhysicsWorld::GetInstance()->GetBodies().GetPosition(bodyIndex);
+	}
+
+	return CreateJoint(JOINT_FIXED, bodyA, bodyB, anchor, anchor, DEFAULT_AXIS);
+}
+
+void Joint::SetFrame(const RigidBodyArrays& bodies, int bodyA, int bodyB, const XMFLOAT3& worldAnchorA, const XMFLOAT3& worldAnchorB, const XMFLOAT3& worldAxis)
+{
+	XMFLOAT3 positionA = bodies.GetPosition(bodyA);
+	XMFLOAT3 positionB = bodies.GetPosition(bodyB);
+	XMFLOAT4 orientationA = bodies.GetOrientation(bodyA);
+	XMFLOAT4 orientationB = bodies.GetOrientation(bodyB);
+	XMVECTOR qA = XMLoadFloat4(&orientationA);
+	XMVECTOR qB = XMLoadFloat4(&orientationB);
+
+	XMStoreFloat3(&m_localAnchorA, XMVector3InverseRotate(XMLoadFloat3(&worldAnchorA) - XMLoadFloat3(&positionA), qA));
+	XMStoreFloat3(&m_localAnchorB, XMVector3InverseRotate(XMLoadFloat3(&worldAnchorB) - XMLoadFloat3(&positionB), qB));
+
+	XMVECTOR axis = XMVector3Normalize(XMLoadFloat3(&worldAxis));
+	XMStoreFloat3(&m_localAxisA, XMVector3InverseRotate(axis, qA));
+	XMStoreFloat3(&m_localAxisB, XMVector3InverseRotate(axis, qB));
+
+	//Turn by B, then back out of A
+	XMStoreFloat4(&m_referenceRotation, XMQuaternionMultiply(qB, XMQuaternionInverse(qA)));
+}
+
+int Joint::GetBodyIdA() const
+{
+	return GetBodyIndex(m_bodyA);
+}
+
+int Joint::GetBodyIdB() const
+{
+	return GetBodyIndex(m_bodyB);
+}
+
+float Joint::GetValue(const RigidBodyArrays& bodies, int bodyA, int bodyB) const
+{
+	XMFLOAT4 orientationA = bodies.GetOrientation(bodyA);
+	XMVECTOR qA = XMLoadFloat4(&orientationA);
+	XMVECTOR separation = WorldAnchor(bodies, bodyB, m_localAnchorB) - WorldAnchor(bodies, bodyA, m_localAnchorA);
+
+	switch (m_type) {
+	case JOINT_HINGE:
+	{
+		//Twist about a's axis since the joint was made, same as the solver
+		XMFLOAT4 orientationB = bodies.GetOrientation(bodyB);
+		XMVECTOR relative = XMQuaternionMultiply(XMLoadFloat4(&orientationB), XMQuaternionInverse(qA));
+		XMFLOAT4 delta;
+		XMStoreFloat4(&delta, XMQuaternionMultiply(XMQuaternionInverse(XMLoadFloat4(&m_referenceRotation)), relative));
+		if (delta.w < 0.0f) {
+			delta = XMFLOAT4(-delta.x, -delta.y, -delta.z, -delta.w);
+		}
+		return 2.0f * atan2f(delta.x * m_localAxisA.x + delta.y * m_localAxisA.y + delta.z * m_localAxisA.z, delta.w);
+	}
+	case JOINT_SLIDER:
+		return XMVectorGetX(XMVector3Dot(separation, XMVector3Rotate(XMLoadFloat3(&m_localAxisA), qA)));
+	case JOINT_DISTANCE:
+		return XMVectorGetX(XMVector3Length(separation));
+	default:
+		return 0.0f;
+	}
+}
+
+float Joint::GetAnchorError(const RigidBodyArrays& bodies, int bodyA, int bodyB) const
+{
+	XMFLOAT4 orientationA = bodies.GetOrientation(bodyA);
+	XMVECTOR separation = WorldAnchor(bodies, bodyB, m_localAnchorB) - WorldAnchor(bodies, bodyA, m_localAnchorA);
+
+	switch (m_type) {
+	case JOINT_SLIDER:
+	{
+		//Sliding along the axis is allowed
+		XMVECTOR axis = XMVector3Rotate(XMLoadFloat3(&m_localAxisA), XMLoadFloat4(&orientationA));
+		return XMVectorGetX(XMVector3Length(separation - axis * XMVector3Dot(separation, axis)));
+	}
+	case JOINT_DISTANCE:
+		return 0.0f;
+	default:
+		return XMVectorGetX(XMVector3Length(separation));
+	}
+}
+
+void Joint::SetLimits(float lower, float upper)
+{
+	m_lowerLimit = std::min(lower, upper);
+	m_upperLimit = std::max(lower, upper);
+}
+
+void Joint::SetMotor(float speed, float maxForce)
+{
+	m_motorSpeed = speed;
+	m_maxMotorForce = std::max(maxForce, 0.0f);
+	m_motorEnabled = true;
+}
+
+void Joint::SetImpulses(const XMFLOAT3& linearImpulse, const XMFLOAT3& angularImpulse, float limitImpulse, float motorImpulse)
+{
+	m_linearImpulse = linearImpulse;
+	m_angularImpulse = angularImpulse;
+	m_limitImpulse = limitImpulse;
+	m_motorImpulse = motorImpulse;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include "RigidBody.h"
+#include "RigidBodyArrays.h"
+
+#include <DirectXMath.h>
+#include <memory>
+
+enum eJointType
+{
+	//Anchor points on both bodies stay together, any rotation allowed
+	JOINT_BALL_SOCKET = 0,
+	//Ball socket that can only turn about one axis, with optional angle limits and a motor
+	JOINT_HINGE,
+	//Only slides along one axis and can't rotate, with optional travel limits and a motor
+	JOINT_SLIDER,
+	//Keeps the anchors a set distance apart, or anywhere in a range (a rope is 0 to its length)
+	JOINT_DISTANCE,
+	//Welds the bodies together where they are
+	JOINT_FIXED,
+
+	JOINT_TYPE_COUNT,
+};
+
+//Connects two rigid bodies, or one body to the world if the other is null. Anchors and axes
+//are saved in each body's own space when the joint is made, so the bodies should already be
+//in the world and posed the way the joint should hold them. The physics world solves joints
+//at the velocity level along with the contacts, and any drift is pushed out on the bias
+//velocities the same way contacts fix penetration. Bodies joined together share an island,
+//so they sleep and wake together, and by default they don't collide with each other
+class Joint
+{
+private:
+	eJointType m_type;
+	std::shared_ptr<RigidBody> m_bodyA;
+	std::shared_ptr<RigidBody> m_bodyB;
+
+	//Relative to each body's centre of mass, along its own axes
+	DirectX::XMFLOAT3 m_localAnchorA;
+	DirectX::XMFLOAT3 m_localAnchorB;
+	//Hinge or slide axis in each body's space, they should stay lined up
+	DirectX::XMFLOAT3 m_localAxisA;
+	DirectX::XMFLOAT3 m_localAxisB;
+	//B's orientation in A's space when the joint was made, hinge angles and welds are measured from it
+	DirectX::XMFLOAT4 m_referenceRotation;
+
+	//Hinge angle (radians), slider travel or distance range
+	bool m_limitEnabled;
+	float m_lowerLimit;
+	float m_upperLimit;
+
+	//Hinge angular speed or slider speed the motor drives towards, with the most torque/force it can use
+	bool m_motorEnabled;
+	float m_motorSpeed;
+	float m_maxMotorForce;
+
+	bool m_collideConnected;
+
+	//Impulses from the last step for warm starting, world space
+	DirectX::XMFLOAT3 m_linearImpulse;
+	DirectX::XMFLOAT3 m_angularImpulse;
+	float m_limitImpulse;
+	float m_motorImpulse;
+
+	//Index in the physics world's joint list, -1 if not added
+	int m_jointId;
+
+public:
+	Joint(eJointType type, std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB);
+	~Joint();
+
+	//Each of these reads the bodies' current poses from the physics world, so add the bodies first.
+	//A null body is the world
+	static std::shared_ptr<Joint> CreateBallSocket(std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB, const DirectX::XMFLOAT3& worldAnchor);
+	static std::shared_ptr<Joint> CreateHinge(std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB, const DirectX::XMFLOAT3& worldAnchor, const DirectX::XMFLOAT3& worldAxis);
+	static std::shared_ptr<Joint> CreateSlider(std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB, const DirectX::XMFLOAT3& worldAnchor, const DirectX::XMFLOAT3& worldAxis);
+	//Keeps the anchors as far apart as they are now
+	static std::shared_ptr<Joint> CreateDistance(std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB, const DirectX::XMFLOAT3& worldAnchorA, const DirectX::XMFLOAT3& worldAnchorB);
+	//Welded at B's centre of mass
+	static std::shared_ptr<Joint> CreateFixed(std::shared_ptr<RigidBody> bodyA, std::shared_ptr<RigidBody> bodyB);
+
+	//Saves the anchors, axis and reference rotation from the bodies' poses in the arrays. The
+	//Create functions call this, it's public for scenes that work on the arrays directly
+	void SetFrame(const RigidBodyArrays& bodies, int bodyA, int bodyB, const DirectX::XMFLOAT3& worldAnchorA, const DirectX::XMFLOAT3& worldAnchorB, const DirectX::XMFLOAT3& worldAxis);
+
+	eJointType GetType() const { return m_type; }
+	RigidBody* GetBodyA() const { return m_bodyA.get(); }
+	RigidBody* GetBodyB() const { return m_bodyB.get(); }
+	//Index into the world's arrays, the static body for the world or -1 if the body isn't added
+	int GetBodyIdA() const;
+	int GetBodyIdB() const;
+
+	const DirectX::XMFLOAT3& GetLocalAnchorA() const { return m_localAnchorA; }
+	const DirectX::XMFLOAT3& GetLocalAnchorB() const { return m_localAnchorB; }
+	const DirectX::XMFLOAT3& GetLocalAxisA() const { return m_localAxisA; }
+	const DirectX::XMFLOAT3& GetLocalAxisB() const { return m_localAxisB; }
+	const DirectX::XMFLOAT4& GetReferenceRotation() const { return m_referenceRotation; }
+
+	//What the limits are checked against for these bodies' current poses: radians for hinges,
+	//distance along the axis for sliders and anchor distance for distance joints. 0 for the rest
+	float GetValue(const RigidBodyArrays& bodies, int bodyA, int bodyB) const;
+	//How far apart the two anchors have drifted, only along the rows that hold them together
+	float GetAnchorError(const RigidBodyArrays& bodies, int bodyA, int bodyB) const;
+
+	//Radians for hinges, distance along the axis for sliders and anchor distance for distance joints
+	void SetLimits(float lower, float upper);
+	void SetLimitEnabled(bool limitEnabled) { m_limitEnabled = limitEnabled; }
+	bool IsLimitEnabled() const { return m_limitEnabled; }
+	float GetLowerLimit() const { return m_lowerLimit; }
+	float GetUpperLimit() const { return m_upperLimit; }
+
+	//Hinges and sliders only. Speed is radians or units per second, force is torque for hinges
+	void SetMotor(float speed, float maxForce);
+	void SetMotorEnabled(bool motorEnabled) { m_motorEnabled = motorEnabled; }
+	bool IsMotorEnabled() const { return m_motorEnabled; }
+	float GetMotorSpeed() const { return m_motorSpeed; }
+	float GetMaxMotorForce() const { return m_maxMotorForce; }
+
+	void SetCollideConnected(bool collideConnected) { m_collideConnected = collideConnected; }
+	bool GetCollideConnected() const { return m_collideConnected; }
+
+	//Warm starting state, written by the joint solver at the end of each step
+	const DirectX::XMFLOAT3& GetLinearImpulse() const { return m_linearImpulse; }
+	const DirectX::XMFLOAT3& GetAngularImpulse() const { return m_angularImpulse; }
+	float GetLimitImpulse() const { return m_limitImpulse; }
+	float GetMotorImpulse() const { return m_motorImpulse; }
+	void SetImpulses(const DirectX::XMFLOAT3& linearImpulse, const DirectX::XMFLOAT3& angularImpulse, float limitImpulse, float motorImpulse);
+
+	int GetJointId() const { return m_jointId; }
+	void SetJointId(int jointId) { m_jointId = jointId; }
+};
@@ -0,0 +1,608 @@
+#include "JointSolver.h"
+#include "SolverBody.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	enum eLimitState
+	{
+		LIMIT_INACTIVE = 0,
+		//Only pushes the value up, the value is nearer the lower limit
+		LIMIT_LOWER,
+		LIMIT_UPPER,
+		//Limits are the same so the row is held both ways
+		LIMIT_EQUAL,
+	};
+
+	//Limits closer together than this are treated as one value
+	const float EQUAL_LIMIT_TOLERANCE = 0.0001f;
+
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	//Two unit vectors at right angles to each other and to normal
+	void PerpendicularAxes(const XMFLOAT3& normal, XMFLOAT3& outFirst, XMFLOAT3& outSecond)
+	{
+		XMVECTOR n = XMLoadFloat3(&normal);
+		XMVECTOR other = fabsf(normal.x) < 0.57735f ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+		XMVECTOR first = XMVector3Normalize(XMVector3Cross(n, other));
+		XMStoreFloat3(&outFirst, first);
+		XMStoreFloat3(&outSecond, XMVector3Cross(n, first));
+	}
+
+	//Inverts the top left size x size of a symmetric 3x3 row major matrix. Anything singular
+	//comes back as 0 so the rows just do nothing
+	void InvertBlock(const float k[9], int size, float out[9])
+	{
+		std::fill(out, out + 9, 0.0f);
+		if (size == 1) {
+			out[0] = k[0] > 0.0f ? 1.0f / k[0] : 0.0f;
+		}
+		else if (size == 2) {
+			float det = k[0] * k[4] - k[1] * k[3];
+			if (det != 0.0f) {
+				float invDet = 1.0f / det;
+				out[0] = k[4] * invDet;
+				out[1] = -k[1] * invDet;
+				out[3] = -k[3] * invDet;
+				out[4] = k[0] * invDet;
+			}
+		}
+		else if (size == 3) {
+			float c0 = k[4] * k[8] - k[5] * k[7];
+			float c1 = k[5] * k[6] - k[3] * k[8];
+			float c2 = k[3] * k[7] - k[4] * k[6];
+			float det = k[0] * c0 + k[1] * c1 + k[2] * c2;
+			if (det != 0.0f) {
+				float invDet = 1.0f / det;
+				out[0] = c0 * invDet;
+				out[1] = (k[2] * k[7] - k[1] * k[8]) * invDet;
+				out[2] = (k[1] * k[5] - k[2] * k[4]) * invDet;
+				out[3] = c1 * invDet;
+				out[4] = (k[0] * k[8] - k[2] * k[6]) * invDet;
+				out[5] = (k[2] * k[3] - k[0] * k[5]) * invDet;
+				out[6] = c2 * invDet;
+				out[7] = (k[1] * k[6] - k[0] * k[7]) * invDet;
+				out[8] = (k[0] * k[4] - k[1] * k[3]) * invDet;
+			}
+		}
+	}
+
+	//out = m * v for the top left size x size of m
+	void MultiplyBlock(const float m[9], int size, const float v[3], float out[3])
+	{
+		for (int i = 0; i < size; i++) {
+			out[i] = 0.0f;
+			for (int j = 0; j < size; j++) {
+				out[i] += m[i * 3 + j] * v[j];
+			}
+		}
+	}
+
+	float Clamp(float value, float limit)
+	{
+		return std::max(-limit, std::min(value, limit));
+	}
+
+	//Speed of b's anchor relative to a's along direction
+	float LinearSpeed(const float vA[3], const float wA[3], const float vB[3], const float wB[3], const XMFLOAT3& rA, const XMFLOAT3& rB, const XMFLOAT3& direction)
+	{
+		XMFLOAT3 pointA = XMFLOAT3(vA[0] + wA[1] * rA.z - wA[2] * rA.y, vA[1] + wA[2] * rA.x - wA[0] * rA.z, vA[2] + wA[0] * rA.y - wA[1] * rA.x);
+		XMFLOAT3 pointB = XMFLOAT3(vB[0] + wB[1] * rB.z - wB[2] * rB.y, vB[1] + wB[2] * rB.x - wB[0] * rB.z, vB[2] + wB[0] * rB.y - wB[1] * rB.x);
+		return Dot(pointB, direction) - Dot(pointA, direction);
+	}
+
+	//How fast b is turning relative to a about direction
+	float AngularSpeed(const float wA[3], const float wB[3], const XMFLOAT3& direction)
+	{
+		return (wB[0] - wA[0]) * direction.x + (wB[1] - wA[1]) * direction.y + (wB[2] - wA[2]) * direction.z;
+	}
+
+	//Linear impulse on b at rB and its opposite on a at rA
+	void ApplyLinear(const SolverBody& a, const SolverBody& b, float vA[3], float wA[3], float vB[3], float wB[3], const XMFLOAT3& rA, const XMFLOAT3& rB, const XMFLOAT3& impulse)
+	{
+		a.AddImpulse(vA, wA, rA, -impulse.x, -impulse.y, -impulse.z);
+		b.AddImpulse(vB, wB, rB, impulse.x, impulse.y, impulse.z);
+	}
+
+	//Angular impulse turning b about impulse and a the other way
+	void ApplyAngular(const SolverBody& a, const SolverBody& b, float wA[3], float wB[3], const XMFLOAT3& impulse)
+	{
+		float turn[3] = { impulse.x, impulse.y, impulse.z };
+		float change[3];
+		a.MultiplyInertia(turn, change);
+		wA[0] -= change[0];
+		wA[1] -= change[1];
+		wA[2] -= change[2];
+		b.MultiplyInertia(turn, change);
+		wB[0] += change[0];
+		wB[1] += change[1];
+		wB[2] += change[2];
+	}
+
+	XMFLOAT3 SumAxes(const XMFLOAT3 axes[3], const float impulses[3], int count)
+	{
+		XMFLOAT3 sum = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		for (int i = 0; i < count; i++) {
+			sum.x += axes[i].x * impulses[i];
+			sum.y += axes[i].y * impulses[i];
+			sum.z += axes[i].z * impulses[i];
+		}
+		return sum;
+	}
+}
+
+JointSolver::JointSolver()
+	: m_baumgarte(0.2f),
+	m_maxCorrectionSpeed(5.0f)
+{
+}
+
+JointSolver::~JointSolver()
+{
+}
+
+void JointSolver::Clear()
+{
+	l_constraints.clear();
+}
+
+void JointSolver::AddJoint(Joint* joint, int bodyA, int bodyB, const RigidBodyArrays& bodies, float dt)
+{
+	//Static or asleep on both sides, nothing to move
+	if (!bodies.IsSimulated(bodyA) && !bodies.IsSimulated(bodyB)) {
+		return;
+	}
+
+	eJointType type = joint->GetType();
+	//A distance joint without limits doesn't hold anything
+	if (type == JOINT_DISTANCE && !joint->IsLimitEnabled()) {
+		return;
+	}
+
+	SolverBody a;
+	SolverBody b;
+	a.Load(bodies, bodyA);
+	b.Load(bodies, bodyB);
+
+	XMFLOAT3 positionA = bodies.GetPosition(bodyA);
+	XMFLOAT3 positionB = bodies.GetPosition(bodyB);
+	XMFLOAT4 orientationA = bodies.GetOrientation(bodyA);
+	XMFLOAT4 orientationB = bodies.GetOrientation(bodyB);
+	XMVECTOR qA = XMLoadFloat4(&orientationA);
+	XMVECTOR qB = XMLoadFloat4(&orientationB);
+
+	JointConstraint constraint;
+	constraint.bodyA = bodyA;
+	constraint.bodyB = bodyB;
+	constraint.joint = joint;
+	constraint.numLinearRows = 0;
+	constraint.numAngularRows = 0;
+	constraint.axisAngular = false;
+	constraint.axis = XMFLOAT3(0.0f, 1.0f, 0.0f);
+	constraint.axisMass = 0.0f;
+	constraint.limitState = LIMIT_INACTIVE;
+	constraint.limitVelocityBias = 0.0f;
+	constraint.limitBias = 0.0f;
+	constraint.limitImpulse = 0.0f;
+	constraint.limitBiasImpulse = 0.0f;
+	constraint.motorEnabled = false;
+	constraint.motorSpeed = 0.0f;
+	constraint.maxMotorImpulse = 0.0f;
+	constraint.motorImpulse = 0.0f;
+
+	XMStoreFloat3(&constraint.rA, XMVector3Rotate(XMLoadFloat3(&joint->GetLocalAnchorA()), qA));
+	XMStoreFloat3(&constraint.rB, XMVector3Rotate(XMLoadFloat3(&joint->GetLocalAnchorB()), qB));
+	XMFLOAT3 anchorA = XMFLOAT3(positionA.x + constraint.rA.x, positionA.y + constraint.rA.y, positionA.z + constraint.rA.z);
+	XMFLOAT3 anchorB = XMFLOAT3(positionB.x + constraint.rB.x, positionB.y + constraint.rB.y, positionB.z + constraint.rB.z);
+	//How far b's anchor has drifted from a's
+	XMFLOAT3 separation = XMFLOAT3(anchorB.x - anchorA.x, anchorB.y - anchorA.y, anchorB.z - anchorA.z);
+
+	XMFLOAT3 axisA;
+	XMFLOAT3 axisB;
+	XMStoreFloat3(&axisA, XMVector3Rotate(XMLoadFloat3(&joint->GetLocalAxisA()), qA));
+	XMStoreFloat3(&axisB, XMVector3Rotate(XMLoadFloat3(&joint->GetLocalAxisB()), qB));
+
+	//Rotation b has made relative to a since the joint was made, in a's space
+	XMVECTOR relative = XMQuaternionMultiply(qB, XMQuaternionInverse(qA));
+	XMVECTOR drift = XMQuaternionMultiply(XMQuaternionInverse(XMLoadFloat4(&joint->GetReferenceRotation())), relative);
+	XMFLOAT4 delta;
+	XMStoreFloat4(&delta, drift);
+	if (delta.w < 0.0f) {
+		delta = XMFLOAT4(-delta.x, -delta.y, -delta.z, -delta.w);
+	}
+	//Small angle rotation vector of the drift, in world space
+	XMFLOAT3 angularError;
+	XMStoreFloat3(&angularError, XMVector3Rotate(XMVectorSet(2.0f * delta.x, 2.0f * delta.y, 2.0f * delta.z, 0.0f), qA));
+
+	float biasScale = -m_baumgarte / dt;
+	float linearRowError[3];
+	float angularRowError[3];
+	float axisValue = 0.0f;
+	bool hasAxis = false;
+
+	switch (type) {
+	case JOINT_BALL_SOCKET:
+	case JOINT_HINGE:
+	case JOINT_FIXED:
+		constraint.numLinearRows = 3;
+		constraint.linearAxes[0] = XMFLOAT3(1.0f, 0.0f, 0.0f);
+		constraint.linearAxes[1] = XMFLOAT3(0.0f, 1.0f, 0.0f);
+		constraint.linearAxes[2] = XMFLOAT3(0.0f, 0.0f, 1.0f);
+		break;
+	case JOINT_SLIDER:
+		//Lever arm on a goes all the way to b's anchor since that's where the rows push
+		constraint.rA = XMFLOAT3(anchorB.x - positionA.x, anchorB.y - positionA.y, anchorB.z - positionA.z);
+		constraint.numLinearRows = 2;
+		PerpendicularAxes(axisA, constraint.linearAxes[0], constraint.linearAxes[1]);
+		break;
+	case JOINT_DISTANCE:
+	default:
+		break;
+	}
+	for (int i = 0; i < constraint.numLinearRows; i++) {
+		linearRowError[i] = Dot(constraint.linearAxes[i], separation);
+		constraint.linearBias[i] = Clamp(biasScale * linearRowError[i], m_maxCorrectionSpeed);
+	}
+
+	switch (type) {
+	case JOINT_HINGE:
+		constraint.numAngularRows = 2;
+		PerpendicularAxes(axisA, constraint.angularAxes[0], constraint.angularAxes[1]);
+		{
+			//Sideways tilt of b's axis away from a's
+			XMFLOAT3 tilt = Cross(axisA, axisB);
+			angularRowError[0] = Dot(constraint.angularAxes[0], tilt);
+			angularRowError[1] = Dot(constraint.angularAxes[1], tilt);
+		}
+		constraint.axisAngular = true;
+		constraint.axis = axisA;
+		{
+			//Twist about the hinge axis, in (-pi, pi]
+			const XMFLOAT3& localAxis = joint->GetLocalAxisA();
+			axisValue = 2.0f * atan2f(delta.x * localAxis.x + delta.y * localAxis.y + delta.z * localAxis.z, delta.w);
+		}
+		hasAxis = true;
+		break;
+	case JOINT_SLIDER:
+	case JOINT_FIXED:
+		constraint.numAngularRows = 3;
+		constraint.angularAxes[0] = XMFLOAT3(1.0f, 0.0f, 0.0f);
+		constraint.angularAxes[1] = XMFLOAT3(0.0f, 1.0f, 0.0f);
+		constraint.angularAxes[2] = XMFLOAT3(0.0f, 0.0f, 1.0f);
+		angularRowError[0] = angularError.x;
+		angularRowError[1] = angularError.y;
+		angularRowError[2] = angularError.z;
+		if (type == JOINT_SLIDER) {
+			constraint.axis = axisA;
+			axisValue = Dot(axisA, separation);
+			hasAxis = true;
+		}
+		break;
+	case JOINT_DISTANCE:
+		{
+			float length = sqrtf(Dot(separation, separation));
+			constraint.axis = length > 0.0001f ? XMFLOAT3(separation.x / length, separation.y / length, separation.z / length) : XMFLOAT3(0.0f, 1.0f, 0.0f);
+			axisValue = length;
+			hasAxis = true;
+		}
+		break;
+	default:
+		break;
+	}
+	for (int i = 0; i < constraint.numAngularRows; i++) {
+		constraint.angularBias[i] = Clamp(biasScale * angularRowError[i], m_maxCorrectionSpeed);
+	}
+
+	//Effective mass blocks, K = J M^-1 J^T over the rows of each
+	float k[9];
+	float rAxn[3][3];
+	float rBxn[3][3];
+	float turnedA[3][3];
+	float turnedB[3][3];
+	for (int i = 0; i < constraint.numLinearRows; i++) {
+		XMFLOAT3 crossA = Cross(constraint.rA, constraint.linearAxes[i]);
+		XMFLOAT3 crossB = Cross(constraint.rB, constraint.linearAxes[i]);
+		rAxn[i][0] = crossA.x; rAxn[i][1] = crossA.y; rAxn[i][2] = crossA.z;
+		rBxn[i][0] = crossB.x; rBxn[i][1] = crossB.y; rBxn[i][2] = crossB.z;
+		a.MultiplyInertia(rAxn[i], turnedA[i]);
+		b.MultiplyInertia(rBxn[i], turnedB[i]);
+	}
+	for (int i = 0; i < constraint.numLinearRows; i++) {
+		for (int j = 0; j < constraint.numLinearRows; j++) {
+			k[i * 3 + j] = (a.inverseMass + b.inverseMass) * Dot(constraint.linearAxes[i], constraint.linearAxes[j])
+				+ rAxn[i][0] * turnedA[j][0] + rAxn[i][1] * turnedA[j][1] + rAxn[i][2] * turnedA[j][2]
+				+ rBxn[i][0] * turnedB[j][0] + rBxn[i][1] * turnedB[j][1] + rBxn[i][2] * turnedB[j][2];
+		}
+	}
+	InvertBlock(k, constraint.numLinearRows, constraint.linearMass);
+
+	for (int i = 0; i < constraint.numAngularRows; i++) {
+		float u[3] = { constraint.angularAxes[i].x, constraint.angularAxes[i].y, constraint.angularAxes[i].z };
+		a.MultiplyInertia(u, turnedA[i]);
+		b.MultiplyInertia(u, turnedB[i]);
+	}
+	for (int i = 0; i < constraint.numAngularRows; i++) {
+		for (int j = 0; j < constraint.numAngularRows; j++) {
+			const XMFLOAT3& u = constraint.angularAxes[i];
+			k[i * 3 + j] = u.x * (turnedA[j][0] + turnedB[j][0]) + u.y * (turnedA[j][1] + turnedB[j][1]) + u.z * (turnedA[j][2] + turnedB[j][2]);
+		}
+	}
+	InvertBlock(k, constraint.numAngularRows, constraint.angularMass);
+
+	if (hasAxis) {
+		float inverseMass;
+		if (constraint.axisAngular) {
+			float u[3] = { constraint.axis.x, constraint.axis.y, constraint.axis.z };
+			float turned[3];
+			a.MultiplyInertia(u, turned);
+			inverseMass = u[0] * turned[0] + u[1] * turned[1] + u[2] * turned[2];
+			b.MultiplyInertia(u, turned);
+			inverseMass += u[0] * turned[0] + u[1] * turned[1] + u[2] * turned[2];
+		}
+		else {
+			inverseMass = a.InverseEffectiveMass(constraint.rA, constraint.axis) + b.InverseEffectiveMass(constraint.rB, constraint.axis);
+		}
+		constraint.axisMass = inverseMass > 0.0f ? 1.0f / inverseMass : 0.0f;
+
+		if (joint->IsLimitEnabled()) {
+			float lower = joint->GetLowerLimit();
+			float upper = joint->GetUpperLimit();
+			if (upper - lower < EQUAL_LIMIT_TOLERANCE) {
+				constraint.limitState = LIMIT_EQUAL;
+				constraint.limitBias = Clamp(biasScale * (axisValue - lower), m_maxCorrectionSpeed);
+			}
+			//Only the nearer limit is checked, but it's on every step so a joint moving fast
+			//towards it slows down in time instead of overshooting (speculative, like contacts)
+			else if (axisValue - lower < upper - axisValue) {
+				float gap = axisValue - lower;
+				constraint.limitState = LIMIT_LOWER;
+				constraint.limitVelocityBias = -std::max(gap, 0.0f) / dt;
+				constraint.limitBias = std::min(biasScale * std::min(gap, 0.0f), m_maxCorrectionSpeed);
+			}
+			else {
+				float gap = upper - axisValue;
+				constraint.limitState = LIMIT_UPPER;
+				constraint.limitVelocityBias = std::max(gap, 0.0f) / dt;
+				constraint.limitBias = -std::min(biasScale * std::min(gap, 0.0f), m_maxCorrectionSpeed);
+			}
+		}
+
+		if (joint->IsMotorEnabled() && type != JOINT_DISTANCE) {
+			constraint.motorEnabled = true;
+			constraint.motorSpeed = joint->GetMotorSpeed();
+			constraint.maxMotorImpulse = joint->GetMaxMotorForce() * dt;
+		}
+	}
+
+	//Last step's impulses were saved as world vectors, so they carry over even though the rows turned with the bodies
+	const XMFLOAT3& linearImpulse = joint->GetLinearImpulse();
+	const XMFLOAT3& angularImpulse = joint->GetAngularImpulse();
+	for (int i = 0; i < 3; i++) {
+		constraint.linearImpulse[i] = i < constraint.numLinearRows ? Dot(constraint.linearAxes[i], linearImpulse) : 0.0f;
+		constraint.angularImpulse[i] = i < constraint.numAngularRows ? Dot(constraint.angularAxes[i], angularImpulse) : 0.0f;
+	}
+
+	float limitImpulse = joint->GetLimitImpulse();
+	if (constraint.limitState == LIMIT_EQUAL || (constraint.limitState == LIMIT_LOWER && limitImpulse > 0.0f) || (constraint.limitState == LIMIT_UPPER && limitImpulse < 0.0f)) {
+		constraint.limitImpulse = limitImpulse;
+	}
+	if (constraint.motorEnabled) {
+		constraint.motorImpulse = Clamp(joint->GetMotorImpulse(), constraint.maxMotorImpulse);
+	}
+
+	l_constraints.push_back(constraint);
+}
+
+void JointSolver::Solve(RigidBodyArrays& bodies, int iterations)
+{
+	int count = NumConstraints();
+	WarmStart(bodies, 0, count);
+	for (int i = 0; i < iterations; i++) {
+		SolveVelocities(bodies, 0, count, (i & 1) != 0);
+	}
+	StoreImpulses(0, count);
+}
+
+void JointSolver::SortIntoIslands(const RigidBodyArrays& bodies, SimulationIslands& islands)
+{
+	int count = NumConstraints();
+
+	//Numbered in the order they first show up so the ranges come out the same every time
+	l_constraintIsland.resize(count);
+	l_rootIslands.assign(bodies.Size(), -1);
+	l_islandRoots.clear();
+	for (int i = 0; i < count; i++) {
+		const JointConstraint& constraint = l_constraints[i];
+		int body = bodies.IsStatic(constraint.bodyA) ? constraint.bodyB : constraint.bodyA;
+		int root = islands.GetIsland(body);
+		if (l_rootIslands[root] == -1) {
+			l_rootIslands[root] = static_cast<int>(l_islandRoots.size());
+			l_islandRoots.push_back(root);
+		}
+		l_constraintIsland[i] = l_rootIslands[root];
+	}
+
+	//Counting sort, keeping the order joints were added in inside each island
+	int numIslands = NumIslands();
+	l_islandStart.assign(numIslands + 1, 0);
+	for (int i = 0; i < count; i++) {
+		l_islandStart[l_constraintIsland[i] + 1]++;
+	}
+	for (int island = 0; island < numIslands; island++) {
+		l_islandStart[island + 1] += l_islandStart[island];
+	}
+
+	l_sorted.resize(count);
+	l_islandNext.assign(l_islandStart.begin(), l_islandStart.end() - 1);
+	for (int i = 0; i < count; i++) {
+		l_sorted[l_islandNext[l_constraintIsland[i]]++] = l_constraints[i];
+	}
+	l_constraints.swap(l_sorted);
+}
+
+void JointSolver::WarmStart(RigidBodyArrays& bodies, int begin, int end)
+{
+	for (int i = begin; i < end; i++) {
+		JointConstraint& constraint = l_constraints[i];
+		SolverBody a;
+		SolverBody b;
+		a.Load(bodies, constraint.bodyA);
+		b.Load(bodies, constraint.bodyB);
+
+		XMFLOAT3 linear = SumAxes(constraint.linearAxes, constraint.linearImpulse, constraint.numLinearRows);
+		XMFLOAT3 angular = SumAxes(constraint.angularAxes, constraint.angularImpulse, constraint.numAngularRows);
+		float axisImpulse = constraint.limitImpulse + constraint.motorImpulse;
+		if (constraint.axisAngular) {
+			angular.x += constraint.axis.x * axisImpulse;
+			angular.y += constraint.axis.y * axisImpulse;
+			angular.z += constraint.axis.z * axisImpulse;
+		}
+		else {
+			linear.x += constraint.axis.x * axisImpulse;
+			linear.y += constraint.axis.y * axisImpulse;
+			linear.z += constraint.axis.z * axisImpulse;
+		}
+
+		ApplyLinear(a, b, a.velocity, a.angularVelocity, b.velocity, b.angularVelocity, constraint.rA, constraint.rB, linear);
+		ApplyAngular(a, b, a.angularVelocity, b.angularVelocity, angular);
+
+		a.Store(bodies, constraint.bodyA);
+		b.Store(bodies, constraint.bodyB);
+	}
+}
+
+void JointSolver::SolveVelocities(RigidBodyArrays& bodies, int begin, int end, bool reverse)
+{
+	if (reverse) {
+		for (int i = end - 1; i >= begin; i--) {
+			SolveJoint(bodies, l_constraints[i]);
+		}
+	}
+	else {
+		for (int i = begin; i < end; i++) {
+			SolveJoint(bodies, l_constraints[i]);
+		}
+	}
+}
+
+void JointSolver::SolveJoint(RigidBodyArrays& bodies, JointConstraint& constraint)
+{
+	SolverBody a;
+	SolverBody b;
+	a.Load(bodies, constraint.bodyA);
+	b.Load(bodies, constraint.bodyB);
+	const XMFLOAT3& rA = constraint.rA;
+	const XMFLOAT3& rB = constraint.rB;
+
+	//Speed along the axis row, for the velocities or the bias velocities
+	auto axisSpeed = [&](const float vA[3], const float wA[3], const float vB[3], const float wB[3]) {
+		return constraint.axisAngular ? AngularSpeed(wA, wB, constraint.axis) : LinearSpeed(vA, wA, vB, wB, rA, rB, constraint.axis);
+	};
+	auto applyAxis = [&](float vA[3], float wA[3], float vB[3], float wB[3], float impulse) {
+		XMFLOAT3 p = XMFLOAT3(constraint.axis.x * impulse, constraint.axis.y * impulse, constraint.axis.z * impulse);
+		if (constraint.axisAngular) {
+			ApplyAngular(a, b, wA, wB, p);
+		}
+		else {
+			ApplyLinear(a, b, vA, wA, vB, wB, rA, rB, p);
+		}
+	};
+
+	//Motor first so the limit can stop it
+	if (constraint.motorEnabled) {
+		float lambda = constraint.axisMass * (constraint.motorSpeed - axisSpeed(a.velocity, a.angularVelocity, b.velocity, b.angularVelocity));
+		float oldImpulse = constraint.motorImpulse;
+		constraint.motorImpulse = Clamp(oldImpulse + lambda, constraint.maxMotorImpulse);
+		applyAxis(a.velocity, a.angularVelocity, b.velocity, b.angularVelocity, constraint.motorImpulse - oldImpulse);
+	}
+
+	if (constraint.limitState != LIMIT_INACTIVE) {
+		//Limits can only push one way, so like contacts the total is clamped rather than each change
+		auto clampLimit = [&](float impulse) {
+			if (constraint.limitState == LIMIT_LOWER) {
+				return std::max(impulse, 0.0f);
+			}
+			if (constraint.limitState == LIMIT_UPPER) {
+				return std::min(impulse, 0.0f);
+			}
+			return impulse;
+		};
+
+		float lambda = constraint.axisMass * (constraint.limitVelocityBias - axisSpeed(a.velocity, a.angularVelocity, b.velocity, b.angularVelocity));
+		float oldImpulse = constraint.limitImpulse;
+		constraint.limitImpulse = clampLimit(oldImpulse + lambda);
+		applyAxis(a.velocity, a.angularVelocity, b.velocity, b.angularVelocity, constraint.limitImpulse - oldImpulse);
+
+		if (constraint.limitBias != 0.0f) {
+			lambda = constraint.axisMass * (constraint.limitBias - axisSpeed(a.biasVelocity, a.biasAngularVelocity, b.biasVelocity, b.biasAngularVelocity));
+			oldImpulse = constraint.limitBiasImpulse;
+			constraint.limitBiasImpulse = clampLimit(oldImpulse + lambda);
+			applyAxis(a.biasVelocity, a.biasAngularVelocity, b.biasVelocity, b.biasAngularVelocity, constraint.limitBiasImpulse - oldImpulse);
+		}
+	}
+
+	//Blocks are equalities, so the whole block is solved at once with no clamping. The bias
+	//velocities get the same treatment to pull out the drift
+	float speed[3];
+	float lambda[3];
+	int numRows = constraint.numAngularRows;
+	if (numRows > 0) {
+		for (int i = 0; i < numRows; i++) {
+			speed[i] = -AngularSpeed(a.angularVelocity, b.angularVelocity, constraint.angularAxes[i]);
+		}
+		MultiplyBlock(constraint.angularMass, numRows, speed, lambda);
+		for (int i = 0; i < numRows; i++) {
+			constraint.angularImpulse[i] += lambda[i];
+		}
+		ApplyAngular(a, b, a.angularVelocity, b.angularVelocity, SumAxes(constraint.angularAxes, lambda, numRows));
+
+		for (int i = 0; i < numRows; i++) {
+			speed[i] = constraint.angularBias[i] - AngularSpeed(a.biasAngularVelocity, b.biasAngularVelocity, constraint.angularAxes[i]);
+		}
+		MultiplyBlock(constraint.angularMass, numRows, speed, lambda);
+		ApplyAngular(a, b, a.biasAngularVelocity, b.biasAngularVelocity, SumAxes(constraint.angularAxes, lambda, numRows));
+	}
+
+	numRows = constraint.numLinearRows;
+	if (numRows > 0) {
+		for (int i = 0; i < numRows; i++) {
+			speed[i] = -LinearSpeed(a.velocity, a.angularVelocity, b.velocity, b.angularVelocity, rA, rB, constraint.linearAxes[i]);
+		}
+		MultiplyBlock(constraint.linearMass, numRows, speed, lambda);
+		for (int i = 0; i < numRows; i++) {
+			constraint.linearImpulse[i] += lambda[i];
+		}
+		ApplyLinear(a, b, a.velocity, a.angularVelocity, b.velocity, b.angularVelocity, rA, rB, SumAxes(constraint.linearAxes, lambda, numRows));
+
+		for (int i = 0; i < numRows; i++) {
+			speed[i] = constraint.linearBias[i] - LinearSpeed(a.biasVelocity, a.biasAngularVelocity, b.biasVelocity, b.biasAngularVelocity, rA, rB, constraint.linearAxes[i]);
+		}
+		MultiplyBlock(constraint.linearMass, numRows, speed, lambda);
+		ApplyLinear(a, b, a.biasVelocity, a.biasAngularVelocity, b.biasVelocity, b.biasAngularVelocity, rA, rB, SumAxes(constraint.linearAxes, lambda, numRows));
+	}
+
+	a.Store(bodies, constraint.bodyA);
+	b.Store(bodies, constraint.bodyB);
+}
+
+void JointSolver::StoreImpulses(int begin, int end)
+{
+	for (int i = begin; i < end; i++) {
+		const JointConstraint& constraint = l_constraints[i];
+		XMFLOAT3 linear = SumAxes(constraint.linearAxes, constraint.linearImpulse, constraint.numLinearRows);
+		XMFLOAT3 angular = SumAxes(constraint.angularAxes, constraint.angularImpulse, constraint.numAngularRows);
+		constraint.joint->SetImpulses(linear, angular, constraint.limitImpulse, constraint.motorImpulse);
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Joint.h"
+#include "RigidBodyArrays.h"
+#include "SimulationIslands.h"
+
+#include <DirectXMath.h>
+#include <vector>
+
+//Sequential impulse solver for joints. Each joint's rows are solved as blocks rather than one
+//at a time: the rows holding the anchors together (up to 3) are one block and the rows locking
+//rotation (up to 3) another, each solved exactly with the inverse of its effective mass matrix.
+//That makes a single joint hold in one pass, what's left for the iterations is passing impulses
+//along chains, which is helped by sweeping the joints in the opposite order every other
+//iteration. Limits and motors are one more row along the joint's axis. Drift is pushed out on
+//the bias velocities like the contact solver's penetration, so correcting it doesn't add energy.
+//Joints are always warm started from the impulses saved on them last step.
+//On its own it can solve everything in one go, in the physics world the contact solver runs it
+//island by island so joints and contacts are iterated together
+class JointSolver
+{
+private:
+	//Everything about one joint that stays the same across iterations
+	struct JointConstraint
+	{
+		int bodyA;
+		int bodyB;
+		Joint* joint;
+
+		//Anchors relative to each body's centre of mass
+		DirectX::XMFLOAT3 rA;
+		DirectX::XMFLOAT3 rB;
+
+		//Rows keeping the anchors together, along these world directions
+		int numLinearRows;
+		DirectX::XMFLOAT3 linearAxes[3];
+		//Inverse of the block's effective mass matrix, numLinearRows square
+		float linearMass[9];
+		//Speed along each row the bias velocities aim for, pulls any drift back in over a few steps
+		float linearBias[3];
+		float linearImpulse[3];
+
+		//Rows stopping the bodies turning relative to each other, about these world directions
+		int numAngularRows;
+		DirectX::XMFLOAT3 angularAxes[3];
+		float angularMass[9];
+		float angularBias[3];
+		float angularImpulse[3];
+
+		//Limit and motor row, turning about the axis for hinges or along it for the others
+		bool axisAngular;
+		DirectX::XMFLOAT3 axis;
+		float axisMass;
+		int limitState;
+		//Approach speed allowed towards the limit, only below 0 while it's still some way off
+		float limitVelocityBias;
+		float limitBias;
+		float limitImpulse;
+		float limitBiasImpulse;
+		bool motorEnabled;
+		float motorSpeed;
+		float maxMotorImpulse;
+		float motorImpulse;
+	};
+
+	std::vector<JointConstraint> l_constraints;
+
+	//Scratch for sorting the constraints by island
+	std::vector<JointConstraint> l_sorted;
+	std::vector<int> l_constraintIsland;
+	//Index into l_islandRoots for each island root body, -1 if it has no joints
+	std::vector<int> l_rootIslands;
+	std::vector<int> l_islandRoots;
+	//Where each island's joints start once sorted, ending with the total
+	std::vector<int> l_islandStart;
+	std::vector<int> l_islandNext;
+
+	//Fraction of the drift fixed each step
+	float m_baumgarte;
+	//Cap on the bias speed so a badly pulled apart joint doesn't fling things
+	float m_maxCorrectionSpeed;
+
+	//Limits and motors on the axis row, then the angular block, then the linear block last so the anchors get the final say
+	void SolveJoint(RigidBodyArrays& bodies, JointConstraint& constraint);
+
+public:
+	JointSolver();
+	~JointSolver();
+
+	//Drops last step's constraints but keeps the memory
+	void Clear();
+	//Works out the joint's rows and effective masses for this step. Joints between two bodies that
+	//are static or asleep are skipped. Positions and inertia should be up to date
+	void AddJoint(Joint* joint, int bodyA, int bodyB, const RigidBodyArrays& bodies, float dt);
+
+	//Warm start, iterations and storing the impulses for every joint at once, on this thread
+	void Solve(RigidBodyArrays& bodies, int iterations);
+
+	//Groups the joints by island so they can be solved alongside their island's contacts
+	void SortIntoIslands(const RigidBodyArrays& bodies, SimulationIslands& islands);
+	int NumIslands() const { return static_cast<int>(l_islandRoots.size()); }
+	int GetIslandRoot(int island) const { return l_islandRoots[island]; }
+	int GetIslandBegin(int island) const { return l_islandStart[island]; }
+	int GetIslandEnd(int island) const { return l_islandStart[island + 1]; }
+	//Island index for a root body, -1 if there are no joints in it
+	int FindIsland(int root) const { return root < static_cast<int>(l_rootIslands.size()) ? l_rootIslands[root] : -1; }
+
+	//Ranged passes for the contact solver's jobs. Reverse sweeps the range back to front
+	void WarmStart(RigidBodyArrays& bodies, int begin, int end);
+	void SolveVelocities(RigidBodyArrays& bodies, int begin, int end, bool reverse);
+	void StoreImpulses(int begin, int end);
+
+	int NumConstraints() const { return static_cast<int>(l_constraints.size()); }
+
+	void SetBaumgarte(float baumgarte) { m_baumgarte = baumgarte; }
+	float GetBaumgarte() const { return m_baumgarte; }
+};
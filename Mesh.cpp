@@ -8,18 +8,22 @@
 
 using namespace DirectX;
 
-Mesh::Mesh(Vertex* verts, unsigned int numVerts, unsigned int* indices, unsigned int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+int Mesh::s_maxHullVertices = ConvexHull::DEFAULT_MAX_VERTICES;
+
+Mesh::Mesh(Vertex* verts, unsigned int numVerts, unsigned int* indices, unsigned int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, eMeshCPUData cpuData)
 {
     this->numIndices = numIndices;
     this->context = context;
+	m_cpuData = cpuData;
 	
 	CalculateTangents(verts, numVerts, indices, numIndices);
 	CreateBuffers(verts, numVerts, indices, device);
 }
 
-Mesh::Mesh(const char* path, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+Mesh::Mesh(const char* path, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, eMeshCPUData cpuData)
 {
 	this->context = context;
+	m_cpuData = cpuData;
 
 	//from open asset importer https://assimp-docs.readthedocs.io/en/latest/usage/use_the_lib.html
 	// Create an instance of the Importer class
@@ -377,8 +381,28 @@ void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11RasterizerState> customRast)
 //helper methods
 void Mesh::CreateBuffers(Vertex* in_verts, unsigned int numVerts, unsigned int* in_indices, Microsoft::WRL::ComPtr<ID3D11Device> device)
 {
-	for (unsigned int i = 0; i < numVerts; i++) {
-		m_verts.push_back(in_verts[i]);
+	//keep whatever CPU side copies were asked for
+	if (m_cpuData & MESH_CPU_VERTICES) {
+		m_verts.assign(in_verts, in_verts + numVerts);
+	}
+
+	if (m_cpuData & MESH_CPU_POSITIONS) {
+		m_positions.resize(numVerts);
+		for (unsigned int i = 0; i < numVerts; i++) {
+			m_positions[i] = in_verts[i].Position;
+		}
+	}
+
+	//local space bounds, only needs doing once since the verts never change
+	if (numVerts > 0) {
+		m_localBounds = AABB(in_verts[0].Position, in_verts[0].Position);
+		for (unsigned int i = 1; i < numVerts; i++) {
+			m_localBounds = AABB::Union(m_localBounds, AABB(in_verts[i].Position, in_verts[i].Position));
+		}
+	}
+
+	if (numVerts > 0) {
+		m_convexHull.Build(&in_verts[0].Position, numVerts, sizeof(Vertex), s_maxHullVertices);
 	}
 
 	//create the buffers and send to GPU
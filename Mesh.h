@@ -10,8 +10,22 @@
 #include <vector>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 
+#include "AABB.h"
+#include "ArrayView.h"
+#include "ConvexHull.h"
 #include "Vertex.h"
 
+//What a mesh keeps on the CPU once its buffers are on the GPU. Physics only ever
+//reads positions, so most meshes don't need the full vertices hanging around
+enum eMeshCPUData
+{
+	MESH_CPU_NONE = 0,		//render only
+	MESH_CPU_POSITIONS = 1,	//tightly packed positions
+	MESH_CPU_VERTICES = 2,	//full vertices, normals/tangents/uvs included
+
+	MESH_CPU_ALL = MESH_CPU_POSITIONS | MESH_CPU_VERTICES,
+};
+
 class Mesh
 {
 private:
@@ -22,19 +36,37 @@ private:
 	unsigned int numIndices;
 
 	std::vector<Vertex> m_verts;
+	std::vector<DirectX::XMFLOAT3> m_positions;
+	eMeshCPUData m_cpuData;
+	//Calculated once when the buffers are made so colliders never have to walk the verts
+	AABB m_localBounds;
+	//Collision shape for GJK, kept even when no CPU data was asked for. Every collider
+	//made from this mesh shares it so the hull is only ever built once
+	ConvexHull m_convexHull;
+
+	static int s_maxHullVertices;
 
 	void CreateBuffers(Vertex* in_verts, unsigned int numVerts, unsigned int * in_indices, Microsoft::WRL::ComPtr<ID3D11Device> device);
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 
 public:
 	//create a mesh by passing in the verts and indices lists
-	Mesh(Vertex * in_verts, unsigned int numVerts, unsigned int * in_indices, unsigned int in_numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> in_context);
+	Mesh(Vertex * in_verts, unsigned int numVerts, unsigned int * in_indices, unsigned int in_numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> in_context, eMeshCPUData cpuData = MESH_CPU_ALL);
 	//load a mesh by passing in the name of a file
-	Mesh(const char* path, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> in_context);
+	Mesh(const char* path, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> in_context, eMeshCPUData cpuData = MESH_CPU_ALL);
 	~Mesh();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
-	std::vector<Vertex> GetVerticies() { return m_verts; }
+	//Views over the CPU copies, empty if the mesh was made without them
+	ArrayView<Vertex> GetVertices() const { return ArrayView<Vertex>(m_verts); }
+	ArrayView<DirectX::XMFLOAT3> GetPositions() const { return ArrayView<DirectX::XMFLOAT3>(m_positions); }
+	eMeshCPUData GetCPUData() const { return m_cpuData; }
+	const AABB& GetLocalBounds() const { return m_localBounds; }
+	const ConvexHull& GetConvexHull() const { return m_convexHull; }
+	//Cap on convex hull vertices for meshes loaded after this is set, detailed meshes
+	//get a slightly smaller hull in exchange for cheaper support searches
+	static void SetMaxHullVertices(int maxHullVertices) { s_maxHullVertices = maxHullVertices; }
+	static int GetMaxHullVertices() { return s_maxHullVertices; }
 	unsigned int GetIndexCount();
 	void Draw();
 	void Draw(Microsoft::WRL::ComPtr<ID3D11RasterizerState> customRast);
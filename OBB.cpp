@@ -0,0 +1,248 @@
+#include "OBB.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	//Same as the epsilon added to AbsR in TestSAT
+	const float SAT_EPSILON = .0000001f;
+
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	//Edge pairs closer to parallel than this have no useful cross product axis, the face axes cover them
+	const float SWEEP_PARALLEL_EPSILON = .000001f;
+}
+
+// Code edited and re-used from an old DSA2 project which I believe referenced a book that I can't seem to find the name of TODO: Cite the book here
+int OBB::TestSAT(const OBB& a, const OBB& b, int firstAxis) {
+	//Costs one axis when the pair is still separated the same way, otherwise falls through to the full test
+	if (firstAxis != SAT_NONE && IsSeparatingAxis(a, b, firstAxis)) {
+		return firstAxis;
+	}
+
+	float ra, rb;
+	float R[3][3] = { {0.0f,0.0f,0.0f},{0.0f,0.0f,0.0f},{0.0f,0.0f,0.0f}};
+	float AbsR[3][3] = { {0.0f,0.0f,0.0f},{0.0f,0.0f,0.0f},{0.0f,0.0f,0.0f} };
+
+	//Orthonormal axes of each box, scale is already in the half dimensions
+	XMVECTOR aU[3] = { XMLoadFloat3(&a.axes[0]), XMLoadFloat3(&a.axes[1]), XMLoadFloat3(&a.axes[2]) };
+	XMVECTOR bU[3] = { XMLoadFloat3(&b.axes[0]), XMLoadFloat3(&b.axes[1]), XMLoadFloat3(&b.axes[2]) };
+
+	// Compute rotation matrix expressing b in a's coordinate frame
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			XMStoreFloat(&R[i][j], XMVector3Dot(aU[i], bU[j]));
+
+	// Compute translation vector t
+	XMVECTOR vecT = XMLoadFloat3(&b.center) - XMLoadFloat3(&a.center);
+	// Bring translation into a's coordinate frame
+	float t[3];
+	for (int i = 0; i < 3; i++)
+		XMStoreFloat(&t[i], XMVector3Dot(vecT, aU[i]));
+
+	// Compute common subexpressions. Add in an epsilon term to
+	// counteract arithmetic errors when two edges are parallel and
+	// their cross product is (near) null (see text for details)
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			AbsR[i][j] = fabsf(R[i][j]) + SAT_EPSILON;
+
+	const float* halfWidths = a.halfExtents;
+	const float* otherHalfWidths = b.halfExtents;
+	// Test axes L = A0, L = A1, L = A2
+	for (int i = 0; i < 3; i++) {
+		ra = halfWidths[i];
+		rb = otherHalfWidths[0] * AbsR[i][0] + otherHalfWidths[1] * AbsR[i][1] + otherHalfWidths[2] * AbsR[i][2];
+		if (fabsf(t[i]) > ra + rb) {
+			return 1 + i;
+		}
+	}
+
+	// Test axes L = B0, L = B1, L = B2
+	for (int i = 0; i < 3; i++) {
+		ra = halfWidths[0] * AbsR[0][i] + halfWidths[1] * AbsR[1][i] + halfWidths[2] * AbsR[2][i];
+		rb = otherHalfWidths[i];
+		if (fabsf(t[0] * R[0][i] + t[1] * R[1][i] + t[2] * R[2][i]) > ra + rb)
+			return 4 + i;
+	}
+	// Test axis L = A0 x B0
+	ra =halfWidths[1] * AbsR[2][0] +halfWidths[2] * AbsR[1][0];
+	rb = otherHalfWidths[1] * AbsR[0][2] + otherHalfWidths[2] * AbsR[0][1];
+	if (fabsf(t[2] * R[1][0] - t[1] * R[2][0]) > ra + rb)
+		return eSATResults::SAT_AXxBX;
+
+	// Test axis L = A0 x B1
+	ra =halfWidths[1] * AbsR[2][1] +halfWidths[2] * AbsR[1][1];
+	rb = otherHalfWidths[0] * AbsR[0][2] + otherHalfWidths[2] * AbsR[0][0];
+	if (fabsf(t[2] * R[1][1] - t[1] * R[2][1]) > ra + rb)
+		return eSATResults::SAT_AXxBY;
+
+	// Test axis L = A0 x B2
+	ra =halfWidths[1] * AbsR[2][2] +halfWidths[2] * AbsR[1][2];
+	rb = otherHalfWidths[0] * AbsR[0][1] + otherHalfWidths[1] * AbsR[0][0];
+	if (fabsf(t[2] * R[1][2] - t[1] * R[2][2]) > ra + rb)
+		return eSATResults::SAT_AXxBZ;
+
+	// Test axis L = A1 x B0
+	ra =halfWidths[0] * AbsR[2][0] +halfWidths[2] * AbsR[0][0];
+	rb = otherHalfWidths[1] * AbsR[1][2] + otherHalfWidths[2] * AbsR[1][1];
+	if (fabsf(t[0] * R[2][0] - t[2] * R[0][0]) > ra + rb)
+		return eSATResults::SAT_AYxBX;
+
+	// Test axis L = A1 x B1
+	ra =halfWidths[0] * AbsR[2][1] +halfWidths[2] * AbsR[0][1];
+	rb = otherHalfWidths[0] * AbsR[1][2] + otherHalfWidths[2] * AbsR[1][0];
+	if (fabsf(t[0] * R[2][1] - t[2] * R[0][1]) > ra + rb)
+		return eSATResults::SAT_AYxBY;
+
+	// Test axis L = A1 x B2
+	ra =halfWidths[0] * AbsR[2][2] +halfWidths[2] * AbsR[0][2];
+	rb = otherHalfWidths[0] * AbsR[1][1] + otherHalfWidths[1] * AbsR[1][0];
+	if (fabsf(t[0] * R[2][2] - t[2] * R[0][2]) > ra + rb)
+		return eSATResults::SAT_AYxBZ;
+
+	// Test axis L = A2 x B0
+	ra =halfWidths[0] * AbsR[1][0] +halfWidths[1] * AbsR[0][0];
+	rb = otherHalfWidths[1] * AbsR[2][2] + otherHalfWidths[2] * AbsR[2][1];
+	if (fabsf(t[1] * R[0][0] - t[0] * R[1][0]) > ra + rb)
+		return eSATResults::SAT_AZxBX;
+
+	// Test axis L = A2 x B1
+	ra =halfWidths[0] * AbsR[1][1] +halfWidths[1] * AbsR[0][1];
+	rb = otherHalfWidths[0] * AbsR[2][2] + otherHalfWidths[2] * AbsR[2][0];
+	if (fabsf(t[1] * R[0][1] - t[0] * R[1][1]) > ra + rb)
+		return eSATResults::SAT_AZxBY;
+
+	// Test axis L = A2 x B2
+	ra =halfWidths[0] * AbsR[1][2] +halfWidths[1] * AbsR[0][2];
+	rb = otherHalfWidths[0] * AbsR[2][1] + otherHalfWidths[1] * AbsR[2][0];
+	if (fabsf(t[1] * R[0][2] - t[0] * R[1][2]) > ra + rb)
+		return eSATResults::SAT_AZxBZ;
+
+	//there is no axis test that separates this two objects
+	return eSATResults::SAT_NONE;
+}
+
+//Only works out the parts of R and t that the one axis needs, same formulas as above
+bool OBB::IsSeparatingAxis(const OBB& a, const OBB& b, int axis, float margin) {
+	XMFLOAT3 vecT = XMFLOAT3(b.center.x - a.center.x, b.center.y - a.center.y, b.center.z - a.center.z);
+
+	if (axis >= SAT_AX && axis <= SAT_AZ) {
+		int i = axis - SAT_AX;
+		float rb = 0.0f;
+		for (int j = 0; j < 3; j++) {
+			rb += b.halfExtents[j] * (fabsf(Dot(a.axes[i], b.axes[j])) + SAT_EPSILON);
+		}
+		return fabsf(Dot(vecT, a.axes[i])) > a.halfExtents[i] + rb + margin;
+	}
+
+	if (axis >= SAT_BX && axis <= SAT_BZ) {
+		int j = axis - SAT_BX;
+		float ra = 0.0f;
+		for (int i = 0; i < 3; i++) {
+			ra += a.halfExtents[i] * (fabsf(Dot(a.axes[i], b.axes[j])) + SAT_EPSILON);
+		}
+		//t . R column j is just the translation onto b's axis
+		return fabsf(Dot(vecT, b.axes[j])) > ra + b.halfExtents[j] + margin;
+	}
+
+	if (axis >= SAT_AXxBX && axis <= SAT_AZxBZ) {
+		int i = (axis - SAT_AXxBX) / 3;
+		int j = (axis - SAT_AXxBX) % 3;
+		int i1 = (i + 1) % 3;
+		int i2 = (i + 2) % 3;
+		int j1 = (j + 1) % 3;
+		int j2 = (j + 2) % 3;
+
+		float rI1J = Dot(a.axes[i1], b.axes[j]);
+		float rI2J = Dot(a.axes[i2], b.axes[j]);
+		float rIJ1 = Dot(a.axes[i], b.axes[j1]);
+		float rIJ2 = Dot(a.axes[i], b.axes[j2]);
+
+		float ra = a.halfExtents[i1] * (fabsf(rI2J) + SAT_EPSILON) + a.halfExtents[i2] * (fabsf(rI1J) + SAT_EPSILON);
+		float rb = b.halfExtents[j1] * (fabsf(rIJ2) + SAT_EPSILON) + b.halfExtents[j2] * (fabsf(rIJ1) + SAT_EPSILON);
+		float distance = Dot(vecT, a.axes[i2]) * rI1J - Dot(vecT, a.axes[i1]) * rI2J;
+		//The cross product axis isn't unit length, so the margin is scaled by it like everything else
+		float rIJ = Dot(a.axes[i], b.axes[j]);
+		return fabsf(distance) > ra + rb + margin * sqrtf(std::max(0.0f, 1.0f - rIJ * rIJ));
+	}
+
+	return false;
+}
+
+bool OBB::Sweep(const OBB& a, const OBB& b, const XMFLOAT3& displacement, float& outTime, XMFLOAT3* outNormal)
+{
+	XMFLOAT3 axes[SAT_AXIS_COUNT - 1];
+	for (int i = 0; i < 3; i++) {
+		axes[i] = a.axes[i];
+		axes[3 + i] = b.axes[i];
+		for (int j = 0; j < 3; j++) {
+			axes[6 + i * 3 + j] = Cross(a.axes[i], b.axes[j]);
+		}
+	}
+
+	XMFLOAT3 offset = XMFLOAT3(b.center.x - a.center.x, b.center.y - a.center.y, b.center.z - a.center.z);
+	float enter = 0.0f;
+	float leave = 1.0f;
+	//Axis the latest span starts on, -1 while they overlap from the start
+	int enterAxis = -1;
+	float enterSign = 1.0f;
+	for (int axis = 0; axis < SAT_AXIS_COUNT - 1; axis++) {
+		const XMFLOAT3& L = axes[axis];
+		float lengthSq = Dot(L, L);
+		if (lengthSq < SWEEP_PARALLEL_EPSILON) {
+			continue;
+		}
+
+		//Nothing is normalized, distance and speed along L are scaled by the same amount
+		float radius = 0.0f;
+		for (int i = 0; i < 3; i++) {
+			radius += a.halfExtents[i] * fabsf(Dot(a.axes[i], L)) + b.halfExtents[i] * fabsf(Dot(b.axes[i], L));
+		}
+		float distance = Dot(offset, L);
+		float speed = Dot(displacement, L);
+
+		//Overlapping along L while |distance - speed * t| <= radius
+		if (fabsf(speed) < SAT_EPSILON) {
+			if (fabsf(distance) > radius) {
+				return false;
+			}
+			continue;
+		}
+
+		float t0 = (distance - radius) / speed;
+		float t1 = (distance + radius) / speed;
+		if (t0 > t1) {
+			std::swap(t0, t1);
+		}
+
+		if (t0 > enter) {
+			enter = t0;
+			enterAxis = axis;
+			//a is moving into b along L, so b's side it meets faces back against the motion
+			enterSign = speed > 0.0f ? -1.0f : 1.0f;
+		}
+		leave = std::min(leave, t1);
+		if (enter > leave) {
+			return false;
+		}
+	}
+
+	outTime = enter;
+	if (outNormal) {
+		XMVECTOR normal = enterAxis >= 0 ? XMLoadFloat3(&axes[enterAxis]) * enterSign : -XMLoadFloat3(&displacement);
+		XMStoreFloat3(outNormal, XMVector3Normalize(normal));
+	}
+	return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+enum eSATResults
+{
+	SAT_NONE = 0,
+
+	SAT_AX,
+	SAT_AY,
+	SAT_AZ,
+
+	SAT_BX,
+	SAT_BY,
+	SAT_BZ,
+
+	SAT_AXxBX,
+	SAT_AXxBY,
+	SAT_AXxBZ,
+
+	SAT_AYxBX,
+	SAT_AYxBY,
+	SAT_AYxBZ,
+
+	SAT_AZxBX,
+	SAT_AZxBY,
+	SAT_AZxBZ,
+
+	SAT_AXIS_COUNT,
+};
+
+//Oriented bounding box in world space. Axes are unit length, the half extents
+//are along those axes so any scale is already baked in
+struct OBB
+{
+	DirectX::XMFLOAT3 center;
+	DirectX::XMFLOAT3 axes[3];
+	float halfExtents[3];
+
+	//Separating axis test between two boxes, returns the first axis that separates
+	//them or SAT_NONE if they overlap. firstAxis is tried before the usual order,
+	//pass in whatever separated the pair last time since it usually still does
+	static int TestSAT(const OBB& a, const OBB& b, int firstAxis = SAT_NONE);
+
+	//Tests just one of the 15 axes, only counts as separating if the gap along it is more than margin
+	static bool IsSeparatingAxis(const OBB& a, const OBB& b, int axis, float margin = 0.0f);
+
+	//Time of impact for a moving by displacement while b stays put (pass the difference if both
+	//move), neither turns. Each of the 15 axes gives the span of time the boxes overlap along it
+	//and they only touch where every span does, so outTime is the latest start of those spans.
+	//0 if they already overlap, returns false if they don't touch before the end of the move.
+	//outNormal gets the axis they meet along, unit length and pointing from b towards a
+	static bool Sweep(const OBB& a, const OBB& b, const DirectX::XMFLOAT3& displacement, float& outTime, DirectX::XMFLOAT3* outNormal = nullptr);
+};
@@ -0,0 +1,277 @@
+#include "OBBPairBatch.h"
+
+#include <immintrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	//Where each part of a box starts within one side's components
+	const int CENTER_OFFSET = 0;
+	const int AXIS_OFFSET = 3;
+	const int HALF_OFFSET = 12;
+
+	//Same epsilon the scalar test adds to |R| to handle near parallel edges
+	const float SAT_EPSILON = .0000001f;
+
+	struct SSELanes
+	{
+		typedef __m128 Vec;
+		static const int WIDTH = 4;
+
+		static Vec Load(const float* p) { return _mm_loadu_ps(p); }
+		static void Store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+		static Vec Set(float f) { return _mm_set1_ps(f); }
+		static Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+		static Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+		static Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+		static Vec And(Vec a, Vec b) { return _mm_and_ps(a, b); }
+		//~a & b
+		static Vec AndNot(Vec a, Vec b) { return _mm_andnot_ps(a, b); }
+		static Vec Or(Vec a, Vec b) { return _mm_or_ps(a, b); }
+		static Vec Abs(Vec v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+		static Vec Greater(Vec a, Vec b) { return _mm_cmpgt_ps(a, b); }
+		static int MoveMask(Vec v) { return _mm_movemask_ps(v); }
+	};
+
+#if defined(__AVX__)
+	struct AVXLanes
+	{
+		typedef __m256 Vec;
+		static const int WIDTH = 8;
+
+		static Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+		static void Store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+		static Vec Set(float f) { return _mm256_set1_ps(f); }
+		static Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+		static Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+		static Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+		static Vec And(Vec a, Vec b) { return _mm256_and_ps(a, b); }
+		static Vec AndNot(Vec a, Vec b) { return _mm256_andnot_ps(a, b); }
+		static Vec Or(Vec a, Vec b) { return _mm256_or_ps(a, b); }
+		static Vec Abs(Vec v) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v); }
+		static Vec Greater(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static int MoveMask(Vec v) { return _mm256_movemask_ps(v); }
+	};
+#endif
+
+	//Tracks which lanes have found a separating axis and which axis it was
+	template<typename Lanes>
+	struct LaneResults
+	{
+		typedef typename Lanes::Vec Vec;
+
+		Vec separated;
+		Vec axis;
+
+		LaneResults()
+			: separated(Lanes::Set(0.0f)),
+			axis(Lanes::Set(0.0f))
+		{
+		}
+
+		void TestAxis(Vec distance, Vec ra, Vec rb, int axisId)
+		{
+			Vec isSeparating = Lanes::Greater(Lanes::Abs(distance), Lanes::Add(ra, rb));
+			//Only keep the first axis that separated each lane, same as the scalar early out
+			Vec isFirst = Lanes::AndNot(separated, isSeparating);
+			axis = Lanes::Or(axis, Lanes::And(isFirst, Lanes::Set(static_cast<float>(axisId))));
+			separated = Lanes::Or(separated, isSeparating);
+		}
+
+		bool AllSeparated() const { return Lanes::MoveMask(separated) == (1 << Lanes::WIDTH) - 1; }
+	};
+
+	//All 15 axes from Ericson's Real-Time Collision Detection OBB test (4.4.1), on Lanes::WIDTH pairs at once
+	template<typename Lanes>
+	void TestLanes(const std::vector<float>* components, int start, int count, int sideComponents, unsigned int* outHitMask, unsigned char* outAxes)
+	{
+		typedef typename Lanes::Vec Vec;
+
+		const std::vector<float>* compA = components;
+		const std::vector<float>* compB = components + sideComponents;
+
+		Vec aAxes[3][3];
+		Vec bAxes[3][3];
+		Vec aHalves[3];
+		Vec bHalves[3];
+		Vec translation[3];
+		for (int i = 0; i < 3; i++) {
+			translation[i] = Lanes::Sub(Lanes::Load(&compB[CENTER_OFFSET + i][start]), Lanes::Load(&compA[CENTER_OFFSET + i][start]));
+			aHalves[i] = Lanes::Load(&compA[HALF_OFFSET + i][start]);
+			bHalves[i] = Lanes::Load(&compB[HALF_OFFSET + i][start]);
+			for (int c = 0; c < 3; c++) {
+				aAxes[i][c] = Lanes::Load(&compA[AXIS_OFFSET + i * 3 + c][start]);
+				bAxes[i][c] = Lanes::Load(&compB[AXIS_OFFSET + i * 3 + c][start]);
+			}
+		}
+
+		//Rotation expressing b in a's frame, and the translation brought into a's frame
+		Vec R[3][3];
+		Vec AbsR[3][3];
+		Vec t[3];
+		Vec epsilon = Lanes::Set(SAT_EPSILON);
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				R[i][j] = Lanes::Add(Lanes::Add(
+					Lanes::Mul(aAxes[i][0], bAxes[j][0]),
+					Lanes::Mul(aAxes[i][1], bAxes[j][1])),
+					Lanes::Mul(aAxes[i][2], bAxes[j][2]));
+				AbsR[i][j] = Lanes::Add(Lanes::Abs(R[i][j]), epsilon);
+			}
+
+			t[i] = Lanes::Add(Lanes::Add(
+				Lanes::Mul(translation[0], aAxes[i][0]),
+				Lanes::Mul(translation[1], aAxes[i][1])),
+				Lanes::Mul(translation[2], aAxes[i][2]));
+		}
+
+		LaneResults<Lanes> results;
+
+		// Test axes L = A0, L = A1, L = A2
+		for (int i = 0; i < 3; i++) {
+			Vec rb = Lanes::Add(Lanes::Add(
+				Lanes::Mul(bHalves[0], AbsR[i][0]),
+				Lanes::Mul(bHalves[1], AbsR[i][1])),
+				Lanes::Mul(bHalves[2], AbsR[i][2]));
+			results.TestAxis(t[i], aHalves[i], rb, SAT_AX + i);
+		}
+
+		// Test axes L = B0, L = B1, L = B2
+		for (int j = 0; j < 3 && !results.AllSeparated(); j++) {
+			Vec ra = Lanes::Add(Lanes::Add(
+				Lanes::Mul(aHalves[0], AbsR[0][j]),
+				Lanes::Mul(aHalves[1], AbsR[1][j])),
+				Lanes::Mul(aHalves[2], AbsR[2][j]));
+			Vec distance = Lanes::Add(Lanes::Add(
+				Lanes::Mul(t[0], R[0][j]),
+				Lanes::Mul(t[1], R[1][j])),
+				Lanes::Mul(t[2], R[2][j]));
+			results.TestAxis(distance, ra, bHalves[j], SAT_BX + j);
+		}
+
+		// Test axes L = Ai x Bj, written generally so the nine cases share one loop
+		for (int i = 0; i < 3 && !results.AllSeparated(); i++) {
+			int i1 = (i + 1) % 3;
+			int i2 = (i + 2) % 3;
+
+			for (int j = 0; j < 3; j++) {
+				int j1 = (j + 1) % 3;
+				int j2 = (j + 2) % 3;
+
+				Vec ra = Lanes::Add(Lanes::Mul(aHalves[i1], AbsR[i2][j]), Lanes::Mul(aHalves[i2], AbsR[i1][j]));
+				Vec rb = Lanes::Add(Lanes::Mul(bHalves[j1], AbsR[i][j2]), Lanes::Mul(bHalves[j2], AbsR[i][j1]));
+				Vec distance = Lanes::Sub(Lanes::Mul(t[i2], R[i1][j]), Lanes::Mul(t[i1], R[i2][j]));
+				results.TestAxis(distance, ra, rb, SAT_AXxBX + i * 3 + j);
+			}
+		}
+
+		//Lanes past the end are padding, leave their bits clear
+		int validLanes = count - start < Lanes::WIDTH ? count - start : Lanes::WIDTH;
+		unsigned int validMask = (1u << validLanes) - 1;
+		unsigned int hits = ~static_cast<unsigned int>(Lanes::MoveMask(results.separated)) & validMask;
+		outHitMask[start >> 5] |= hits << (start & 31);
+
+		float axes[Lanes::WIDTH];
+		Lanes::Store(axes, results.axis);
+		for (int lane = 0; lane < validLanes; lane++) {
+			outAxes[start + lane] = static_cast<unsigned char>(axes[lane]);
+		}
+	}
+}
+
+OBBPairBatch::OBBPairBatch()
+	: m_count(0)
+{
+}
+
+OBBPairBatch::~OBBPairBatch()
+{
+}
+
+void OBBPairBatch::Clear()
+{
+	m_count = 0;
+}
+
+void OBBPairBatch::WriteSide(int side, int index, const OBB& box)
+{
+	std::vector<float>* components = l_components + side * SIDE_COMPONENTS;
+
+	const float* center = &box.center.x;
+	for (int c = 0; c < 3; c++) {
+		components[CENTER_OFFSET + c][index] = center[c];
+		components[HALF_OFFSET + c][index] = box.halfExtents[c];
+	}
+
+	for (int i = 0; i < 3; i++) {
+		const float* axis = &box.axes[i].x;
+		for (int c = 0; c < 3; c++) {
+			components[AXIS_OFFSET + i * 3 + c][index] = axis[c];
+		}
+	}
+}
+
+void OBBPairBatch::AddPair(const OBB& a, const OBB& b)
+{
+	//Keep every array padded to a whole number of the widest lanes so loads never run off the end
+	int paddedSize = (m_count + MAX_LANE_WIDTH) / MAX_LANE_WIDTH * MAX_LANE_WIDTH;
+	if (static_cast<int>(l_components[0].size()) < paddedSize) {
+		for (int c = 0; c < NUM_COMPONENTS; c++) {
+			l_components[c].resize(paddedSize, 0.0f);
+		}
+	}
+
+	WriteSide(0, m_count, a);
+	WriteSide(1, m_count, b);
+	m_count++;
+}
+
+void OBBPairBatch::Test(std::vector<unsigned int>& outHitMask, std::vector<unsigned char>& outAxes, int laneWidth) const
+{
+	outHitMask.assign((m_count + 31) / 32, 0);
+	outAxes.resize(m_count);
+
+#if defined(__AVX__)
+	if (laneWidth == 8) {
+		for (int start = 0; start < m_count; start += AVXLanes::WIDTH) {
+			TestLanes<AVXLanes>(l_components, start, m_count, SIDE_COMPONENTS, outHitMask.data(), outAxes.data());
+		}
+		return;
+	}
+#else
+	//Only AVX builds have a choice of width
+	(void)laneWidth;
+#endif
+
+	for (int start = 0; start < m_count; start += SSELanes::WIDTH) {
+		TestLanes<SSELanes>(l_components, start, m_count, SIDE_COMPONENTS, outHitMask.data(), outAxes.data());
+	}
+}
+
+void OBBPairBatch::TestScalar(std::vector<unsigned int>& outHitMask, std::vector<unsigned char>& outAxes) const
+{
+	outHitMask.assign((m_count + 31) / 32, 0);
+	outAxes.resize(m_count);
+
+	for (int index = 0; index < m_count; index++) {
+		OBB boxes[2];
+		for (int side = 0; side < 2; side++) {
+			const std::vector<float>* components = l_components + side * SIDE_COMPONENTS;
+			boxes[side].center = XMFLOAT3(components[CENTER_OFFSET][index], components[CENTER_OFFSET + 1][index], components[CENTER_OFFSET + 2][index]);
+			for (int i = 0; i < 3; i++) {
+				boxes[side].halfExtents[i] = components[HALF_OFFSET + i][index];
+				boxes[side].axes[i] = XMFLOAT3(
+					components[AXIS_OFFSET + i * 3][index],
+					components[AXIS_OFFSET + i * 3 + 1][index],
+					components[AXIS_OFFSET + i * 3 + 2][index]);
+			}
+		}
+
+		int axis = OBB::TestSAT(boxes[0], boxes[1]);
+		outAxes[index] = static_cast<unsigned char>(axis);
+		if (axis == SAT_NONE) {
+			outHitMask[index >> 5] |= 1u << (index & 31);
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "OBB.h"
+
+#include <vector>
+
+//Batch of OBB pairs stored as structure of arrays, so the separating axis test can
+//run on 4 (SSE) or 8 (AVX) pairs at once instead of one pair at a time. Every
+//component (center x, axis 0 y, half extent 2, etc.) of every pair gets its own
+//array, padded out to a full set of lanes
+class OBBPairBatch
+{
+private:
+	//Each side of a pair is 3 center + 9 axis + 3 half extent floats
+	static const int SIDE_COMPONENTS = 15;
+	static const int NUM_COMPONENTS = SIDE_COMPONENTS * 2;
+
+	std::vector<float> l_components[NUM_COMPONENTS];
+	int m_count;
+
+	void WriteSide(int side, int index, const OBB& box);
+
+public:
+#if defined(__AVX__)
+	static const int MAX_LANE_WIDTH = 8;
+#else
+	static const int MAX_LANE_WIDTH = 4;
+#endif
+
+	OBBPairBatch();
+	~OBBPairBatch();
+
+	//Empties the batch but keeps the memory around for the next one
+	void Clear();
+	void AddPair(const OBB& a, const OBB& b);
+	int Size() const { return m_count; }
+
+	//Runs the SAT on every pair. outHitMask gets one bit per pair, set if the boxes overlap
+	//(pair i is bit i % 32 of word i / 32). outAxes gets each pair's first separating
+	//axis as an eSATResults, SAT_NONE for the ones that hit. laneWidth can be 4 or
+	//MAX_LANE_WIDTH, AVX is only there if the project is built with /arch:AVX or higher
+	void Test(std::vector<unsigned int>& outHitMask, std::vector<unsigned char>& outAxes, int laneWidth = MAX_LANE_WIDTH) const;
+
+	//Same results as Test but one pair at a time through OBB::TestSAT, for checking and timing against
+	void TestScalar(std::vector<unsigned int>& outHitMask, std::vector<unsigned char>& outAxes) const;
+
+	static bool IsHit(const std::vector<unsigned int>& hitMask, int index) { return (hitMask[index >> 5] >> (index & 31)) & 1; }
+};
@@ -0,0 +1,1828 @@
+#include "PhysicsBenchmarks.h"
+#include "ContactManifold.h"
+#include "ContactSolver.h"
+#include "ContinuousCollision.h"
+#include "DynamicAABBTree.h"
+#include "GJK.h"
+#include "JobSystem.h"
+#include "Joint.h"
+#include "JointSolver.h"
+#include "OBBPairBatch.h"
+#include "QueryBVH.h"
+#include "RigidBodyArrays.h"
+#include "SimulationIslands.h"
+#include "SpatialHashGrid.h"
+#include "SweepAndPrune.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock BenchClock;
+
+	const float BENCH_DT = 1.0f / 60.0f;
+	const float BENCH_HALF_SIZE = 0.5f;
+	//Roughly how many colliders per cubic unit, kept constant so pair counts scale linearly
+	const float BENCH_DENSITY = 0.05f;
+
+	double MillisecondsSince(BenchClock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+	}
+
+	//Cloud of small boxes bouncing around inside a cube
+	struct MovingBoxScene
+	{
+		std::vector<XMFLOAT3> l_positions;
+		std::vector<XMFLOAT3> l_velocities;
+		float m_worldHalfSize;
+		float m_halfSize;
+		//Only the first m_numMovers boxes move, the rest stay put
+		int m_numMovers;
+
+		MovingBoxScene(int count, unsigned int seed, float movingFraction = 1.0f, float halfSize = BENCH_HALF_SIZE)
+		{
+			m_numMovers = static_cast<int>(count * movingFraction);
+			m_halfSize = halfSize;
+			//Keep the same density relative to box volume so smaller boxes get a smaller world
+			m_worldHalfSize = 0.5f * cbrtf(count / BENCH_DENSITY) * (halfSize / BENCH_HALF_SIZE);
+
+			std::mt19937 rng(seed);
+			std::uniform_real_distribution<float> posDist(-m_worldHalfSize, m_worldHalfSize);
+			std::uniform_real_distribution<float> velDist(-2.0f, 2.0f);
+
+			l_positions.resize(count);
+			l_velocities.resize(count);
+			for (int i = 0; i < count; i++) {
+				l_positions[i] = XMFLOAT3(posDist(rng), posDist(rng), posDist(rng));
+				l_velocities[i] = XMFLOAT3(velDist(rng), velDist(rng), velDist(rng));
+			}
+		}
+
+		AABB GetBounds(int index) const
+		{
+			const XMFLOAT3& p = l_positions[index];
+			return AABB(
+				XMFLOAT3(p.x - m_halfSize, p.y - m_halfSize, p.z - m_halfSize),
+				XMFLOAT3(p.x + m_halfSize, p.y + m_halfSize, p.z + m_halfSize));
+		}
+
+		//Moves every box and returns its displacement through outDisplacements
+		void Step(std::vector<XMFLOAT3>& outDisplacements)
+		{
+			outDisplacements.assign(l_positions.size(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+			for (int i = 0; i < m_numMovers; i++) {
+				float* pos = &l_positions[i].x;
+				float* vel = &l_velocities[i].x;
+				float* disp = &outDisplacements[i].x;
+
+				for (int axis = 0; axis < 3; axis++) {
+					disp[axis] = vel[axis] * BENCH_DT;
+					pos[axis] += disp[axis];
+
+					//Bounce off the walls
+					if (pos[axis] > m_worldHalfSize || pos[axis] < -m_worldHalfSize) {
+						vel[axis] = -vel[axis];
+					}
+				}
+			}
+		}
+	};
+
+	//Runs the scene for a number of frames through the broadphase and returns a report line
+	std::string RunScene(Broadphase& broadphase, MovingBoxScene& scene, int frames)
+	{
+		int count = static_cast<int>(scene.l_positions.size());
+		std::vector<int> proxies(count);
+		std::vector<int> proxyToIndex;
+		std::vector<XMFLOAT3> displacements;
+		std::vector<BroadphasePair> pairs;
+
+		for (int i = 0; i < count; i++) {
+			proxies[i] = broadphase.CreateProxy(scene.GetBounds(i), nullptr);
+		}
+
+		//Proxy ids don't have to line up with scene indices (the tree shares them with internal nodes)
+		proxyToIndex.assign(*std::max_element(proxies.begin(), proxies.end()) + 1, -1);
+		for (int i = 0; i < count; i++) {
+			proxyToIndex[proxies[i]] = i;
+		}
+
+		double updateMs = 0.0;
+		double pairMs = 0.0;
+		long long totalPairs = 0;
+		long long totalOverlaps = 0;
+
+		for (int frame = 0; frame < frames; frame++) {
+			scene.Step(displacements);
+
+			BenchClock::time_point start = BenchClock::now();
+			for (int i = 0; i < count; i++) {
+				broadphase.MoveProxy(proxies[i], scene.GetBounds(i), displacements[i]);
+			}
+			updateMs += MillisecondsSince(start);
+
+			start = BenchClock::now();
+			broadphase.ComputePairs(pairs);
+			pairMs += MillisecondsSince(start);
+
+			totalPairs += pairs.size();
+			for (auto& pair : pairs) {
+				if (scene.GetBounds(proxyToIndex[pair.proxyA]).Overlaps(scene.GetBounds(proxyToIndex[pair.proxyB]))) {
+					totalOverlaps++;
+				}
+			}
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %-15s %6d colliders (%3d%% moving): %8.1f pairs/frame (%7.1f overlapping), %7.3f ms/frame (update %.3f, pairs %.3f)\n",
+			broadphase.GetName(),
+			count,
+			count > 0 ? scene.m_numMovers * 100 / count : 0,
+			static_cast<double>(totalPairs) / frames,
+			static_cast<double>(totalOverlaps) / frames,
+			(updateMs + pairMs) / frames,
+			updateMs / frames,
+			pairMs / frames);
+		return line;
+	}
+
+	//Every box against every other box, the reference the broadphases are compared against
+	std::string RunBruteForce(MovingBoxScene& scene, int frames)
+	{
+		int count = static_cast<int>(scene.l_positions.size());
+		std::vector<XMFLOAT3> displacements;
+		long long totalOverlaps = 0;
+
+		BenchClock::time_point start = BenchClock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			scene.Step(displacements);
+			for (int i = 0; i < count; i++) {
+				AABB bounds = scene.GetBounds(i);
+				for (int j = i + 1; j < count; j++) {
+					if (bounds.Overlaps(scene.GetBounds(j))) {
+						totalOverlaps++;
+					}
+				}
+			}
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %-15s %6d colliders: %7.1f overlapping/frame, %7.3f ms/frame\n",
+			"Brute force",
+			count,
+			static_cast<double>(totalOverlaps) / frames,
+			MillisecondsSince(start) / frames);
+		return line;
+	}
+
+	//Randomly rotated and scaled boxes close enough together that some overlap
+	void BuildRandomOBBPairs(OBBPairBatch& batch, int count, unsigned int seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> posDist(-2.0f, 2.0f);
+		std::uniform_real_distribution<float> angleDist(-XM_PI, XM_PI);
+		std::uniform_real_distribution<float> sizeDist(0.1f, 1.0f);
+
+		batch.Clear();
+		for (int i = 0; i < count; i++) {
+			OBB boxes[2];
+			for (int side = 0; side < 2; side++) {
+				XMMATRIX rotation = XMMatrixRotationRollPitchYaw(angleDist(rng), angleDist(rng), angleDist(rng));
+				boxes[side].center = XMFLOAT3(posDist(rng), posDist(rng), posDist(rng));
+				for (int axis = 0; axis < 3; axis++) {
+					XMStoreFloat3(&boxes[side].axes[axis], rotation.r[axis]);
+					boxes[side].halfExtents[axis] = sizeDist(rng);
+				}
+			}
+
+			batch.AddPair(boxes[0], boxes[1]);
+		}
+	}
+
+	//Times repeated runs of one SAT path, laneWidth 0 means the scalar one
+	std::string RunSATPath(const OBBPairBatch& batch, int laneWidth, int repeats, const std::vector<unsigned int>& expectedHits, const std::vector<unsigned char>& expectedAxes)
+	{
+		std::vector<unsigned int> hitMask;
+		std::vector<unsigned char> axes;
+
+		BenchClock::time_point start = BenchClock::now();
+		for (int i = 0; i < repeats; i++) {
+			if (laneWidth == 0) {
+				batch.TestScalar(hitMask, axes);
+			}
+			else {
+				batch.Test(hitMask, axes, laneWidth);
+			}
+		}
+		double ms = MillisecondsSince(start) / repeats;
+
+		int hits = 0;
+		int mismatches = 0;
+		for (int i = 0; i < batch.Size(); i++) {
+			bool hit = OBBPairBatch::IsHit(hitMask, i);
+			hits += hit ? 1 : 0;
+			if (hit != OBBPairBatch::IsHit(expectedHits, i) || axes[i] != expectedAxes[i]) {
+				mismatches++;
+			}
+		}
+
+		char name[32];
+		if (laneWidth == 0) {
+			snprintf(name, sizeof(name), "Scalar");
+		}
+		else {
+			snprintf(name, sizeof(name), "%d lanes", laneWidth);
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %-15s %6d pairs: %6d hits, %7.3f ms, %6.1f ns/pair, %d mismatches\n",
+			name,
+			batch.Size(),
+			hits,
+			ms,
+			ms * 1000000.0 / batch.Size(),
+			mismatches);
+		return line;
+	}
+
+	//Box pairs drifting and tumbling slowly, so most stay apart the same way from one frame to the next
+	struct TumblingPairScene
+	{
+		std::vector<XMFLOAT3> l_positions;
+		std::vector<XMFLOAT3> l_velocities;
+		std::vector<XMFLOAT3> l_angles;
+		std::vector<XMFLOAT3> l_spins;
+		std::vector<XMFLOAT3> l_halfExtents;
+
+		TumblingPairScene(int pairCount, unsigned int seed)
+		{
+			std::mt19937 rng(seed);
+			std::uniform_real_distribution<float> posDist(-2.0f, 2.0f);
+			std::uniform_real_distribution<float> velDist(-0.5f, 0.5f);
+			std::uniform_real_distribution<float> angleDist(-XM_PI, XM_PI);
+			std::uniform_real_distribution<float> sizeDist(0.1f, 1.0f);
+
+			int count = pairCount * 2;
+			l_positions.resize(count);
+			l_velocities.resize(count);
+			l_angles.resize(count);
+			l_spins.resize(count);
+			l_halfExtents.resize(count);
+			for (int i = 0; i < count; i++) {
+				l_positions[i] = XMFLOAT3(posDist(rng), posDist(rng), posDist(rng));
+				l_velocities[i] = XMFLOAT3(velDist(rng), velDist(rng), velDist(rng));
+				l_angles[i] = XMFLOAT3(angleDist(rng), angleDist(rng), angleDist(rng));
+				l_spins[i] = XMFLOAT3(velDist(rng), velDist(rng), velDist(rng));
+				l_halfExtents[i] = XMFLOAT3(sizeDist(rng), sizeDist(rng), sizeDist(rng));
+			}
+		}
+
+		void Step(std::vector<OBB>& outBoxes)
+		{
+			outBoxes.resize(l_positions.size());
+			for (int i = 0; i < static_cast<int>(l_positions.size()); i++) {
+				float* pos = &l_positions[i].x;
+				float* vel = &l_velocities[i].x;
+				float* angle = &l_angles[i].x;
+				const float* spin = &l_spins[i].x;
+				for (int axis = 0; axis < 3; axis++) {
+					pos[axis] += vel[axis] * BENCH_DT;
+					angle[axis] += spin[axis] * BENCH_DT;
+					//Keep each pair loosely together
+					if (pos[axis] > 2.0f || pos[axis] < -2.0f) {
+						vel[axis] = -vel[axis];
+					}
+				}
+
+				OBB& box = outBoxes[i];
+				XMMATRIX rotation = XMMatrixRotationRollPitchYaw(angle[0], angle[1], angle[2]);
+				box.center = l_positions[i];
+				box.halfExtents[0] = l_halfExtents[i].x;
+				box.halfExtents[1] = l_halfExtents[i].y;
+				box.halfExtents[2] = l_halfExtents[i].z;
+				for (int axis = 0; axis < 3; axis++) {
+					XMStoreFloat3(&box.axes[axis], rotation.r[axis]);
+				}
+			}
+		}
+	};
+
+	//Scalar SAT over a few seconds of the tumbling scene, with or without remembering each pair's separating axis
+	std::string RunCoherentSAT(int pairCount, int frames, bool useCachedAxis)
+	{
+		TumblingPairScene scene(pairCount, 77);
+		std::vector<OBB> boxes;
+		std::vector<int> cachedAxes(pairCount, SAT_NONE);
+
+		double testMs = 0.0;
+		long long hits = 0;
+		long long cachedTests = 0;
+		long long earlyOuts = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			scene.Step(boxes);
+
+			BenchClock::time_point start = BenchClock::now();
+			for (int i = 0; i < pairCount; i++) {
+				int firstAxis = useCachedAxis ? cachedAxes[i] : SAT_NONE;
+				int axis = OBB::TestSAT(boxes[i * 2], boxes[i * 2 + 1], firstAxis);
+
+				if (firstAxis != SAT_NONE) {
+					cachedTests++;
+					earlyOuts += axis == firstAxis ? 1 : 0;
+				}
+				hits += axis == SAT_NONE ? 1 : 0;
+				cachedAxes[i] = axis;
+			}
+			testMs += MillisecondsSince(start);
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %-15s %6d pairs: %7.1f hits/frame, %7.3f ms/frame, %5.1f%% cached axis early outs\n",
+			useCachedAxis ? "Cached axis" : "No cache",
+			pairCount,
+			static_cast<double>(hits) / frames,
+			testMs / frames,
+			cachedTests > 0 ? 100.0 * earlyOuts / cachedTests : 0.0);
+		return line;
+	}
+
+	//How far the boxes overlap along axis (not necessarily unit length), the sum of their radii
+	//along it less the distance between their centers
+	float OverlapAlong(const OBB& a, const OBB& b, FXMVECTOR axis)
+	{
+		XMVECTOR unitAxis = XMVector3Normalize(axis);
+		float radius = 0.0f;
+		for (int i = 0; i < 3; i++) {
+			radius += a.halfExtents[i] * fabsf(XMVectorGetX(XMVector3Dot(XMLoadFloat3(&a.axes[i]), unitAxis)));
+			radius += b.halfExtents[i] * fabsf(XMVectorGetX(XMVector3Dot(XMLoadFloat3(&b.axes[i]), unitAxis)));
+		}
+
+		XMVECTOR offset = XMLoadFloat3(&b.center) - XMLoadFloat3(&a.center);
+		return radius - fabsf(XMVectorGetX(XMVector3Dot(offset, unitAxis)));
+	}
+
+	//True penetration depth of two overlapping boxes, the least overlap over all 15 SAT axes
+	float SATDepth(const OBB& a, const OBB& b)
+	{
+		float depth = FLT_MAX;
+		for (int i = 0; i < 3; i++) {
+			XMVECTOR axisA = XMLoadFloat3(&a.axes[i]);
+			depth = fminf(depth, OverlapAlong(a, b, axisA));
+			depth = fminf(depth, OverlapAlong(a, b, XMLoadFloat3(&b.axes[i])));
+
+			for (int j = 0; j < 3; j++) {
+				XMVECTOR cross = XMVector3Cross(axisA, XMLoadFloat3(&b.axes[j]));
+				//Nearly parallel edges are covered by the face axes
+				if (XMVectorGetX(XMVector3LengthSq(cross)) > .000001f) {
+					depth = fminf(depth, OverlapAlong(a, b, cross));
+				}
+			}
+		}
+
+		return depth;
+	}
+
+	//GJK and EPA between unit cube hulls stretched into random overlapping boxes. Each depth is checked
+	//against SAT's, and each normal by how far the boxes overlap along it, which is the same depth
+	//if it's the right way to push them apart
+	std::string RunEPACheck(int pairCount)
+	{
+		XMFLOAT3 corners[8];
+		for (int i = 0; i < 8; i++) {
+			corners[i] = XMFLOAT3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+		}
+		ConvexHull cube;
+		cube.Build(corners, 8);
+
+		std::mt19937 rng(31);
+		std::uniform_real_distribution<float> posDist(-0.75f, 0.75f);
+		std::uniform_real_distribution<float> angleDist(-XM_PI, XM_PI);
+		std::uniform_real_distribution<float> sizeDist(0.1f, 1.0f);
+
+		std::vector<OBB> boxes;
+		std::vector<ConvexSupport> supports;
+		while (static_cast<int>(boxes.size()) < pairCount * 2) {
+			OBB pair[2];
+			XMFLOAT4X4 worlds[2];
+			for (int side = 0; side < 2; side++) {
+				XMMATRIX rotation = XMMatrixRotationRollPitchYaw(angleDist(rng), angleDist(rng), angleDist(rng));
+				pair[side].center = XMFLOAT3(posDist(rng), posDist(rng), posDist(rng));
+				for (int axis = 0; axis < 3; axis++) {
+					XMStoreFloat3(&pair[side].axes[axis], rotation.r[axis]);
+					pair[side].halfExtents[axis] = sizeDist(rng);
+				}
+
+				XMMATRIX scale = XMMatrixScaling(pair[side].halfExtents[0], pair[side].halfExtents[1], pair[side].halfExtents[2]);
+				XMMATRIX translation = XMMatrixTranslation(pair[side].center.x, pair[side].center.y, pair[side].center.z);
+				XMStoreFloat4x4(&worlds[side], scale * rotation * translation);
+			}
+
+			if (OBB::TestSAT(pair[0], pair[1]) != SAT_NONE) {
+				continue;
+			}
+
+			for (int side = 0; side < 2; side++) {
+				boxes.push_back(pair[side]);
+				supports.push_back(ConvexSupport(&cube, worlds[side]));
+			}
+		}
+
+		std::vector<PenetrationInfo> penetrations(pairCount);
+		int misses = 0;
+		int unmeasured = 0;
+		BenchClock::time_point start = BenchClock::now();
+		for (int i = 0; i < pairCount; i++) {
+			GJKSimplex simplex;
+			if (!GJK::Intersect(supports[i * 2], supports[i * 2 + 1], simplex)) {
+				misses++;
+				penetrations[i].depth = -1.0f;
+			}
+			else if (!GJK::Penetration(supports[i * 2], supports[i * 2 + 1], simplex, penetrations[i])) {
+				unmeasured++;
+				penetrations[i].depth = -1.0f;
+			}
+		}
+		double ms = MillisecondsSince(start);
+
+		//Well past EPA's own tolerance, anything over is a wrong face rather than rounding
+		const float DEPTH_TOLERANCE = .001f;
+		float worstDepthError = 0.0f;
+		float worstNormalError = 0.0f;
+		int wrongDepths = 0;
+		int wrongNormals = 0;
+		for (int i = 0; i < pairCount; i++) {
+			if (penetrations[i].depth < 0.0f) {
+				continue;
+			}
+
+			const OBB& a = boxes[i * 2];
+			const OBB& b = boxes[i * 2 + 1];
+			float depth = SATDepth(a, b);
+			float depthError = fabsf(penetrations[i].depth - depth);
+			worstDepthError = fmaxf(worstDepthError, depthError);
+			wrongDepths += depthError > DEPTH_TOLERANCE ? 1 : 0;
+
+			//Has to point from a towards b as well
+			XMVECTOR normal = XMLoadFloat3(&penetrations[i].normal);
+			XMVECTOR offset = XMLoadFloat3(&b.center) - XMLoadFloat3(&a.center);
+			float normalError = fabsf(OverlapAlong(a, b, normal) - depth);
+			worstNormalError = fmaxf(worstNormalError, normalError);
+			wrongNormals += normalError > DEPTH_TOLERANCE || XMVectorGetX(XMVector3Dot(normal, offset)) < -DEPTH_TOLERANCE ? 1 : 0;
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %-15s %6d pairs: %7.3f ms, %6.1f ns/pair, worst depth error %.2e, worst normal error %.2e, %d wrong depths, %d wrong normals, %d missed, %d unmeasured\n",
+			"GJK + EPA",
+			pairCount,
+			ms,
+			ms * 1000000.0 / pairCount,
+			worstDepthError,
+			worstNormalError,
+			wrongDepths,
+			wrongNormals,
+			misses,
+			unmeasured);
+		return line;
+	}
+
+	const int STACK_HEIGHT = 10;
+	//Distance between neighbouring stacks, leaves a box width of space between them
+	const float STACK_SPACING = 2.0f;
+	const XMFLOAT3 BENCH_GRAVITY = XMFLOAT3(0.0f, -9.81f, 0.0f);
+	//Same as the collision manager's
+	const float BENCH_CONTACT_MARGIN = 0.02f;
+
+	//Columns of unit boxes resting on a static floor. Does its own collision detection
+	//straight from the body arrays (tree broadphase, box manifolds kept between steps for
+	//warm starting like the collision manager's pair cache) so no colliders or meshes are needed
+	struct StackingScene
+	{
+		struct ManifoldEntry
+		{
+			ContactManifold manifold;
+			int lastStep;
+		};
+
+		RigidBodyArrays m_bodies;
+		std::vector<XMFLOAT3> l_halfExtents;
+		std::vector<XMFLOAT3> l_startPositions;
+
+		DynamicAABBTree m_tree;
+		std::vector<int> l_proxies;
+		std::vector<int> l_proxyToBody;
+		std::vector<BroadphasePair> l_pairs;
+
+		std::unordered_map<unsigned long long, ManifoldEntry> m_manifolds;
+		std::vector<ContactManifold*> l_touching;
+		std::vector<int> l_touchingBodies;
+
+		ContactSolver m_solver;
+		SimulationIslands m_islands;
+		ContinuousCollision m_continuousCollision;
+		//Joints are made against the arrays directly, so they have no body handles and the indices are kept here
+		std::vector<Joint> l_joints;
+		std::vector<int> l_jointBodies;
+		//Sorted so Collide can skip pairs that have a joint between them
+		std::vector<unsigned long long> l_jointedPairs;
+		JointSolver m_jointSolver;
+		std::vector<int> l_sweepProxies;
+		double m_sweepMs;
+		bool m_sleeping;
+		//Solve through the job system, needs the islands built even with sleeping off
+		bool m_parallel;
+		int m_step;
+
+		//A spacing of 1 packs the stacks side by side so the whole scene is one island
+		StackingScene(int boxCount, bool warmStarting, bool sleeping = false, bool parallel = false, float spacing = STACK_SPACING)
+			: m_sweepMs(0.0),
+			m_sleeping(sleeping),
+			m_parallel(parallel),
+			m_step(0)
+		{
+			m_solver.SetWarmStarting(warmStarting);
+
+			int numStacks = (boxCount + STACK_HEIGHT - 1) / STACK_HEIGHT;
+			int stacksPerRow = static_cast<int>(ceilf(sqrtf(static_cast<float>(numStacks))));
+			float floorHalfSize = stacksPerRow * spacing * 0.5f + STACK_SPACING;
+
+			l_halfExtents.push_back(XMFLOAT3(0.0f, 0.0f, 0.0f));
+			AddBox(XMFLOAT3(0.0f, -0.5f, 0.0f), XMFLOAT3(floorHalfSize, 0.5f, floorHalfSize), 0.0f);
+
+			for (int i = 0; i < boxCount; i++) {
+				int stack = i / STACK_HEIGHT;
+				int level = i % STACK_HEIGHT;
+				float x = (stack % stacksPerRow - stacksPerRow * 0.5f) * spacing;
+				float z = (stack / stacksPerRow - stacksPerRow * 0.5f) * spacing;
+				AddBox(XMFLOAT3(x, 0.5f + level, z), XMFLOAT3(0.5f, 0.5f, 0.5f), 1.0f);
+			}
+
+			l_startPositions.resize(m_bodies.Size());
+			for (int i = 0; i < m_bodies.Size(); i++) {
+				l_startPositions[i] = m_bodies.GetPosition(i);
+			}
+		}
+
+		int AddBox(const XMFLOAT3& center, const XMFLOAT3& halfExtents, float mass)
+		{
+			int body = m_bodies.Add();
+			m_bodies.SetPose(body, center, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+			m_bodies.SetBoxMass(body, mass, &halfExtents.x);
+			l_halfExtents.push_back(halfExtents);
+
+			int proxy = m_tree.CreateProxy(GetAABB(body), nullptr);
+			l_proxies.push_back(proxy);
+			if (proxy >= static_cast<int>(l_proxyToBody.size())) {
+				l_proxyToBody.resize(proxy + 1, -1);
+			}
+			l_proxyToBody[proxy] = body;
+			return body;
+		}
+
+		Joint& AddJoint(eJointType type, int bodyA, int bodyB, const XMFLOAT3& anchor, const XMFLOAT3& axis = XMFLOAT3(0.0f, 1.0f, 0.0f))
+		{
+			l_joints.push_back(Joint(type, nullptr, nullptr));
+			l_joints.back().SetFrame(m_bodies, bodyA, bodyB, anchor, anchor, axis);
+			l_jointBodies.push_back(bodyA);
+			l_jointBodies.push_back(bodyB);
+
+			unsigned long long key = (static_cast<unsigned long long>(std::min(bodyA, bodyB)) << 32) | static_cast<unsigned int>(std::max(bodyA, bodyB));
+			l_jointedPairs.insert(std::lower_bound(l_jointedPairs.begin(), l_jointedPairs.end(), key), key);
+			return l_joints.back();
+		}
+
+		OBB GetOBB(int body) const
+		{
+			XMFLOAT4 orientation = m_bodies.GetOrientation(body);
+			XMMATRIX rotation = XMMatrixRotationQuaternion(XMLoadFloat4(&orientation));
+
+			OBB box;
+			box.center = m_bodies.GetPosition(body);
+			for (int axis = 0; axis < 3; axis++) {
+				XMStoreFloat3(&box.axes[axis], rotation.r[axis]);
+				box.halfExtents[axis] = (&l_halfExtents[body].x)[axis];
+			}
+			return box;
+		}
+
+		AABB GetAABB(int body) const
+		{
+			OBB box = GetOBB(body);
+			XMVECTOR extents = XMVectorZero();
+			for (int axis = 0; axis < 3; axis++) {
+				extents += XMVectorAbs(XMLoadFloat3(&box.axes[axis])) * box.halfExtents[axis];
+			}
+
+			XMFLOAT3 min;
+			XMFLOAT3 max;
+			XMStoreFloat3(&min, XMLoadFloat3(&box.center) - extents);
+			XMStoreFloat3(&max, XMLoadFloat3(&box.center) + extents);
+			return AABB(min, max);
+		}
+
+		void Collide()
+		{
+			for (int body = 1; body < m_bodies.Size(); body++) {
+				//Floor never moves, sleeping boxes haven't since they fell asleep
+				if (!m_bodies.IsSimulated(body)) {
+					continue;
+				}
+
+				XMFLOAT3 velocity = m_bodies.GetVelocity(body);
+				XMFLOAT3 displacement = XMFLOAT3(velocity.x * BENCH_DT, velocity.y * BENCH_DT, velocity.z * BENCH_DT);
+				m_tree.MoveProxy(l_proxies[body - 1], GetAABB(body), displacement);
+			}
+			m_tree.ComputePairs(l_pairs);
+
+			l_touching.clear();
+			l_touchingBodies.clear();
+			for (auto& pair : l_pairs) {
+				int bodyA = std::min(l_proxyToBody[pair.proxyA], l_proxyToBody[pair.proxyB]);
+				int bodyB = std::max(l_proxyToBody[pair.proxyA], l_proxyToBody[pair.proxyB]);
+				if (m_bodies.IsStatic(bodyA) && m_bodies.IsStatic(bodyB)) {
+					continue;
+				}
+
+				unsigned long long key = (static_cast<unsigned long long>(bodyA) << 32) | static_cast<unsigned int>(bodyB);
+				if (std::binary_search(l_jointedPairs.begin(), l_jointedPairs.end(), key)) {
+					continue;
+				}
+
+				//Neither side has moved, keep last step's manifold as it is
+				if (!m_bodies.IsSimulated(bodyA) && !m_bodies.IsSimulated(bodyB)) {
+					auto found = m_manifolds.find(key);
+					if (found != m_manifolds.end() && found->second.lastStep == m_step - 1) {
+						found->second.lastStep = m_step;
+						l_touching.push_back(&found->second.manifold);
+						l_touchingBodies.push_back(bodyA);
+						l_touchingBodies.push_back(bodyB);
+					}
+					continue;
+				}
+
+				ContactManifold manifold;
+				if (!ContactManifold::CollideBoxes(GetOBB(bodyA), GetOBB(bodyB), manifold, BENCH_CONTACT_MARGIN)) {
+					continue;
+				}
+
+				auto inserted = m_manifolds.insert(std::make_pair(key, ManifoldEntry()));
+				ManifoldEntry& entry = inserted.first->second;
+				if (!inserted.second && entry.lastStep == m_step - 1) {
+					manifold.WarmStart(entry.manifold);
+				}
+				entry.manifold = manifold;
+				entry.lastStep = m_step;
+
+				l_touching.push_back(&entry.manifold);
+				l_touchingBodies.push_back(bodyA);
+				l_touchingBodies.push_back(bodyB);
+			}
+
+			for (auto it = m_manifolds.begin(); it != m_manifolds.end();) {
+				if (it->second.lastStep != m_step) {
+					it = m_manifolds.erase(it);
+				}
+				else {
+					++it;
+				}
+			}
+		}
+
+		//One full step, adding each part's time to the totals. Islands only run with sleeping or the parallel solve on
+		void Step(double& collideMs, double& solveMs, double& integrateMs, double& islandMs)
+		{
+			BenchClock::time_point start = BenchClock::now();
+			m_bodies.UpdateWorldInertia();
+			Collide();
+			collideMs += MillisecondsSince(start);
+
+			if (m_sleeping || m_parallel) {
+				start = BenchClock::now();
+				m_islands.Begin(m_bodies.Size());
+				for (int i = 0; i < static_cast<int>(l_touching.size()); i++) {
+					m_islands.AddContact(l_touchingBodies[i * 2], l_touchingBodies[i * 2 + 1], m_bodies);
+				}
+				for (int i = 0; i < static_cast<int>(l_joints.size()); i++) {
+					m_islands.AddContact(l_jointBodies[i * 2], l_jointBodies[i * 2 + 1], m_bodies);
+				}
+				if (m_sleeping) {
+					m_islands.UpdateSleep(m_bodies, BENCH_DT);
+				}
+				islandMs += MillisecondsSince(start);
+			}
+
+			start = BenchClock::now();
+			m_bodies.IntegrateVelocities(BENCH_DT, BENCH_GRAVITY, 0.0f, 0.05f);
+			integrateMs += MillisecondsSince(start);
+
+			start = BenchClock::now();
+			m_solver.Clear();
+			for (int i = 0; i < static_cast<int>(l_touching.size()); i++) {
+				m_solver.AddManifold(l_touching[i], l_touchingBodies[i * 2], l_touchingBodies[i * 2 + 1], m_bodies, BENCH_DT);
+			}
+			m_jointSolver.Clear();
+			for (int i = 0; i < static_cast<int>(l_joints.size()); i++) {
+				m_jointSolver.AddJoint(&l_joints[i], l_jointBodies[i * 2], l_jointBodies[i * 2 + 1], m_bodies, BENCH_DT);
+			}
+			if (m_parallel) {
+				m_jointSolver.SortIntoIslands(m_bodies, m_islands);
+				m_solver.Solve(m_bodies, m_islands, &m_jointSolver);
+			}
+			else {
+				m_jointSolver.Solve(m_bodies, m_solver.GetIterations());
+				m_solver.Solve(m_bodies);
+			}
+			solveMs += MillisecondsSince(start);
+
+			start = BenchClock::now();
+			SweepFastBodies();
+			m_sweepMs += MillisecondsSince(start);
+
+			start = BenchClock::now();
+			m_bodies.IntegratePositions(BENCH_DT);
+			m_continuousCollision.ApplyImpacts(m_bodies);
+			m_bodies.ClearForces();
+			integrateMs += MillisecondsSince(start);
+
+			m_step++;
+		}
+
+		//Same as PhysicsWorld::SweepFastBodies but against the tree
+		void SweepFastBodies()
+		{
+			m_continuousCollision.Begin();
+
+			for (int body = 1; body < m_bodies.Size(); body++) {
+				XMFLOAT3 displacement;
+				if (!m_continuousCollision.NeedsSweep(m_bodies, body, BENCH_DT, displacement)) {
+					continue;
+				}
+
+				AABB start = GetAABB(body);
+				AABB end = AABB(
+					XMFLOAT3(start.min.x + displacement.x, start.min.y + displacement.y, start.min.z + displacement.z),
+					XMFLOAT3(start.max.x + displacement.x, start.max.y + displacement.y, start.max.z + displacement.z));
+				m_tree.QueryAABB(AABB::Union(start, end), l_sweepProxies);
+
+				OBB box = GetOBB(body);
+				float earliestTime = 1.0f;
+				for (int proxy : l_sweepProxies) {
+					int other = l_proxyToBody[proxy];
+					if (other != body) {
+						ContinuousCollision::SweepAgainst(box, displacement, GetOBB(other), ContinuousCollision::GetDisplacement(m_bodies, other, BENCH_DT), earliestTime);
+					}
+				}
+
+				m_continuousCollision.AddImpact(m_bodies, body, displacement, earliestTime);
+			}
+		}
+
+		//Furthest any box has moved from where it started, stays small if the stacks are standing
+		float MaxDrift() const
+		{
+			float maxDrift = 0.0f;
+			for (int body = 2; body < m_bodies.Size(); body++) {
+				XMFLOAT3 position = m_bodies.GetPosition(body);
+				XMVECTOR offset = XMLoadFloat3(&position) - XMLoadFloat3(&l_startPositions[body]);
+				maxDrift = std::max(maxDrift, XMVectorGetX(XMVector3Length(offset)));
+			}
+			return maxDrift;
+		}
+	};
+
+	std::string RunStacking(int boxCount, int steps, bool warmStarting)
+	{
+		StackingScene scene(boxCount, warmStarting);
+
+		double collideMs = 0.0;
+		double solveMs = 0.0;
+		double integrateMs = 0.0;
+		double islandMs = 0.0;
+		long long constraints = 0;
+		for (int step = 0; step < steps; step++) {
+			scene.Step(collideMs, solveMs, integrateMs, islandMs);
+			constraints += scene.m_solver.NumConstraints();
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %-15s %6d boxes: %7.3f ms/step solver (%7.1f contact points), collision %7.3f ms, integration %6.3f ms, max drift %.3f\n",
+			warmStarting ? "Warm started" : "Cold",
+			boxCount,
+			solveMs / steps,
+			static_cast<double>(constraints) / steps,
+			collideMs / steps,
+			integrateMs / steps,
+			scene.MaxDrift());
+		return line;
+	}
+
+	//Drops boxes with different restitution onto the floor side by side and measures how high each
+	//comes back up after the first bounce. Without losses that's restitution squared times the drop
+	std::string RunBounce()
+	{
+		const float restitutions[] = { 0.0f, 0.5f, 0.75f, 0.9f };
+		const int NUM_BOXES = sizeof(restitutions) / sizeof(restitutions[0]);
+		const float DROP_HEIGHT = 2.0f;
+		const int STEPS = 180;
+
+		//Just the floor, the boxes go in its four corners
+		StackingScene scene(0, true);
+		int boxes[NUM_BOXES];
+		for (int i = 0; i < NUM_BOXES; i++) {
+			XMFLOAT3 position = XMFLOAT3((i % 2 - 0.5f) * 1.5f, 0.5f + DROP_HEIGHT, (i / 2 - 0.5f) * 1.5f);
+			boxes[i] = scene.AddBox(position, XMFLOAT3(0.5f, 0.5f, 0.5f), 1.0f);
+			scene.m_bodies.SetRestitution(boxes[i], restitutions[i]);
+		}
+
+		//Highest each box got once it had started moving up again
+		float peaks[NUM_BOXES] = {};
+		bool bounced[NUM_BOXES] = {};
+		double collideMs = 0.0;
+		double solveMs = 0.0;
+		double integrateMs = 0.0;
+		double islandMs = 0.0;
+		for (int step = 0; step < STEPS; step++) {
+			scene.Step(collideMs, solveMs, integrateMs, islandMs);
+			for (int i = 0; i < NUM_BOXES; i++) {
+				float height = scene.m_bodies.GetPosition(boxes[i]).y - 0.5f;
+				bounced[i] = bounced[i] || scene.m_bodies.GetVelocity(boxes[i]).y > 0.0f;
+				//Only up to the second landing, so a box that never bounced doesn't count where it started
+				if (bounced[i] && scene.m_bodies.GetVelocity(boxes[i]).y >= 0.0f) {
+					peaks[i] = std::max(peaks[i], height);
+				}
+				else if (bounced[i] && peaks[i] > 0.0f && height < peaks[i] * 0.5f) {
+					bounced[i] = false;
+				}
+			}
+		}
+
+		std::string report;
+		for (int i = 0; i < NUM_BOXES; i++) {
+			char line[256];
+			snprintf(line, sizeof(line), "  Restitution %.2f: came back up %.3f of the %.1f drop (expected %.3f), %.3f up after %d steps\n",
+				restitutions[i],
+				peaks[i] / DROP_HEIGHT,
+				DROP_HEIGHT,
+				restitutions[i] * restitutions[i],
+				scene.m_bodies.GetPosition(boxes[i]).y - 0.5f,
+				STEPS);
+			report += line;
+		}
+		return report;
+	}
+
+	//Lets the stacks settle until every box is asleep, then times steps of the settled pile.
+	//The awake figure is the first second of steps, before anything could have slept
+	std::string RunSleeping(int boxCount)
+	{
+		const int AWAKE_STEPS = 60;
+		const int MAX_SETTLE_STEPS = 300;
+		const int SETTLED_STEPS = 120;
+
+		StackingScene scene(boxCount, true, true);
+
+		double collideMs = 0.0;
+		double solveMs = 0.0;
+		double integrateMs = 0.0;
+		double islandMs = 0.0;
+		for (int step = 0; step < AWAKE_STEPS; step++) {
+			scene.Step(collideMs, solveMs, integrateMs, islandMs);
+		}
+		double awakeMs = (collideMs + solveMs + integrateMs + islandMs) / AWAKE_STEPS;
+
+		int settleSteps = AWAKE_STEPS;
+		while (scene.m_islands.NumSleepingBodies() < boxCount && settleSteps < MAX_SETTLE_STEPS) {
+			scene.Step(collideMs, solveMs, integrateMs, islandMs);
+			settleSteps++;
+		}
+		int sleeping = scene.m_islands.NumSleepingBodies();
+
+		collideMs = 0.0;
+		solveMs = 0.0;
+		integrateMs = 0.0;
+		islandMs = 0.0;
+		for (int step = 0; step < SETTLED_STEPS; step++) {
+			scene.Step(collideMs, solveMs, integrateMs, islandMs);
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %6d boxes: awake %8.3f ms/step, %5d/%d asleep after %4d steps, settled %7.3f ms/step (collision %.3f, islands %.3f, solver %.3f), max drift %.3f\n",
+			boxCount,
+			awakeMs,
+			sleeping,
+			boxCount,
+			settleSteps,
+			(collideMs + solveMs + integrateMs + islandMs) / SETTLED_STEPS,
+			collideMs / SETTLED_STEPS,
+			islandMs / SETTLED_STEPS,
+			solveMs / SETTLED_STEPS,
+			scene.MaxDrift());
+		return line;
+	}
+
+	//Regression scene for continuous collision. A grid of small cubes with no gravity is fired
+	//straight at a thin static wall, then the scene runs for a second. Counts how many ended up
+	//on the far side, and how many were actually stopped by it rather than left hovering against
+	//it still trying to move forward
+	std::string RunTunneling(float speed, bool continuous)
+	{
+		const int GRID_SIZE = 10;
+		const int STEPS = 60;
+		const float BULLET_HALF_SIZE = 0.05f;
+		const float WALL_HALF_THICKNESS = 0.025f;
+		const float WALL_X = 2.0f;
+		const float LANE_SPACING = 0.5f;
+
+		//Just the floor, the bullets and the wall are added on top
+		StackingScene scene(0, true);
+		float wallHalfSize = GRID_SIZE * LANE_SPACING * 0.5f + 1.0f;
+		scene.AddBox(XMFLOAT3(WALL_X, wallHalfSize, 0.0f), XMFLOAT3(WALL_HALF_THICKNESS, wallHalfSize, wallHalfSize), 0.0f);
+
+		std::vector<int> bullets;
+		for (int y = 0; y < GRID_SIZE; y++) {
+			for (int z = 0; z < GRID_SIZE; z++) {
+				XMFLOAT3 position = XMFLOAT3(-3.0f, 1.0f + y * LANE_SPACING, (z - GRID_SIZE * 0.5f) * LANE_SPACING);
+				int body = scene.AddBox(position, XMFLOAT3(BULLET_HALF_SIZE, BULLET_HALF_SIZE, BULLET_HALF_SIZE), 0.1f);
+				scene.m_bodies.SetVelocity(body, XMFLOAT3(speed, 0.0f, 0.0f));
+				//Straight shots, otherwise the slow ones drop under the wall
+				scene.m_bodies.SetGravityScale(body, 0.0f);
+				//Anything faster than its own size per step
+				scene.m_bodies.SetCCDSpeed(body, continuous ? 2.0f * BULLET_HALF_SIZE / BENCH_DT : 0.0f);
+				bullets.push_back(body);
+			}
+		}
+
+		double collideMs = 0.0;
+		double solveMs = 0.0;
+		double integrateMs = 0.0;
+		double islandMs = 0.0;
+		int maxClamped = 0;
+		for (int step = 0; step < STEPS; step++) {
+			scene.Step(collideMs, solveMs, integrateMs, islandMs);
+			maxClamped = std::max(maxClamped, scene.m_continuousCollision.NumClampedBodies());
+		}
+
+		int passedThrough = 0;
+		//On the near side and down to a tenth of the launch speed, so resting against the wall or bouncing off it
+		int stopped = 0;
+		float maxSpeedLeft = 0.0f;
+		for (int body : bullets) {
+			if (scene.m_bodies.GetPosition(body).x > WALL_X) {
+				passedThrough++;
+				continue;
+			}
+
+			XMFLOAT3 velocity = scene.m_bodies.GetVelocity(body);
+			float speedLeft = XMVectorGetX(XMVector3Length(XMLoadFloat3(&velocity)));
+			maxSpeedLeft = std::max(maxSpeedLeft, speedLeft);
+			if (velocity.x <= 0.0f || speedLeft < 0.1f * speed) {
+				stopped++;
+			}
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %6.0f m/s, CCD %-3s: %3d/%d cubes through the wall, %3d stopped by it (fastest left %.2f m/s), sweeps %.3f ms/step (%d clamped in one step), collision %.3f ms/step\n",
+			speed,
+			continuous ? "on" : "off",
+			passedThrough,
+			static_cast<int>(bullets.size()),
+			stopped,
+			maxSpeedLeft,
+			scene.m_sweepMs / STEPS,
+			maxClamped,
+			collideMs / STEPS);
+		return line;
+	}
+
+	//Parallel solve of the same scene at 1 to 16 threads. Since the jobs never share a body every
+	//thread count should end up with exactly the same positions as the single threaded run
+	std::string RunThreadScaling(int boxCount, int steps, float spacing, const char* label)
+	{
+		const int threadCounts[] = { 1, 2, 4, 8, 16 };
+
+		std::string report;
+		std::vector<XMFLOAT3> singleThreaded;
+		double singleThreadedMs = 0.0;
+		for (int threads : threadCounts) {
+			JobSystem::GetInstance()->SetThreadCount(threads);
+			StackingScene scene(boxCount, true, false, true, spacing);
+
+			double collideMs = 0.0;
+			double solveMs = 0.0;
+			double integrateMs = 0.0;
+			double islandMs = 0.0;
+			for (int step = 0; step < steps; step++) {
+				scene.Step(collideMs, solveMs, integrateMs, islandMs);
+			}
+			solveMs /= steps;
+
+			//Furthest any body ended up from where it did on one thread
+			float maxDifference = 0.0f;
+			if (threads == 1) {
+				singleThreadedMs = solveMs;
+				singleThreaded.resize(scene.m_bodies.Size());
+			}
+			for (int body = 0; body < scene.m_bodies.Size(); body++) {
+				XMFLOAT3 position = scene.m_bodies.GetPosition(body);
+				if (threads == 1) {
+					singleThreaded[body] = position;
+				}
+				XMVECTOR offset = XMLoadFloat3(&position) - XMLoadFloat3(&singleThreaded[body]);
+				maxDifference = std::max(maxDifference, XMVectorGetX(XMVector3Length(offset)));
+			}
+
+			char line[256];
+			snprintf(line, sizeof(line), "  %-15s %6d boxes, %2d threads: %7.3f ms/step solver (x%.2f), %4d island jobs, %d split into %2d colours, differs from 1 thread by %g\n",
+				label,
+				boxCount,
+				threads,
+				solveMs,
+				singleThreadedMs / solveMs,
+				scene.m_solver.NumIslandJobs(),
+				scene.m_solver.NumSplitIslands(),
+				scene.m_solver.NumColors(),
+				maxDifference);
+			report += line;
+		}
+		return report;
+	}
+
+	//Largest distance any joint's anchors have come apart, and how far past its limits any of them is
+	void MeasureJoints(const StackingScene& scene, float& outAnchorError, float& outLimitError)
+	{
+		outAnchorError = 0.0f;
+		outLimitError = 0.0f;
+		for (int i = 0; i < static_cast<int>(scene.l_joints.size()); i++) {
+			const Joint& joint = scene.l_joints[i];
+			int bodyA = scene.l_jointBodies[i * 2];
+			int bodyB = scene.l_jointBodies[i * 2 + 1];
+			outAnchorError = std::max(outAnchorError, joint.GetAnchorError(scene.m_bodies, bodyA, bodyB));
+			if (joint.IsLimitEnabled()) {
+				float value = joint.GetValue(scene.m_bodies, bodyA, bodyB);
+				outLimitError = std::max(outLimitError, std::max(joint.GetLowerLimit() - value, value - joint.GetUpperLimit()));
+			}
+		}
+	}
+
+	//Angle b has turned away from a since the joint was made, for joints that should hold rotation
+	float RotationDrift(const StackingScene& scene, const Joint& joint, int bodyA, int bodyB)
+	{
+		XMFLOAT4 orientationA = scene.m_bodies.GetOrientation(bodyA);
+		XMFLOAT4 orientationB = scene.m_bodies.GetOrientation(bodyB);
+		XMVECTOR relative = XMQuaternionMultiply(XMLoadFloat4(&orientationB), XMQuaternionInverse(XMLoadFloat4(&orientationA)));
+		XMVECTOR delta = XMQuaternionMultiply(XMQuaternionInverse(XMLoadFloat4(&joint.GetReferenceRotation())), relative);
+		return 2.0f * acosf(std::min(fabsf(XMVectorGetW(delta)), 1.0f));
+	}
+
+	//Chains of ball and socket links hanging from the world, started out sideways so they swing down.
+	//Every chain is its own island, so they're spread over the job system like separate stacks
+	std::string RunJointChains(int numChains, int steps)
+	{
+		const int LINKS = 10;
+		const float LINK_LENGTH = 0.4f;
+
+		StackingScene scene(0, true, false, true);
+		int chainsPerRow = static_cast<int>(ceilf(sqrtf(static_cast<float>(numChains))));
+		for (int chain = 0; chain < numChains; chain++) {
+			float x = (chain % chainsPerRow) * (LINKS * LINK_LENGTH + 1.0f);
+			float z = (chain / chainsPerRow) * 1.0f;
+
+			int previous = RigidBodyArrays::STATIC_BODY;
+			for (int link = 0; link < LINKS; link++) {
+				float start = x + link * LINK_LENGTH;
+				int body = scene.AddBox(XMFLOAT3(start + LINK_LENGTH * 0.5f, 10.0f, z), XMFLOAT3(LINK_LENGTH * 0.375f, 0.05f, 0.05f), 1.0f);
+				scene.AddJoint(JOINT_BALL_SOCKET, previous, body, XMFLOAT3(start, 10.0f, z));
+				previous = body;
+			}
+		}
+
+		double collideMs = 0.0;
+		double solveMs = 0.0;
+		double integrateMs = 0.0;
+		double islandMs = 0.0;
+		float maxAnchorError = 0.0f;
+		float anchorError;
+		float limitError;
+		for (int step = 0; step < steps; step++) {
+			scene.Step(collideMs, solveMs, integrateMs, islandMs);
+			MeasureJoints(scene, anchorError, limitError);
+			maxAnchorError = std::max(maxAnchorError, anchorError);
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %5d ball socket chains, %5d joints: %7.3f ms/step solver, %4d island jobs, worst anchor gap %.4f, %.4f at the end\n",
+			numChains,
+			static_cast<int>(scene.l_joints.size()),
+			solveMs / steps,
+			scene.m_solver.NumIslandJobs(),
+			maxAnchorError,
+			anchorError);
+		return line;
+	}
+
+	//Rough ragdolls of 11 boxes and 10 joints (hinged knees, elbows and waist with limits, ball
+	//joints everywhere else) dropped in a grid onto the floor, so joints and contacts share islands
+	std::string RunRagdolls(int numRagdolls, int steps)
+	{
+		StackingScene scene(0, true, false, true);
+		int perRow = static_cast<int>(ceilf(sqrtf(static_cast<float>(numRagdolls))));
+		//The scene's own floor is sized for stacks
+		scene.AddBox(XMFLOAT3(0.0f, -0.5f, 0.0f), XMFLOAT3(perRow + 2.0f, 0.5f, perRow + 2.0f), 0.0f);
+		const XMFLOAT3 sideways = XMFLOAT3(1.0f, 0.0f, 0.0f);
+		const XMFLOAT3 up = XMFLOAT3(0.0f, 1.0f, 0.0f);
+
+		for (int ragdoll = 0; ragdoll < numRagdolls; ragdoll++) {
+			float x = (ragdoll % perRow - perRow * 0.5f) * 2.0f;
+			float y = 1.5f + (ragdoll % 3) * 0.5f;
+			float z = (ragdoll / perRow - perRow * 0.5f) * 2.0f;
+			auto at = [&](float px, float py) { return XMFLOAT3(x + px, y + py, z); };
+
+			int pelvis = scene.AddBox(at(0.0f, 0.0f), XMFLOAT3(0.2f, 0.1f, 0.1f), 2.0f);
+			int torso = scene.AddBox(at(0.0f, 0.35f), XMFLOAT3(0.2f, 0.2f, 0.1f), 3.0f);
+			int head = scene.AddBox(at(0.0f, 0.75f), XMFLOAT3(0.1f, 0.1f, 0.1f), 1.0f);
+			scene.AddJoint(JOINT_HINGE, pelvis, torso, at(0.0f, 0.125f), sideways).SetLimits(-0.5f, 1.0f);
+			scene.l_joints.back().SetLimitEnabled(true);
+			scene.AddJoint(JOINT_BALL_SOCKET, torso, head, at(0.0f, 0.6f));
+
+			for (int side = -1; side <= 1; side += 2) {
+				float s = static_cast<float>(side);
+				int upperArm = scene.AddBox(at(s * 0.35f, 0.45f), XMFLOAT3(0.12f, 0.05f, 0.05f), 0.5f);
+				int lowerArm = scene.AddBox(at(s * 0.63f, 0.45f), XMFLOAT3(0.12f, 0.05f, 0.05f), 0.5f);
+				int thigh = scene.AddBox(at(s * 0.1f, -0.3f), XMFLOAT3(0.06f, 0.15f, 0.06f), 1.0f);
+				int shin = scene.AddBox(at(s * 0.1f, -0.65f), XMFLOAT3(0.05f, 0.15f, 0.05f), 0.8f);
+
+				scene.AddJoint(JOINT_BALL_SOCKET, torso, upperArm, at(s * 0.215f, 0.45f));
+				scene.AddJoint(JOINT_HINGE, upperArm, lowerArm, at(s * 0.49f, 0.45f), up).SetLimits(side > 0 ? 0.0f : -2.5f, side > 0 ? 2.5f : 0.0f);
+				scene.l_joints.back().SetLimitEnabled(true);
+				scene.AddJoint(JOINT_BALL_SOCKET, pelvis, thigh, at(s * 0.1f, -0.125f));
+				scene.AddJoint(JOINT_HINGE, thigh, shin, at(s * 0.1f, -0.475f), sideways).SetLimits(0.0f, 2.5f);
+				scene.l_joints.back().SetLimitEnabled(true);
+			}
+		}
+
+		double collideMs = 0.0;
+		double solveMs = 0.0;
+		double integrateMs = 0.0;
+		double islandMs = 0.0;
+		float maxAnchorError = 0.0f;
+		float maxLimitError = 0.0f;
+		float anchorError;
+		float limitError;
+		long long constraints = 0;
+		for (int step = 0; step < steps; step++) {
+			scene.Step(collideMs, solveMs, integrateMs, islandMs);
+			constraints += scene.m_solver.NumConstraints();
+
+			MeasureJoints(scene, anchorError, limitError);
+			maxAnchorError = std::max(maxAnchorError, anchorError);
+			maxLimitError = std::max(maxLimitError, limitError);
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %5d ragdolls, %5d joints: %7.3f ms/step solver (%7.1f contact points), collision %.3f ms, worst anchor gap %.4f (%.4f at the end), worst limit overshoot %.4f rad (%.4f)\n",
+			numRagdolls,
+			static_cast<int>(scene.l_joints.size()),
+			solveMs / steps,
+			static_cast<double>(constraints) / steps,
+			collideMs / steps,
+			maxAnchorError,
+			anchorError,
+			maxLimitError,
+			std::max(limitError, 0.0f));
+		return line;
+	}
+
+	//One of each joint under gravity for two seconds, checking each holds what it's meant to
+	std::string RunJointTypes()
+	{
+		const int STEPS = 120;
+		const XMFLOAT3 half = XMFLOAT3(0.25f, 0.1f, 0.1f);
+		const XMFLOAT3 forward = XMFLOAT3(0.0f, 0.0f, 1.0f);
+
+		StackingScene scene(0, true, false, true);
+		int world = RigidBodyArrays::STATIC_BODY;
+		//Joints are held onto by reference below, so they can't move
+		scene.l_joints.reserve(6);
+
+		//Pendulum that would swing straight down, stopped half a radian below level
+		int pendulum = scene.AddBox(XMFLOAT3(0.5f, 5.0f, 0.0f), half, 1.0f);
+		Joint& hinge = scene.AddJoint(JOINT_HINGE, world, pendulum, XMFLOAT3(0.0f, 5.0f, 0.0f), forward);
+		hinge.SetLimits(-0.5f, 0.5f);
+		hinge.SetLimitEnabled(true);
+
+		//Wheel spun up by its motor about its own centre
+		int wheel = scene.AddBox(XMFLOAT3(3.0f, 5.0f, 0.0f), XMFLOAT3(0.3f, 0.3f, 0.1f), 1.0f);
+		scene.AddJoint(JOINT_HINGE, world, wheel, XMFLOAT3(3.0f, 5.0f, 0.0f), forward).SetMotor(2.0f, 50.0f);
+
+		//Block sliding down a 45 degree rail until it hits the end stop
+		int slider = scene.AddBox(XMFLOAT3(6.0f, 5.0f, 0.0f), half, 1.0f);
+		Joint& rail = scene.AddJoint(JOINT_SLIDER, world, slider, XMFLOAT3(6.0f, 5.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 0.0f));
+		rail.SetLimits(-1.0f, 0.5f);
+		rail.SetLimitEnabled(true);
+
+		//Rope, only stops the box getting further away than it started
+		int weight = scene.AddBox(XMFLOAT3(10.0f, 5.0f, 0.0f), half, 1.0f);
+		scene.l_joints.push_back(Joint(JOINT_DISTANCE, nullptr, nullptr));
+		Joint& rope = scene.l_joints.back();
+		rope.SetFrame(scene.m_bodies, world, weight, XMFLOAT3(9.0f, 5.0f, 0.0f), XMFLOAT3(10.0f, 5.0f, 0.0f), forward);
+		rope.SetLimits(0.0f, 1.0f);
+		rope.SetLimitEnabled(true);
+		scene.l_jointBodies.push_back(world);
+		scene.l_jointBodies.push_back(weight);
+
+		//L shape welded out of two boxes, swinging from a ball joint at one end
+		int arm = scene.AddBox(XMFLOAT3(12.5f, 5.0f, 0.0f), half, 1.0f);
+		int foot = scene.AddBox(XMFLOAT3(12.85f, 5.25f, 0.0f), XMFLOAT3(0.1f, 0.25f, 0.1f), 1.0f);
+		scene.AddJoint(JOINT_BALL_SOCKET, world, arm, XMFLOAT3(12.25f, 5.0f, 0.0f));
+		scene.AddJoint(JOINT_FIXED, arm, foot, XMFLOAT3(12.75f, 5.0f, 0.0f));
+
+		double collideMs = 0.0;
+		double solveMs = 0.0;
+		double integrateMs = 0.0;
+		double islandMs = 0.0;
+		float hingeOvershoot = 0.0f;
+		float railGap = 0.0f;
+		float railOvershoot = 0.0f;
+		float ropeStretch = 0.0f;
+		float weldGap = 0.0f;
+		float weldTwist = 0.0f;
+		for (int step = 0; step < STEPS; step++) {
+			scene.Step(collideMs, solveMs, integrateMs, islandMs);
+
+			float angle = hinge.GetValue(scene.m_bodies, world, pendulum);
+			hingeOvershoot = std::max(hingeOvershoot, std::max(-0.5f - angle, angle - 0.5f));
+			float travel = rail.GetValue(scene.m_bodies, world, slider);
+			railOvershoot = std::max(railOvershoot, std::max(-1.0f - travel, travel - 0.5f));
+			railGap = std::max(railGap, rail.GetAnchorError(scene.m_bodies, world, slider));
+			ropeStretch = std::max(ropeStretch, rope.GetValue(scene.m_bodies, world, weight) - 1.0f);
+			const Joint& weld = scene.l_joints.back();
+			weldGap = std::max(weldGap, weld.GetAnchorError(scene.m_bodies, arm, foot));
+			weldTwist = std::max(weldTwist, RotationDrift(scene, weld, arm, foot));
+		}
+
+		std::string report;
+		char line[256];
+		snprintf(line, sizeof(line), "  Hinge with limits: %.3f rad at the end (stop at -0.5), worst overshoot %.4f rad\n",
+			hinge.GetValue(scene.m_bodies, world, pendulum), hingeOvershoot);
+		report += line;
+		snprintf(line, sizeof(line), "  Hinge motor: %.3f rad/s (driving at 2)\n",
+			scene.m_bodies.GetAngularVelocity(wheel).z);
+		report += line;
+		snprintf(line, sizeof(line), "  Slider: %.3f travel at the end (stop at -1), worst overshoot %.4f, worst gap off the rail %.4f\n",
+			rail.GetValue(scene.m_bodies, world, slider), railOvershoot, railGap);
+		report += line;
+		snprintf(line, sizeof(line), "  Distance (rope of 1): worst stretch %.4f\n", ropeStretch);
+		report += line;
+		snprintf(line, sizeof(line), "  Fixed: worst anchor gap %.4f, worst twist %.4f rad\n", weldGap, weldTwist);
+		report += line;
+		snprintf(line, sizeof(line), "  %d joints, %.3f ms/step solver\n", static_cast<int>(scene.l_joints.size()), solveMs / STEPS);
+		report += line;
+		return report;
+	}
+	//Box half extents for the scene query runs
+	const float QUERY_MIN_HALF_SIZE = 0.2f;
+	const float QUERY_MAX_HALF_SIZE = 1.0f;
+	//Layers the query scene's boxes are spread over
+	const int QUERY_LAYERS = 4;
+	//Rays checked against every box one by one, the rest are only checked against the scalar path
+	const int QUERY_BRUTE_FORCE_RAYS = 500;
+	//How far apart two answers for the same ray can be and still agree
+	const float QUERY_TOLERANCE = 0.0001f;
+
+	AABB GetOBBBounds(const OBB& box)
+	{
+		XMFLOAT3 extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		for (int i = 0; i < 3; i++) {
+			extents.x += box.halfExtents[i] * fabsf(box.axes[i].x);
+			extents.y += box.halfExtents[i] * fabsf(box.axes[i].y);
+			extents.z += box.halfExtents[i] * fabsf(box.axes[i].z);
+		}
+		return AABB(
+			XMFLOAT3(box.center.x - extents.x, box.center.y - extents.y, box.center.z - extents.z),
+			XMFLOAT3(box.center.x + extents.x, box.center.y + extents.y, box.center.z + extents.z));
+	}
+
+	//Randomly turned boxes of mixed sizes filling a cube, shape i is on layer i % QUERY_LAYERS
+	float BuildQueryScene(QueryBVH& tree, int count, unsigned int seed)
+	{
+		float worldHalfSize = 0.5f * cbrtf(count / BENCH_DENSITY);
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> posDist(-worldHalfSize, worldHalfSize);
+		std::uniform_real_distribution<float> angleDist(-XM_PI, XM_PI);
+		std::uniform_real_distribution<float> sizeDist(QUERY_MIN_HALF_SIZE, QUERY_MAX_HALF_SIZE);
+
+		tree.Resize(count);
+		for (int i = 0; i < count; i++) {
+			QueryShape& shape = tree.GetShape(i);
+			XMMATRIX rotation = XMMatrixRotationRollPitchYaw(angleDist(rng), angleDist(rng), angleDist(rng));
+			shape.box.center = XMFLOAT3(posDist(rng), posDist(rng), posDist(rng));
+			for (int axis = 0; axis < 3; axis++) {
+				XMStoreFloat3(&shape.box.axes[axis], rotation.r[axis]);
+				shape.box.halfExtents[axis] = sizeDist(rng);
+			}
+			shape.bounds = GetOBBBounds(shape.box);
+			shape.layerBit = 1u << (i % QUERY_LAYERS);
+			shape.trigger = false;
+			shape.collider = nullptr;
+		}
+		tree.Update();
+		return worldHalfSize;
+	}
+
+	//Rays from anywhere in the scene in any direction, long enough to cross it
+	void BuildRandomRays(std::vector<Ray>& outRays, int count, float worldHalfSize, unsigned int seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> posDist(-worldHalfSize, worldHalfSize);
+		std::normal_distribution<float> dirDist(0.0f, 1.0f);
+
+		outRays.resize(count);
+		for (int i = 0; i < count; i++) {
+			outRays[i] = Ray(XMFLOAT3(posDist(rng), posDist(rng), posDist(rng)), XMFLOAT3(dirDist(rng), dirDist(rng), dirDist(rng)), 2.0f * worldHalfSize);
+		}
+	}
+
+	//A grid of rays from one point outside the scene, like mouse picking across the screen
+	void BuildPickingRays(std::vector<Ray>& outRays, int width, int height, float worldHalfSize)
+	{
+		XMFLOAT3 eye = XMFLOAT3(0.0f, 0.0f, -2.0f * worldHalfSize);
+		outRays.resize(width * height);
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				XMFLOAT3 target = XMFLOAT3(
+					worldHalfSize * (2.0f * x / (width - 1) - 1.0f),
+					worldHalfSize * (2.0f * y / (height - 1) - 1.0f),
+					0.0f);
+				outRays[y * width + x] = Ray(eye, XMFLOAT3(target.x - eye.x, target.y - eye.y, target.z - eye.z), 4.0f * worldHalfSize);
+			}
+		}
+	}
+
+	//Reference answer for one ray: the slab test against every box on the mask's layers, -1 for a miss
+	float BruteForceRaycast(const QueryBVH& tree, const Ray& ray, unsigned int layerMask)
+	{
+		XMVECTOR direction = XMVector3Normalize(XMLoadFloat3(&ray.direction));
+		float closest = -1.0f;
+		for (int i = 0; i < tree.NumShapes(); i++) {
+			const QueryShape& shape = tree.GetShape(i);
+			if (!(shape.layerBit & layerMask)) {
+				continue;
+			}
+
+			XMVECTOR offset = XMLoadFloat3(&ray.origin) - XMLoadFloat3(&shape.box.center);
+			float enter = 0.0f;
+			float leave = ray.maxDistance;
+			for (int axis = 0; axis < 3 && enter <= leave; axis++) {
+				XMVECTOR boxAxis = XMLoadFloat3(&shape.box.axes[axis]);
+				float e = XMVectorGetX(XMVector3Dot(offset, boxAxis));
+				float f = XMVectorGetX(XMVector3Dot(direction, boxAxis));
+				float h = shape.box.halfExtents[axis];
+				if (fabsf(f) < 0.000001f) {
+					leave = fabsf(e) > h ? -1.0f : leave;
+					continue;
+				}
+				float t0 = (-h - e) / f;
+				float t1 = (h - e) / f;
+				enter = std::max(enter, std::min(t0, t1));
+				leave = std::min(leave, std::max(t0, t1));
+			}
+
+			if (enter <= leave && (closest < 0.0f || enter < closest)) {
+				closest = enter;
+			}
+		}
+		return closest;
+	}
+
+	bool SameHit(const QueryHit& a, const QueryHit& b)
+	{
+		return (a.shape < 0) == (b.shape < 0) && (a.shape < 0 || fabsf(a.distance - b.distance) <= QUERY_TOLERANCE);
+	}
+
+	//Times a set of rays in packets against one at a time, for the nearest hit and for any hit,
+	//and checks the packets agree with the single rays and the first few with brute force
+	std::string RunRaycasts(const QueryBVH& tree, const std::vector<Ray>& rays, const char* label, const QueryFilter& filter, int repeats)
+	{
+		int count = static_cast<int>(rays.size());
+		std::vector<QueryHit> expected(count);
+		std::vector<QueryHit> hits(count);
+
+		BenchClock::time_point start = BenchClock::now();
+		for (int i = 0; i < repeats; i++) {
+			tree.RaycastBatchScalar(rays.data(), count, expected.data(), RAYCAST_CLOSEST, filter);
+		}
+		double scalarMs = MillisecondsSince(start) / repeats;
+
+		start = BenchClock::now();
+		for (int i = 0; i < repeats; i++) {
+			tree.RaycastBatch(rays.data(), count, hits.data(), RAYCAST_CLOSEST, filter);
+		}
+		double packetMs = MillisecondsSince(start) / repeats;
+
+		int numHits = 0;
+		int mismatches = 0;
+		int wrongLayer = 0;
+		for (int i = 0; i < count; i++) {
+			numHits += hits[i].shape >= 0 ? 1 : 0;
+			mismatches += SameHit(hits[i], expected[i]) ? 0 : 1;
+			if (hits[i].shape >= 0 && !(tree.GetShape(hits[i].shape).layerBit & filter.layerMask)) {
+				wrongLayer++;
+			}
+		}
+
+		int bruteForceMismatches = 0;
+		for (int i = 0; i < std::min(count, QUERY_BRUTE_FORCE_RAYS); i++) {
+			float distance = BruteForceRaycast(tree, rays[i], filter.layerMask);
+			bool agrees = (distance < 0.0f) == (expected[i].shape < 0) && (distance < 0.0f || fabsf(distance - expected[i].distance) <= QUERY_TOLERANCE);
+			bruteForceMismatches += agrees ? 0 : 1;
+		}
+
+		start = BenchClock::now();
+		for (int i = 0; i < repeats; i++) {
+			tree.RaycastBatchScalar(rays.data(), count, expected.data(), RAYCAST_ANY, filter);
+		}
+		double scalarAnyMs = MillisecondsSince(start) / repeats;
+
+		start = BenchClock::now();
+		for (int i = 0; i < repeats; i++) {
+			tree.RaycastBatch(rays.data(), count, hits.data(), RAYCAST_ANY, filter);
+		}
+		double packetAnyMs = MillisecondsSince(start) / repeats;
+
+		//Any hit can stop on a different shape, only whether something was hit has to match
+		for (int i = 0; i < count; i++) {
+			mismatches += (hits[i].shape < 0) == (expected[i].shape < 0) ? 0 : 1;
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %-14s %6d rays, %6d hits: closest %7.3f ms one by one, %7.3f ms in packets (%.1fx), any %7.3f / %7.3f ms\n",
+			label, count, numHits, scalarMs, packetMs, scalarMs / std::max(packetMs, 0.001), scalarAnyMs, packetAnyMs);
+		std::string report = line;
+		snprintf(line, sizeof(line), "  %-14s %d mismatches between paths, %d of %d wrong against brute force, %d hits on filtered layers\n",
+			"", mismatches, bruteForceMismatches, std::min(count, QUERY_BRUTE_FORCE_RAYS), wrongLayer);
+		report += line;
+		return report;
+	}
+
+	//Sphere and box sweeps through the scene. Each hit is checked with overlap tests: grown a little at
+	//the distance it has to touch what was hit, and a little short of it it can't touch anything
+	std::string RunSweeps(const QueryBVH& tree, float worldHalfSize, int count)
+	{
+		const float radius = 0.3f;
+		const float checkOffset = 0.01f;
+
+		std::vector<Ray> paths;
+		BuildRandomRays(paths, count, worldHalfSize, 555);
+
+		std::mt19937 rng(556);
+		std::uniform_real_distribution<float> angleDist(-XM_PI, XM_PI);
+		std::vector<OBB> boxes(count);
+		for (int i = 0; i < count; i++) {
+			XMMATRIX rotation = XMMatrixRotationRollPitchYaw(angleDist(rng), angleDist(rng), angleDist(rng));
+			boxes[i].center = paths[i].origin;
+			for (int axis = 0; axis < 3; axis++) {
+				XMStoreFloat3(&boxes[i].axes[axis], rotation.r[axis]);
+				boxes[i].halfExtents[axis] = radius;
+			}
+		}
+
+		std::vector<QueryHit> sphereHits(count);
+		BenchClock::time_point start = BenchClock::now();
+		for (int i = 0; i < count; i++) {
+			tree.SweepSphere(paths[i].origin, radius, paths[i].direction, paths[i].maxDistance, sphereHits[i]);
+		}
+		double sphereMs = MillisecondsSince(start);
+
+		std::vector<QueryHit> boxHits(count);
+		start = BenchClock::now();
+		for (int i = 0; i < count; i++) {
+			tree.SweepBox(boxes[i], paths[i].direction, paths[i].maxDistance, boxHits[i]);
+		}
+		double boxMs = MillisecondsSince(start);
+
+		int numSphereHits = 0;
+		int numBoxHits = 0;
+		int sphereFailures = 0;
+		int boxFailures = 0;
+		std::vector<int> overlaps;
+		for (int i = 0; i < count; i++) {
+			XMVECTOR direction = XMVector3Normalize(XMLoadFloat3(&paths[i].direction));
+			XMVECTOR origin = XMLoadFloat3(&paths[i].origin);
+
+			const QueryHit& sphereHit = sphereHits[i];
+			if (sphereHit.shape >= 0) {
+				numSphereHits++;
+				XMFLOAT3 touching;
+				XMStoreFloat3(&touching, origin + direction * sphereHit.distance);
+				tree.OverlapSphere(touching, radius + checkOffset, overlaps);
+				bool failed = std::find(overlaps.begin(), overlaps.end(), sphereHit.shape) == overlaps.end();
+				if (sphereHit.distance > checkOffset) {
+					XMFLOAT3 before;
+					XMStoreFloat3(&before, origin + direction * (sphereHit.distance - checkOffset));
+					failed = failed || tree.OverlapSphere(before, radius, overlaps) > 0;
+				}
+				sphereFailures += failed ? 1 : 0;
+			}
+
+			const QueryHit& boxHit = boxHits[i];
+			if (boxHit.shape >= 0) {
+				numBoxHits++;
+				OBB moved = boxes[i];
+				XMStoreFloat3(&moved.center, origin + direction * boxHit.distance);
+				for (int axis = 0; axis < 3; axis++) {
+					moved.halfExtents[axis] += checkOffset;
+				}
+				tree.OverlapBox(moved, overlaps);
+				bool failed = std::find(overlaps.begin(), overlaps.end(), boxHit.shape) == overlaps.end();
+				if (boxHit.distance > checkOffset) {
+					moved = boxes[i];
+					XMStoreFloat3(&moved.center, origin + direction * (boxHit.distance - checkOffset));
+					failed = failed || tree.OverlapBox(moved, overlaps) > 0;
+				}
+				boxFailures += failed ? 1 : 0;
+			}
+		}
+
+		std::string report;
+		char line[256];
+		snprintf(line, sizeof(line), "  Sphere sweeps:  %d of %d hit, %.2f us each, %d failed the overlap check\n",
+			numSphereHits, count, sphereMs * 1000.0 / count, sphereFailures);
+		report += line;
+		snprintf(line, sizeof(line), "  Box sweeps:     %d of %d hit, %.2f us each, %d failed the overlap check\n",
+			numBoxHits, count, boxMs * 1000.0 / count, boxFailures);
+		report += line;
+		return report;
+	}
+
+	//Every box drifts a little each frame, the tree is refit and rebuilt whenever refitting has made it too loose
+	std::string RunQueryRefits(QueryBVH& tree, float worldHalfSize, int frames)
+	{
+		std::mt19937 rng(777);
+		std::uniform_real_distribution<float> velDist(-2.0f, 2.0f);
+		std::vector<XMFLOAT3> velocities(tree.NumShapes());
+		for (XMFLOAT3& velocity : velocities) {
+			velocity = XMFLOAT3(velDist(rng), velDist(rng), velDist(rng));
+		}
+
+		int buildsBefore = tree.NumBuilds();
+		double updateMs = 0.0;
+		for (int frame = 0; frame < frames; frame++) {
+			for (int i = 0; i < tree.NumShapes(); i++) {
+				QueryShape& shape = tree.GetShape(i);
+				float* center = &shape.box.center.x;
+				float* velocity = &velocities[i].x;
+				for (int axis = 0; axis < 3; axis++) {
+					center[axis] += velocity[axis] * BENCH_DT;
+					if (center[axis] > worldHalfSize || center[axis] < -worldHalfSize) {
+						velocity[axis] = -velocity[axis];
+					}
+				}
+				shape.bounds = GetOBBBounds(shape.box);
+			}
+
+			BenchClock::time_point start = BenchClock::now();
+			tree.Update();
+			updateMs += MillisecondsSince(start);
+		}
+
+		BenchClock::time_point start = BenchClock::now();
+		tree.Rebuild();
+		double rebuildMs = MillisecondsSince(start);
+
+		char line[256];
+		snprintf(line, sizeof(line), "  Moving boxes: %.3f ms/frame to update (%d rebuilds in %d frames), %.3f ms for a full rebuild, %d nodes\n",
+			updateMs / frames, tree.NumBuilds() - buildsBefore, frames, rebuildMs, tree.NumNodes());
+		return line;
+	}
+}
+
+std::string PhysicsBenchmarks::RunBroadphaseBenchmark()
+{
+	const int counts[] = { 1000, 10000, 50000 };
+	const int frames[] = { 120, 30, 10 };
+
+	std::string report = "Broadphase\n";
+
+	for (int run = 0; run < 3; run++) {
+		{
+			MovingBoxScene scene(counts[run], 1234);
+			DynamicAABBTree tree;
+			report += RunScene(tree, scene, frames[run]);
+		}
+		{
+			MovingBoxScene scene(counts[run], 1234);
+			SweepAndPrune sweepAndPrune;
+			report += RunScene(sweepAndPrune, scene, frames[run]);
+		}
+		{
+			MovingBoxScene scene(counts[run], 1234);
+			SpatialHashGrid spatialHash(BENCH_HALF_SIZE * 2.0f);
+			report += RunScene(spatialHash, scene, frames[run]);
+		}
+	}
+
+	//Mostly static scene, where sweep and prune should only pay for the few movers
+	{
+		MovingBoxScene scene(counts[1], 1234, 0.05f);
+		DynamicAABBTree tree;
+		report += RunScene(tree, scene, frames[1]);
+	}
+	{
+		MovingBoxScene scene(counts[1], 1234, 0.05f);
+		SweepAndPrune sweepAndPrune;
+		report += RunScene(sweepAndPrune, scene, frames[1]);
+	}
+
+	//Brute force reference at the smallest size, the larger ones take too long to be useful
+	{
+		MovingBoxScene scene(counts[0], 1234);
+		report += RunBruteForce(scene, frames[0]);
+	}
+
+	return report;
+}
+
+std::string PhysicsBenchmarks::RunSpatialHashBenchmark()
+{
+	//Swarms of small boxes, about the size of the debug spheres
+	const int counts[] = { 1000, 5000, 10000 };
+	const int frames[] = { 60, 20, 10 };
+	const float halfSize = 0.1f;
+
+	std::string report = "Spatial hash (swarm of small boxes)\n";
+
+	for (int run = 0; run < 3; run++) {
+		{
+			MovingBoxScene scene(counts[run], 4321, 1.0f, halfSize);
+			SpatialHashGrid spatialHash(halfSize * 2.0f);
+			report += RunScene(spatialHash, scene, frames[run]);
+		}
+		{
+			MovingBoxScene scene(counts[run], 4321, 1.0f, halfSize);
+			report += RunBruteForce(scene, frames[run]);
+		}
+	}
+
+	//Cell size relative to the box size at the largest count
+	const float cellScales[] = { 0.5f, 1.0f, 2.0f, 4.0f };
+	char line[128];
+	for (int i = 0; i < 4; i++) {
+		MovingBoxScene scene(counts[2], 4321, 1.0f, halfSize);
+		SpatialHashGrid spatialHash(halfSize * 2.0f * cellScales[i]);
+
+		snprintf(line, sizeof(line), "  cell size %.1fx box:\n", cellScales[i]);
+		report += line;
+		report += RunScene(spatialHash, scene, frames[2]);
+	}
+
+	return report;
+}
+
+std::string PhysicsBenchmarks::RunSATBenchmark()
+{
+	const int counts[] = { 1000, 10000, 100000 };
+	const int repeats[] = { 200, 20, 4 };
+
+	std::string report = "Batched SAT\n";
+
+	OBBPairBatch batch;
+	std::vector<unsigned int> expectedHits;
+	std::vector<unsigned char> expectedAxes;
+	for (int run = 0; run < 3; run++) {
+		BuildRandomOBBPairs(batch, counts[run], 99);
+		batch.TestScalar(expectedHits, expectedAxes);
+
+		report += RunSATPath(batch, 0, repeats[run], expectedHits, expectedAxes);
+		report += RunSATPath(batch, 4, repeats[run], expectedHits, expectedAxes);
+		if (OBBPairBatch::MAX_LANE_WIDTH > 4) {
+			report += RunSATPath(batch, OBBPairBatch::MAX_LANE_WIDTH, repeats[run], expectedHits, expectedAxes);
+		}
+	}
+
+	//Same pairs over many frames, where remembering the last separating axis pays off
+	report += "Separating axis cache (tumbling pairs)\n";
+	report += RunCoherentSAT(counts[1], 120, false);
+	report += RunCoherentSAT(counts[1], 120, true);
+
+	//The hull narrowphase's depth and normal, checked against SAT on the same boxes
+	report += "EPA penetration against SAT (overlapping box pairs)\n";
+	report += RunEPACheck(counts[1]);
+
+	return report;
+}
+
+std::string PhysicsBenchmarks::RunStackingBenchmark()
+{
+	const int counts[] = { 100, 1000, 10000 };
+	const int steps[] = { 240, 120, 60 };
+
+	char header[128];
+	snprintf(header, sizeof(header), "Box stacks (%d high, %d solver iterations)\n", STACK_HEIGHT, ContactSolver().GetIterations());
+	std::string report = header;
+
+	for (int run = 0; run < 3; run++) {
+		report += RunStacking(counts[run], steps[run], true);
+	}
+
+	//Same stacks starting every step from zero, to show what warm starting buys
+	report += RunStacking(counts[1], steps[1], false);
+
+	report += "Bounce\n";
+	report += RunBounce();
+
+	return report;
+}
+
+std::string PhysicsBenchmarks::RunSleepingBenchmark()
+{
+	std::string report = "Sleeping box stacks\n";
+	report += RunSleeping(1000);
+	report += RunSleeping(10000);
+	return report;
+}
+
+std::string PhysicsBenchmarks::RunThreadScalingBenchmark()
+{
+	int previousThreads = JobSystem::GetInstance()->GetThreadCount();
+
+	char header[128];
+	snprintf(header, sizeof(header), "Parallel contact solve (%d hardware threads)\n", JobSystem::GetHardwareThreads());
+	std::string report = header;
+	report += RunThreadScaling(10000, 60, STACK_SPACING, "Separate stacks");
+	report += RunThreadScaling(2500, 60, 1.0f, "Packed stacks");
+
+	JobSystem::GetInstance()->SetThreadCount(previousThreads);
+	return report;
+}
+
+std::string PhysicsBenchmarks::RunJointBenchmark()
+{
+	int previousThreads = JobSystem::GetInstance()->GetThreadCount();
+
+	char header[128];
+	snprintf(header, sizeof(header), "Joints (%d solver iterations, %d threads)\n", ContactSolver().GetIterations(), previousThreads);
+	std::string report = header;
+	report += RunJointChains(100, 240);
+	report += RunJointChains(500, 120);
+	report += RunRagdolls(100, 240);
+	report += RunJointTypes();
+
+	//Same chains on one thread, the island jobs don't depend on how many there are
+	JobSystem::GetInstance()->SetThreadCount(1);
+	report += RunJointChains(100, 240);
+	JobSystem::GetInstance()->SetThreadCount(previousThreads);
+	return report;
+}
+
+std::string PhysicsBenchmarks::RunContinuousCollisionBenchmark()
+{
+	const float speeds[] = { 10.0f, 30.0f, 100.0f, 300.0f, 1000.0f };
+
+	std::string report = "0.1 unit cubes fired at a 0.05 thick wall\n";
+	for (float speed : speeds) {
+		report += RunTunneling(speed, false);
+		report += RunTunneling(speed, true);
+	}
+	return report;
+}
+
+std::string PhysicsBenchmarks::RunSceneQueryBenchmark()
+{
+	const int counts[] = { 1000, 10000, 50000 };
+	const int numRays = 10000;
+
+	char header[128];
+	snprintf(header, sizeof(header), "Scene queries (%d threads)\n", JobSystem::GetInstance()->GetThreadCount());
+	std::string report = header;
+
+	for (int run = 0; run < 3; run++) {
+		QueryBVH tree;
+		float worldHalfSize = BuildQueryScene(tree, counts[run], 2024);
+
+		char line[128];
+		snprintf(line, sizeof(line), " %d boxes\n", counts[run]);
+		report += line;
+
+		std::vector<Ray> rays;
+		BuildRandomRays(rays, numRays, worldHalfSize, 2025);
+		report += RunRaycasts(tree, rays, "Random", QueryFilter(), 4);
+		//Only layer 1, a quarter of the boxes
+		report += RunRaycasts(tree, rays, "One layer", QueryFilter(2u), 4);
+		BuildPickingRays(rays, 128, 128, worldHalfSize);
+		report += RunRaycasts(tree, rays, "Picking grid", QueryFilter(), 4);
+
+		report += RunSweeps(tree, worldHalfSize, 1000);
+		report += RunQueryRefits(tree, worldHalfSize, 30);
+	}
+
+	return report;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+
+//Headless timing runs for the physics systems. Each one builds its own scene
+//out of raw bounds so it doesn't need any meshes or a device, and returns a
+//printable report. Kicked off from the Physics section of the debug UI
+class PhysicsBenchmarks
+{
+public:
+	//Pair counts and ms/frame for each broadphase at 1k, 10k and 50k moving colliders,
+	//plus a mostly static 10k scene and a brute force reference
+	static std::string RunBroadphaseBenchmark();
+
+	//Spatial hash against brute force on swarms of 1k, 5k and 10k small boxes, and a sweep over cell sizes
+	static std::string RunSpatialHashBenchmark();
+
+	//Batched SAT (SSE and AVX when built for it) against the scalar test on random box pairs,
+	//also checks every lane agrees with the scalar hit and separating axis. Then times
+	//slowly moving pairs with and without the remembered separating axis, and checks GJK and EPA's
+	//penetration depth and normal on overlapping pairs against SAT's
+	static std::string RunSATBenchmark();
+
+	//Stacks of boxes on a floor at 100, 1k and 10k bodies, reports contact solver ms/step
+	//along with collision and integration time and how far any box drifted from its start. Then drops
+	//boxes of different restitution and checks how high each bounces
+	static std::string RunStackingBenchmark();
+
+	//Same stacks with islands and sleeping on at 1k and 10k boxes. Reports the cost of a step while
+	//everything is awake against one once the whole pile has gone to sleep
+	static std::string RunSleepingBenchmark();
+
+	//Contact solve on the job system at 1, 2, 4, 8 and 16 threads, over 1000 separate stacks (one island
+	//each) and the same stacks packed into one island that has to be split by colouring
+	static std::string RunThreadScalingBenchmark();
+
+	//Regression scene for tunnelling: 100 small cubes fired at a thin wall at speeds from 10 to 1000
+	//units per second, with and without continuous collision. With it on none should get through
+	static std::string RunContinuousCollisionBenchmark();
+
+	//Ball socket chains with 1000 and 5000 joints and ragdolls falling onto a floor, reporting joint solver
+	//ms/step and the worst drift at the anchors and limits. Then checks each joint type on its own
+	static std::string RunJointBenchmark();
+
+	//Raycasts against 1k, 10k and 50k turned boxes, batched into packets against one ray at a time, with
+	//every answer checked against the single ray path and the first few against brute force. Then sphere
+	//and box sweeps checked with overlap tests, and what it costs to keep the tree fitted as boxes move
+	static std::string RunSceneQueryBenchmark();
+};
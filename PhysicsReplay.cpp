@@ -0,0 +1,141 @@
+#include "PhysicsReplay.h"
+#include "JobSystem.h"
+#include "PhysicsWorld.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+	//Turns deterministic mode on for as long as it's around, then puts back whatever it was
+	class DeterministicScope
+	{
+	private:
+		PhysicsWorld& m_world;
+		bool m_wasDeterministic;
+
+	public:
+		DeterministicScope(PhysicsWorld& world)
+			: m_world(world),
+			m_wasDeterministic(world.IsDeterministic())
+		{
+			m_world.SetDeterministic(true);
+		}
+
+		~DeterministicScope()
+		{
+			m_world.SetDeterministic(m_wasDeterministic);
+		}
+	};
+
+	std::string DescribeVerify(int result, int steps)
+	{
+		char line[128];
+		if (result == PhysicsReplay::VERIFY_MATCHED) {
+			snprintf(line, sizeof(line), "all %d steps matched", steps);
+		}
+		else if (result == PhysicsReplay::VERIFY_RESTORE_FAILED) {
+			snprintf(line, sizeof(line), "snapshot couldn't be restored");
+		}
+		else if (result == 0) {
+			snprintf(line, sizeof(line), "MISMATCH right after restoring");
+		}
+		else {
+			snprintf(line, sizeof(line), "MISMATCH from step %d", result);
+		}
+
+		return line;
+	}
+}
+
+PhysicsReplay::PhysicsReplay()
+	: m_timeStep(0.0f)
+{
+}
+
+PhysicsReplay::~PhysicsReplay()
+{
+}
+
+unsigned long long PhysicsReplay::HashState(PhysicsWorld& world)
+{
+	world.SaveSnapshot(m_stepState);
+	return m_stepState.Hash();
+}
+
+unsigned long long PhysicsReplay::StepAndHash(PhysicsWorld& world)
+{
+	world.GetBodies().SavePreviousPoses();
+	world.Step(m_timeStep);
+	return HashState(world);
+}
+
+void PhysicsReplay::Record(PhysicsWorld& world, int steps, float timeStep)
+{
+	DeterministicScope deterministic(world);
+	m_timeStep = timeStep;
+
+	world.SaveSnapshot(m_start);
+	l_stepHashes.clear();
+	l_stepHashes.push_back(m_start.Hash());
+	for (int i = 0; i < steps; i++) {
+		l_stepHashes.push_back(StepAndHash(world));
+	}
+}
+
+int PhysicsReplay::Verify(PhysicsWorld& world)
+{
+	DeterministicScope deterministic(world);
+	if (!world.RestoreSnapshot(m_start)) {
+		return VERIFY_RESTORE_FAILED;
+	}
+
+	//Catches anything the snapshot missed or didn't put back exactly
+	if (HashState(world) != l_stepHashes[0]) {
+		return 0;
+	}
+
+	for (int i = 1; i < static_cast<int>(l_stepHashes.size()); i++) {
+		if (StepAndHash(world) != l_stepHashes[i]) {
+			return i;
+		}
+	}
+
+	return VERIFY_MATCHED;
+}
+
+bool PhysicsReplay::Rewind(PhysicsWorld& world)
+{
+	return world.RestoreSnapshot(m_start);
+}
+
+std::string PhysicsReplay::CheckWorld(PhysicsWorld& world, int steps)
+{
+	PhysicsReplay replay;
+	std::shared_ptr<JobSystem> jobSystem = JobSystem::GetInstance();
+	int threadCount = jobSystem->GetThreadCount();
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	replay.Record(world, steps, world.GetFixedTimeStep());
+	float recordMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	int sameThreads = replay.Verify(world);
+
+	//Islands and colours are handed out to threads differently but have to come out the same
+	jobSystem->SetThreadCount(1);
+	int oneThread = replay.Verify(world);
+	jobSystem->SetThreadCount(threadCount);
+
+	replay.Rewind(world);
+
+	std::string report = "Determinism check\n";
+	char line[256];
+	snprintf(line, sizeof(line), "  %d bodies, %d steps recorded in %.1f ms, %zu byte snapshot, final hash %016llx\n",
+		world.NumBodies(), steps, recordMs, replay.GetSnapshotSize(), replay.GetStepHash(replay.NumSteps()));
+	report += line;
+	snprintf(line, sizeof(line), "  replay on %2d threads: %s\n", threadCount, DescribeVerify(sameThreads, steps).c_str());
+	report += line;
+	snprintf(line, sizeof(line), "  replay on  1 thread:  %s\n", DescribeVerify(oneThread, steps).c_str());
+	report += line;
+	return report;
+}
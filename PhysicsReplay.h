@@ -0,0 +1,52 @@
+#pragma once
+#include "PhysicsSnapshot.h"
+
+#include <string>
+#include <vector>
+
+class PhysicsWorld;
+
+//Headless record and replay for checking the physics world is deterministic. Record snapshots the
+//world, steps it the given number of times and keeps a hash of the whole state after each step.
+//Verify puts the snapshot back and steps through again, every hash has to come out the same.
+//Both run in deterministic mode and nothing but physics is updated, so entities and rendering
+//don't get a say in what happens
+class PhysicsReplay
+{
+private:
+	PhysicsSnapshot m_start;
+	//Index 0 is the starting state, then one per step
+	std::vector<unsigned long long> l_stepHashes;
+	float m_timeStep;
+
+	//Scratch for hashing after each step
+	PhysicsSnapshot m_stepState;
+
+	unsigned long long HashState(PhysicsWorld& world);
+	//One fixed step the same way PhysicsWorld::Update takes them
+	unsigned long long StepAndHash(PhysicsWorld& world);
+
+public:
+	//Verify results besides the index of the first step that didn't match
+	static const int VERIFY_MATCHED = -1;
+	static const int VERIFY_RESTORE_FAILED = -2;
+
+	PhysicsReplay();
+	~PhysicsReplay();
+
+	//Leaves the world where the last step put it
+	void Record(PhysicsWorld& world, int steps, float timeStep);
+	//VERIFY_MATCHED if every step hashed the same as when it was recorded, 0 if the state after
+	//restoring didn't, otherwise the first step that went differently
+	int Verify(PhysicsWorld& world);
+	//Back to where Record started
+	bool Rewind(PhysicsWorld& world);
+
+	int NumSteps() const { return static_cast<int>(l_stepHashes.size()) - 1; }
+	unsigned long long GetStepHash(int step) const { return l_stepHashes[step]; }
+	size_t GetSnapshotSize() const { return m_start.GetSize(); }
+
+	//Records steps from the world's current state, replays them on the same thread count and on
+	//one thread, then rewinds. Returns a printable report like the benchmarks do
+	static std::string CheckWorld(PhysicsWorld& world, int steps);
+};
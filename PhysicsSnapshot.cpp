@@ -0,0 +1,55 @@
+#include "PhysicsSnapshot.h"
+
+#include <cstring>
+
+namespace
+{
+	const unsigned long long FNV_OFFSET_BASIS = 14695981039346656037ull;
+	const unsigned long long FNV_PRIME = 1099511628211ull;
+}
+
+PhysicsSnapshot::Reader::Reader(const PhysicsSnapshot& snapshot)
+	: m_snapshot(snapshot),
+	m_offset(0),
+	m_failed(false)
+{
+}
+
+bool PhysicsSnapshot::Reader::ReadBytes(void* outData, size_t size)
+{
+	if (m_failed || size > m_snapshot.l_data.size() - m_offset) {
+		m_failed = true;
+		return false;
+	}
+
+	if (size > 0) {
+		memcpy(outData, m_snapshot.l_data.data() + m_offset, size);
+	}
+	m_offset += size;
+	return true;
+}
+
+PhysicsSnapshot::PhysicsSnapshot()
+{
+}
+
+PhysicsSnapshot::~PhysicsSnapshot()
+{
+}
+
+void PhysicsSnapshot::WriteBytes(const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	l_data.insert(l_data.end(), bytes, bytes + size);
+}
+
+unsigned long long PhysicsSnapshot::Hash() const
+{
+	unsigned long long hash = FNV_OFFSET_BASIS;
+	for (unsigned char byte : l_data) {
+		hash ^= byte;
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
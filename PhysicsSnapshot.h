@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+//Flat binary copy of the physics state, what PhysicsWorld::SaveSnapshot writes and RestoreSnapshot
+//reads back. Values are copied in as raw bytes so a restore is bit for bit, which also means a
+//snapshot is only good for the same build on the same kind of machine. The hash covers every
+//byte, two worlds with the same hash are in exactly the same state
+class PhysicsSnapshot
+{
+private:
+	std::vector<unsigned char> l_data;
+
+public:
+	//Walks through a snapshot in the order it was written. Reading past the end fails
+	//and leaves the value alone, and every read after that fails too
+	class Reader
+	{
+	private:
+		const PhysicsSnapshot& m_snapshot;
+		size_t m_offset;
+		bool m_failed;
+
+	public:
+		Reader(const PhysicsSnapshot& snapshot);
+
+		bool ReadBytes(void* outData, size_t size);
+		template<typename T> bool Read(T& outValue) { return ReadBytes(&outValue, sizeof(T)); }
+		template<typename T> bool ReadArray(T* outValues, int count) { return ReadBytes(outValues, sizeof(T) * count); }
+
+		bool Failed() const { return m_failed; }
+		bool AtEnd() const { return m_offset == m_snapshot.l_data.size(); }
+	};
+
+	PhysicsSnapshot();
+	~PhysicsSnapshot();
+
+	void Clear() { l_data.clear(); }
+
+	void WriteBytes(const void* data, size_t size);
+	template<typename T> void Write(const T& value) { WriteBytes(&value, sizeof(T)); }
+	template<typename T> void WriteArray(const T* values, int count) { WriteBytes(values, sizeof(T) * count); }
+
+	size_t GetSize() const { return l_data.size(); }
+	const unsigned char* GetData() const { return l_data.data(); }
+
+	//64 bit FNV-1a of every byte
+	unsigned long long Hash() const;
+};
@@ -0,0 +1,471 @@
+#include "PhysicsWorld.h"
+#include "CollisionManager.h"
+#include "FloatingPointEnvironment.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace DirectX;
+
+std::shared_ptr<PhysicsWorld> PhysicsWorld::s_instance;
+
+namespace
+{
+	//"PHYS", and bumped whenever what's saved changes
+	const unsigned int SNAPSHOT_MAGIC = 0x53594850;
+	const unsigned int SNAPSHOT_VERSION = 4;
+
+	bool IsZero(const XMFLOAT3& v)
+	{
+		return v.x == 0.0f && v.y == 0.0f && v.z == 0.0f;
+	}
+
+	unsigned long long PairKey(int bodyA, int bodyB)
+	{
+		int low = std::min(bodyA, bodyB);
+		int high = std::max(bodyA, bodyB);
+		return (static_cast<unsigned long long>(low) << 32) | static_cast<unsigned int>(high);
+	}
+
+	//What a joint saves for warm starting
+	struct JointImpulses
+	{
+		XMFLOAT3 linear;
+		XMFLOAT3 angular;
+		float limit;
+		float motor;
+	};
+
+	//A body's transform as the snapshot stores it
+	struct TransformState
+	{
+		XMFLOAT3 position;
+		XMFLOAT4 rotation;
+		XMFLOAT3 scale;
+	};
+}
+
+PhysicsWorld::PhysicsWorld()
+	: l_bodyHandles(1),
+	m_gravity(XMFLOAT3(0.0f, -9.81f, 0.0f)),
+	m_linearDamping(0.0f),
+	m_angularDamping(0.05f),
+	m_maxTimeStep(1.0f / 30.0f),
+	m_fixedTimeStep(1.0f / 60.0f),
+	m_maxSubSteps(4),
+	m_accumulator(0.0f),
+	m_interpolationAlpha(1.0f),
+	m_deterministic(false),
+	m_solverMs(0.0f),
+	m_lastSubSteps(0)
+{
+}
+
+//Not needed atm
+PhysicsWorld::~PhysicsWorld()
+{
+}
+
+std::shared_ptr<PhysicsWorld> PhysicsWorld::GetInstance()
+{
+	if (!s_instance.get()) {
+		std::shared_ptr<PhysicsWorld> newInstance(new PhysicsWorld());
+		s_instance = newInstance;
+	}
+
+	return s_instance;
+}
+
+void PhysicsWorld::AddBody(std::shared_ptr<RigidBody> body)
+{
+	//Already added
+	if (!body || body->GetBodyId() != -1) {
+		return;
+	}
+
+	//Grab whatever was set on the handle before it had a slot
+	XMFLOAT3 velocity = body->GetVelocity();
+	XMFLOAT3 angularVelocity = body->GetAngularVelocity();
+
+	int bodyId = m_bodies.Add();
+	l_bodyHandles.push_back(body);
+	body->SetBodyId(bodyId);
+
+	body->UpdateMassProperties();
+	m_bodies.SetVelocity(bodyId, velocity);
+	m_bodies.SetAngularVelocity(bodyId, angularVelocity);
+}
+
+void PhysicsWorld::RemoveBody(std::shared_ptr<RigidBody> body)
+{
+	if (!body || body->GetBodyId() == -1) {
+		return;
+	}
+
+	int bodyId = body->GetBodyId();
+	XMFLOAT3 velocity = m_bodies.GetVelocity(bodyId);
+	XMFLOAT3 angularVelocity = m_bodies.GetAngularVelocity(bodyId);
+
+	//Order doesn't matter so the last body takes its slot
+	int last = m_bodies.Size() - 1;
+	m_bodies.RemoveSwap(bodyId);
+	l_bodyHandles[bodyId] = l_bodyHandles[last];
+	l_bodyHandles.pop_back();
+	if (bodyId != last) {
+		l_bodyHandles[bodyId]->SetBodyId(bodyId);
+	}
+
+	//Keep its motion on the handle in case it gets added again
+	if (body->GetCollider()) {
+		body->GetCollider()->SetSleeping(false);
+	}
+	body->SetBodyId(-1);
+	body->SetVelocity(velocity);
+	body->SetAngularVelocity(angularVelocity);
+}
+
+void PhysicsWorld::WakeBody(int bodyId)
+{
+	if (!m_bodies.IsStatic(bodyId) && !m_bodies.IsAwake(bodyId)) {
+		m_bodies.SetAwake(bodyId, true);
+	}
+}
+
+void PhysicsWorld::AddJoint(std::shared_ptr<Joint> joint)
+{
+	//Already added
+	if (!joint || joint->GetJointId() != -1) {
+		return;
+	}
+
+	joint->SetJointId(static_cast<int>(l_joints.size()));
+	l_joints.push_back(joint);
+}
+
+void PhysicsWorld::RemoveJoint(std::shared_ptr<Joint> joint)
+{
+	if (!joint || joint->GetJointId() == -1) {
+		return;
+	}
+
+	//Same as bodies, the last joint takes its slot
+	int jointId = joint->GetJointId();
+	l_joints[jointId] = l_joints.back();
+	l_joints[jointId]->SetJointId(jointId);
+	l_joints.pop_back();
+	joint->SetJointId(-1);
+
+	//Whatever it was holding together has to start moving again
+	int bodyA = joint->GetBodyIdA();
+	int bodyB = joint->GetBodyIdB();
+	if (bodyA >= 0) {
+		WakeBody(bodyA);
+	}
+	if (bodyB >= 0) {
+		WakeBody(bodyB);
+	}
+}
+
+void PhysicsWorld::Update(float frameTime)
+{
+	m_accumulator += frameTime;
+
+	//Spiral of death, the sim just runs slower than real time while frames are this long
+	float maxAccumulated = m_fixedTimeStep * m_maxSubSteps;
+	if (m_accumulator > maxAccumulated) {
+		m_accumulator = maxAccumulated;
+	}
+
+	m_lastSubSteps = 0;
+	while (m_accumulator >= m_fixedTimeStep) {
+		m_bodies.SavePreviousPoses();
+		RunStep(m_fixedTimeStep);
+		m_accumulator -= m_fixedTimeStep;
+		m_lastSubSteps++;
+	}
+
+	m_interpolationAlpha = m_accumulator / m_fixedTimeStep;
+	UpdateRenderPoses();
+	//Frames with no steps publish nothing, last frame's records were already seen
+	m_collisionEvents.Swap();
+}
+
+void PhysicsWorld::SetTickRate(float hz)
+{
+	if (hz <= 0.0f) {
+		return;
+	}
+
+	m_fixedTimeStep = 1.0f / hz;
+	m_maxTimeStep = std::max(m_maxTimeStep, m_fixedTimeStep);
+}
+
+void PhysicsWorld::Step(float dt)
+{
+	RunStep(dt);
+	m_collisionEvents.Swap();
+}
+
+void PhysicsWorld::RunStep(float dt)
+{
+	if (dt <= 0.0f) {
+		return;
+	}
+	dt = std::min(dt, m_maxTimeStep);
+
+	//Whatever the rest of the frame left the environment as, the step always runs the same way
+	FloatingPointEnvironment::Scope floatScope(m_deterministic ? FloatingPointEnvironment::DETERMINISTIC : FloatingPointEnvironment::Get());
+
+	ReadTransforms();
+	m_bodies.UpdateWorldInertia();
+
+	//Contacts are found where the bodies are now, then the velocities they'd have
+	//after this step are corrected so they don't carry on into each other
+	CollisionManager::GetInstance()->UpdateCollisions();
+	UpdateIslands(dt);
+	m_bodies.IntegrateVelocities(dt, m_gravity, m_linearDamping, m_angularDamping);
+
+	std::chrono::high_resolution_clock::time_point solveStart = std::chrono::high_resolution_clock::now();
+	BuildJointConstraints(dt);
+	BuildContactConstraints(dt);
+	m_contactSolver.Solve(m_bodies, m_islands, &m_jointSolver);
+	m_solverMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - solveStart).count();
+	m_collisionEvents.RecordStep(*CollisionManager::GetInstance());
+
+	SweepFastBodies(dt);
+	m_bodies.IntegratePositions(dt);
+	m_continuousCollision.ApplyImpacts(m_bodies);
+	m_bodies.ClearForces();
+	WriteTransforms();
+}
+
+void PhysicsWorld::SetDeterministic(bool deterministic)
+{
+	m_deterministic = deterministic;
+	CollisionManager::GetInstance()->SetDeterministic(deterministic);
+}
+
+void PhysicsWorld::SaveSnapshot(PhysicsSnapshot& snapshot) const
+{
+	snapshot.Clear();
+	snapshot.Write(SNAPSHOT_MAGIC);
+	snapshot.Write(SNAPSHOT_VERSION);
+
+	int bodyCount = m_bodies.Size();
+	snapshot.Write(bodyCount);
+	snapshot.Write(static_cast<int>(BODY_COMPONENT_COUNT));
+	for (int c = 0; c < BODY_COMPONENT_COUNT; c++) {
+		snapshot.WriteArray(m_bodies.Get(static_cast<eBodyComponent>(c)), bodyCount);
+	}
+
+	//The body's pose is about its centre of mass, the transform's own values are what colliders are built from
+	for (unsigned int i = 1; i < l_bodyHandles.size(); i++) {
+		Transform* transform = l_bodyHandles[i]->GetTransform();
+		TransformState state;
+		state.position = transform->GetPosition();
+		state.rotation = transform->GetRotationQuat();
+		state.scale = transform->GetScale();
+		snapshot.Write(state);
+	}
+
+	snapshot.Write(static_cast<int>(l_joints.size()));
+	for (const std::shared_ptr<Joint>& joint : l_joints) {
+		JointImpulses impulses;
+		impulses.linear = joint->GetLinearImpulse();
+		impulses.angular = joint->GetAngularImpulse();
+		impulses.limit = joint->GetLimitImpulse();
+		impulses.motor = joint->GetMotorImpulse();
+		snapshot.Write(impulses);
+	}
+
+	CollisionManager::GetInstance()->SaveState(snapshot);
+}
+
+bool PhysicsWorld::RestoreSnapshot(const PhysicsSnapshot& snapshot)
+{
+	PhysicsSnapshot::Reader reader(snapshot);
+
+	unsigned int magic;
+	unsigned int version;
+	int bodyCount;
+	int componentCount;
+	if (!reader.Read(magic) || magic != SNAPSHOT_MAGIC || !reader.Read(version) || version != SNAPSHOT_VERSION ||
+		!reader.Read(bodyCount) || bodyCount != m_bodies.Size() ||
+		!reader.Read(componentCount) || componentCount != BODY_COMPONENT_COUNT) {
+		return false;
+	}
+
+	//Held onto until the collision manager's part has been read too, so a bad snapshot changes nothing
+	std::vector<float> components(static_cast<size_t>(bodyCount) * BODY_COMPONENT_COUNT);
+	std::vector<TransformState> transforms(static_cast<size_t>(bodyCount - 1));
+	int jointCount;
+	std::vector<JointImpulses> jointImpulses(l_joints.size());
+	if (!reader.ReadArray(components.data(), static_cast<int>(components.size())) ||
+		!reader.ReadArray(transforms.data(), static_cast<int>(transforms.size())) ||
+		!reader.Read(jointCount) || jointCount != NumJoints() ||
+		!reader.ReadArray(jointImpulses.data(), jointCount) ||
+		!CollisionManager::GetInstance()->RestoreState(reader)) {
+		return false;
+	}
+
+	//Transforms first, a body whose scale changed since works its mass out again and that's overwritten below
+	for (unsigned int i = 1; i < l_bodyHandles.size(); i++) {
+		const TransformState& transform = transforms[i - 1];
+		l_bodyHandles[i]->RestoreTransform(transform.position, transform.rotation, transform.scale);
+	}
+
+	for (int c = 0; c < BODY_COMPONENT_COUNT; c++) {
+		std::copy(components.begin() + static_cast<size_t>(c) * bodyCount, components.begin() + static_cast<size_t>(c + 1) * bodyCount,
+			m_bodies.Get(static_cast<eBodyComponent>(c)));
+	}
+
+	for (int i = 0; i < jointCount; i++) {
+		const JointImpulses& impulses = jointImpulses[i];
+		l_joints[i]->SetImpulses(impulses.linear, impulses.angular, impulses.limit, impulses.motor);
+	}
+
+	CollisionManager::GetInstance()->RefreshBounds();
+	UpdateRenderPoses();
+	return true;
+}
+
+void PhysicsWorld::ReadTransforms()
+{
+	for (unsigned int i = 1; i < l_bodyHandles.size(); i++) {
+		RigidBody* body = l_bodyHandles[i].get();
+		//Moved by hand wakes it up. For a static body it just means it can wake what it touches
+		//this step, same goes for one that was given a velocity and is moving on its own
+		bool moved = body->ReadTransform();
+		if (m_bodies.IsStatic(i)) {
+			moved = moved || !IsZero(m_bodies.GetVelocity(i)) || !IsZero(m_bodies.GetAngularVelocity(i));
+		}
+		if (moved) {
+			m_bodies.SetAwake(i, true);
+		}
+
+		//Anything that won't move this step can be skipped by the collision manager. Under another
+		//transform the parent can move it without the body knowing, so those are always checked
+		Collider* collider = body->GetCollider();
+		if (collider) {
+			collider->SetSleeping(!m_bodies.IsAwake(i) && !body->GetTransform()->GetParent());
+		}
+	}
+}
+
+void PhysicsWorld::WriteTransforms()
+{
+	for (unsigned int i = 1; i < l_bodyHandles.size(); i++) {
+		l_bodyHandles[i]->WriteTransform();
+	}
+}
+
+void PhysicsWorld::UpdateRenderPoses()
+{
+	for (unsigned int i = 1; i < l_bodyHandles.size(); i++) {
+		l_bodyHandles[i]->UpdateRenderPose(m_interpolationAlpha);
+	}
+}
+
+void PhysicsWorld::UpdateIslands(float dt)
+{
+	m_islands.Begin(m_bodies.Size());
+
+	//Same reason as in ReadTransforms, the parent could move them at any time
+	for (unsigned int i = 1; i < l_bodyHandles.size(); i++) {
+		if (l_bodyHandles[i]->GetTransform()->GetParent()) {
+			m_islands.KeepAwake(i);
+		}
+	}
+
+	for (ContactManifold* manifold : CollisionManager::GetInstance()->GetManifolds()) {
+		int bodyA = manifold->colliderA->GetBodyId();
+		int bodyB = manifold->colliderB->GetBodyId();
+		m_islands.AddContact(bodyA >= 0 ? bodyA : RigidBodyArrays::STATIC_BODY, bodyB >= 0 ? bodyB : RigidBodyArrays::STATIC_BODY, m_bodies);
+	}
+
+	//Jointed bodies sleep and wake together whether they're touching or not
+	for (const std::shared_ptr<Joint>& joint : l_joints) {
+		int bodyA = joint->GetBodyIdA();
+		int bodyB = joint->GetBodyIdB();
+		if (bodyA >= 0 && bodyB >= 0) {
+			m_islands.AddContact(bodyA, bodyB, m_bodies);
+		}
+	}
+
+	m_islands.UpdateSleep(m_bodies, dt);
+}
+
+void PhysicsWorld::BuildJointConstraints(float dt)
+{
+	m_jointSolver.Clear();
+	l_jointedPairs.clear();
+
+	for (const std::shared_ptr<Joint>& joint : l_joints) {
+		int bodyA = joint->GetBodyIdA();
+		int bodyB = joint->GetBodyIdB();
+		if (bodyA < 0 || bodyB < 0) {
+			continue;
+		}
+
+		m_jointSolver.AddJoint(joint.get(), bodyA, bodyB, m_bodies, dt);
+		//The shared static body stands in for every collider without a body, so joints to the world can't filter anything
+		if (!joint->GetCollideConnected() && bodyA != RigidBodyArrays::STATIC_BODY && bodyB != RigidBodyArrays::STATIC_BODY) {
+			l_jointedPairs.push_back(PairKey(bodyA, bodyB));
+		}
+	}
+
+	std::sort(l_jointedPairs.begin(), l_jointedPairs.end());
+	m_jointSolver.SortIntoIslands(m_bodies, m_islands);
+}
+
+void PhysicsWorld::BuildContactConstraints(float dt)
+{
+	m_contactSolver.Clear();
+
+	for (ContactManifold* manifold : CollisionManager::GetInstance()->GetManifolds()) {
+		int bodyA = manifold->colliderA->GetBodyId();
+		int bodyB = manifold->colliderB->GetBodyId();
+		bodyA = bodyA >= 0 ? bodyA : RigidBodyArrays::STATIC_BODY;
+		bodyB = bodyB >= 0 ? bodyB : RigidBodyArrays::STATIC_BODY;
+
+		if (!l_jointedPairs.empty() && std::binary_search(l_jointedPairs.begin(), l_jointedPairs.end(), PairKey(bodyA, bodyB))) {
+			manifold->solved = false;
+			continue;
+		}
+		m_contactSolver.AddManifold(manifold, bodyA, bodyB, m_bodies, dt);
+	}
+}
+
+void PhysicsWorld::SweepFastBodies(float dt)
+{
+	m_continuousCollision.Begin();
+
+	for (unsigned int i = 1; i < l_bodyHandles.size(); i++) {
+		XMFLOAT3 displacement;
+		Collider* collider = l_bodyHandles[i]->GetCollider();
+		//Triggers don't stop anything so there's nothing for them to tunnel through
+		if (!collider || collider->IsTrigger() || !m_continuousCollision.NeedsSweep(m_bodies, i, dt, displacement)) {
+			continue;
+		}
+
+		//Everything the box passes over this step
+		AABB start = collider->GetWorldAABB();
+		AABB end = AABB(
+			XMFLOAT3(start.min.x + displacement.x, start.min.y + displacement.y, start.min.z + displacement.z),
+			XMFLOAT3(start.max.x + displacement.x, start.max.y + displacement.y, start.max.z + displacement.z));
+		CollisionManager::GetInstance()->QueryAABB(AABB::Union(start, end), l_sweepColliders);
+
+		float earliestTime = 1.0f;
+		for (Collider* other : l_sweepColliders) {
+			int otherBody = other->GetBodyId();
+			if (other == collider || otherBody == static_cast<int>(i) || other->IsTrigger() || !Collider::ShouldCollide(collider, other)) {
+				continue;
+			}
+
+			XMFLOAT3 otherDisplacement = otherBody >= 0 ? ContinuousCollision::GetDisplacement(m_bodies, otherBody, dt) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+			ContinuousCollision::SweepAgainst(collider->GetWorldOBB(), displacement, other->GetWorldOBB(), otherDisplacement, earliestTime);
+		}
+
+		m_continuousCollision.AddImpact(m_bodies, i, displacement, earliestTime);
+	}
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include "CollisionEventBuffer.h"
+#include "ContactSolver.h"
+#include "ContinuousCollision.h"
+#include "Joint.h"
+#include "JointSolver.h"
+#include "PhysicsSnapshot.h"
+#include "RigidBody.h"
+#include "RigidBodyArrays.h"
+#include "SimulationIslands.h"
+
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+//Owns every rigid body's state and moves them each frame. A step reads in any
+//transforms that were moved by hand, runs the collision manager, adds gravity and
+//forces, solves the contacts it found and then moves the bodies and writes them back
+//out to their transforms. Contacts against colliders with no body are solved as if
+//that collider was static. Touching bodies are grouped into islands which sleep once
+//they settle, sleeping bodies aren't integrated, solved or collision tested. Islands
+//are also what lets the contact solve run across the job system's threads. Bodies with
+//continuous collision on are swept after the solve so they can't skip through thin things.
+//Joints are solved along with the contacts and keep the bodies they connect in one island.
+//In deterministic mode the same starting state and steps give bit for bit the same result on
+//the same build, and the whole state can be saved to a snapshot and put back later.
+//Every step's collision events go into a double buffered list of records, published
+//once per Update for gameplay to go through in one pass
+class PhysicsWorld
+{
+private:
+	static std::shared_ptr<PhysicsWorld> s_instance;
+
+	RigidBodyArrays m_bodies;
+	//Handle for each index in m_bodies, index 0 is the shared static body and has none
+	std::vector<std::shared_ptr<RigidBody>> l_bodyHandles;
+
+	ContactSolver m_contactSolver;
+	std::vector<std::shared_ptr<Joint>> l_joints;
+	JointSolver m_jointSolver;
+	//Body pairs with a joint between them that shouldn't collide, sorted so contacts can be checked against it
+	std::vector<unsigned long long> l_jointedPairs;
+	SimulationIslands m_islands;
+	ContinuousCollision m_continuousCollision;
+	//Scratch for the colliders near a swept body
+	std::vector<Collider*> l_sweepColliders;
+	CollisionEventBuffer m_collisionEvents;
+
+	DirectX::XMFLOAT3 m_gravity;
+	float m_linearDamping;
+	float m_angularDamping;
+	//Longest step that will be taken at once, long frames are cut short instead of blowing up
+	float m_maxTimeStep;
+
+	//Update() always steps by m_fixedTimeStep, frame time piles up in the accumulator until there's
+	//enough for a step. Anything past m_maxSubSteps steps in one frame is dropped so a slow frame
+	//can't make the next one slower
+	float m_fixedTimeStep;
+	int m_maxSubSteps;
+	float m_accumulator;
+	//How far between the last two steps the current frame is, 0 is the previous step
+	float m_interpolationAlpha;
+
+	//Fixed floating point environment and manifold order every step
+	bool m_deterministic;
+
+	//Stats from the last step
+	float m_solverMs;
+	int m_lastSubSteps;
+
+	PhysicsWorld();
+
+	//Everything Step does apart from publishing the collision records
+	void RunStep(float dt);
+	void ReadTransforms();
+	void WriteTransforms();
+	void UpdateRenderPoses();
+	//Links touching bodies into islands and puts the ones that have settled to sleep
+	void UpdateIslands(float dt);
+	void BuildJointConstraints(float dt);
+	void BuildContactConstraints(float dt);
+	//Sweeps fast bodies that asked for continuous collision against what's around them
+	void SweepFastBodies(float dt);
+
+public:
+	~PhysicsWorld();
+
+	static std::shared_ptr<PhysicsWorld> GetInstance();
+
+	void AddBody(std::shared_ptr<RigidBody> body);
+	void RemoveBody(std::shared_ptr<RigidBody> body);
+	//Its island wakes with it on the next step
+	void WakeBody(int bodyId);
+
+	//Joints whose bodies have been taken out of the world are kept but do nothing until they're back
+	void AddJoint(std::shared_ptr<Joint> joint);
+	void RemoveJoint(std::shared_ptr<Joint> joint);
+
+	//Runs however many fixed steps fit into the time that's built up, then works out the
+	//blended poses entities should draw with. This is what the game calls once per frame
+	void Update(float frameTime);
+	//Collision detection, contact solve and integration for every body. Publishes the step's
+	//collision records on its own, Update only publishes once all of its steps are done
+	void Step(float dt);
+
+	//Steps per second for Update
+	void SetTickRate(float hz);
+	float GetTickRate() const { return 1.0f / m_fixedTimeStep; }
+	float GetFixedTimeStep() const { return m_fixedTimeStep; }
+	void SetMaxSubSteps(int maxSubSteps) { m_maxSubSteps = maxSubSteps > 1 ? maxSubSteps : 1; }
+	int GetMaxSubSteps() const { return m_maxSubSteps; }
+	float GetInterpolationAlpha() const { return m_interpolationAlpha; }
+
+	//Runs every step with the same floating point environment and has the collision manager hand
+	//over manifolds in a fixed order. The solver's threads already give the same result however
+	//many there are, so this doesn't turn them off
+	void SetDeterministic(bool deterministic);
+	bool IsDeterministic() const { return m_deterministic; }
+
+	//Every body's arrays and transform, the joints' warm starting impulses and the collision manager's contact cache, all a step needs
+	//besides the settings. Take it between steps
+	void SaveSnapshot(PhysicsSnapshot& snapshot) const;
+	//Puts the world back to how it was when the snapshot was saved. Only works with the same bodies,
+	//joints and colliders in the same order, returns false without changing anything if they don't match
+	bool RestoreSnapshot(const PhysicsSnapshot& snapshot);
+
+	RigidBodyArrays& GetBodies() { return m_bodies; }
+	ContactSolver& GetContactSolver() { return m_contactSolver; }
+	JointSolver& GetJointSolver() { return m_jointSolver; }
+	ContinuousCollision& GetContinuousCollision() { return m_continuousCollision; }
+	SimulationIslands& GetIslands() { return m_islands; }
+	//Enter, stay and exit records from every step of the last Update (or the last Step called directly)
+	const CollisionEventBuffer& GetCollisionEvents() const { return m_collisionEvents; }
+
+	void SetGravity(const DirectX::XMFLOAT3& gravity) { m_gravity = gravity; }
+	DirectX::XMFLOAT3 GetGravity() const { return m_gravity; }
+
+	//Not counting the shared static body
+	int NumBodies() const { return static_cast<int>(l_bodyHandles.size()) - 1; }
+	int NumContactConstraints() const { return m_contactSolver.NumConstraints(); }
+	int NumJoints() const { return static_cast<int>(l_joints.size()); }
+	//Joints that were solved last step, ones with both sides asleep or static are skipped
+	int NumJointConstraints() const { return m_jointSolver.NumConstraints(); }
+	int NumIslands() const { return m_islands.NumIslands(); }
+	int NumSleepingBodies() const { return m_islands.NumSleepingBodies(); }
+	float GetSolverMs() const { return m_solverMs; }
+	int NumSweptBodies() const { return m_continuousCollision.NumSweptBodies(); }
+	int NumClampedBodies() const { return m_continuousCollision.NumClampedBodies(); }
+	int GetLastSubSteps() const { return m_lastSubSteps; }
+};
@@ -0,0 +1,844 @@
+#include "QueryBVH.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <xmmintrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	//Direction components smaller than this are treated as parallel to a slab
+	const float RAY_PARALLEL_EPSILON = .000001f;
+	//Sphere sweeps step forward until they're this close to touching
+	const float SWEEP_TOLERANCE = .001f;
+	const int SWEEP_ITERATIONS = 32;
+	//Packets handed to each job in a batch
+	const int PACKETS_PER_JOB = 32;
+	const int PACKET_SIZE = 4;
+	//Bits per axis of the Morton code rays are sorted on
+	const int MORTON_BITS = 9;
+
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	XMFLOAT3 MulAdd(const XMFLOAT3& a, const XMFLOAT3& b, float scale)
+	{
+		return XMFLOAT3(a.x + b.x * scale, a.y + b.y * scale, a.z + b.z * scale);
+	}
+
+	//Unit direction and how long it was, 0 length comes back as is
+	XMFLOAT3 Normalize(const XMFLOAT3& v, float& outLength)
+	{
+		outLength = sqrtf(Dot(v, v));
+		if (outLength <= 0.0f) {
+			return v;
+		}
+		return XMFLOAT3(v.x / outLength, v.y / outLength, v.z / outLength);
+	}
+
+	//Stays finite for parallel components so the slab test never multiplies 0 by infinity
+	float SafeInverse(float f)
+	{
+		if (fabsf(f) < RAY_PARALLEL_EPSILON) {
+			f = f < 0.0f ? -RAY_PARALLEL_EPSILON : RAY_PARALLEL_EPSILON;
+		}
+		return 1.0f / f;
+	}
+
+	//Slab test against a box grown by extents, outEnter is where the segment gets into it
+	bool RayAABB(const XMFLOAT3& origin, const XMFLOAT3& inverse, const AABB& bounds, const XMFLOAT3& extents, float maxDistance, float& outEnter)
+	{
+		float enter = 0.0f;
+		float leave = maxDistance;
+		const float* o = &origin.x;
+		const float* inv = &inverse.x;
+		const float* lo = &bounds.min.x;
+		const float* hi = &bounds.max.x;
+		const float* e = &extents.x;
+		for (int i = 0; i < 3; i++) {
+			float t0 = (lo[i] - e[i] - o[i]) * inv[i];
+			float t1 = (hi[i] + e[i] - o[i]) * inv[i];
+			enter = std::max(enter, std::min(t0, t1));
+			leave = std::min(leave, std::max(t0, t1));
+		}
+		outEnter = enter;
+		return enter <= leave;
+	}
+
+	//Ray against the box with its half extents grown by inflate. A ray starting inside hits at 0
+	//with the normal facing back along it
+	bool RayOBB(const OBB& box, const XMFLOAT3& origin, const XMFLOAT3& direction, float inflate, float maxDistance, float& outDistance, XMFLOAT3& outNormal)
+	{
+		XMFLOAT3 offset = Sub(origin, box.center);
+		float enter = 0.0f;
+		float leave = maxDistance;
+		int enterAxis = -1;
+		float enterSign = 1.0f;
+		for (int i = 0; i < 3; i++) {
+			float h = box.halfExtents[i] + inflate;
+			float e = Dot(box.axes[i], offset);
+			float f = Dot(box.axes[i], direction);
+			if (fabsf(f) < RAY_PARALLEL_EPSILON) {
+				if (fabsf(e) > h) {
+					return false;
+				}
+				continue;
+			}
+
+			//Going in through the -h face when heading along the axis, the +h face otherwise
+			float t0 = (-h - e) / f;
+			float t1 = (h - e) / f;
+			float sign = -1.0f;
+			if (t0 > t1) {
+				std::swap(t0, t1);
+				sign = 1.0f;
+			}
+
+			if (t0 > enter) {
+				enter = t0;
+				enterAxis = i;
+				enterSign = sign;
+			}
+			leave = std::min(leave, t1);
+			if (enter > leave) {
+				return false;
+			}
+		}
+
+		outDistance = enter;
+		if (enterAxis >= 0) {
+			const XMFLOAT3& axis = box.axes[enterAxis];
+			outNormal = XMFLOAT3(axis.x * enterSign, axis.y * enterSign, axis.z * enterSign);
+		}
+		else {
+			outNormal = XMFLOAT3(-direction.x, -direction.y, -direction.z);
+		}
+		return true;
+	}
+
+	//Which of 4 rays (stored as structure of arrays) get through a box before their max distance, as
+	//a movemask. Only used to rule rays out, the ones left still go through RayOBB for the exact hit
+	int RayOBBMask(const OBB& box, __m128 ox, __m128 oy, __m128 oz, __m128 dx, __m128 dy, __m128 dz, __m128 maxDistance)
+	{
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		const __m128 epsilon = _mm_set1_ps(RAY_PARALLEL_EPSILON);
+		__m128 rx = _mm_sub_ps(ox, _mm_set1_ps(box.center.x));
+		__m128 ry = _mm_sub_ps(oy, _mm_set1_ps(box.center.y));
+		__m128 rz = _mm_sub_ps(oz, _mm_set1_ps(box.center.z));
+		__m128 enter = _mm_setzero_ps();
+		__m128 leave = maxDistance;
+
+		for (int i = 0; i < 3; i++) {
+			__m128 ax = _mm_set1_ps(box.axes[i].x);
+			__m128 ay = _mm_set1_ps(box.axes[i].y);
+			__m128 az = _mm_set1_ps(box.axes[i].z);
+			__m128 e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, ax), _mm_mul_ps(ry, ay)), _mm_mul_ps(rz, az));
+			__m128 f = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, ax), _mm_mul_ps(dy, ay)), _mm_mul_ps(dz, az));
+
+			//Same nudge as SafeInverse, a parallel ray gets a huge slab on one side instead of a NaN
+			__m128 parallel = _mm_cmplt_ps(_mm_andnot_ps(signBit, f), epsilon);
+			__m128 nudged = _mm_or_ps(_mm_and_ps(f, signBit), epsilon);
+			f = _mm_or_ps(_mm_and_ps(parallel, nudged), _mm_andnot_ps(parallel, f));
+			__m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), f);
+
+			__m128 h = _mm_set1_ps(box.halfExtents[i]);
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), h), e), inverse);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(h, e), inverse);
+			enter = _mm_max_ps(enter, _mm_min_ps(t0, t1));
+			leave = _mm_min_ps(leave, _mm_max_ps(t0, t1));
+		}
+
+		return _mm_movemask_ps(_mm_cmple_ps(enter, leave));
+	}
+
+	XMFLOAT3 ClosestPointOnOBB(const OBB& box, const XMFLOAT3& point)
+	{
+		XMFLOAT3 offset = Sub(point, box.center);
+		XMFLOAT3 closest = box.center;
+		for (int i = 0; i < 3; i++) {
+			float d = std::max(-box.halfExtents[i], std::min(box.halfExtents[i], Dot(box.axes[i], offset)));
+			closest = MulAdd(closest, box.axes[i], d);
+		}
+		return closest;
+	}
+
+	//The gap between the sphere and the box is convex along the path, so Newton steps on it from
+	//the near side land short of the first touch and never skip past it. Starts where the centre
+	//enters the box grown by the radius, which the rounded shape it has to reach sits inside
+	bool SweepSphereOBB(const OBB& box, const XMFLOAT3& center, float radius, const XMFLOAT3& direction, float maxDistance,
+		float& outDistance, XMFLOAT3& outPoint, XMFLOAT3& outNormal)
+	{
+		float distance;
+		XMFLOAT3 normal;
+		if (!RayOBB(box, center, direction, radius, maxDistance, distance, normal)) {
+			return false;
+		}
+
+		for (int i = 0; i < SWEEP_ITERATIONS; i++) {
+			XMFLOAT3 position = MulAdd(center, direction, distance);
+			XMFLOAT3 closest = ClosestPointOnOBB(box, position);
+			XMFLOAT3 gap = Sub(position, closest);
+			float gapLength = sqrtf(Dot(gap, gap));
+			float separation = gapLength - radius;
+
+			if (separation < SWEEP_TOLERANCE) {
+				outDistance = distance;
+				outPoint = closest;
+				if (gapLength > RAY_PARALLEL_EPSILON) {
+					outNormal = XMFLOAT3(gap.x / gapLength, gap.y / gapLength, gap.z / gapLength);
+				}
+				else {
+					outNormal = XMFLOAT3(-direction.x, -direction.y, -direction.z);
+				}
+				return true;
+			}
+
+			//How fast the gap is closing, once it stops closing it only grows from here
+			float closing = -Dot(direction, gap) / gapLength;
+			if (closing <= 0.0f) {
+				return false;
+			}
+
+			distance += separation / closing;
+			if (distance > maxDistance) {
+				return false;
+			}
+		}
+
+		//Still creeping along after every iteration means it's only grazing past
+		return false;
+	}
+
+	//World axis aligned half size of an oriented box
+	XMFLOAT3 OBBExtents(const OBB& box)
+	{
+		XMFLOAT3 extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		for (int i = 0; i < 3; i++) {
+			extents.x += box.halfExtents[i] * fabsf(box.axes[i].x);
+			extents.y += box.halfExtents[i] * fabsf(box.axes[i].y);
+			extents.z += box.halfExtents[i] * fabsf(box.axes[i].z);
+		}
+		return extents;
+	}
+
+	//Spreads the low 10 bits out so there are two zero bits between each
+	unsigned int SpreadBits(unsigned int v)
+	{
+		v &= 0x3ff;
+		v = (v | (v << 16)) & 0x030000ff;
+		v = (v | (v << 8)) & 0x0300f00f;
+		v = (v | (v << 4)) & 0x030c30c3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	}
+
+	void FillHit(QueryHit& outHit, const QueryShape& shape, int shapeIndex, float distance, const XMFLOAT3& point, const XMFLOAT3& normal)
+	{
+		outHit.collider = shape.collider;
+		outHit.shape = shapeIndex;
+		outHit.distance = distance;
+		outHit.point = point;
+		outHit.normal = normal;
+	}
+}
+
+QueryBVH::QueryBVH()
+	: m_builtCost(0.0f),
+	m_rebuildRatio(2.0f),
+	m_needsBuild(true),
+	m_numBuilds(0),
+	m_numRefits(0)
+{
+}
+
+QueryBVH::~QueryBVH()
+{
+}
+
+void QueryBVH::Resize(int count)
+{
+	if (count != NumShapes()) {
+		l_shapes.resize(count);
+		m_needsBuild = true;
+	}
+}
+
+void QueryBVH::Update()
+{
+	if (m_needsBuild) {
+		Rebuild();
+		return;
+	}
+
+	//Children always come after their parent so going backwards sees them first
+	float cost = 0.0f;
+	for (int i = NumNodes() - 1; i >= 0; i--) {
+		Node& node = l_nodes[i];
+		if (node.count > 0) {
+			node.bounds = l_shapes[l_order[node.offset]].bounds;
+			node.layers = l_shapes[l_order[node.offset]].layerBit;
+			for (int j = node.offset + 1; j < node.offset + node.count; j++) {
+				node.bounds = AABB::Union(node.bounds, l_shapes[l_order[j]].bounds);
+				node.layers |= l_shapes[l_order[j]].layerBit;
+			}
+		}
+		else {
+			node.bounds = AABB::Union(l_nodes[i + 1].bounds, l_nodes[node.offset].bounds);
+			node.layers = l_nodes[i + 1].layers | l_nodes[node.offset].layers;
+		}
+		cost += node.bounds.Perimeter();
+	}
+	m_numRefits++;
+
+	//Shapes that started together and drifted apart leave big overlapping nodes behind
+	if (cost > m_builtCost * m_rebuildRatio) {
+		Rebuild();
+	}
+}
+
+void QueryBVH::Rebuild()
+{
+	int count = NumShapes();
+	l_nodes.clear();
+	l_order.resize(count);
+	l_centroids.resize(count);
+	for (int i = 0; i < count; i++) {
+		l_order[i] = i;
+		l_centroids[i] = l_shapes[i].bounds.GetCenter();
+	}
+
+	m_builtCost = 0.0f;
+	if (count > 0) {
+		//Leaves hold up to MAX_LEAF_SHAPES, a full binary tree over them
+		l_nodes.reserve(2 * (count / MAX_LEAF_SHAPES + 1));
+		BuildNode(0, count);
+	}
+
+	for (unsigned int i = 0; i < l_nodes.size(); i++) {
+		m_builtCost += l_nodes[i].bounds.Perimeter();
+	}
+	m_needsBuild = false;
+	m_numBuilds++;
+}
+
+int QueryBVH::BuildNode(int begin, int end)
+{
+	int nodeId = NumNodes();
+	l_nodes.push_back(Node());
+
+	AABB bounds = l_shapes[l_order[begin]].bounds;
+	AABB centroidBounds = AABB(l_centroids[l_order[begin]], l_centroids[l_order[begin]]);
+	unsigned int layers = l_shapes[l_order[begin]].layerBit;
+	for (int i = begin + 1; i < end; i++) {
+		bounds = AABB::Union(bounds, l_shapes[l_order[i]].bounds);
+		layers |= l_shapes[l_order[i]].layerBit;
+		const XMFLOAT3& c = l_centroids[l_order[i]];
+		centroidBounds = AABB::Union(centroidBounds, AABB(c, c));
+	}
+
+	if (end - begin <= MAX_LEAF_SHAPES) {
+		Node& leaf = l_nodes[nodeId];
+		leaf.bounds = bounds;
+		leaf.offset = begin;
+		leaf.count = end - begin;
+		leaf.axis = 0;
+		leaf.layers = layers;
+		return nodeId;
+	}
+
+	//Median split along whichever axis the centres are most spread out on, keeps the tree balanced
+	XMFLOAT3 spread = centroidBounds.GetExtents();
+	int axis = 0;
+	if (spread.y > spread.x && spread.y >= spread.z) {
+		axis = 1;
+	}
+	else if (spread.z > spread.x && spread.z > spread.y) {
+		axis = 2;
+	}
+
+	int mid = (begin + end) / 2;
+	const std::vector<XMFLOAT3>& centroids = l_centroids;
+	std::nth_element(l_order.begin() + begin, l_order.begin() + mid, l_order.begin() + end, [&centroids, axis](int a, int b) {
+		return (&centroids[a].x)[axis] < (&centroids[b].x)[axis];
+	});
+
+	BuildNode(begin, mid);
+	int second = BuildNode(mid, end);
+
+	//Building the children can move the node array
+	Node& node = l_nodes[nodeId];
+	node.bounds = bounds;
+	node.offset = second;
+	node.count = 0;
+	node.axis = axis;
+	node.layers = layers;
+	return nodeId;
+}
+
+template<typename T>
+void QueryBVH::Traverse(const XMFLOAT3& origin, const XMFLOAT3& direction, const XMFLOAT3& extents, unsigned int layerMask, float& maxDistance, T&& test) const
+{
+	if (l_nodes.empty()) {
+		return;
+	}
+
+	XMFLOAT3 inverse = XMFLOAT3(SafeInverse(direction.x), SafeInverse(direction.y), SafeInverse(direction.z));
+	int stack[MAX_STACK];
+	int stackCount = 0;
+	stack[stackCount++] = 0;
+
+	while (stackCount > 0) {
+		int nodeId = stack[--stackCount];
+		const Node& node = l_nodes[nodeId];
+
+		//maxDistance shrinks as closer hits turn up, so this is checked when popped rather than when pushed
+		float enter;
+		if (!(node.layers & layerMask) || !RayAABB(origin, inverse, node.bounds, extents, maxDistance, enter)) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (int i = node.offset; i < node.offset + node.count; i++) {
+				if (!test(l_order[i], maxDistance)) {
+					return;
+				}
+			}
+			continue;
+		}
+
+		//Near child goes on top so it's visited first
+		int nearChild = nodeId + 1;
+		int farChild = node.offset;
+		if ((&direction.x)[node.axis] < 0.0f) {
+			std::swap(nearChild, farChild);
+		}
+		if (stackCount + 2 <= MAX_STACK) {
+			stack[stackCount++] = farChild;
+			stack[stackCount++] = nearChild;
+		}
+	}
+}
+
+template<typename T>
+void QueryBVH::TraverseAABB(const AABB& aabb, unsigned int layerMask, T&& test) const
+{
+	if (l_nodes.empty()) {
+		return;
+	}
+
+	int stack[MAX_STACK];
+	int stackCount = 0;
+	stack[stackCount++] = 0;
+
+	while (stackCount > 0) {
+		int nodeId = stack[--stackCount];
+		const Node& node = l_nodes[nodeId];
+		if (!(node.layers & layerMask) || !node.bounds.Overlaps(aabb)) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (int i = node.offset; i < node.offset + node.count; i++) {
+				if (!test(l_order[i])) {
+					return;
+				}
+			}
+		}
+		else if (stackCount + 2 <= MAX_STACK) {
+			stack[stackCount++] = node.offset;
+			stack[stackCount++] = nodeId + 1;
+		}
+	}
+}
+
+bool QueryBVH::Raycast(const Ray& ray, QueryHit& outHit, const QueryFilter& filter) const
+{
+	outHit = QueryHit();
+	float length;
+	XMFLOAT3 direction = Normalize(ray.direction, length);
+	if (length <= 0.0f) {
+		return false;
+	}
+
+	float maxDistance = ray.maxDistance;
+	bool hit = false;
+	Traverse(ray.origin, direction, XMFLOAT3(0.0f, 0.0f, 0.0f), filter.layerMask, maxDistance, [&](int shapeIndex, float& segmentLength) {
+		const QueryShape& shape = l_shapes[shapeIndex];
+		float distance;
+		XMFLOAT3 normal;
+		if (PassesFilter(shape, filter) && RayOBB(shape.box, ray.origin, direction, 0.0f, segmentLength, distance, normal)) {
+			FillHit(outHit, shape, shapeIndex, distance, MulAdd(ray.origin, direction, distance), normal);
+			segmentLength = distance;
+			hit = true;
+		}
+		return true;
+	});
+	return hit;
+}
+
+bool QueryBVH::RaycastAny(const Ray& ray, const QueryFilter& filter, QueryHit* outHit) const
+{
+	float length;
+	XMFLOAT3 direction = Normalize(ray.direction, length);
+	if (length <= 0.0f) {
+		return false;
+	}
+
+	float maxDistance = ray.maxDistance;
+	bool hit = false;
+	Traverse(ray.origin, direction, XMFLOAT3(0.0f, 0.0f, 0.0f), filter.layerMask, maxDistance, [&](int shapeIndex, float& segmentLength) {
+		const QueryShape& shape = l_shapes[shapeIndex];
+		float distance;
+		XMFLOAT3 normal;
+		if (PassesFilter(shape, filter) && RayOBB(shape.box, ray.origin, direction, 0.0f, segmentLength, distance, normal)) {
+			if (outHit) {
+				FillHit(*outHit, shape, shapeIndex, distance, MulAdd(ray.origin, direction, distance), normal);
+			}
+			hit = true;
+			return false;
+		}
+		return true;
+	});
+	return hit;
+}
+
+int QueryBVH::RaycastAll(const Ray& ray, std::vector<QueryHit>& outHits, const QueryFilter& filter) const
+{
+	outHits.clear();
+	float length;
+	XMFLOAT3 direction = Normalize(ray.direction, length);
+	if (length <= 0.0f) {
+		return 0;
+	}
+
+	float maxDistance = ray.maxDistance;
+	Traverse(ray.origin, direction, XMFLOAT3(0.0f, 0.0f, 0.0f), filter.layerMask, maxDistance, [&](int shapeIndex, float& segmentLength) {
+		const QueryShape& shape = l_shapes[shapeIndex];
+		float distance;
+		XMFLOAT3 normal;
+		if (PassesFilter(shape, filter) && RayOBB(shape.box, ray.origin, direction, 0.0f, segmentLength, distance, normal)) {
+			outHits.push_back(QueryHit());
+			FillHit(outHits.back(), shape, shapeIndex, distance, MulAdd(ray.origin, direction, distance), normal);
+		}
+		return true;
+	});
+
+	//Shape index breaks ties so the order doesn't depend on how the tree was walked
+	std::sort(outHits.begin(), outHits.end(), [](const QueryHit& a, const QueryHit& b) {
+		return a.distance < b.distance || (a.distance == b.distance && a.shape < b.shape);
+	});
+	return static_cast<int>(outHits.size());
+}
+
+void QueryBVH::RaycastPacket(const Ray* rays, const int* indices, int count, eRaycastMode mode, const QueryFilter& filter, QueryHit* outHits) const
+{
+	//Lanes past count or with no direction get a negative length so no node ever lets them through
+	alignas(16) float originX[PACKET_SIZE], originY[PACKET_SIZE], originZ[PACKET_SIZE];
+	alignas(16) float inverseX[PACKET_SIZE], inverseY[PACKET_SIZE], inverseZ[PACKET_SIZE];
+	alignas(16) float maxDistance[PACKET_SIZE];
+	XMFLOAT3 directions[PACKET_SIZE];
+	int active = 0;
+
+	for (int lane = 0; lane < PACKET_SIZE; lane++) {
+		const Ray& ray = rays[indices[lane < count ? lane : 0]];
+		float length;
+		directions[lane] = Normalize(ray.direction, length);
+		originX[lane] = ray.origin.x;
+		originY[lane] = ray.origin.y;
+		originZ[lane] = ray.origin.z;
+		inverseX[lane] = SafeInverse(directions[lane].x);
+		inverseY[lane] = SafeInverse(directions[lane].y);
+		inverseZ[lane] = SafeInverse(directions[lane].z);
+		maxDistance[lane] = -1.0f;
+
+		if (lane < count) {
+			outHits[indices[lane]] = QueryHit();
+			if (length > 0.0f) {
+				maxDistance[lane] = ray.maxDistance;
+				active |= 1 << lane;
+			}
+		}
+	}
+
+	if (!active || l_nodes.empty()) {
+		return;
+	}
+
+	__m128 ox = _mm_load_ps(originX);
+	__m128 oy = _mm_load_ps(originY);
+	__m128 oz = _mm_load_ps(originZ);
+	__m128 ix = _mm_load_ps(inverseX);
+	__m128 iy = _mm_load_ps(inverseY);
+	__m128 iz = _mm_load_ps(inverseZ);
+	__m128 dx = _mm_set_ps(directions[3].x, directions[2].x, directions[1].x, directions[0].x);
+	__m128 dy = _mm_set_ps(directions[3].y, directions[2].y, directions[1].y, directions[0].y);
+	__m128 dz = _mm_set_ps(directions[3].z, directions[2].z, directions[1].z, directions[0].z);
+	__m128 zero = _mm_setzero_ps();
+
+	int stack[MAX_STACK];
+	int stackCount = 0;
+	stack[stackCount++] = 0;
+
+	while (stackCount > 0) {
+		int nodeId = stack[--stackCount];
+		const Node& node = l_nodes[nodeId];
+		if (!(node.layers & filter.layerMask)) {
+			continue;
+		}
+
+		//Slab test for all 4 rays at once, a lane is through if it gets in before it gets out
+		__m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bounds.min.x), ox), ix);
+		__m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bounds.max.x), ox), ix);
+		__m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bounds.min.y), oy), iy);
+		__m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bounds.max.y), oy), iy);
+		__m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bounds.min.z), oz), iz);
+		__m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.bounds.max.z), oz), iz);
+
+		__m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)), _mm_max_ps(_mm_min_ps(tz0, tz1), zero));
+		__m128 leave = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)), _mm_min_ps(_mm_max_ps(tz0, tz1), _mm_load_ps(maxDistance)));
+		int mask = _mm_movemask_ps(_mm_cmple_ps(enter, leave)) & active;
+		if (!mask) {
+			continue;
+		}
+
+		if (node.count == 0) {
+			//Near side for the first ray still in, the rest of the packet mostly agrees after sorting
+			int lead = 0;
+			while (!(mask & (1 << lead))) {
+				lead++;
+			}
+
+			int nearChild = nodeId + 1;
+			int farChild = node.offset;
+			if ((&directions[lead].x)[node.axis] < 0.0f) {
+				std::swap(nearChild, farChild);
+			}
+			if (stackCount + 2 <= MAX_STACK) {
+				stack[stackCount++] = farChild;
+				stack[stackCount++] = nearChild;
+			}
+			continue;
+		}
+
+		for (int i = node.offset; i < node.offset + node.count; i++) {
+			int shapeIndex = l_order[i];
+			const QueryShape& shape = l_shapes[shapeIndex];
+			if (!PassesFilter(shape, filter)) {
+				continue;
+			}
+
+			int lanes = mask & active & RayOBBMask(shape.box, ox, oy, oz, dx, dy, dz, _mm_load_ps(maxDistance));
+			for (int lane = 0; lane < PACKET_SIZE; lane++) {
+				if (!(lanes & (1 << lane))) {
+					continue;
+				}
+
+				XMFLOAT3 origin = XMFLOAT3(originX[lane], originY[lane], originZ[lane]);
+				float distance;
+				XMFLOAT3 normal;
+				if (!RayOBB(shape.box, origin, directions[lane], 0.0f, maxDistance[lane], distance, normal)) {
+					continue;
+				}
+
+				FillHit(outHits[indices[lane]], shape, shapeIndex, distance, MulAdd(origin, directions[lane], distance), normal);
+				if (mode == RAYCAST_ANY) {
+					//Done with this ray, parking its length below 0 drops it from every node test
+					maxDistance[lane] = -1.0f;
+					active &= ~(1 << lane);
+				}
+				else {
+					maxDistance[lane] = distance;
+				}
+			}
+		}
+
+		if (!active) {
+			return;
+		}
+	}
+}
+
+void QueryBVH::RaycastBatch(const Ray* rays, int count, QueryHit* outHits, eRaycastMode mode, const QueryFilter& filter) const
+{
+	if (count <= 0) {
+		return;
+	}
+
+	//Sort by which octant each ray heads into and then by where it starts along a Morton curve, so
+	//rays sharing a packet go through mostly the same nodes. Ties keep the order they came in, which
+	//for things like a grid of picking rays is already coherent
+	AABB originBounds = AABB(rays[0].origin, rays[0].origin);
+	for (int i = 1; i < count; i++) {
+		originBounds = AABB::Union(originBounds, AABB(rays[i].origin, rays[i].origin));
+	}
+	XMFLOAT3 size = Sub(originBounds.max, originBounds.min);
+	const float cells = static_cast<float>((1 << MORTON_BITS) - 1);
+	XMFLOAT3 scale = XMFLOAT3(
+		size.x > 0.0f ? cells / size.x : 0.0f,
+		size.y > 0.0f ? cells / size.y : 0.0f,
+		size.z > 0.0f ? cells / size.z : 0.0f);
+
+	std::vector<unsigned long long> keys(count);
+	for (int i = 0; i < count; i++) {
+		const Ray& ray = rays[i];
+		unsigned int octant = (ray.direction.x < 0.0f ? 1 : 0) | (ray.direction.y < 0.0f ? 2 : 0) | (ray.direction.z < 0.0f ? 4 : 0);
+		unsigned int morton =
+			SpreadBits(static_cast<unsigned int>((ray.origin.x - originBounds.min.x) * scale.x)) |
+			(SpreadBits(static_cast<unsigned int>((ray.origin.y - originBounds.min.y) * scale.y)) << 1) |
+			(SpreadBits(static_cast<unsigned int>((ray.origin.z - originBounds.min.z) * scale.z)) << 2);
+		unsigned long long key = (static_cast<unsigned long long>(octant) << (3 * MORTON_BITS)) | morton;
+		keys[i] = (key << 32) | static_cast<unsigned int>(i);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	std::vector<int> order(count);
+	for (int i = 0; i < count; i++) {
+		order[i] = static_cast<int>(keys[i] & 0xffffffffu);
+	}
+
+	//Each packet only writes its own rays' hits
+	int numPackets = (count + PACKET_SIZE - 1) / PACKET_SIZE;
+	JobSystem::GetInstance()->ParallelFor(numPackets, PACKETS_PER_JOB, [&](int begin, int end) {
+		for (int packet = begin; packet < end; packet++) {
+			int first = packet * PACKET_SIZE;
+			RaycastPacket(rays, &order[first], std::min(PACKET_SIZE, count - first), mode, filter, outHits);
+		}
+	});
+}
+
+void QueryBVH::RaycastBatchScalar(const Ray* rays, int count, QueryHit* outHits, eRaycastMode mode, const QueryFilter& filter) const
+{
+	for (int i = 0; i < count; i++) {
+		if (mode == RAYCAST_ANY) {
+			outHits[i] = QueryHit();
+			RaycastAny(rays[i], filter, &outHits[i]);
+		}
+		else {
+			Raycast(rays[i], outHits[i], filter);
+		}
+	}
+}
+
+bool QueryBVH::SweepSphere(const XMFLOAT3& center, float radius, const XMFLOAT3& direction, float maxDistance, QueryHit& outHit, const QueryFilter& filter) const
+{
+	outHit = QueryHit();
+	float length;
+	XMFLOAT3 unitDirection = Normalize(direction, length);
+	if (length <= 0.0f) {
+		//Not going anywhere, only something it's already touching counts
+		unitDirection = XMFLOAT3(0.0f, 0.0f, 1.0f);
+		maxDistance = 0.0f;
+	}
+
+	bool hit = false;
+	Traverse(center, unitDirection, XMFLOAT3(radius, radius, radius), filter.layerMask, maxDistance, [&](int shapeIndex, float& segmentLength) {
+		const QueryShape& shape = l_shapes[shapeIndex];
+		float distance;
+		XMFLOAT3 point;
+		XMFLOAT3 normal;
+		if (PassesFilter(shape, filter) && SweepSphereOBB(shape.box, center, radius, unitDirection, segmentLength, distance, point, normal)) {
+			FillHit(outHit, shape, shapeIndex, distance, point, normal);
+			segmentLength = distance;
+			hit = true;
+		}
+		return true;
+	});
+	return hit;
+}
+
+bool QueryBVH::SweepBox(const OBB& box, const XMFLOAT3& direction, float maxDistance, QueryHit& outHit, const QueryFilter& filter) const
+{
+	outHit = QueryHit();
+	float length;
+	XMFLOAT3 unitDirection = Normalize(direction, length);
+	if (length <= 0.0f) {
+		unitDirection = XMFLOAT3(0.0f, 0.0f, 1.0f);
+		maxDistance = 0.0f;
+	}
+
+	bool hit = false;
+	Traverse(box.center, unitDirection, OBBExtents(box), filter.layerMask, maxDistance, [&](int shapeIndex, float& segmentLength) {
+		const QueryShape& shape = l_shapes[shapeIndex];
+		if (!PassesFilter(shape, filter)) {
+			return true;
+		}
+
+		float time;
+		XMFLOAT3 normal;
+		XMFLOAT3 displacement = XMFLOAT3(unitDirection.x * segmentLength, unitDirection.y * segmentLength, unitDirection.z * segmentLength);
+		if (!OBB::Sweep(box, shape.box, displacement, time, &normal)) {
+			return true;
+		}
+
+		//The moving box's corner furthest along -normal is on the plane they meet on
+		float distance = time * segmentLength;
+		XMFLOAT3 point = MulAdd(box.center, unitDirection, distance);
+		for (int i = 0; i < 3; i++) {
+			point = MulAdd(point, box.axes[i], Dot(box.axes[i], normal) > 0.0f ? -box.halfExtents[i] : box.halfExtents[i]);
+		}
+
+		FillHit(outHit, shape, shapeIndex, distance, point, normal);
+		segmentLength = distance;
+		hit = true;
+		return true;
+	});
+	return hit;
+}
+
+int QueryBVH::OverlapSphere(const XMFLOAT3& center, float radius, std::vector<int>& outShapes, const QueryFilter& filter) const
+{
+	outShapes.clear();
+	AABB aabb = AABB(
+		XMFLOAT3(center.x - radius, center.y - radius, center.z - radius),
+		XMFLOAT3(center.x + radius, center.y + radius, center.z + radius));
+
+	TraverseAABB(aabb, filter.layerMask, [&](int shapeIndex) {
+		const QueryShape& shape = l_shapes[shapeIndex];
+		if (PassesFilter(shape, filter)) {
+			XMFLOAT3 gap = Sub(center, ClosestPointOnOBB(shape.box, center));
+			if (Dot(gap, gap) <= radius * radius) {
+				outShapes.push_back(shapeIndex);
+			}
+		}
+		return true;
+	});
+	return static_cast<int>(outShapes.size());
+}
+
+int QueryBVH::OverlapBox(const OBB& box, std::vector<int>& outShapes, const QueryFilter& filter) const
+{
+	outShapes.clear();
+	XMFLOAT3 extents = OBBExtents(box);
+	AABB aabb = AABB(Sub(box.center, extents), MulAdd(box.center, extents, 1.0f));
+
+	TraverseAABB(aabb, filter.layerMask, [&](int shapeIndex) {
+		const QueryShape& shape = l_shapes[shapeIndex];
+		if (PassesFilter(shape, filter) && OBB::TestSAT(box, shape.box) == SAT_NONE) {
+			outShapes.push_back(shapeIndex);
+		}
+		return true;
+	});
+	return static_cast<int>(outShapes.size());
+}
+
+int QueryBVH::OverlapAABB(const AABB& aabb, std::vector<int>& outShapes, const QueryFilter& filter) const
+{
+	outShapes.clear();
+	TraverseAABB(aabb, filter.layerMask, [&](int shapeIndex) {
+		const QueryShape& shape = l_shapes[shapeIndex];
+		if (PassesFilter(shape, filter) && shape.bounds.Overlaps(aabb)) {
+			outShapes.push_back(shapeIndex);
+		}
+		return true;
+	});
+	return static_cast<int>(outShapes.size());
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include "AABB.h"
+#include "OBB.h"
+
+#include <DirectXMath.h>
+#include <vector>
+
+class Collider;
+
+//Line to test against the scene, hits further than maxDistance are ignored
+struct Ray
+{
+	DirectX::XMFLOAT3 origin;
+	//Doesn't need to be unit length, distances always come back in world units
+	DirectX::XMFLOAT3 direction;
+	float maxDistance;
+
+	Ray()
+		: origin(0.0f, 0.0f, 0.0f),
+		direction(0.0f, 0.0f, 1.0f),
+		maxDistance(1000.0f)
+	{
+	}
+
+	Ray(DirectX::XMFLOAT3 in_origin, DirectX::XMFLOAT3 in_direction, float in_maxDistance)
+		: origin(in_origin),
+		direction(in_direction),
+		maxDistance(in_maxDistance)
+	{
+	}
+};
+
+//Where a ray or sweep first touched a shape. collider is null for a miss
+struct QueryHit
+{
+	Collider* collider;
+	//Index of the shape in the tree, -1 for a miss
+	int shape;
+	//How far along the ray or sweep direction
+	float distance;
+	DirectX::XMFLOAT3 point;
+	//Surface normal of the shape that was hit, facing back at whatever hit it
+	DirectX::XMFLOAT3 normal;
+
+	QueryHit()
+		: collider(nullptr),
+		shape(-1),
+		distance(0.0f),
+		point(0.0f, 0.0f, 0.0f),
+		normal(0.0f, 0.0f, 0.0f)
+	{
+	}
+};
+
+//Which shapes a query can see. A shape is skipped if its layer bit isn't in layerMask, if it
+//belongs to ignore (usually whoever is asking, so a ray from inside its own box doesn't hit it)
+//or if it's a trigger and triggers weren't asked for
+struct QueryFilter
+{
+	unsigned int layerMask;
+	const Collider* ignore;
+	bool includeTriggers;
+
+	QueryFilter(unsigned int in_layerMask = 0xffffffffu, const Collider* in_ignore = nullptr, bool in_includeTriggers = false)
+		: layerMask(in_layerMask),
+		ignore(in_ignore),
+		includeTriggers(in_includeTriggers)
+	{
+	}
+};
+
+enum eRaycastMode
+{
+	//Nearest hit along each ray
+	RAYCAST_CLOSEST = 0,
+	//Stops at the first hit found, for line of sight checks. Not necessarily the nearest
+	RAYCAST_ANY,
+};
+
+//One thing the tree can be queried for, the box is what rays and sweeps are tested against
+struct QueryShape
+{
+	OBB box;
+	AABB bounds;
+	unsigned int layerBit;
+	//Invisible to queries unless the filter includes triggers
+	bool trigger;
+	//Owner handed back in hits, can be null for shapes that aren't colliders
+	Collider* collider;
+};
+
+//Bounding volume hierarchy built just for scene queries, kept apart from the collision manager's
+//broadphase so queries don't depend on which broadphase is picked or on its padded boxes.
+//Nodes are stored flat in depth first order with the first child right after its parent, so a
+//refit is one backwards pass over the array. Moving shapes only refits the boxes, the tree is
+//rebuilt from scratch once refitting has made it noticeably worse than it was when built, or
+//when shapes are added or removed.
+//Shapes are tested as their oriented boxes, the same boxes SAT uses. Batched raycasts walk the
+//tree with packets of 4 rays at once, testing each node against the whole packet with SSE,
+//after sorting the rays so the ones in a packet start near each other and head the same way
+class QueryBVH
+{
+private:
+	//Most shapes in one leaf
+	static const int MAX_LEAF_SHAPES = 4;
+	//Deepest traversal stack needed, the build always splits at the median so depth is log2 of the leaf count
+	static const int MAX_STACK = 64;
+
+	struct Node
+	{
+		AABB bounds;
+		//Second child for internal nodes (the first is the next node), first entry in l_order for leaves
+		int offset;
+		//0 for internal nodes
+		int count;
+		//Axis the children were split on, the side a ray is heading towards is visited second
+		int axis;
+		//Every layer bit of the shapes under it, so filtered queries can skip whole subtrees
+		unsigned int layers;
+	};
+
+	std::vector<QueryShape> l_shapes;
+	std::vector<Node> l_nodes;
+	//Shape indices grouped by leaf
+	std::vector<int> l_order;
+	//Scratch for the build
+	std::vector<DirectX::XMFLOAT3> l_centroids;
+
+	//Summed node surface area when the tree was last built, refits compare against it
+	float m_builtCost;
+	//How much worse refitting can make the tree before it gets rebuilt
+	float m_rebuildRatio;
+	bool m_needsBuild;
+	int m_numBuilds;
+	int m_numRefits;
+
+	int BuildNode(int begin, int end);
+
+	bool PassesFilter(const QueryShape& shape, const QueryFilter& filter) const
+	{
+		return (shape.layerBit & filter.layerMask) != 0 && (!filter.ignore || shape.collider != filter.ignore) && (filter.includeTriggers || !shape.trigger);
+	}
+
+	//Walks every leaf with shapes on layerMask that a (possibly fattened) ray segment could reach, nearest
+	//side first. test(shape, maxDistance) can shorten maxDistance and returns false to stop
+	template<typename T>
+	void Traverse(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, const DirectX::XMFLOAT3& extents, unsigned int layerMask, float& maxDistance, T&& test) const;
+	//Calls test(shape) for every shape in a leaf with shapes on layerMask whose bounds overlap aabb, returning false stops early
+	template<typename T>
+	void TraverseAABB(const AABB& aabb, unsigned int layerMask, T&& test) const;
+
+	//Runs one packet of up to 4 rays, indices point into rays/outHits
+	void RaycastPacket(const Ray* rays, const int* indices, int count, eRaycastMode mode, const QueryFilter& filter, QueryHit* outHits) const;
+
+public:
+	QueryBVH();
+	~QueryBVH();
+
+	//Changing the count means a full rebuild on the next Update, changing shapes in place only a refit
+	void Resize(int count);
+	QueryShape& GetShape(int index) { return l_shapes[index]; }
+	const QueryShape& GetShape(int index) const { return l_shapes[index]; }
+	int NumShapes() const { return static_cast<int>(l_shapes.size()); }
+
+	//Refits to the shapes' current bounds, or rebuilds if the tree needs it. Call after moving shapes
+	//and before querying, queries themselves never change the tree so they can run from several threads
+	void Update();
+	void Rebuild();
+
+	bool Raycast(const Ray& ray, QueryHit& outHit, const QueryFilter& filter = QueryFilter()) const;
+	//outHit gets whichever hit ended the search when given
+	bool RaycastAny(const Ray& ray, const QueryFilter& filter = QueryFilter(), QueryHit* outHit = nullptr) const;
+	//Every hit along the ray, nearest first. Returns how many were found
+	int RaycastAll(const Ray& ray, std::vector<QueryHit>& outHits, const QueryFilter& filter = QueryFilter()) const;
+
+	//outHits needs room for count hits, misses have a null collider and shape -1. Rays are sorted into
+	//packets and the packets are shared out across the job system
+	void RaycastBatch(const Ray* rays, int count, QueryHit* outHits, eRaycastMode mode = RAYCAST_CLOSEST, const QueryFilter& filter = QueryFilter()) const;
+	//Same results one ray at a time through Raycast, for checking and timing against
+	void RaycastBatchScalar(const Ray* rays, int count, QueryHit* outHits, eRaycastMode mode = RAYCAST_CLOSEST, const QueryFilter& filter = QueryFilter()) const;
+
+	//First shape a sphere or box touches moving along direction. A shape it already overlaps is hit at 0
+	bool SweepSphere(const DirectX::XMFLOAT3& center, float radius, const DirectX::XMFLOAT3& direction, float maxDistance, QueryHit& outHit, const QueryFilter& filter = QueryFilter()) const;
+	bool SweepBox(const OBB& box, const DirectX::XMFLOAT3& direction, float maxDistance, QueryHit& outHit, const QueryFilter& filter = QueryFilter()) const;
+
+	//Shape indices overlapping the volume, outShapes is cleared first. Returns how many were found
+	int OverlapSphere(const DirectX::XMFLOAT3& center, float radius, std::vector<int>& outShapes, const QueryFilter& filter = QueryFilter()) const;
+	int OverlapBox(const OBB& box, std::vector<int>& outShapes, const QueryFilter& filter = QueryFilter()) const;
+	int OverlapAABB(const AABB& aabb, std::vector<int>& outShapes, const QueryFilter& filter = QueryFilter()) const;
+
+	void SetRebuildRatio(float rebuildRatio) { m_rebuildRatio = rebuildRatio; }
+	float GetRebuildRatio() const { return m_rebuildRatio; }
+
+	int NumNodes() const { return static_cast<int>(l_nodes.size()); }
+	//How often Update has rebuilt and refit the tree, for stats
+	int NumBuilds() const { return m_numBuilds; }
+	int NumRefits() const { return m_numRefits; }
+};
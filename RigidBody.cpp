@@ -1,30 +1,342 @@
 #include "RigidBody.h"
+#include "Collider.h"
+#include "PhysicsWorld.h"
 
 using namespace DirectX;
 
-RigidBody::RigidBody(Transform* parentTransform)
+namespace
+{
+	bool SameFloat3(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	bool SameFloat4(const XMFLOAT4& a, const XMFLOAT4& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+	}
+}
+
+RigidBody::RigidBody(Transform* parentTransform, Collider* collider)
 	: m_transform(parentTransform),
+	m_collider(nullptr),
+	m_bodyId(-1),
+	m_mass(0.0f),
+	m_friction(RigidBodyArrays::DEFAULT_FRICTION),
+	m_restitution(0.0f),
+	m_hasGravity(true),
+	m_ccdSpeed(0.0f),
 	m_velocity(XMFLOAT3(0.0f, 0.0f, 0.0f)),
-	m_acceleration(XMFLOAT3(0.0f, 0.0f, 0.0f)),
-	m_hasGravity(false)
+	m_angularVelocity(XMFLOAT3(0.0f, 0.0f, 0.0f)),
+	m_centerOfMassOffset(XMFLOAT3(0.0f, 0.0f, 0.0f)),
+	m_syncedPosition(XMFLOAT3(0.0f, 0.0f, 0.0f)),
+	m_syncedRotation(XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f)),
+	m_syncedScale(XMFLOAT3(0.0f, 0.0f, 0.0f)),
+	m_hasRenderPose(false)
 {
+	SetCollider(collider);
 }
 
 RigidBody::~RigidBody()
 {
 }
 
-void RigidBody::UpdateTransform(float dt) 
+void RigidBody::SetCollider(Collider* collider)
 {
-	XMVECTOR velocity = XMLoadFloat3(&m_velocity);
-	velocity += dt * XMLoadFloat3(&m_acceleration);
+	if (m_collider) {
+		m_collider->SetBodyId(-1);
+	}
 
-	XMStoreFloat3(&m_velocity, velocity);
+	m_collider = collider;
+	if (m_collider) {
+		m_collider->SetBodyId(m_bodyId);
+	}
 
-	if (m_hasGravity)
-	{
-		m_velocity.y += GRAVITY * dt;
+	UpdateMassProperties();
+}
+
+void RigidBody::SetBodyId(int bodyId)
+{
+	m_bodyId = bodyId;
+	if (m_collider) {
+		m_collider->SetBodyId(bodyId);
+	}
+}
+
+void RigidBody::SetMass(float mass)
+{
+	m_mass = mass > 0.0f ? mass : 0.0f;
+	UpdateMassProperties();
+}
+
+void RigidBody::SetFriction(float friction)
+{
+	m_friction = friction;
+	if (m_bodyId >= 0) {
+		PhysicsWorld::GetInstance()->GetBodies().SetFriction(m_bodyId, friction);
+	}
+}
+
+void RigidBody::SetRestitution(float restitution)
+{
+	m_restitution = restitution;
+	if (m_bodyId >= 0) {
+		PhysicsWorld::GetInstance()->GetBodies().SetRestitution(m_bodyId, restitution);
+	}
+}
+
+void RigidBody::SetContinuousCollision(float speed)
+{
+	m_ccdSpeed = speed > 0.0f ? speed : 0.0f;
+	if (m_bodyId >= 0) {
+		PhysicsWorld::GetInstance()->GetBodies().SetCCDSpeed(m_bodyId, m_ccdSpeed);
+	}
+}
+
+void RigidBody::SetHasGravity(bool hasGravity)
+{
+	m_hasGravity = hasGravity;
+	if (m_bodyId >= 0) {
+		PhysicsWorld::GetInstance()->GetBodies().SetGravityScale(m_bodyId, hasGravity ? 1.0f : 0.0f);
+	}
+}
+
+XMFLOAT3 RigidBody::GetVelocity() const
+{
+	if (m_bodyId < 0) {
+		return m_velocity;
+	}
+
+	return PhysicsWorld::GetInstance()->GetBodies().GetVelocity(m_bodyId);
+}
+
+void RigidBody::SetVelocity(const XMFLOAT3& velocity)
+{
+	m_velocity = velocity;
+	if (m_bodyId >= 0) {
+		PhysicsWorld::GetInstance()->WakeBody(m_bodyId);
+		PhysicsWorld::GetInstance()->GetBodies().SetVelocity(m_bodyId, velocity);
+	}
+}
+
+XMFLOAT3 RigidBody::GetAngularVelocity() const
+{
+	if (m_bodyId < 0) {
+		return m_angularVelocity;
+	}
+
+	return PhysicsWorld::GetInstance()->GetBodies().GetAngularVelocity(m_bodyId);
+}
+
+void RigidBody::SetAngularVelocity(const XMFLOAT3& angularVelocity)
+{
+	m_angularVelocity = angularVelocity;
+	if (m_bodyId >= 0) {
+		PhysicsWorld::GetInstance()->WakeBody(m_bodyId);
+		PhysicsWorld::GetInstance()->GetBodies().SetAngularVelocity(m_bodyId, angularVelocity);
+	}
+}
+
+void RigidBody::AddForce(const XMFLOAT3& force)
+{
+	if (m_bodyId >= 0) {
+		PhysicsWorld::GetInstance()->WakeBody(m_bodyId);
+		PhysicsWorld::GetInstance()->GetBodies().AddForce(m_bodyId, force);
+	}
+}
+
+void RigidBody::AddTorque(const XMFLOAT3& torque)
+{
+	if (m_bodyId >= 0) {
+		PhysicsWorld::GetInstance()->WakeBody(m_bodyId);
+		PhysicsWorld::GetInstance()->GetBodies().AddTorque(m_bodyId, torque);
+	}
+}
+
+void RigidBody::ApplyImpulse(const XMFLOAT3& impulse, const XMFLOAT3& worldPoint)
+{
+	if (m_bodyId >= 0) {
+		PhysicsWorld::GetInstance()->WakeBody(m_bodyId);
+		PhysicsWorld::GetInstance()->GetBodies().ApplyImpulse(m_bodyId, impulse, worldPoint);
+	}
+}
+
+void RigidBody::UpdateMassProperties()
+{
+	if (m_bodyId < 0) {
+		return;
+	}
+
+	XMFLOAT4 rotation = m_transform->GetRotationQuat();
+	XMVECTOR orientation = XMLoadFloat4(&rotation);
+
+	float halfExtents[3];
+	if (m_collider) {
+		m_collider->UpdateBounds();
+		const OBB& box = m_collider->GetWorldOBB();
+		for (int i = 0; i < 3; i++) {
+			halfExtents[i] = box.halfExtents[i];
+		}
+
+		//The box's axes follow the transform's rotation, so its centre only has to be turned back into body space
+		XMFLOAT3 position = m_transform->GetPosition();
+		XMVECTOR offset = XMLoadFloat3(&box.center) - XMLoadFloat3(&position);
+		XMStoreFloat3(&m_centerOfMassOffset, XMVector3InverseRotate(offset, orientation));
+	}
+	else {
+		//No shape to go on, treat it as a unit cube
+		XMFLOAT3 scale = m_transform->GetScale();
+		halfExtents[0] = 0.5f * scale.x;
+		halfExtents[1] = 0.5f * scale.y;
+		halfExtents[2] = 0.5f * scale.z;
+		m_centerOfMassOffset = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	}
+
+	RigidBodyArrays& bodies = PhysicsWorld::GetInstance()->GetBodies();
+	bodies.SetBoxMass(m_bodyId, m_mass, halfExtents);
+	bodies.SetFriction(m_bodyId, m_friction);
+	bodies.SetRestitution(m_bodyId, m_restitution);
+	bodies.SetCCDSpeed(m_bodyId, m_ccdSpeed);
+	bodies.SetGravityScale(m_bodyId, m_hasGravity ? 1.0f : 0.0f);
+	//Whatever it's resting on may not hold it any more
+	bodies.SetAwake(m_bodyId, true);
+
+	//The centre of mass may have moved
+	ReadTransform(true);
+}
+
+bool RigidBody::ReadTransform(bool force)
+{
+	if (m_bodyId < 0) {
+		return false;
+	}
+
+	XMFLOAT3 position = m_transform->GetPosition();
+	XMFLOAT4 rotation = m_transform->GetRotationQuat();
+	XMFLOAT3 scale = m_transform->GetScale();
+	if (!force && SameFloat3(position, m_syncedPosition) && SameFloat4(rotation, m_syncedRotation) && SameFloat3(scale, m_syncedScale)) {
+		return false;
+	}
+
+	bool rescaled = !SameFloat3(scale, m_syncedScale);
+	m_syncedPosition = position;
+	m_syncedRotation = rotation;
+	m_syncedScale = scale;
+
+	if (rescaled && !force) {
+		//Calls back in here with force once the new offset is known
+		UpdateMassProperties();
+		return true;
+	}
+
+	XMVECTOR center = XMLoadFloat3(&position) + XMVector3Rotate(XMLoadFloat3(&m_centerOfMassOffset), XMLoadFloat4(&rotation));
+
+	XMFLOAT3 centerOfMass;
+	XMStoreFloat3(&centerOfMass, center);
+	PhysicsWorld::GetInstance()->GetBodies().SetPose(m_bodyId, centerOfMass, rotation);
+	return true;
+}
+
+void RigidBody::WriteTransform()
+{
+	//Bodies under another transform would need their pose turned into the parent's space, they're left where they are
+	if (m_bodyId < 0 || m_transform->GetParent()) {
+		return;
+	}
+
+	RigidBodyArrays& bodies = PhysicsWorld::GetInstance()->GetBodies();
+	XMFLOAT3 velocity = bodies.GetVelocity(m_bodyId);
+	XMFLOAT3 angularVelocity = bodies.GetAngularVelocity(m_bodyId);
+	XMFLOAT3 zero = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	//Nothing moved it (static or asleep), don't dirty the transform and everything under it
+	if (!bodies.IsSimulated(m_bodyId) && SameFloat3(velocity, zero) && SameFloat3(angularVelocity, zero)) {
+		return;
 	}
 
-	m_transform->MoveRelative(dt * m_velocity.x, dt * m_velocity.y, dt * m_velocity.z);
-}
\ No newline at end of file
+	XMFLOAT3 centerOfMass = bodies.GetPosition(m_bodyId);
+	XMFLOAT4 orientationQuat = bodies.GetOrientation(m_bodyId);
+	XMVECTOR orientation = XMLoadFloat4(&orientationQuat);
+
+	XMFLOAT3 position;
+	XMStoreFloat3(&position, XMLoadFloat3(&centerOfMass) - XMVector3Rotate(XMLoadFloat3(&m_centerOfMassOffset), orientation));
+	m_transform->SetPosition(position);
+	m_transform->SetRotationQuat(orientationQuat);
+
+	m_syncedPosition = m_transform->GetPosition();
+	m_syncedRotation = m_transform->GetRotationQuat();
+	m_syncedScale = m_transform->GetScale();
+}
+
+void RigidBody::RestoreTransform(const XMFLOAT3& position, const XMFLOAT4& rotation, const XMFLOAT3& scale)
+{
+	bool rescaled = !SameFloat3(scale, m_syncedScale);
+	m_transform->SetPosition(position);
+	m_transform->SetRotationQuat(rotation);
+	m_transform->SetScale(scale);
+
+	m_syncedPosition = position;
+	m_syncedRotation = rotation;
+	m_syncedScale = scale;
+
+	//Centre of mass offset goes with the scale. This also pushes mass into the arrays, which the restore then overwrites
+	if (rescaled) {
+		UpdateMassProperties();
+	}
+}
+
+void RigidBody::UpdateRenderPose(float alpha)
+{
+	m_hasRenderPose = false;
+	//Same bodies WriteTransform leaves alone
+	if (m_bodyId < 0 || m_transform->GetParent()) {
+		return;
+	}
+
+	RigidBodyArrays& bodies = PhysicsWorld::GetInstance()->GetBodies();
+	XMFLOAT3 velocity = bodies.GetVelocity(m_bodyId);
+	XMFLOAT3 angularVelocity = bodies.GetAngularVelocity(m_bodyId);
+	XMFLOAT3 zero = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	if (!bodies.IsSimulated(m_bodyId) && SameFloat3(velocity, zero) && SameFloat3(angularVelocity, zero)) {
+		return;
+	}
+
+	XMFLOAT3 centerOfMass;
+	XMFLOAT4 orientationQuat;
+	bodies.GetInterpolatedPose(m_bodyId, alpha, centerOfMass, orientationQuat);
+	XMVECTOR orientation = XMLoadFloat4(&orientationQuat);
+	XMVECTOR position = XMLoadFloat3(&centerOfMass) - XMVector3Rotate(XMLoadFloat3(&m_centerOfMassOffset), orientation);
+
+	//Same order as Transform, scale then rotate then move
+	XMMATRIX rotation = XMMatrixRotationQuaternion(orientation);
+	XMMATRIX world = XMMatrixScaling(m_syncedScale.x, m_syncedScale.y, m_syncedScale.z) * rotation *
+		XMMatrixTranslationFromVector(position);
+	//The inverse transpose of a scale then rotate is one over the scale then the same rotation. A flattened
+	//axis gets 0 like Transform gives it, rather than filling the normals with infinities
+	const float* scale = &m_syncedScale.x;
+	float invScale[3];
+	for (int i = 0; i < 3; i++) {
+		invScale[i] = scale[i] != 0.0f ? 1.0f / scale[i] : 0.0f;
+	}
+	XMMATRIX invTranspose = XMMatrixScaling(invScale[0], invScale[1], invScale[2]) * rotation;
+	XMStoreFloat3x4(&m_renderWorldMatrix, world);
+	XMStoreFloat3x4(&m_renderWorldInverseTranspose, invTranspose);
+	m_hasRenderPose = true;
+}
+
+bool RigidBody::GetRenderMatrices(XMFLOAT3X4& outWorld, XMFLOAT3X4& outWorldInverseTranspose) const
+{
+	if (!m_hasRenderPose) {
+		return false;
+	}
+
+	//Moved by hand after the physics update, show where it was put
+	if (!SameFloat3(m_transform->GetPosition(), m_syncedPosition) ||
+		!SameFloat4(m_transform->GetRotationQuat(), m_syncedRotation) ||
+		!SameFloat3(m_transform->GetScale(), m_syncedScale)) {
+		return false;
+	}
+
+	outWorld = m_renderWorldMatrix;
+	outWorldInverseTranspose = m_renderWorldInverseTranspose;
+	return true;
+}
@@ -3,23 +3,104 @@
 
 #include <memory>
 
+class Collider;
+
+//Handle to one body in the physics world. The actual state (velocity, mass, inertia...)
+//lives in the world's arrays while the body is added, before that the values set here
+//are kept and handed over when it's added. Mass 0 means static, which is the default so
+//nothing falls over until it's given a mass. Mass and inertia come from the collider's
+//oriented box, and the centre of mass is that box's centre
 class RigidBody
 {
 private:
-	const float GRAVITY = 10.0f;
+	Transform* m_transform;
+	Collider* m_collider;
+
+	//Index of this body in the physics world's arrays, -1 if not added
+	int m_bodyId;
+
+	float m_mass;
+	float m_friction;
+	float m_restitution;
+	bool m_hasGravity;
+	//0 means no continuous collision
+	float m_ccdSpeed;
 
+	//Only used while the body isn't in the world
 	DirectX::XMFLOAT3 m_velocity;
-	DirectX::XMFLOAT3 m_acceleration;
+	DirectX::XMFLOAT3 m_angularVelocity;
 
-	Transform* m_transform;
+	//Centre of mass relative to the transform's position, along the body's own (rotated) axes
+	DirectX::XMFLOAT3 m_centerOfMassOffset;
 
-	bool m_hasGravity;
+	//What the transform looked like the last time the world read or wrote it,
+	//anything different at the start of a step means it was moved by hand
+	DirectX::XMFLOAT3 m_syncedPosition;
+	DirectX::XMFLOAT4 m_syncedRotation;
+	DirectX::XMFLOAT3 m_syncedScale;
+
+	//Pose blended between the last two fixed steps, only valid while the transform hasn't been touched since
+	bool m_hasRenderPose;
+	DirectX::XMFLOAT3X4 m_renderWorldMatrix;
+	DirectX::XMFLOAT3X4 m_renderWorldInverseTranspose;
 
 public:
-	RigidBody(Transform* parentTransform);
+	RigidBody(Transform* parentTransform, Collider* collider = nullptr);
 	~RigidBody();
 
-	void ToggleGravity() { m_hasGravity = !m_hasGravity; }
-	void UpdateTransform(float dt);
-};
+	Transform* GetTransform() const { return m_transform; }
+	Collider* GetCollider() const { return m_collider; }
+	//Shape used for mass and inertia, contacts on it are pushed onto this body
+	void SetCollider(Collider* collider);
 
+	int GetBodyId() const { return m_bodyId; }
+	void SetBodyId(int bodyId);
+
+	//0 makes the body static
+	void SetMass(float mass);
+	float GetMass() const { return m_mass; }
+	bool IsStatic() const { return m_mass <= 0.0f; }
+
+	void SetFriction(float friction);
+	float GetFriction() const { return m_friction; }
+	//Bounciness from 0 to 1, a contact uses the bouncier of its two bodies
+	void SetRestitution(float restitution);
+	float GetRestitution() const { return m_restitution; }
+
+	//Sweeps the body against the scene on any step it moves faster than speed, so it can't pass
+	//through thin things. Costs a broadphase query and a sweep per nearby collider, 0 turns it off
+	void SetContinuousCollision(float speed);
+	float GetContinuousCollisionSpeed() const { return m_ccdSpeed; }
+
+	void ToggleGravity() { SetHasGravity(!m_hasGravity); }
+	void SetHasGravity(bool hasGravity);
+	bool HasGravity() const { return m_hasGravity; }
+
+	DirectX::XMFLOAT3 GetVelocity() const;
+	void SetVelocity(const DirectX::XMFLOAT3& velocity);
+	DirectX::XMFLOAT3 GetAngularVelocity() const;
+	void SetAngularVelocity(const DirectX::XMFLOAT3& angularVelocity);
+
+	//Forces and torques only last until the next step. Anything that changes the motion wakes the body up
+	void AddForce(const DirectX::XMFLOAT3& force);
+	void AddTorque(const DirectX::XMFLOAT3& torque);
+	void ApplyImpulse(const DirectX::XMFLOAT3& impulse, const DirectX::XMFLOAT3& worldPoint);
+
+	//Copies the transform into the world's arrays if it was changed outside the physics step,
+	//returns true if it was. A new scale also means a new mass distribution so the inertia is worked out again
+	bool ReadTransform(bool force = false);
+	//Writes the world's position and orientation back to the transform
+	void WriteTransform();
+	//Puts the transform back exactly as it was without it counting as moved by hand. Used when the
+	//world restores a snapshot
+	void RestoreTransform(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT4& rotation, const DirectX::XMFLOAT3& scale);
+	//Pushes mass, inertia, friction and gravity into the world's arrays
+	void UpdateMassProperties();
+
+	//Builds the world matrices to draw with this frame, alpha is how far between the previous and current step
+	void UpdateRenderPose(float alpha);
+	//False if the transform's own matrices should be used instead (not simulated, parented, or moved by hand since)
+	bool GetRenderMatrices(DirectX::XMFLOAT3X4& outWorld, DirectX::XMFLOAT3X4& outWorldInverseTranspose) const;
+	//Whether the last UpdateRenderPose built a blended pose, those change every frame
+	bool HasRenderPose() const { return m_hasRenderPose; }
+};
@@ -0,0 +1,375 @@
+#include "RigidBodyArrays.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	//Position then orientation, laid out the same way for the current and previous pose
+	const int POSE_COMPONENT_COUNT = BODY_ORIENTATION_W - BODY_POSITION_X + 1;
+}
+
+const float RigidBodyArrays::DEFAULT_FRICTION = 0.5f;
+
+RigidBodyArrays::RigidBodyArrays()
+{
+	Clear();
+}
+
+RigidBodyArrays::~RigidBodyArrays()
+{
+}
+
+int RigidBodyArrays::Add()
+{
+	int index = Size();
+	for (int c = 0; c < BODY_COMPONENT_COUNT; c++) {
+		l_components[c].push_back(0.0f);
+	}
+
+	//Everything else starts at zero, which is already a static body with no velocity
+	l_components[BODY_ORIENTATION_W][index] = 1.0f;
+	l_components[BODY_PREVIOUS_ORIENTATION_W][index] = 1.0f;
+	l_components[BODY_GRAVITY_SCALE][index] = 1.0f;
+	l_components[BODY_FRICTION][index] = DEFAULT_FRICTION;
+	l_components[BODY_AWAKE][index] = 1.0f;
+	return index;
+}
+
+void RigidBodyArrays::RemoveSwap(int index)
+{
+	int last = Size() - 1;
+	for (int c = 0; c < BODY_COMPONENT_COUNT; c++) {
+		l_components[c][index] = l_components[c][last];
+		l_components[c].pop_back();
+	}
+}
+
+void RigidBodyArrays::Clear()
+{
+	for (int c = 0; c < BODY_COMPONENT_COUNT; c++) {
+		l_components[c].clear();
+	}
+
+	Add();
+}
+
+XMFLOAT3 RigidBodyArrays::GetPosition(int index) const
+{
+	return XMFLOAT3(l_components[BODY_POSITION_X][index], l_components[BODY_POSITION_Y][index], l_components[BODY_POSITION_Z][index]);
+}
+
+XMFLOAT4 RigidBodyArrays::GetOrientation(int index) const
+{
+	return XMFLOAT4(
+		l_components[BODY_ORIENTATION_X][index],
+		l_components[BODY_ORIENTATION_Y][index],
+		l_components[BODY_ORIENTATION_Z][index],
+		l_components[BODY_ORIENTATION_W][index]);
+}
+
+void RigidBodyArrays::SetPose(int index, const XMFLOAT3& position, const XMFLOAT4& orientation)
+{
+	l_components[BODY_POSITION_X][index] = position.x;
+	l_components[BODY_POSITION_Y][index] = position.y;
+	l_components[BODY_POSITION_Z][index] = position.z;
+	l_components[BODY_ORIENTATION_X][index] = orientation.x;
+	l_components[BODY_ORIENTATION_Y][index] = orientation.y;
+	l_components[BODY_ORIENTATION_Z][index] = orientation.z;
+	l_components[BODY_ORIENTATION_W][index] = orientation.w;
+
+	for (int c = 0; c < POSE_COMPONENT_COUNT; c++) {
+		l_components[BODY_PREVIOUS_POSITION_X + c][index] = l_components[BODY_POSITION_X + c][index];
+	}
+}
+
+void RigidBodyArrays::GetInterpolatedPose(int index, float alpha, XMFLOAT3& outPosition, XMFLOAT4& outOrientation) const
+{
+	XMFLOAT3 previousPosition = XMFLOAT3(
+		l_components[BODY_PREVIOUS_POSITION_X][index],
+		l_components[BODY_PREVIOUS_POSITION_Y][index],
+		l_components[BODY_PREVIOUS_POSITION_Z][index]);
+	XMFLOAT4 previousOrientation = XMFLOAT4(
+		l_components[BODY_PREVIOUS_ORIENTATION_X][index],
+		l_components[BODY_PREVIOUS_ORIENTATION_Y][index],
+		l_components[BODY_PREVIOUS_ORIENTATION_Z][index],
+		l_components[BODY_PREVIOUS_ORIENTATION_W][index]);
+	XMFLOAT3 position = GetPosition(index);
+	XMFLOAT4 orientation = GetOrientation(index);
+
+	XMStoreFloat3(&outPosition, XMVectorLerp(XMLoadFloat3(&previousPosition), XMLoadFloat3(&position), alpha));
+	XMStoreFloat4(&outOrientation, XMQuaternionSlerp(XMLoadFloat4(&previousOrientation), XMLoadFloat4(&orientation), alpha));
+}
+
+XMFLOAT3 RigidBodyArrays::GetVelocity(int index) const
+{
+	return XMFLOAT3(l_components[BODY_VELOCITY_X][index], l_components[BODY_VELOCITY_Y][index], l_components[BODY_VELOCITY_Z][index]);
+}
+
+void RigidBodyArrays::SetVelocity(int index, const XMFLOAT3& velocity)
+{
+	l_components[BODY_VELOCITY_X][index] = velocity.x;
+	l_components[BODY_VELOCITY_Y][index] = velocity.y;
+	l_components[BODY_VELOCITY_Z][index] = velocity.z;
+}
+
+XMFLOAT3 RigidBodyArrays::GetAngularVelocity(int index) const
+{
+	return XMFLOAT3(l_components[BODY_ANGULAR_VELOCITY_X][index], l_components[BODY_ANGULAR_VELOCITY_Y][index], l_components[BODY_ANGULAR_VELOCITY_Z][index]);
+}
+
+void RigidBodyArrays::SetAngularVelocity(int index, const XMFLOAT3& angularVelocity)
+{
+	l_components[BODY_ANGULAR_VELOCITY_X][index] = angularVelocity.x;
+	l_components[BODY_ANGULAR_VELOCITY_Y][index] = angularVelocity.y;
+	l_components[BODY_ANGULAR_VELOCITY_Z][index] = angularVelocity.z;
+}
+
+void RigidBodyArrays::AddForce(int index, const XMFLOAT3& force)
+{
+	l_components[BODY_FORCE_X][index] += force.x;
+	l_components[BODY_FORCE_Y][index] += force.y;
+	l_components[BODY_FORCE_Z][index] += force.z;
+}
+
+void RigidBodyArrays::AddTorque(int index, const XMFLOAT3& torque)
+{
+	l_components[BODY_TORQUE_X][index] += torque.x;
+	l_components[BODY_TORQUE_Y][index] += torque.y;
+	l_components[BODY_TORQUE_Z][index] += torque.z;
+}
+
+void RigidBodyArrays::ApplyImpulse(int index, const XMFLOAT3& impulse, const XMFLOAT3& point)
+{
+	float inverseMass = l_components[BODY_INVERSE_MASS][index];
+	l_components[BODY_VELOCITY_X][index] += impulse.x * inverseMass;
+	l_components[BODY_VELOCITY_Y][index] += impulse.y * inverseMass;
+	l_components[BODY_VELOCITY_Z][index] += impulse.z * inverseMass;
+
+	float rx = point.x - l_components[BODY_POSITION_X][index];
+	float ry = point.y - l_components[BODY_POSITION_Y][index];
+	float rz = point.z - l_components[BODY_POSITION_Z][index];
+	float tx = ry * impulse.z - rz * impulse.y;
+	float ty = rz * impulse.x - rx * impulse.z;
+	float tz = rx * impulse.y - ry * impulse.x;
+
+	float xx = l_components[BODY_INVERSE_INERTIA_XX][index];
+	float xy = l_components[BODY_INVERSE_INERTIA_XY][index];
+	float xz = l_components[BODY_INVERSE_INERTIA_XZ][index];
+	float yy = l_components[BODY_INVERSE_INERTIA_YY][index];
+	float yz = l_components[BODY_INVERSE_INERTIA_YZ][index];
+	float zz = l_components[BODY_INVERSE_INERTIA_ZZ][index];
+	l_components[BODY_ANGULAR_VELOCITY_X][index] += xx * tx + xy * ty + xz * tz;
+	l_components[BODY_ANGULAR_VELOCITY_Y][index] += xy * tx + yy * ty + yz * tz;
+	l_components[BODY_ANGULAR_VELOCITY_Z][index] += xz * tx + yz * ty + zz * tz;
+}
+
+void RigidBodyArrays::SetAwake(int index, bool awake)
+{
+	l_components[BODY_AWAKE][index] = awake ? 1.0f : 0.0f;
+	l_components[BODY_SLEEP_TIME][index] = 0.0f;
+	if (!awake) {
+		SetVelocity(index, XMFLOAT3(0.0f, 0.0f, 0.0f));
+		SetAngularVelocity(index, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	}
+}
+
+void RigidBodyArrays::SetBoxMass(int index, float mass, const float halfExtents[3])
+{
+	if (mass <= 0.0f) {
+		l_components[BODY_INVERSE_MASS][index] = 0.0f;
+		l_components[BODY_LOCAL_INVERSE_INERTIA_X][index] = 0.0f;
+		l_components[BODY_LOCAL_INVERSE_INERTIA_Y][index] = 0.0f;
+		l_components[BODY_LOCAL_INVERSE_INERTIA_Z][index] = 0.0f;
+	}
+	else {
+		//Solid box, I = m/12 * (h^2 + d^2) with full sizes which is m/3 * (y^2 + z^2) with half sizes
+		float xx = halfExtents[0] * halfExtents[0];
+		float yy = halfExtents[1] * halfExtents[1];
+		float zz = halfExtents[2] * halfExtents[2];
+		float third = mass / 3.0f;
+		float inertia[3] = { third * (yy + zz), third * (xx + zz), third * (xx + yy) };
+
+		l_components[BODY_INVERSE_MASS][index] = 1.0f / mass;
+		//A flat box has no inertia around its normal, treat that axis as unable to turn
+		l_components[BODY_LOCAL_INVERSE_INERTIA_X][index] = inertia[0] > 0.0f ? 1.0f / inertia[0] : 0.0f;
+		l_components[BODY_LOCAL_INVERSE_INERTIA_Y][index] = inertia[1] > 0.0f ? 1.0f / inertia[1] : 0.0f;
+		l_components[BODY_LOCAL_INVERSE_INERTIA_Z][index] = inertia[2] > 0.0f ? 1.0f / inertia[2] : 0.0f;
+	}
+}
+
+void RigidBodyArrays::UpdateWorldInertia()
+{
+	int count = Size();
+	const float* qx = Get(BODY_ORIENTATION_X);
+	const float* qy = Get(BODY_ORIENTATION_Y);
+	const float* qz = Get(BODY_ORIENTATION_Z);
+	const float* qw = Get(BODY_ORIENTATION_W);
+	const float* dx = Get(BODY_LOCAL_INVERSE_INERTIA_X);
+	const float* dy = Get(BODY_LOCAL_INVERSE_INERTIA_Y);
+	const float* dz = Get(BODY_LOCAL_INVERSE_INERTIA_Z);
+	float* ixx = Get(BODY_INVERSE_INERTIA_XX);
+	float* ixy = Get(BODY_INVERSE_INERTIA_XY);
+	float* ixz = Get(BODY_INVERSE_INERTIA_XZ);
+	float* iyy = Get(BODY_INVERSE_INERTIA_YY);
+	float* iyz = Get(BODY_INVERSE_INERTIA_YZ);
+	float* izz = Get(BODY_INVERSE_INERTIA_ZZ);
+
+	for (int i = 0; i < count; i++) {
+		//Columns of the rotation matrix are the body's axes in world space
+		float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+		float r00 = 1.0f - 2.0f * (y * y + z * z);
+		float r01 = 2.0f * (x * y - z * w);
+		float r02 = 2.0f * (x * z + y * w);
+		float r10 = 2.0f * (x * y + z * w);
+		float r11 = 1.0f - 2.0f * (x * x + z * z);
+		float r12 = 2.0f * (y * z - x * w);
+		float r20 = 2.0f * (x * z - y * w);
+		float r21 = 2.0f * (y * z + x * w);
+		float r22 = 1.0f - 2.0f * (x * x + y * y);
+
+		//R * D * R^T
+		ixx[i] = r00 * r00 * dx[i] + r01 * r01 * dy[i] + r02 * r02 * dz[i];
+		ixy[i] = r00 * r10 * dx[i] + r01 * r11 * dy[i] + r02 * r12 * dz[i];
+		ixz[i] = r00 * r20 * dx[i] + r01 * r21 * dy[i] + r02 * r22 * dz[i];
+		iyy[i] = r10 * r10 * dx[i] + r11 * r11 * dy[i] + r12 * r12 * dz[i];
+		iyz[i] = r10 * r20 * dx[i] + r11 * r21 * dy[i] + r12 * r22 * dz[i];
+		izz[i] = r20 * r20 * dx[i] + r21 * r21 * dy[i] + r22 * r22 * dz[i];
+	}
+}
+
+void RigidBodyArrays::SavePreviousPoses()
+{
+	for (int c = 0; c < POSE_COMPONENT_COUNT; c++) {
+		std::copy(l_components[BODY_POSITION_X + c].begin(), l_components[BODY_POSITION_X + c].end(), l_components[BODY_PREVIOUS_POSITION_X + c].begin());
+	}
+}
+
+void RigidBodyArrays::UpdateSleepTimers(float dt, float linearToleranceSq, float angularToleranceSq)
+{
+	int count = Size();
+	const float* invMass = Get(BODY_INVERSE_MASS);
+	const float* awake = Get(BODY_AWAKE);
+	const float* vx = Get(BODY_VELOCITY_X);
+	const float* vy = Get(BODY_VELOCITY_Y);
+	const float* vz = Get(BODY_VELOCITY_Z);
+	const float* wx = Get(BODY_ANGULAR_VELOCITY_X);
+	const float* wy = Get(BODY_ANGULAR_VELOCITY_Y);
+	const float* wz = Get(BODY_ANGULAR_VELOCITY_Z);
+	float* sleepTime = Get(BODY_SLEEP_TIME);
+
+	for (int i = 0; i < count; i++) {
+		float linearSq = vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i];
+		float angularSq = wx[i] * wx[i] + wy[i] * wy[i] + wz[i] * wz[i];
+		bool resting = linearSq < linearToleranceSq && angularSq < angularToleranceSq;
+		//Sleeping bodies keep the time they fell asleep with, static ones never count
+		float timer = resting ? sleepTime[i] + dt : 0.0f;
+		sleepTime[i] = invMass[i] > 0.0f ? (awake[i] != 0.0f ? timer : sleepTime[i]) : 0.0f;
+	}
+}
+
+void RigidBodyArrays::IntegrateVelocities(float dt, const XMFLOAT3& gravity, float linearDamping, float angularDamping)
+{
+	int count = Size();
+	const float* invMass = Get(BODY_INVERSE_MASS);
+	const float* gravityScale = Get(BODY_GRAVITY_SCALE);
+	const float* awake = Get(BODY_AWAKE);
+	const float* fx = Get(BODY_FORCE_X);
+	const float* fy = Get(BODY_FORCE_Y);
+	const float* fz = Get(BODY_FORCE_Z);
+	const float* tx = Get(BODY_TORQUE_X);
+	const float* ty = Get(BODY_TORQUE_Y);
+	const float* tz = Get(BODY_TORQUE_Z);
+	const float* ixx = Get(BODY_INVERSE_INERTIA_XX);
+	const float* ixy = Get(BODY_INVERSE_INERTIA_XY);
+	const float* ixz = Get(BODY_INVERSE_INERTIA_XZ);
+	const float* iyy = Get(BODY_INVERSE_INERTIA_YY);
+	const float* iyz = Get(BODY_INVERSE_INERTIA_YZ);
+	const float* izz = Get(BODY_INVERSE_INERTIA_ZZ);
+	float* vx = Get(BODY_VELOCITY_X);
+	float* vy = Get(BODY_VELOCITY_Y);
+	float* vz = Get(BODY_VELOCITY_Z);
+	float* wx = Get(BODY_ANGULAR_VELOCITY_X);
+	float* wy = Get(BODY_ANGULAR_VELOCITY_Y);
+	float* wz = Get(BODY_ANGULAR_VELOCITY_Z);
+
+	//Same damping as Box2D, v *= 1 / (1 + c * dt) stays stable for any timestep
+	float linearScale = 1.0f / (1.0f + dt * linearDamping);
+	float angularScale = 1.0f / (1.0f + dt * angularDamping);
+
+	for (int i = 0; i < count; i++) {
+		//A select rather than a branch, static bodies keep whatever velocity they were given
+		//and sleeping ones get nothing added
+		float stepDt = awake[i] * dt;
+		float gravityDt = invMass[i] > 0.0f ? gravityScale[i] * stepDt : 0.0f;
+		float forceDt = invMass[i] * stepDt;
+		vx[i] = (vx[i] + gravity.x * gravityDt + fx[i] * forceDt) * linearScale;
+		vy[i] = (vy[i] + gravity.y * gravityDt + fy[i] * forceDt) * linearScale;
+		vz[i] = (vz[i] + gravity.z * gravityDt + fz[i] * forceDt) * linearScale;
+
+		wx[i] = (wx[i] + (ixx[i] * tx[i] + ixy[i] * ty[i] + ixz[i] * tz[i]) * stepDt) * angularScale;
+		wy[i] = (wy[i] + (ixy[i] * tx[i] + iyy[i] * ty[i] + iyz[i] * tz[i]) * stepDt) * angularScale;
+		wz[i] = (wz[i] + (ixz[i] * tx[i] + iyz[i] * ty[i] + izz[i] * tz[i]) * stepDt) * angularScale;
+	}
+}
+
+void RigidBodyArrays::IntegratePositions(float dt)
+{
+	int count = Size();
+	const float* vx = Get(BODY_VELOCITY_X);
+	const float* vy = Get(BODY_VELOCITY_Y);
+	const float* vz = Get(BODY_VELOCITY_Z);
+	const float* wx = Get(BODY_ANGULAR_VELOCITY_X);
+	const float* wy = Get(BODY_ANGULAR_VELOCITY_Y);
+	const float* wz = Get(BODY_ANGULAR_VELOCITY_Z);
+	float* bvx = Get(BODY_BIAS_VELOCITY_X);
+	float* bvy = Get(BODY_BIAS_VELOCITY_Y);
+	float* bvz = Get(BODY_BIAS_VELOCITY_Z);
+	float* bwx = Get(BODY_BIAS_ANGULAR_VELOCITY_X);
+	float* bwy = Get(BODY_BIAS_ANGULAR_VELOCITY_Y);
+	float* bwz = Get(BODY_BIAS_ANGULAR_VELOCITY_Z);
+	float* px = Get(BODY_POSITION_X);
+	float* py = Get(BODY_POSITION_Y);
+	float* pz = Get(BODY_POSITION_Z);
+	float* qx = Get(BODY_ORIENTATION_X);
+	float* qy = Get(BODY_ORIENTATION_Y);
+	float* qz = Get(BODY_ORIENTATION_Z);
+	float* qw = Get(BODY_ORIENTATION_W);
+
+	float halfDt = 0.5f * dt;
+	for (int i = 0; i < count; i++) {
+		px[i] += (vx[i] + bvx[i]) * dt;
+		py[i] += (vy[i] + bvy[i]) * dt;
+		pz[i] += (vz[i] + bvz[i]) * dt;
+
+		//q += dt/2 * (w, 0) * q
+		float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+		float ax = (wx[i] + bwx[i]) * halfDt, ay = (wy[i] + bwy[i]) * halfDt, az = (wz[i] + bwz[i]) * halfDt;
+		float nx = x + ax * w + ay * z - az * y;
+		float ny = y + ay * w + az * x - ax * z;
+		float nz = z + az * w + ax * y - ay * x;
+		float nw = w - (ax * x + ay * y + az * z);
+
+		float inverseLength = 1.0f / sqrtf(nx * nx + ny * ny + nz * nz + nw * nw);
+		qx[i] = nx * inverseLength;
+		qy[i] = ny * inverseLength;
+		qz[i] = nz * inverseLength;
+		qw[i] = nw * inverseLength;
+
+		bvx[i] = 0.0f;
+		bvy[i] = 0.0f;
+		bvz[i] = 0.0f;
+		bwx[i] = 0.0f;
+		bwy[i] = 0.0f;
+		bwz[i] = 0.0f;
+	}
+}
+
+void RigidBodyArrays::ClearForces()
+{
+	for (int c = BODY_FORCE_X; c <= BODY_TORQUE_Z; c++) {
+		std::fill(l_components[c].begin(), l_components[c].end(), 0.0f);
+	}
+}
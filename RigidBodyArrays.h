@@ -0,0 +1,156 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+//Every piece of body state the physics step touches, one array per float
+enum eBodyComponent
+{
+	//Centre of mass in world space
+	BODY_POSITION_X = 0,
+	BODY_POSITION_Y,
+	BODY_POSITION_Z,
+
+	BODY_ORIENTATION_X,
+	BODY_ORIENTATION_Y,
+	BODY_ORIENTATION_Z,
+	BODY_ORIENTATION_W,
+
+	//Pose before the last step, rendering blends from this to the current pose
+	BODY_PREVIOUS_POSITION_X,
+	BODY_PREVIOUS_POSITION_Y,
+	BODY_PREVIOUS_POSITION_Z,
+	BODY_PREVIOUS_ORIENTATION_X,
+	BODY_PREVIOUS_ORIENTATION_Y,
+	BODY_PREVIOUS_ORIENTATION_Z,
+	BODY_PREVIOUS_ORIENTATION_W,
+
+	BODY_VELOCITY_X,
+	BODY_VELOCITY_Y,
+	BODY_VELOCITY_Z,
+
+	//World space, radians per second
+	BODY_ANGULAR_VELOCITY_X,
+	BODY_ANGULAR_VELOCITY_Y,
+	BODY_ANGULAR_VELOCITY_Z,
+
+	//Extra velocity the contact solver uses to push overlapping bodies apart. It moves the
+	//body for one step and is then thrown away, so fixing penetration doesn't add energy
+	BODY_BIAS_VELOCITY_X,
+	BODY_BIAS_VELOCITY_Y,
+	BODY_BIAS_VELOCITY_Z,
+	BODY_BIAS_ANGULAR_VELOCITY_X,
+	BODY_BIAS_ANGULAR_VELOCITY_Y,
+	BODY_BIAS_ANGULAR_VELOCITY_Z,
+
+	//Accumulated until the next step, then cleared
+	BODY_FORCE_X,
+	BODY_FORCE_Y,
+	BODY_FORCE_Z,
+	BODY_TORQUE_X,
+	BODY_TORQUE_Y,
+	BODY_TORQUE_Z,
+
+	//0 for anything that can't be pushed around
+	BODY_INVERSE_MASS,
+	//Diagonal of the inverse inertia tensor along the body's own axes
+	BODY_LOCAL_INVERSE_INERTIA_X,
+	BODY_LOCAL_INVERSE_INERTIA_Y,
+	BODY_LOCAL_INVERSE_INERTIA_Z,
+	//Same tensor turned into world space, it's symmetric so only 6 of the 9 are kept
+	BODY_INVERSE_INERTIA_XX,
+	BODY_INVERSE_INERTIA_XY,
+	BODY_INVERSE_INERTIA_XZ,
+	BODY_INVERSE_INERTIA_YY,
+	BODY_INVERSE_INERTIA_YZ,
+	BODY_INVERSE_INERTIA_ZZ,
+
+	BODY_GRAVITY_SCALE,
+	BODY_FRICTION,
+	//How much of the approach speed a contact gives back, 0 doesn't bounce and 1 bounces all the way
+	BODY_RESTITUTION,
+	//Speed above which the body is swept for continuous collision, 0 turns it off
+	BODY_CCD_SPEED,
+
+	//1 while the body is simulated, 0 while it sleeps. Static bodies only have it set
+	//for the step they were moved by hand in, so they can wake what they touch
+	BODY_AWAKE,
+	//How long a dynamic body has been moving slowly enough to sleep
+	BODY_SLEEP_TIME,
+
+	BODY_COMPONENT_COUNT,
+};
+
+//Dynamics state for a set of rigid bodies stored as structure of arrays. The per body
+//loops (integration, inertia updates) are written as straight loops over raw float
+//arrays with no branches so the compiler can vectorize them, and the solver only pulls
+//in the handful of arrays it needs. Index 0 is always a static body that never moves,
+//contacts against anything without a body of its own are solved against it
+class RigidBodyArrays
+{
+private:
+	std::vector<float> l_components[BODY_COMPONENT_COUNT];
+
+public:
+	static const int STATIC_BODY = 0;
+	static const float DEFAULT_FRICTION;
+
+	RigidBodyArrays();
+	~RigidBodyArrays();
+
+	//Adds a static body at the origin and returns its index
+	int Add();
+	//Moves the last body into index, so whatever was last is at index afterwards
+	void RemoveSwap(int index);
+	//Back to just the static body
+	void Clear();
+	int Size() const { return static_cast<int>(l_components[0].size()); }
+
+	float* Get(eBodyComponent component) { return l_components[component].data(); }
+	const float* Get(eBodyComponent component) const { return l_components[component].data(); }
+
+	DirectX::XMFLOAT3 GetPosition(int index) const;
+	DirectX::XMFLOAT4 GetOrientation(int index) const;
+	//Also resets the previous pose so a body that's placed by hand doesn't get blended in from where it was
+	void SetPose(int index, const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT4& orientation);
+	//Blend between the previous and current pose, alpha 0 is the previous one
+	void GetInterpolatedPose(int index, float alpha, DirectX::XMFLOAT3& outPosition, DirectX::XMFLOAT4& outOrientation) const;
+
+	DirectX::XMFLOAT3 GetVelocity(int index) const;
+	void SetVelocity(int index, const DirectX::XMFLOAT3& velocity);
+	DirectX::XMFLOAT3 GetAngularVelocity(int index) const;
+	void SetAngularVelocity(int index, const DirectX::XMFLOAT3& angularVelocity);
+
+	void AddForce(int index, const DirectX::XMFLOAT3& force);
+	void AddTorque(int index, const DirectX::XMFLOAT3& torque);
+	//Instant change in momentum at a world space point, also spins the body if it's off centre
+	void ApplyImpulse(int index, const DirectX::XMFLOAT3& impulse, const DirectX::XMFLOAT3& point);
+
+	//Mass 0 makes the body static. Inertia is a solid box with these half extents along the body's axes
+	void SetBoxMass(int index, float mass, const float halfExtents[3]);
+	void SetGravityScale(int index, float gravityScale) { l_components[BODY_GRAVITY_SCALE][index] = gravityScale; }
+	void SetFriction(int index, float friction) { l_components[BODY_FRICTION][index] = friction; }
+	void SetRestitution(int index, float restitution) { l_components[BODY_RESTITUTION][index] = restitution; }
+	void SetCCDSpeed(int index, float ccdSpeed) { l_components[BODY_CCD_SPEED][index] = ccdSpeed; }
+	bool IsStatic(int index) const { return l_components[BODY_INVERSE_MASS][index] == 0.0f; }
+
+	bool IsAwake(int index) const { return l_components[BODY_AWAKE][index] != 0.0f; }
+	//Dynamic and awake, anything else doesn't need solving
+	bool IsSimulated(int index) const { return !IsStatic(index) && IsAwake(index); }
+	//Going to sleep also stops the body dead, waking up restarts its sleep timer
+	void SetAwake(int index, bool awake);
+
+	//Turns every body's local inverse inertia into world space with its current orientation
+	void UpdateWorldInertia();
+	//Copies every current pose into the previous pose, done right before a step
+	void SavePreviousPoses();
+	//Adds dt to the sleep time of every awake dynamic body moving slower than both tolerances
+	//(squared speeds) and resets the rest
+	void UpdateSleepTimers(float dt, float linearToleranceSq, float angularToleranceSq);
+	//Gravity, forces and damping into velocity, sleeping bodies are left alone
+	void IntegrateVelocities(float dt, const DirectX::XMFLOAT3& gravity, float linearDamping, float angularDamping);
+	//Velocity plus bias velocity into position and orientation, orientations are renormalized
+	//after and the bias velocities cleared
+	void IntegratePositions(float dt);
+	void ClearForces();
+};
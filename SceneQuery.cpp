@@ -0,0 +1,129 @@
+#include "SceneQuery.h"
+
+using namespace DirectX;
+
+std::shared_ptr<SceneQuery> SceneQuery::s_instance;
+
+SceneQuery::SceneQuery()
+	: m_boundsDirty(true)
+{
+}
+
+SceneQuery::~SceneQuery()
+{
+}
+
+std::shared_ptr<SceneQuery> SceneQuery::GetInstance()
+{
+	if (!s_instance.get()) {
+		std::shared_ptr<SceneQuery> newInstance(new SceneQuery());
+		s_instance = newInstance;
+	}
+
+	return s_instance;
+}
+
+void SceneQuery::AddCollider(Collider* collider)
+{
+	if (!collider) {
+		return;
+	}
+
+	l_colliders.push_back(collider);
+	m_tree.Resize(NumColliders());
+	m_boundsDirty = true;
+}
+
+void SceneQuery::RemoveCollider(Collider* collider)
+{
+	for (unsigned int i = 0; i < l_colliders.size(); i++) {
+		if (l_colliders[i] == collider) {
+			//Shapes are rewritten from the list on the next update so order doesn't matter
+			l_colliders[i] = l_colliders.back();
+			l_colliders.pop_back();
+			m_tree.Resize(NumColliders());
+			m_boundsDirty = true;
+			return;
+		}
+	}
+}
+
+void SceneQuery::Update()
+{
+	if (!m_boundsDirty) {
+		return;
+	}
+
+	for (int i = 0; i < NumColliders(); i++) {
+		Collider* collider = l_colliders[i];
+		QueryShape& shape = m_tree.GetShape(i);
+		shape.box = collider->GetWorldOBB();
+		shape.bounds = collider->GetWorldAABB();
+		shape.layerBit = collider->GetLayerBit();
+		shape.trigger = collider->IsTrigger();
+		shape.collider = collider;
+	}
+
+	m_tree.Update();
+	m_boundsDirty = false;
+}
+
+void SceneQuery::CollectColliders(std::vector<Collider*>& outColliders) const
+{
+	outColliders.clear();
+	for (int shape : l_overlapShapes) {
+		outColliders.push_back(l_colliders[shape]);
+	}
+}
+
+bool SceneQuery::Raycast(const Ray& ray, QueryHit& outHit, const QueryFilter& filter)
+{
+	Update();
+	return m_tree.Raycast(ray, outHit, filter);
+}
+
+bool SceneQuery::RaycastAny(const Ray& ray, const QueryFilter& filter, QueryHit* outHit)
+{
+	Update();
+	return m_tree.RaycastAny(ray, filter, outHit);
+}
+
+int SceneQuery::RaycastAll(const Ray& ray, std::vector<QueryHit>& outHits, const QueryFilter& filter)
+{
+	Update();
+	return m_tree.RaycastAll(ray, outHits, filter);
+}
+
+void SceneQuery::RaycastBatch(const Ray* rays, int count, QueryHit* outHits, eRaycastMode mode, const QueryFilter& filter)
+{
+	Update();
+	m_tree.RaycastBatch(rays, count, outHits, mode, filter);
+}
+
+bool SceneQuery::SweepSphere(const XMFLOAT3& center, float radius, const XMFLOAT3& direction, float maxDistance, QueryHit& outHit, const QueryFilter& filter)
+{
+	Update();
+	return m_tree.SweepSphere(center, radius, direction, maxDistance, outHit, filter);
+}
+
+bool SceneQuery::SweepBox(const OBB& box, const XMFLOAT3& direction, float maxDistance, QueryHit& outHit, const QueryFilter& filter)
+{
+	Update();
+	return m_tree.SweepBox(box, direction, maxDistance, outHit, filter);
+}
+
+int SceneQuery::OverlapSphere(const XMFLOAT3& center, float radius, std::vector<Collider*>& outColliders, const QueryFilter& filter)
+{
+	Update();
+	m_tree.OverlapSphere(center, radius, l_overlapShapes, filter);
+	CollectColliders(outColliders);
+	return static_cast<int>(outColliders.size());
+}
+
+int SceneQuery::OverlapBox(const OBB& box, std::vector<Collider*>& outColliders, const QueryFilter& filter)
+{
+	Update();
+	m_tree.OverlapBox(box, l_overlapShapes, filter);
+	CollectColliders(outColliders);
+	return static_cast<int>(outColliders.size());
+}
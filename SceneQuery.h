@@ -0,0 +1,61 @@
+#pragma once
+#include "Collider.h"
+#include "QueryBVH.h"
+
+#include <memory>
+#include <vector>
+
+//Raycasts, sweeps and overlap tests against every collider the collision manager knows about, so
+//gameplay code can ask what a ray hits without looping over the entities. The collision manager
+//registers colliders here as they're added and flags the bounds as stale after each update, the
+//next query copies them into its own tree and refits it. Layer and trigger changes are picked up
+//the same way.
+//Queries bring the tree up to date before running so they should be made from the main thread,
+//RaycastBatch spreads its rays across the job system itself
+class SceneQuery
+{
+private:
+	static std::shared_ptr<SceneQuery> s_instance;
+
+	//Shape i in the tree is l_colliders[i]
+	std::vector<Collider*> l_colliders;
+	QueryBVH m_tree;
+	bool m_boundsDirty;
+
+	//Scratch for the overlap queries
+	std::vector<int> l_overlapShapes;
+
+	SceneQuery();
+
+	void CollectColliders(std::vector<Collider*>& outColliders) const;
+
+public:
+	~SceneQuery();
+
+	static std::shared_ptr<SceneQuery> GetInstance();
+
+	void AddCollider(Collider* collider);
+	void RemoveCollider(Collider* collider);
+
+	//Called by the collision manager once it's refreshed every collider's bounds
+	void MarkBoundsDirty() { m_boundsDirty = true; }
+	//Copies the colliders' bounds and layers into the tree if anything changed. Queries call this first
+	void Update();
+
+	//Nearest hit, any hit at all (cheapest, for line of sight) and every hit nearest first
+	bool Raycast(const Ray& ray, QueryHit& outHit, const QueryFilter& filter = QueryFilter());
+	bool RaycastAny(const Ray& ray, const QueryFilter& filter = QueryFilter(), QueryHit* outHit = nullptr);
+	int RaycastAll(const Ray& ray, std::vector<QueryHit>& outHits, const QueryFilter& filter = QueryFilter());
+	//Thousands of rays in one call, traced in packets of 4. outHits needs room for count hits
+	void RaycastBatch(const Ray* rays, int count, QueryHit* outHits, eRaycastMode mode = RAYCAST_CLOSEST, const QueryFilter& filter = QueryFilter());
+
+	bool SweepSphere(const DirectX::XMFLOAT3& center, float radius, const DirectX::XMFLOAT3& direction, float maxDistance, QueryHit& outHit, const QueryFilter& filter = QueryFilter());
+	bool SweepBox(const OBB& box, const DirectX::XMFLOAT3& direction, float maxDistance, QueryHit& outHit, const QueryFilter& filter = QueryFilter());
+
+	//outColliders is cleared first, returns how many were found
+	int OverlapSphere(const DirectX::XMFLOAT3& center, float radius, std::vector<Collider*>& outColliders, const QueryFilter& filter = QueryFilter());
+	int OverlapBox(const OBB& box, std::vector<Collider*>& outColliders, const QueryFilter& filter = QueryFilter());
+
+	const QueryBVH& GetTree() const { return m_tree; }
+	int NumColliders() const { return static_cast<int>(l_colliders.size()); }
+};
@@ -3,7 +3,8 @@
 //constant buffer. Can't be changed by shaders but
 // can be changed from C++
 cbuffer ExternalData : register(b0) {
-	matrix world;
+	//Same compact world matrix as VertexShader
+	row_major float3x4 world;
 	matrix view;
 	matrix proj;
 	float3 lightPos;
@@ -28,11 +29,10 @@ VertexToPixel_Shadow main(VertexShaderInput input)
 	// Set up output struct
 	VertexToPixel_Shadow output;
 
-	// 'backwards' due to column major
-	matrix wvp = mul(mul(proj, view), world);
-	output.screenPos = mul(wvp, float4(input.localPosition, 1.0f));
+	output.worldPos = float4(mul(world, float4(input.localPosition, 1.0f)), 1.0f);
 
-	output.worldPos = mul(world, float4(input.localPosition, 1.0f));
+	// 'backwards' due to column major
+	output.screenPos = mul(mul(proj, view), output.worldPos);
 
 	output.lightPos = lightPos - output.worldPos.xyz;
 
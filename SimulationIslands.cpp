@@ -0,0 +1,131 @@
+#include "SimulationIslands.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+namespace
+{
+	//Something outside the island (a static body moved by hand) touched it this step, or it was kept awake
+	const unsigned char ISLAND_FORCE_WAKE = 1 << 0;
+}
+
+SimulationIslands::SimulationIslands()
+	: m_linearSleepTolerance(0.1f),
+	m_angularSleepTolerance(0.1f),
+	m_timeToSleep(0.5f),
+	m_sleepingEnabled(true),
+	m_numIslands(0),
+	m_numSleepingBodies(0)
+{
+}
+
+SimulationIslands::~SimulationIslands()
+{
+}
+
+int SimulationIslands::Find(int body)
+{
+	//Path halving, every other node on the way up gets pointed at its grandparent
+	while (l_parent[body] != body) {
+		l_parent[body] = l_parent[l_parent[body]];
+		body = l_parent[body];
+	}
+
+	return body;
+}
+
+void SimulationIslands::Union(int bodyA, int bodyB)
+{
+	int rootA = Find(bodyA);
+	int rootB = Find(bodyB);
+	if (rootA == rootB) {
+		return;
+	}
+
+	//Lower index as root keeps it deterministic without needing ranks
+	if (rootA < rootB) {
+		l_parent[rootB] = rootA;
+	}
+	else {
+		l_parent[rootA] = rootB;
+	}
+}
+
+void SimulationIslands::Begin(int bodyCount)
+{
+	l_parent.resize(bodyCount);
+	std::iota(l_parent.begin(), l_parent.end(), 0);
+	l_forceWake.assign(bodyCount, 0);
+}
+
+void SimulationIslands::AddContact(int bodyA, int bodyB, const RigidBodyArrays& bodies)
+{
+	bool staticA = bodies.IsStatic(bodyA);
+	bool staticB = bodies.IsStatic(bodyB);
+	if (staticA && staticB) {
+		return;
+	}
+
+	if (!staticA && !staticB) {
+		Union(bodyA, bodyB);
+	}
+	else if (staticA && bodies.IsAwake(bodyA)) {
+		l_forceWake[bodyB] = 1;
+	}
+	else if (staticB && bodies.IsAwake(bodyB)) {
+		l_forceWake[bodyA] = 1;
+	}
+}
+
+void SimulationIslands::UpdateSleep(RigidBodyArrays& bodies, float dt)
+{
+	bodies.UpdateSleepTimers(dt, m_linearSleepTolerance * m_linearSleepTolerance, m_angularSleepTolerance * m_angularSleepTolerance);
+
+	int count = bodies.Size();
+	const float* sleepTime = bodies.Get(BODY_SLEEP_TIME);
+	float* awake = bodies.Get(BODY_AWAKE);
+
+	//An island's time is its least rested awake body. One that's already fully asleep stays at FLT_MAX
+	l_islandSleepTime.assign(count, FLT_MAX);
+	l_islandFlags.assign(count, 0);
+	for (int i = 0; i < count; i++) {
+		if (bodies.IsStatic(i)) {
+			continue;
+		}
+
+		int root = Find(i);
+		if (awake[i] != 0.0f) {
+			l_islandSleepTime[root] = std::min(l_islandSleepTime[root], sleepTime[i]);
+		}
+		if (l_forceWake[i]) {
+			l_islandFlags[root] |= ISLAND_FORCE_WAKE;
+		}
+	}
+
+	m_numIslands = 0;
+	m_numSleepingBodies = 0;
+	for (int i = 0; i < count; i++) {
+		if (bodies.IsStatic(i)) {
+			//Only counts as moved for the step it was moved in
+			awake[i] = 0.0f;
+			continue;
+		}
+
+		int root = Find(i);
+		if (root == i) {
+			m_numIslands++;
+		}
+
+		bool sleeps = m_sleepingEnabled && !(l_islandFlags[root] & ISLAND_FORCE_WAKE) && l_islandSleepTime[root] >= m_timeToSleep;
+		if (sleeps) {
+			m_numSleepingBodies++;
+			if (awake[i] != 0.0f) {
+				bodies.SetAwake(i, false);
+			}
+		}
+		else if (awake[i] == 0.0f) {
+			bodies.SetAwake(i, true);
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "RigidBodyArrays.h"
+
+#include <vector>
+
+//Groups dynamic bodies that touch into islands with union-find over the contact pairs, then
+//puts whole islands to sleep once every body in them has been slow for long enough. An island
+//either sleeps or it doesn't, so a sleeping pile that gets touched by anything awake wakes up
+//together instead of one box at a time. Static bodies don't join islands (everything on the
+//floor would end up as one), but one that was moved by hand wakes whatever it touches
+class SimulationIslands
+{
+private:
+	//Union-find over body indices, l_parent[i] == i for the root of each island
+	std::vector<int> l_parent;
+	//Bodies touching a static body that moved this step
+	std::vector<unsigned char> l_forceWake;
+
+	//Per island, indexed by the root body
+	std::vector<float> l_islandSleepTime;
+	std::vector<unsigned char> l_islandFlags;
+
+	float m_linearSleepTolerance;
+	float m_angularSleepTolerance;
+	float m_timeToSleep;
+	bool m_sleepingEnabled;
+
+	//Stats from the last update
+	int m_numIslands;
+	int m_numSleepingBodies;
+
+	int Find(int body);
+	void Union(int bodyA, int bodyB);
+
+public:
+	SimulationIslands();
+	~SimulationIslands();
+
+	//Starts a new set of islands, every body on its own
+	void Begin(int bodyCount);
+	//Links two bodies that are touching this step
+	void AddContact(int bodyA, int bodyB, const RigidBodyArrays& bodies);
+	//Body at the root of the island this one is in, the same for every body in an island
+	int GetIsland(int body) { return Find(body); }
+	//Stops the island this body ends up in from sleeping this step
+	void KeepAwake(int body) { l_forceWake[body] = 1; }
+	//Ticks sleep timers then sleeps or wakes each island as a whole. Static bodies are marked not moved after
+	void UpdateSleep(RigidBodyArrays& bodies, float dt);
+
+	//Off wakes everything on the next update and keeps it awake
+	void SetSleepingEnabled(bool sleepingEnabled) { m_sleepingEnabled = sleepingEnabled; }
+	bool GetSleepingEnabled() const { return m_sleepingEnabled; }
+	//Speeds (units and radians per second) a body has to stay under to count as resting
+	void SetSleepTolerances(float linear, float angular) { m_linearSleepTolerance = linear; m_angularSleepTolerance = angular; }
+	//Seconds an island has to rest before it sleeps
+	void SetTimeToSleep(float timeToSleep) { m_timeToSleep = timeToSleep; }
+
+	//Islands with at least one dynamic body in them
+	int NumIslands() const { return m_numIslands; }
+	int NumSleepingBodies() const { return m_numSleepingBodies; }
+};
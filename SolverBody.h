@@ -0,0 +1,82 @@
+#pragma once
+
+#include "RigidBodyArrays.h"
+
+#include <DirectXMath.h>
+
+//Copy of the bits of one body a solver reads and writes, pulled out of the arrays
+//once per constraint instead of once per row
+struct SolverBody
+{
+	float velocity[3];
+	float angularVelocity[3];
+	float biasVelocity[3];
+	float biasAngularVelocity[3];
+	float inverseMass;
+	//xx, xy, xz, yy, yz, zz
+	float inverseInertia[6];
+
+	void Load(const RigidBodyArrays& bodies, int index)
+	{
+		for (int i = 0; i < 3; i++) {
+			velocity[i] = bodies.Get(static_cast<eBodyComponent>(BODY_VELOCITY_X + i))[index];
+			angularVelocity[i] = bodies.Get(static_cast<eBodyComponent>(BODY_ANGULAR_VELOCITY_X + i))[index];
+			biasVelocity[i] = bodies.Get(static_cast<eBodyComponent>(BODY_BIAS_VELOCITY_X + i))[index];
+			biasAngularVelocity[i] = bodies.Get(static_cast<eBodyComponent>(BODY_BIAS_ANGULAR_VELOCITY_X + i))[index];
+		}
+		inverseMass = bodies.Get(BODY_INVERSE_MASS)[index];
+		for (int i = 0; i < 6; i++) {
+			inverseInertia[i] = bodies.Get(static_cast<eBodyComponent>(BODY_INVERSE_INERTIA_XX + i))[index];
+		}
+	}
+
+	void Store(RigidBodyArrays& bodies, int index) const
+	{
+		//Nothing changes on static bodies, and they're shared between islands so other threads could be reading them
+		if (inverseMass == 0.0f) {
+			return;
+		}
+
+		for (int i = 0; i < 3; i++) {
+			bodies.Get(static_cast<eBodyComponent>(BODY_VELOCITY_X + i))[index] = velocity[i];
+			bodies.Get(static_cast<eBodyComponent>(BODY_ANGULAR_VELOCITY_X + i))[index] = angularVelocity[i];
+			bodies.Get(static_cast<eBodyComponent>(BODY_BIAS_VELOCITY_X + i))[index] = biasVelocity[i];
+			bodies.Get(static_cast<eBodyComponent>(BODY_BIAS_ANGULAR_VELOCITY_X + i))[index] = biasAngularVelocity[i];
+		}
+	}
+
+	void MultiplyInertia(const float v[3], float out[3]) const
+	{
+		const float* I = inverseInertia;
+		out[0] = I[0] * v[0] + I[1] * v[1] + I[2] * v[2];
+		out[1] = I[1] * v[0] + I[3] * v[1] + I[4] * v[2];
+		out[2] = I[2] * v[0] + I[4] * v[1] + I[5] * v[2];
+	}
+
+	//Impulse p at r changes v by p/m and w by I^-1 (r x p)
+	void AddImpulse(float v[3], float w[3], const DirectX::XMFLOAT3& r, float px, float py, float pz) const
+	{
+		v[0] += px * inverseMass;
+		v[1] += py * inverseMass;
+		v[2] += pz * inverseMass;
+
+		float torque[3] = { r.y * pz - r.z * py, r.z * px - r.x * pz, r.x * py - r.y * px };
+		float change[3];
+		MultiplyInertia(torque, change);
+		w[0] += change[0];
+		w[1] += change[1];
+		w[2] += change[2];
+	}
+
+	//How hard it is to change the speed of point r along direction, (r x d) . I^-1 (r x d) + 1/m
+	float InverseEffectiveMass(const DirectX::XMFLOAT3& r, const DirectX::XMFLOAT3& direction) const
+	{
+		float rxd[3] = {
+			r.y * direction.z - r.z * direction.y,
+			r.z * direction.x - r.x * direction.z,
+			r.x * direction.y - r.y * direction.x };
+		float turned[3];
+		MultiplyInertia(rxd, turned);
+		return inverseMass + rxd[0] * turned[0] + rxd[1] * turned[1] + rxd[2] * turned[2];
+	}
+};
@@ -0,0 +1,256 @@
+#include "SpatialHashGrid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+SpatialHashGrid::SpatialHashGrid(float cellSize, int maxCellsPerProxy)
+	: m_freeList(NULL_PROXY),
+	m_proxyCount(0),
+	m_maxCellsPerProxy(maxCellsPerProxy),
+	m_bucketMask(0)
+{
+	SetCellSize(cellSize);
+}
+
+SpatialHashGrid::~SpatialHashGrid()
+{
+}
+
+void SpatialHashGrid::Clear()
+{
+	l_proxies.clear();
+	l_bucketStarts.clear();
+	l_bucketEntries.clear();
+	l_entryBuckets.clear();
+	l_entryProxies.clear();
+	l_bucketCursors.clear();
+	l_oversizedProxies.clear();
+	m_freeList = NULL_PROXY;
+	m_proxyCount = 0;
+}
+
+void SpatialHashGrid::SetCellSize(float cellSize)
+{
+	assert(cellSize > 0.0f);
+
+	m_cellSize = cellSize;
+	m_inverseCellSize = 1.0f / cellSize;
+}
+
+void SpatialHashGrid::CellRange(const AABB& aabb, int outMin[3], int outMax[3]) const
+{
+	const float* mins = &aabb.min.x;
+	const float* maxs = &aabb.max.x;
+
+	for (int axis = 0; axis < 3; axis++) {
+		outMin[axis] = static_cast<int>(floorf(mins[axis] * m_inverseCellSize));
+		outMax[axis] = static_cast<int>(floorf(maxs[axis] * m_inverseCellSize));
+	}
+}
+
+unsigned int SpatialHashGrid::HashCell(int x, int y, int z) const
+{
+	//Large primes from Teschner et al. "Optimized Spatial Hashing for Collision Detection of Deformable Objects"
+	return ((static_cast<unsigned int>(x) * 73856093u) ^
+		(static_cast<unsigned int>(y) * 19349663u) ^
+		(static_cast<unsigned int>(z) * 83492791u)) & m_bucketMask;
+}
+
+int SpatialHashGrid::CreateProxy(const AABB& aabb, void* userData)
+{
+	int proxyId;
+	if (m_freeList != NULL_PROXY) {
+		proxyId = m_freeList;
+		m_freeList = l_proxies[proxyId].nextFree;
+	}
+	else {
+		proxyId = static_cast<int>(l_proxies.size());
+		l_proxies.push_back(Proxy());
+	}
+
+	Proxy& proxy = l_proxies[proxyId];
+	proxy.aabb = aabb;
+	proxy.userData = userData;
+	proxy.nextFree = NULL_PROXY;
+	proxy.alive = true;
+
+	m_proxyCount++;
+	return proxyId;
+}
+
+void SpatialHashGrid::DestroyProxy(int proxyId)
+{
+	assert(proxyId >= 0 && proxyId < static_cast<int>(l_proxies.size()) && l_proxies[proxyId].alive);
+
+	Proxy& proxy = l_proxies[proxyId];
+	proxy.alive = false;
+	proxy.userData = nullptr;
+	proxy.nextFree = m_freeList;
+	m_freeList = proxyId;
+	m_proxyCount--;
+}
+
+bool SpatialHashGrid::MoveProxy(int proxyId, const AABB& aabb, const XMFLOAT3& /*displacement*/)
+{
+	l_proxies[proxyId].aabb = aabb;
+	return true;
+}
+
+void SpatialHashGrid::BuildCells()
+{
+	l_entryBuckets.clear();
+	l_entryProxies.clear();
+	l_oversizedProxies.clear();
+
+	//Count first so the table can be sized to keep buckets around half full
+	int numEntries = 0;
+	for (int i = 0; i < static_cast<int>(l_proxies.size()); i++) {
+		if (!l_proxies[i].alive) {
+			continue;
+		}
+
+		int cellMin[3];
+		int cellMax[3];
+		CellRange(l_proxies[i].aabb, cellMin, cellMax);
+
+		long long numCells = 1;
+		for (int axis = 0; axis < 3; axis++) {
+			numCells *= static_cast<long long>(cellMax[axis]) - cellMin[axis] + 1;
+		}
+
+		if (numCells > m_maxCellsPerProxy) {
+			l_oversizedProxies.push_back(i);
+		}
+		else {
+			numEntries += static_cast<int>(numCells);
+		}
+	}
+
+	unsigned int bucketCount = 16;
+	while (bucketCount < static_cast<unsigned int>(numEntries) * 2) {
+		bucketCount <<= 1;
+	}
+	m_bucketMask = bucketCount - 1;
+
+	unsigned int nextOversized = 0;
+	for (int i = 0; i < static_cast<int>(l_proxies.size()); i++) {
+		if (!l_proxies[i].alive) {
+			continue;
+		}
+		if (nextOversized < l_oversizedProxies.size() && l_oversizedProxies[nextOversized] == i) {
+			nextOversized++;
+			continue;
+		}
+
+		int cellMin[3];
+		int cellMax[3];
+		CellRange(l_proxies[i].aabb, cellMin, cellMax);
+
+		for (int z = cellMin[2]; z <= cellMax[2]; z++) {
+			for (int y = cellMin[1]; y <= cellMax[1]; y++) {
+				for (int x = cellMin[0]; x <= cellMax[0]; x++) {
+					l_entryBuckets.push_back(HashCell(x, y, z));
+					l_entryProxies.push_back(i);
+				}
+			}
+		}
+	}
+
+	//Counting sort by bucket. It's stable, so if a proxy lands in the same bucket
+	//from two different cells those entries end up next to each other
+	l_bucketStarts.assign(bucketCount + 1, 0);
+	for (int bucket : l_entryBuckets) {
+		l_bucketStarts[bucket + 1]++;
+	}
+	for (unsigned int b = 0; b < bucketCount; b++) {
+		l_bucketStarts[b + 1] += l_bucketStarts[b];
+	}
+
+	l_bucketCursors.assign(l_bucketStarts.begin(), l_bucketStarts.end() - 1);
+	l_bucketEntries.resize(l_entryProxies.size());
+	for (unsigned int i = 0; i < l_entryProxies.size(); i++) {
+		l_bucketEntries[l_bucketCursors[l_entryBuckets[i]]++] = l_entryProxies[i];
+	}
+}
+
+void SpatialHashGrid::ComputePairs(std::vector<BroadphasePair>& outPairs)
+{
+	outPairs.clear();
+	BuildCells();
+
+	int bucketCount = static_cast<int>(l_bucketStarts.size()) - 1;
+	for (int bucket = 0; bucket < bucketCount; bucket++) {
+		int start = l_bucketStarts[bucket];
+		int end = l_bucketStarts[bucket + 1];
+
+		for (int i = start; i < end; i++) {
+			int proxyA = l_bucketEntries[i];
+			//Same proxy from another cell that hashed here
+			if (i > start && l_bucketEntries[i - 1] == proxyA) {
+				continue;
+			}
+
+			const AABB& aabbA = l_proxies[proxyA].aabb;
+
+			for (int j = i + 1; j < end; j++) {
+				int proxyB = l_bucketEntries[j];
+				if (proxyB == proxyA || l_bucketEntries[j - 1] == proxyB) {
+					continue;
+				}
+
+				const AABB& aabbB = l_proxies[proxyB].aabb;
+				if (!aabbA.Overlaps(aabbB)) {
+					continue;
+				}
+
+				//Boxes sharing more than one cell would be found in each of them, so only
+				//report the pair from the cell holding the min corner of their overlap
+				int ownerX = static_cast<int>(floorf(std::max(aabbA.min.x, aabbB.min.x) * m_inverseCellSize));
+				int ownerY = static_cast<int>(floorf(std::max(aabbA.min.y, aabbB.min.y) * m_inverseCellSize));
+				int ownerZ = static_cast<int>(floorf(std::max(aabbA.min.z, aabbB.min.z) * m_inverseCellSize));
+				if (HashCell(ownerX, ownerY, ownerZ) != static_cast<unsigned int>(bucket)) {
+					continue;
+				}
+
+				BroadphasePair pair = { std::min(proxyA, proxyB), std::max(proxyA, proxyB) };
+				outPairs.push_back(pair);
+			}
+		}
+	}
+
+	//Oversized proxies skip the grid and get checked against everything
+	for (unsigned int i = 0; i < l_oversizedProxies.size(); i++) {
+		int proxyA = l_oversizedProxies[i];
+		const AABB& aabbA = l_proxies[proxyA].aabb;
+
+		for (int proxyB = 0; proxyB < static_cast<int>(l_proxies.size()); proxyB++) {
+			if (!l_proxies[proxyB].alive || proxyB == proxyA) {
+				continue;
+			}
+
+			//Two oversized proxies would find each other twice
+			if (proxyB < proxyA && std::binary_search(l_oversizedProxies.begin(), l_oversizedProxies.end(), proxyB)) {
+				continue;
+			}
+
+			if (aabbA.Overlaps(l_proxies[proxyB].aabb)) {
+				BroadphasePair pair = { std::min(proxyA, proxyB), std::max(proxyA, proxyB) };
+				outPairs.push_back(pair);
+			}
+		}
+	}
+}
+
+void SpatialHashGrid::QueryAABB(const AABB& aabb, std::vector<int>& outProxies) const
+{
+	outProxies.clear();
+	for (int proxyId = 0; proxyId < static_cast<int>(l_proxies.size()); proxyId++) {
+		const Proxy& proxy = l_proxies[proxyId];
+		if (proxy.alive && proxy.aabb.Overlaps(aabb)) {
+			outProxies.push_back(proxyId);
+		}
+	}
+}
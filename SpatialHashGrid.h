@@ -0,0 +1,83 @@
+#pragma once
+#include "Broadphase.h"
+
+#include <DirectXMath.h>
+#include <vector>
+
+//Uniform grid broadphase for lots of small, similarly sized colliders. Space is
+//split into cubes of m_cellSize and every proxy goes in each cell its box touches,
+//cells are hashed into a fixed number of buckets so the grid has no bounds.
+//Nothing is kept between updates, ComputePairs counting sorts the proxies into one
+//flat array grouped by bucket and checks everything that shares a bucket. That
+//makes moving things free and keeps the pair search walking memory in order.
+//Proxies that would cover too many cells are kept to the side and checked against everything
+class SpatialHashGrid : public Broadphase
+{
+private:
+	static const int NULL_PROXY = -1;
+
+	struct Proxy
+	{
+		AABB aabb;
+		void* userData;
+
+		//Next free proxy when in the free list
+		int nextFree;
+		bool alive;
+	};
+
+	std::vector<Proxy> l_proxies;
+	int m_freeList;
+	int m_proxyCount;
+
+	float m_cellSize;
+	float m_inverseCellSize;
+	int m_maxCellsPerProxy;
+
+	//Flat cell layout, rebuilt every ComputePairs. Proxies in bucket b are
+	//l_bucketEntries[l_bucketStarts[b]] up to l_bucketEntries[l_bucketStarts[b + 1]]
+	std::vector<int> l_bucketStarts;
+	std::vector<int> l_bucketEntries;
+	//Scratch list of (bucket, proxy) for every cell a proxy touches, in proxy order
+	std::vector<int> l_entryBuckets;
+	std::vector<int> l_entryProxies;
+	//Write position for each bucket while the entries are being placed
+	std::vector<int> l_bucketCursors;
+	//Proxies too big to put in cells
+	std::vector<int> l_oversizedProxies;
+
+	unsigned int m_bucketMask;
+
+	void CellRange(const AABB& aabb, int outMin[3], int outMax[3]) const;
+	unsigned int HashCell(int x, int y, int z) const;
+
+	void BuildCells();
+
+public:
+	SpatialHashGrid(float cellSize = 1.0f, int maxCellsPerProxy = 64);
+	~SpatialHashGrid();
+
+	int CreateProxy(const AABB& aabb, void* userData) override;
+	void DestroyProxy(int proxyId) override;
+
+	//Just stores the new box, the cells are built from scratch when pairs are needed
+	bool MoveProxy(int proxyId, const AABB& aabb, const DirectX::XMFLOAT3& displacement) override;
+
+	void* GetUserData(int proxyId) const override { return l_proxies[proxyId].userData; }
+	const AABB& GetAABB(int proxyId) const { return l_proxies[proxyId].aabb; }
+	int GetProxyCount() const override { return m_proxyCount; }
+
+	//Only reports pairs whose boxes actually overlap
+	void ComputePairs(std::vector<BroadphasePair>& outPairs) override;
+	//Checks every live proxy, the cells are only valid right after ComputePairs
+	void QueryAABB(const AABB& aabb, std::vector<int>& outProxies) const override;
+
+	//Works best around the size of the typical collider
+	void SetCellSize(float cellSize);
+	float GetCellSize() const { return m_cellSize; }
+	int GetOversizedCount() const { return static_cast<int>(l_oversizedProxies.size()); }
+
+	void Clear() override;
+
+	const char* GetName() const override { return "Spatial Hash"; }
+};
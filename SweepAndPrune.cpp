@@ -0,0 +1,385 @@
+#include "SweepAndPrune.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace DirectX;
+
+SweepAndPrune::SweepAndPrune()
+	: m_freeList(NULL_PROXY),
+	m_proxyCount(0),
+	m_needsRebuild(false)
+{
+}
+
+SweepAndPrune::~SweepAndPrune()
+{
+}
+
+void SweepAndPrune::Clear()
+{
+	l_proxies.clear();
+	for (int axis = 0; axis < 3; axis++) {
+		l_endPoints[axis].clear();
+	}
+	l_pairs.clear();
+	m_pairIndices.clear();
+	m_freeList = NULL_PROXY;
+	m_proxyCount = 0;
+	m_needsRebuild = false;
+}
+
+unsigned long long SweepAndPrune::PairKey(int proxyA, int proxyB)
+{
+	return (static_cast<unsigned long long>(proxyA) << 32) | static_cast<unsigned int>(proxyB);
+}
+
+void SweepAndPrune::AddPair(int proxyA, int proxyB)
+{
+	if (proxyA > proxyB) {
+		int temp = proxyA;
+		proxyA = proxyB;
+		proxyB = temp;
+	}
+
+	unsigned long long key = PairKey(proxyA, proxyB);
+	if (m_pairIndices.find(key) != m_pairIndices.end()) {
+		return;
+	}
+
+	m_pairIndices[key] = static_cast<int>(l_pairs.size());
+	BroadphasePair pair = { proxyA, proxyB };
+	l_pairs.push_back(pair);
+}
+
+void SweepAndPrune::RemovePair(int proxyA, int proxyB)
+{
+	if (proxyA > proxyB) {
+		int temp = proxyA;
+		proxyA = proxyB;
+		proxyB = temp;
+	}
+
+	auto it = m_pairIndices.find(PairKey(proxyA, proxyB));
+	if (it == m_pairIndices.end()) {
+		return;
+	}
+
+	//Swap with the back so removing doesn't shift every pair after it
+	int index = it->second;
+	m_pairIndices.erase(it);
+
+	int last = static_cast<int>(l_pairs.size()) - 1;
+	if (index != last) {
+		l_pairs[index] = l_pairs[last];
+		m_pairIndices[PairKey(l_pairs[index].proxyA, l_pairs[index].proxyB)] = index;
+	}
+	l_pairs.pop_back();
+}
+
+void SweepAndPrune::SwapEndPoints(int axis, int indexA, int indexB)
+{
+	std::vector<EndPoint>& endPoints = l_endPoints[axis];
+
+	EndPoint temp = endPoints[indexA];
+	endPoints[indexA] = endPoints[indexB];
+	endPoints[indexB] = temp;
+
+	//Keep the proxies pointing at where their endpoints ended up
+	int indices[2] = { indexA, indexB };
+	for (int i = 0; i < 2; i++) {
+		const EndPoint& endPoint = endPoints[indices[i]];
+		Proxy& proxy = l_proxies[endPoint.GetProxy()];
+		if (endPoint.IsMax()) {
+			proxy.maxIndex[axis] = indices[i];
+		}
+		else {
+			proxy.minIndex[axis] = indices[i];
+		}
+	}
+}
+
+void SweepAndPrune::SortMinDown(int axis, int index, bool updatePairs)
+{
+	std::vector<EndPoint>& endPoints = l_endPoints[axis];
+
+	while (index > 0 && EndPointBefore(endPoints[index], endPoints[index - 1])) {
+		const EndPoint& prev = endPoints[index - 1];
+
+		//Min moving below another max means they start overlapping on this axis
+		if (updatePairs && prev.IsMax()) {
+			int self = endPoints[index].GetProxy();
+			int other = prev.GetProxy();
+			if (l_proxies[self].aabb.Overlaps(l_proxies[other].aabb)) {
+				AddPair(self, other);
+			}
+		}
+
+		SwapEndPoints(axis, index - 1, index);
+		index--;
+	}
+}
+
+void SweepAndPrune::SortMinUp(int axis, int index, bool updatePairs)
+{
+	std::vector<EndPoint>& endPoints = l_endPoints[axis];
+	int last = static_cast<int>(endPoints.size()) - 1;
+
+	while (index < last && EndPointBefore(endPoints[index + 1], endPoints[index])) {
+		const EndPoint& next = endPoints[index + 1];
+
+		//Min moving past another max means they've separated on this axis
+		if (updatePairs && next.IsMax()) {
+			RemovePair(endPoints[index].GetProxy(), next.GetProxy());
+		}
+
+		SwapEndPoints(axis, index, index + 1);
+		index++;
+	}
+}
+
+void SweepAndPrune::SortMaxDown(int axis, int index, bool updatePairs)
+{
+	std::vector<EndPoint>& endPoints = l_endPoints[axis];
+
+	while (index > 0 && EndPointBefore(endPoints[index], endPoints[index - 1])) {
+		const EndPoint& prev = endPoints[index - 1];
+
+		//Max moving below another min means they've separated on this axis
+		if (updatePairs && !prev.IsMax()) {
+			RemovePair(endPoints[index].GetProxy(), prev.GetProxy());
+		}
+
+		SwapEndPoints(axis, index - 1, index);
+		index--;
+	}
+}
+
+void SweepAndPrune::SortMaxUp(int axis, int index, bool updatePairs)
+{
+	std::vector<EndPoint>& endPoints = l_endPoints[axis];
+	int last = static_cast<int>(endPoints.size()) - 1;
+
+	while (index < last && EndPointBefore(endPoints[index + 1], endPoints[index])) {
+		const EndPoint& next = endPoints[index + 1];
+
+		//Max moving past another min means they start overlapping on this axis
+		if (updatePairs && !next.IsMax()) {
+			int self = endPoints[index].GetProxy();
+			int other = next.GetProxy();
+			if (l_proxies[self].aabb.Overlaps(l_proxies[other].aabb)) {
+				AddPair(self, other);
+			}
+		}
+
+		SwapEndPoints(axis, index, index + 1);
+		index++;
+	}
+}
+
+int SweepAndPrune::CreateProxy(const AABB& aabb, void* userData)
+{
+	int proxyId;
+	if (m_freeList != NULL_PROXY) {
+		proxyId = m_freeList;
+		m_freeList = l_proxies[proxyId].nextFree;
+	}
+	else {
+		proxyId = static_cast<int>(l_proxies.size());
+		l_proxies.push_back(Proxy());
+	}
+
+	Proxy& proxy = l_proxies[proxyId];
+	proxy.aabb = aabb;
+	proxy.userData = userData;
+	proxy.nextFree = NULL_PROXY;
+	proxy.alive = true;
+
+	const float* mins = &aabb.min.x;
+	const float* maxs = &aabb.max.x;
+
+	for (int axis = 0; axis < 3; axis++) {
+		std::vector<EndPoint>& endPoints = l_endPoints[axis];
+
+		//Sorted into place and paired up on the next rebuild
+		EndPoint minPoint = { mins[axis], proxyId << 1 };
+		EndPoint maxPoint = { maxs[axis], (proxyId << 1) | 1 };
+		proxy.minIndex[axis] = static_cast<int>(endPoints.size());
+		endPoints.push_back(minPoint);
+		proxy.maxIndex[axis] = static_cast<int>(endPoints.size());
+		endPoints.push_back(maxPoint);
+	}
+
+	m_needsRebuild = true;
+	m_proxyCount++;
+	return proxyId;
+}
+
+void SweepAndPrune::DestroyProxy(int proxyId)
+{
+	assert(proxyId >= 0 && proxyId < static_cast<int>(l_proxies.size()) && l_proxies[proxyId].alive);
+
+	for (int i = static_cast<int>(l_pairs.size()) - 1; i >= 0; i--) {
+		if (l_pairs[i].proxyA == proxyId || l_pairs[i].proxyB == proxyId) {
+			RemovePair(l_pairs[i].proxyA, l_pairs[i].proxyB);
+		}
+	}
+
+	Proxy& proxy = l_proxies[proxyId];
+	for (int axis = 0; axis < 3; axis++) {
+		std::vector<EndPoint>& endPoints = l_endPoints[axis];
+		int minIndex = proxy.minIndex[axis];
+		int maxIndex = proxy.maxIndex[axis];
+
+		//Max is always after min so erase it first to keep minIndex valid
+		endPoints.erase(endPoints.begin() + maxIndex);
+		endPoints.erase(endPoints.begin() + minIndex);
+
+		for (int i = minIndex; i < static_cast<int>(endPoints.size()); i++) {
+			Proxy& shifted = l_proxies[endPoints[i].GetProxy()];
+			if (endPoints[i].IsMax()) {
+				shifted.maxIndex[axis] = i;
+			}
+			else {
+				shifted.minIndex[axis] = i;
+			}
+		}
+	}
+
+	proxy.alive = false;
+	proxy.userData = nullptr;
+	proxy.nextFree = m_freeList;
+	m_freeList = proxyId;
+	m_proxyCount--;
+}
+
+bool SweepAndPrune::MoveProxy(int proxyId, const AABB& aabb, const XMFLOAT3& /*displacement*/)
+{
+	Proxy& proxy = l_proxies[proxyId];
+
+	const float* oldMins = &proxy.aabb.min.x;
+	const float* oldMaxs = &proxy.aabb.max.x;
+	const float* mins = &aabb.min.x;
+	const float* maxs = &aabb.max.x;
+
+	bool moved = false;
+	for (int axis = 0; axis < 3; axis++) {
+		if (oldMins[axis] != mins[axis] || oldMaxs[axis] != maxs[axis]) {
+			moved = true;
+			break;
+		}
+	}
+
+	if (!moved) {
+		return false;
+	}
+
+	//Needs to be updated before sorting since the overlap tests read it
+	proxy.aabb = aabb;
+
+	//Everything gets sorted on the rebuild anyway
+	if (m_needsRebuild) {
+		for (int axis = 0; axis < 3; axis++) {
+			l_endPoints[axis][proxy.minIndex[axis]].value = mins[axis];
+			l_endPoints[axis][proxy.maxIndex[axis]].value = maxs[axis];
+		}
+		return true;
+	}
+
+	for (int axis = 0; axis < 3; axis++) {
+		std::vector<EndPoint>& endPoints = l_endPoints[axis];
+		int minIndex = proxy.minIndex[axis];
+		int maxIndex = proxy.maxIndex[axis];
+
+		float oldMin = endPoints[minIndex].value;
+		float oldMax = endPoints[maxIndex].value;
+		endPoints[minIndex].value = mins[axis];
+		endPoints[maxIndex].value = maxs[axis];
+
+		//Grow first then shrink so a min never has to pass its own max
+		if (mins[axis] < oldMin) {
+			SortMinDown(axis, proxy.minIndex[axis], true);
+		}
+		if (maxs[axis] > oldMax) {
+			SortMaxUp(axis, proxy.maxIndex[axis], true);
+		}
+		if (mins[axis] > oldMin) {
+			SortMinUp(axis, proxy.minIndex[axis], true);
+		}
+		if (maxs[axis] < oldMax) {
+			SortMaxDown(axis, proxy.maxIndex[axis], true);
+		}
+	}
+
+	return true;
+}
+
+void SweepAndPrune::Rebuild()
+{
+	for (int axis = 0; axis < 3; axis++) {
+		std::vector<EndPoint>& endPoints = l_endPoints[axis];
+
+		std::sort(endPoints.begin(), endPoints.end(), EndPointBefore);
+
+		for (int i = 0; i < static_cast<int>(endPoints.size()); i++) {
+			Proxy& proxy = l_proxies[endPoints[i].GetProxy()];
+			if (endPoints[i].IsMax()) {
+				proxy.maxIndex[axis] = i;
+			}
+			else {
+				proxy.minIndex[axis] = i;
+			}
+		}
+	}
+
+	l_pairs.clear();
+	m_pairIndices.clear();
+
+	//Sweep along x keeping a list of the boxes that are open at the current point,
+	//anything that opens while another is still open overlaps it on x
+	l_activeProxies.clear();
+	for (const EndPoint& endPoint : l_endPoints[0]) {
+		int proxyId = endPoint.GetProxy();
+
+		if (endPoint.IsMax()) {
+			for (unsigned int i = 0; i < l_activeProxies.size(); i++) {
+				if (l_activeProxies[i] == proxyId) {
+					l_activeProxies[i] = l_activeProxies.back();
+					l_activeProxies.pop_back();
+					break;
+				}
+			}
+			continue;
+		}
+
+		const AABB& aabb = l_proxies[proxyId].aabb;
+		for (int activeId : l_activeProxies) {
+			if (aabb.Overlaps(l_proxies[activeId].aabb)) {
+				AddPair(proxyId, activeId);
+			}
+		}
+		l_activeProxies.push_back(proxyId);
+	}
+
+	m_needsRebuild = false;
+}
+
+void SweepAndPrune::ComputePairs(std::vector<BroadphasePair>& outPairs)
+{
+	if (m_needsRebuild) {
+		Rebuild();
+	}
+
+	outPairs.assign(l_pairs.begin(), l_pairs.end());
+}
+
+void SweepAndPrune::QueryAABB(const AABB& aabb, std::vector<int>& outProxies) const
+{
+	outProxies.clear();
+	for (int proxyId = 0; proxyId < static_cast<int>(l_proxies.size()); proxyId++) {
+		const Proxy& proxy = l_proxies[proxyId];
+		if (proxy.alive && proxy.aabb.Overlaps(aabb)) {
+			outProxies.push_back(proxyId);
+		}
+	}
+}
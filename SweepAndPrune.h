@@ -0,0 +1,106 @@
+#pragma once
+#include "Broadphase.h"
+
+#include <DirectXMath.h>
+#include <unordered_map>
+#include <vector>
+
+//Sort and sweep broadphase. Every proxy has a min and max endpoint on each axis,
+//kept sorted with insertion sort as things move. Between frames the order barely
+//changes so the sort is close to linear, and every swap of a min past a max (or
+//the other way) is exactly where an overlap begins or ends. The overlapping pairs
+//are kept up to date from those swaps instead of being searched for every update,
+//so mostly static scenes only pay for the things that actually moved.
+//Based on the incremental sweep and prune from Baraff's thesis / Bullet's axis sweep
+class SweepAndPrune : public Broadphase
+{
+private:
+	static const int NULL_PROXY = -1;
+
+	struct EndPoint
+	{
+		float value;
+		//Proxy id shifted left by one with the low bit set for max endpoints
+		int data;
+
+		int GetProxy() const { return data >> 1; }
+		bool IsMax() const { return (data & 1) != 0; }
+	};
+
+	struct Proxy
+	{
+		AABB aabb;
+		void* userData;
+
+		//Where this proxy's endpoints are in each axis list
+		int minIndex[3];
+		int maxIndex[3];
+
+		//Next free proxy when in the free list
+		int nextFree;
+		bool alive;
+	};
+
+	std::vector<Proxy> l_proxies;
+	std::vector<EndPoint> l_endPoints[3];
+	int m_freeList;
+	int m_proxyCount;
+
+	//Live overlapping pairs, the map goes from a pair's key to where it is in l_pairs
+	std::vector<BroadphasePair> l_pairs;
+	std::unordered_map<unsigned long long, int> m_pairIndices;
+
+	//New proxies are just appended, sorting them in one at a time is quadratic when a
+	//whole scene gets added at once. The next ComputePairs does a full sort and sweep
+	bool m_needsRebuild;
+	std::vector<int> l_activeProxies;
+
+	static unsigned long long PairKey(int proxyA, int proxyB);
+
+	//Sort order of the endpoint lists. Mins go before maxes on ties so boxes that only touch
+	//count as overlapping, same as AABB::Overlaps. The rebuild and the insertion sorts both use
+	//it so a touching pair is found the same way whichever of them last ran
+	static bool EndPointBefore(const EndPoint& a, const EndPoint& b)
+	{
+		return a.value < b.value || (a.value == b.value && !a.IsMax() && b.IsMax());
+	}
+
+	void AddPair(int proxyA, int proxyB);
+	void RemovePair(int proxyA, int proxyB);
+
+	//Insertion sort passes for a single endpoint, adding or removing pairs as it crosses other endpoints
+	void SortMinDown(int axis, int index, bool updatePairs);
+	void SortMinUp(int axis, int index, bool updatePairs);
+	void SortMaxDown(int axis, int index, bool updatePairs);
+	void SortMaxUp(int axis, int index, bool updatePairs);
+
+	void SwapEndPoints(int axis, int indexA, int indexB);
+
+	//Fully sorts every axis and finds all pairs from scratch with one sweep
+	void Rebuild();
+
+public:
+	SweepAndPrune();
+	~SweepAndPrune();
+
+	int CreateProxy(const AABB& aabb, void* userData) override;
+	void DestroyProxy(int proxyId) override;
+
+	//Displacement isn't needed, the sort only moves what actually changed
+	bool MoveProxy(int proxyId, const AABB& aabb, const DirectX::XMFLOAT3& displacement) override;
+
+	void* GetUserData(int proxyId) const override { return l_proxies[proxyId].userData; }
+	const AABB& GetAABB(int proxyId) const { return l_proxies[proxyId].aabb; }
+	int GetProxyCount() const override { return m_proxyCount; }
+
+	//Pairs are already up to date so this is just a copy
+	void ComputePairs(std::vector<BroadphasePair>& outPairs) override;
+	int GetPairCount() const { return static_cast<int>(l_pairs.size()); }
+
+	//Checks every live proxy, the endpoint lists can't narrow down a box on their own
+	void QueryAABB(const AABB& aabb, std::vector<int>& outProxies) const override;
+
+	void Clear() override;
+
+	const char* GetName() const override { return "Sweep and Prune"; }
+};
@@ -1,18 +1,101 @@
 #include "Transform.h"
 
+#include <cassert>
+#include <cmath>
+
 using namespace DirectX;
 
+namespace
+{
+#if defined(_DEBUG)
+	//Checks the inverse transpose worked out from the scale and rotation against a general inverse
+	bool MatchesGeneralInverseTranspose(FXMMATRIX world, CXMMATRIX invTranspose)
+	{
+		//Nothing to compare against for a flattened matrix
+		if (fabsf(XMVectorGetX(XMMatrixDeterminant(world))) < 1e-12f)
+			return true;
+
+		XMMATRIX general = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
+		float size = 1.0f;
+		float error = 0.0f;
+		for (int i = 0; i < 3; i++) {
+			size = fmaxf(size, XMVectorGetX(XMVector3LengthSq(general.r[i])));
+			error = fmaxf(error, XMVectorGetX(XMVector3LengthSq(general.r[i] - invTranspose.r[i])));
+		}
+		return error <= 1e-6f * size;
+	}
+#endif
+
+	//Never freed, transforms owned by other statics still take themselves off it when they're
+	//destroyed at shutdown
+	std::vector<Transform*>& ChangedThisFrame()
+	{
+		static std::vector<Transform*>* s_changed = new std::vector<Transform*>();
+		return *s_changed;
+	}
+}
+
+unsigned int Transform::s_frame = 0;
+
 Transform::Transform()
+	: m_pParent(nullptr),
+	m_changedIndex(-1)
 {
 	SetPosition(0, 0, 0);
 	SetRotation(0, 0, 0);
 	SetScale(1, 1, 1);
 	RecalcNormals();
 
-	XMStoreFloat4x4(&m_m4WorldMatrix, XMMatrixIdentity());
-	XMStoreFloat4x4(&m_m4WorldInverseTranspose, XMMatrixIdentity());
+	XMStoreFloat3x4(&m_m34WorldMatrix, XMMatrixIdentity());
+	XMStoreFloat3x4(&m_m34WorldInverseTranspose, XMMatrixIdentity());
+	m_bUniformWorldScale = true;
 	m_bRecalcWorld = false;
-	m_pParent = nullptr;
+}
+
+Transform::Transform(const Transform& other)
+	: m_changedIndex(-1)
+{
+	*this = other;
+}
+
+Transform& Transform::operator=(const Transform& other)
+{
+	if (this == &other)
+		return *this;
+
+	m_pParent = other.m_pParent;
+	m_lChildren = other.m_lChildren;
+	m_v3Position = other.m_v3Position;
+	m_v3EulerAngles = other.m_v3EulerAngles;
+	m_v3Scale = other.m_v3Scale;
+	m_v4RotationQuat = other.m_v4RotationQuat;
+	m_v3Forward = other.m_v3Forward;
+	m_v3Up = other.m_v3Up;
+	m_v3Right = other.m_v3Right;
+	m_m34WorldMatrix = other.m_m34WorldMatrix;
+	m_m34WorldInverseTranspose = other.m_m34WorldInverseTranspose;
+	m_bUniformWorldScale = other.m_bUniformWorldScale;
+	m_bRecalcWorld = other.m_bRecalcWorld;
+	m_bRecalcNormals = other.m_bRecalcNormals;
+	m_bRecalcEuler = other.m_bRecalcEuler;
+
+	if (other.m_changedIndex != -1)
+		MarkChanged();
+
+	return *this;
+}
+
+Transform::~Transform()
+{
+	if (m_changedIndex == -1)
+		return;
+
+	//Swaps the last one into this spot so it doesn't have to search or shift the list
+	std::vector<Transform*>& changed = ChangedThisFrame();
+	Transform* last = changed.back();
+	changed[m_changedIndex] = last;
+	last->m_changedIndex = m_changedIndex;
+	changed.pop_back();
 }
 
 void Transform::MoveAbsolute(float x, float y, float z)
@@ -21,8 +104,7 @@ void Transform::MoveAbsolute(float x, float y, float z)
 	XMVECTOR offset = XMVectorSet(x, y, z, 0);
 	XMStoreFloat3(&m_v3Position, pos + offset);
 
-	m_bRecalcWorld = true;
-	MarkChildrenDirty();
+	MarkWorldDirty();
 }
 
 void Transform::MoveRelative(float x, float y, float z)
@@ -38,19 +120,43 @@ void Transform::MoveRelative(float x, float y, float z)
 	XMVECTOR pos = XMLoadFloat3(&m_v3Position);
 	XMStoreFloat3(&m_v3Position, pos + rotatedVec);
 
-	m_bRecalcWorld = true;
-	MarkChildrenDirty();
+	MarkWorldDirty();
 }
 
 void Transform::Rotate(float p, float y, float r)
 {
-	XMVECTOR rot = XMLoadFloat3(&m_v3EulerAngles);
-	XMVECTOR offset = XMVectorSet(p, y, r, 0);
-	XMStoreFloat3(&m_v3EulerAngles, rot + offset);
+	//Pitch and roll turn around the local axes and yaw around the parent's up. That's the same as
+	//adding to the Euler angles while roll is 0, so cameras and single axis spins turn like they did
+	XMVECTOR local = XMQuaternionRotationRollPitchYaw(p, 0, r);
+	XMVECTOR yaw = XMQuaternionRotationRollPitchYaw(0, y, 0);
+	XMVECTOR rotation = XMQuaternionMultiply(XMQuaternionMultiply(local, XMLoadFloat4(&m_v4RotationQuat)), yaw);
+	XMStoreFloat4(&m_v4RotationQuat, XMQuaternionNormalize(rotation));
+
+	m_bRecalcEuler = true;
+	m_bRecalcNormals = true;
+	MarkWorldDirty();
+}
 
-	m_bRecalcWorld = true;
+void Transform::RotateAxisAngle(DirectX::XMFLOAT3 axis, float angle)
+{
+	RotateQuat(XMQuaternionRotationAxis(XMLoadFloat3(&axis), angle));
+}
+
+void Transform::RotateQuat(DirectX::XMFLOAT4 rotQuat)
+{
+	RotateQuat(XMLoadFloat4(&rotQuat));
+}
+
+void Transform::RotateQuat(DirectX::FXMVECTOR rotQuat)
+{
+	//Applied before the current rotation so it turns around the transform's own axes. Normalized
+	//so small rotations added up every frame don't drift away from unit length
+	XMVECTOR rotation = XMQuaternionMultiply(rotQuat, XMLoadFloat4(&m_v4RotationQuat));
+	XMStoreFloat4(&m_v4RotationQuat, XMQuaternionNormalize(rotation));
+
+	m_bRecalcEuler = true;
 	m_bRecalcNormals = true;
-	MarkChildrenDirty();
+	MarkWorldDirty();
 }
 
 void Transform::Scale(float x, float y, float z)
@@ -59,8 +165,7 @@ void Transform::Scale(float x, float y, float z)
 	XMVECTOR offset = XMVectorSet(x, y, z, 0);
 	XMStoreFloat3(&m_v3Scale, scale * offset);
 
-	m_bRecalcWorld = true;
-	MarkChildrenDirty();
+	MarkWorldDirty();
 }
 
 void Transform::Scale(float scalar)
@@ -68,8 +173,7 @@ void Transform::Scale(float scalar)
 	XMVECTOR scale = XMLoadFloat3(&m_v3Scale);
 	XMStoreFloat3(&m_v3Scale, scale * scalar);
 
-	m_bRecalcWorld = true;
-	MarkChildrenDirty();
+	MarkWorldDirty();
 }
 
 void Transform::SetPosition(float x, float y, float z)
@@ -78,34 +182,39 @@ void Transform::SetPosition(float x, float y, float z)
 	m_v3Position.y = y;
 	m_v3Position.z = z;
 
-	m_bRecalcWorld = true;
-	MarkChildrenDirty();
+	MarkWorldDirty();
 }
 
 void Transform::SetPosition(DirectX::XMFLOAT3 newPos)
 {
 	m_v3Position = newPos;
-	m_bRecalcWorld = true;
-	MarkChildrenDirty();
+	MarkWorldDirty();
 }
 
 void Transform::SetRotation(float p, float y, float r)
 {
+	//Kept as given so the inspector shows what was typed rather than an equivalent set of angles
 	m_v3EulerAngles.x = p;
 	m_v3EulerAngles.y = y;
 	m_v3EulerAngles.z = r;
+	XMStoreFloat4(&m_v4RotationQuat, XMQuaternionRotationRollPitchYaw(p, y, r));
 
-	m_bRecalcWorld = true;
+	m_bRecalcEuler = false;
 	m_bRecalcNormals = true;
-	MarkChildrenDirty();
+	MarkWorldDirty();
 }
 
 void Transform::SetRotation(DirectX::XMFLOAT3 newRot)
 {
-	m_v3EulerAngles = newRot;
-	m_bRecalcWorld = true;
+	SetRotation(newRot.x, newRot.y, newRot.z);
+}
+
+void Transform::SetRotationQuat(DirectX::XMFLOAT4 newRotQuat)
+{
+	m_v4RotationQuat = newRotQuat;
+	m_bRecalcEuler = true;
 	m_bRecalcNormals = true;
-	MarkChildrenDirty();
+	MarkWorldDirty();
 }
 
 void Transform::SetScale(float x, float y, float z)
@@ -114,15 +223,13 @@ void Transform::SetScale(float x, float y, float z)
 	m_v3Scale.y = y;
 	m_v3Scale.z = z;
 
-	m_bRecalcWorld = true;
-	MarkChildrenDirty();
+	MarkWorldDirty();
 }
 
 void Transform::SetScale(DirectX::XMFLOAT3 newScale)
 {
 	m_v3Scale = newScale;
-	m_bRecalcWorld = true;
-	MarkChildrenDirty();
+	MarkWorldDirty();
 }
 
 void Transform::SetTransformsFromMatrix(DirectX::XMFLOAT4X4 newWorldMatrix)
@@ -134,16 +241,23 @@ void Transform::SetTransformsFromMatrix(DirectX::XMFLOAT4X4 newWorldMatrix)
 
 	XMMatrixDecompose(&scale, &rotation, &position, XMLoadFloat4x4(&newWorldMatrix));
 
-	//Makes sure to store both the Euler and quaternion
 	XMStoreFloat4(&m_v4RotationQuat, rotation);
-	m_v3EulerAngles = QuatToEuler(m_v4RotationQuat);
+	m_bRecalcEuler = true;
 
 	XMStoreFloat3(&m_v3Position, position);
 	XMStoreFloat3(&m_v3Scale, scale);
 
-	m_bRecalcWorld = true;
 	m_bRecalcNormals = true;
-	MarkChildrenDirty();
+	MarkWorldDirty();
+}
+
+DirectX::XMFLOAT3 Transform::GetEulerAngles()
+{
+	if (m_bRecalcEuler) {
+		m_v3EulerAngles = QuatToEuler(m_v4RotationQuat);
+		m_bRecalcEuler = false;
+	}
+	return m_v3EulerAngles;
 }
 
 DirectX::XMFLOAT3 Transform::GetForward()
@@ -167,13 +281,29 @@ DirectX::XMFLOAT3 Transform::GetRight()
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
 {
 	RecalcWorldAndInverseTranspose();
-	return m_m4WorldMatrix;
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMLoadFloat3x4(&m_m34WorldMatrix));
+	return world;
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
 {
 	RecalcWorldAndInverseTranspose();
-	return m_m4WorldInverseTranspose;
+	XMFLOAT4X4 invTranspose;
+	XMStoreFloat4x4(&invTranspose, XMLoadFloat3x4(&m_m34WorldInverseTranspose));
+	return invTranspose;
+}
+
+DirectX::XMFLOAT3X4 Transform::GetWorldMatrix3x4()
+{
+	RecalcWorldAndInverseTranspose();
+	return m_m34WorldMatrix;
+}
+
+DirectX::XMFLOAT3X4 Transform::GetWorldInverseTranspose3x4()
+{
+	RecalcWorldAndInverseTranspose();
+	return m_m34WorldInverseTranspose;
 }
 
 void Transform::AddChild(Transform* child, bool makeRelative)
@@ -205,9 +335,8 @@ void Transform::AddChild(Transform* child, bool makeRelative)
 	m_lChildren.push_back(child);
 	child->m_pParent = this;
 
-	child->m_bRecalcWorld = true;
 	child->m_bRecalcNormals = true;
-	child->MarkChildrenDirty();
+	child->MarkWorldDirty();
 }
 
 void Transform::RemoveChild(Transform* child)
@@ -222,9 +351,8 @@ void Transform::RemoveChild(Transform* child)
 
 	m_lChildren.erase(m_lChildren.begin() + childIndex);
 	child->m_pParent = nullptr;
-	child->m_bRecalcWorld = true;
 	child->m_bRecalcNormals = true;
-	child->MarkChildrenDirty();
+	child->MarkWorldDirty();
 }
 
 Transform* Transform::RemoveChildByIndex(unsigned int index)
@@ -236,9 +364,8 @@ Transform* Transform::RemoveChildByIndex(unsigned int index)
 	m_lChildren.erase(m_lChildren.begin() + index);
 
 	removedChild->m_pParent = nullptr;
-	removedChild->m_bRecalcWorld = true;
 	removedChild->m_bRecalcNormals = true;
-	removedChild->MarkChildrenDirty();
+	removedChild->MarkWorldDirty();
 
 	return removedChild;
 }
@@ -256,31 +383,103 @@ void Transform::SetParent(Transform* newParent)
 void Transform::MarkChildrenDirty()
 {
 	for (auto& child : m_lChildren) {
-		child->m_bRecalcWorld = true;
-		child->m_bRecalcNormals = true;
+		child->MarkWorldDirty();
 	}
 }
 
+void Transform::MarkWorldDirty()
+{
+	//A world matrix only gets rebuilt after its parent's, so everything under a flagged transform
+	//is flagged too. If this one's already flagged and listed this frame so is its whole subtree
+	if (m_bRecalcWorld && m_changedIndex != -1)
+		return;
+
+	m_bRecalcWorld = true;
+	MarkChanged();
+	MarkChildrenDirty();
+}
+
+void Transform::MarkChanged()
+{
+	if (m_changedIndex != -1)
+		return;
+
+	std::vector<Transform*>& changed = ChangedThisFrame();
+	m_changedIndex = static_cast<int>(changed.size());
+	changed.push_back(this);
+}
+
+void Transform::BeginFrame()
+{
+	std::vector<Transform*>& changed = ChangedThisFrame();
+	for (Transform* transform : changed) {
+		transform->m_changedIndex = -1;
+	}
+	changed.clear();
+	s_frame++;
+}
+
+const std::vector<Transform*>& Transform::GetChangedThisFrame()
+{
+	return ChangedThisFrame();
+}
+
 void Transform::RecalcWorldAndInverseTranspose()
 {
 	if (!m_bRecalcWorld)
 		return;
 
-	XMMATRIX translation = XMMatrixTranslation(m_v3Position.x, m_v3Position.y, m_v3Position.z);
-	XMMATRIX rotation = XMMatrixRotationRollPitchYaw(m_v3EulerAngles.x, m_v3EulerAngles.y, m_v3EulerAngles.z);
-	XMMATRIX scale = XMMatrixScaling(m_v3Scale.x, m_v3Scale.y, m_v3Scale.z);
+	XMMATRIX rotation = XMMatrixRotationQuaternion(XMLoadFloat4(&m_v4RotationQuat));
+
+	//Scale then rotate then move. Scaling first just stretches each row of the rotation
+	XMMATRIX worldMat;
+	worldMat.r[0] = rotation.r[0] * m_v3Scale.x;
+	worldMat.r[1] = rotation.r[1] * m_v3Scale.y;
+	worldMat.r[2] = rotation.r[2] * m_v3Scale.z;
+	worldMat.r[3] = XMVectorSet(m_v3Position.x, m_v3Position.y, m_v3Position.z, 1.0f);
 
-	XMMATRIX worldMat = scale * rotation * translation;
+	bool uniformScale = m_v3Scale.x == m_v3Scale.y && m_v3Scale.y == m_v3Scale.z;
 
 	// Is there a parent?
 	if (m_pParent)
 	{
-		XMFLOAT4X4 parentWorld = m_pParent->GetWorldMatrix();
-		worldMat *= XMLoadFloat4x4(&parentWorld);
+		m_pParent->RecalcWorldAndInverseTranspose();
+		worldMat *= XMLoadFloat3x4(&m_pParent->m_m34WorldMatrix);
+		uniformScale = uniformScale && m_pParent->m_bUniformWorldScale;
+	}
+
+	//Only the 3x3 part matters for normals, translation is left out
+	XMMATRIX invTranspose = XMMatrixIdentity();
+	if (uniformScale)
+	{
+		//World is s * R, so the inverse transpose is R / s, which is just the world over s^2
+		float scaleSq = XMVectorGetX(XMVector3LengthSq(worldMat.r[0]));
+		float invScaleSq = scaleSq > 0.0f ? 1.0f / scaleSq : 0.0f;
+		for (int i = 0; i < 3; i++) {
+			invTranspose.r[i] = worldMat.r[i] * invScaleSq;
+		}
 	}
+	else
+	{
+		//A rotation's inverse transpose is itself and a scale's is one over it, so for S * R it's
+		//the rotation rows over the scale. Under a parent it's that times the parent's, the same
+		//way the world matrix is built
+		const float* scale = &m_v3Scale.x;
+		for (int i = 0; i < 3; i++) {
+			invTranspose.r[i] = rotation.r[i] * (scale[i] != 0.0f ? 1.0f / scale[i] : 0.0f);
+		}
+		if (m_pParent) {
+			invTranspose *= XMLoadFloat3x4(&m_pParent->m_m34WorldInverseTranspose);
+		}
+	}
+
+#if defined(_DEBUG)
+	assert(MatchesGeneralInverseTranspose(worldMat, invTranspose));
+#endif
 
-	XMStoreFloat4x4(&m_m4WorldMatrix, worldMat);
-	XMStoreFloat4x4(&m_m4WorldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(worldMat)));
+	XMStoreFloat3x4(&m_m34WorldMatrix, worldMat);
+	XMStoreFloat3x4(&m_m34WorldInverseTranspose, invTranspose);
+	m_bUniformWorldScale = uniformScale;
 	m_bRecalcWorld = false;
 }
 
@@ -290,24 +489,11 @@ void Transform::RecalcNormals()
 	if (!m_bRecalcNormals)
 		return;
 
-	XMVECTOR rotationQuat = XMQuaternionRotationRollPitchYaw(m_v3EulerAngles.x, m_v3EulerAngles.y, m_v3EulerAngles.z);
-	//Storing rotation quaternion for other use since it's already being calculated here every time
-	XMStoreFloat4(&m_v4RotationQuat, rotationQuat);
-
-	//Recalculates Forward Vector
-	XMStoreFloat3(&m_v3Forward, XMVector3Rotate(
-		XMVectorSet(0, 0, 1, 0),
-		rotationQuat));
-
-	//Recalculates Up Vector
-	XMStoreFloat3(&m_v3Up, XMVector3Rotate(
-		XMVectorSet(0, 1, 0, 0),
-		rotationQuat));
-
-	//Recalculates Right Vector
-	XMStoreFloat3(&m_v3Right, XMVector3Rotate(
-		XMVectorSet(1, 0, 0, 0),
-		rotationQuat));
+	//Rows of the rotation matrix are the local right, up and forward axes, no need to rotate each one
+	XMMATRIX rotation = XMMatrixRotationQuaternion(XMLoadFloat4(&m_v4RotationQuat));
+	XMStoreFloat3(&m_v3Right, rotation.r[0]);
+	XMStoreFloat3(&m_v3Up, rotation.r[1]);
+	XMStoreFloat3(&m_v3Forward, rotation.r[2]);
 
 	m_bRecalcNormals = false;
 }
@@ -10,27 +10,46 @@ private:
 	std::vector<Transform*> m_lChildren;
 
 	DirectX::XMFLOAT3 m_v3Position;
-	DirectX::XMFLOAT3 m_v3EulerAngles;
 	DirectX::XMFLOAT3 m_v3Scale;
 
+	//The rotation everything is built from
 	DirectX::XMFLOAT4 m_v4RotationQuat;
+	//Only worked out from the quaternion when something asks for it, mostly the inspector
+	DirectX::XMFLOAT3 m_v3EulerAngles;
 
 	//Transform directions
 	DirectX::XMFLOAT3 m_v3Forward;
 	DirectX::XMFLOAT3 m_v3Up;
 	DirectX::XMFLOAT3 m_v3Right;
 
-	DirectX::XMFLOAT4X4 m_m4WorldMatrix;
-	DirectX::XMFLOAT4X4 m_m4WorldInverseTranspose;
+	//World matrix and its inverse transpose without the last column, which is always (0, 0, 0, 1)
+	//for a TRS. Stored transposed as three rows of four, which is how the vertex shaders take them
+	DirectX::XMFLOAT3X4 m_m34WorldMatrix;
+	DirectX::XMFLOAT3X4 m_m34WorldInverseTranspose;
+	//Is the world matrix scaled the same on every axis, parents included
+	bool m_bUniformWorldScale;
 
 	//Does matrix need an update
 	bool m_bRecalcWorld;
 	//Do the normals need an update;
 	bool m_bRecalcNormals;
+	//Are the Euler angles behind the quaternion
+	bool m_bRecalcEuler;
+
+	//Where this is in the changed this frame list, -1 if it hasn't changed since BeginFrame
+	int m_changedIndex;
+	//Bumped by every BeginFrame
+	static unsigned int s_frame;
 
-	//Recalcutaes the m_m4WorldMatrix and m_m4WorldInverseTranspose member variables
+	//Flags the world matrix of this and every descendant, and puts any that weren't already on it
+	//on the changed this frame list
+	void MarkWorldDirty();
+	void MarkChanged();
+
+	//Recalcutaes the m_m34WorldMatrix and m_m34WorldInverseTranspose member variables
 	//based on the values of the position, scale, and rotation the Transform is 
-	//currently in.
+	//currently in. The inverse transpose comes straight from the scale and rotation
+	//instead of a general inverse.
 	void RecalcWorldAndInverseTranspose();
 
 	//Recalculates the Forward, Right, and Up vectors
@@ -40,6 +59,11 @@ private:
 
 public:
 	Transform();
+	//Copies everything but the spot on the changed list, a copy of something that changed this frame
+	//gets its own spot
+	Transform(const Transform& other);
+	Transform& operator=(const Transform& other);
+	~Transform();
 
 	void MoveAbsolute(float x, float y, float z);
 	void MoveAbsolute(DirectX::XMFLOAT3 absoluteMoveVec) { this->MoveAbsolute(absoluteMoveVec.x, absoluteMoveVec.y, absoluteMoveVec.z); };
@@ -49,6 +73,11 @@ public:
 
 	void Rotate(float p, float y, float r);
 	void Rotate(DirectX::XMFLOAT3 rotateVec) { this->Rotate(rotateVec.x, rotateVec.y, rotateVec.z); };
+	//Turns around an axis in the transform's own space, axis has to be normalized
+	void RotateAxisAngle(DirectX::XMFLOAT3 axis, float angle);
+	//Applies rotQuat in the transform's own space, on top of the current rotation
+	void RotateQuat(DirectX::XMFLOAT4 rotQuat);
+	void RotateQuat(DirectX::FXMVECTOR rotQuat);
 
 	void Scale(float x, float y, float z);
 	void Scale(float scalar);
@@ -57,13 +86,17 @@ public:
 	void SetPosition(DirectX::XMFLOAT3 newPos);
 	void SetRotation(float p, float y, float r);
 	void SetRotation(DirectX::XMFLOAT3 newRot);
+	//Has to be normalized
+	void SetRotationQuat(DirectX::XMFLOAT4 newRotQuat);
 	void SetScale(float x, float y, float z);
 	void SetScale(DirectX::XMFLOAT3 newScale);
 	void SetTransformsFromMatrix(DirectX::XMFLOAT4X4 newWorldMatrix);
 
 	DirectX::XMFLOAT3 GetPosition() const { return m_v3Position; }
-	DirectX::XMFLOAT3 GetEulerAngles() const { return m_v3EulerAngles; }
-	DirectX::XMFLOAT3 GetRotation() const { return m_v3EulerAngles; }
+	//Derived from the quaternion, only pitch in [-pi/2, pi/2] comes back so a turn past straight up
+	//shows as a different but equal set of angles
+	DirectX::XMFLOAT3 GetEulerAngles();
+	DirectX::XMFLOAT3 GetRotation() { return GetEulerAngles(); }
 	DirectX::XMFLOAT3 GetScale() const { return m_v3Scale; }
 
 	DirectX::XMFLOAT4 GetRotationQuat() const { return m_v4RotationQuat; }
@@ -73,12 +106,19 @@ public:
 	DirectX::XMFLOAT3 GetRight();
 
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
+	//Only the 3x3 part that normals use is filled in, the translation column is left at 0
 	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
+	//Same matrices in the compact layout, 48 bytes each instead of 64. Ready to copy into a
+	//row_major float3x4 in a shader's constant buffer
+	DirectX::XMFLOAT3X4 GetWorldMatrix3x4();
+	DirectX::XMFLOAT3X4 GetWorldInverseTranspose3x4();
 
 	void AddChild(Transform* child, bool makeRelative = true);
 	void RemoveChild(Transform* child);
 	Transform* RemoveChildByIndex(unsigned int index);
 	void SetParent(Transform* newParent);
+	//Flags every descendant, not just the direct children, but stops at any that are already flagged
+	//so it only walks the part of the hierarchy that actually changed
 	void MarkChildrenDirty();
 
 	Transform* GetParent() const { return m_pParent; }
@@ -92,7 +132,17 @@ public:
 		return -1;
 	}
 
-	bool IsWorldDirty() { return m_bRecalcWorld; }
+	bool IsWorldDirty() const { return m_bRecalcWorld; }
+
+	//Whether this world matrix changed since the last BeginFrame, either from its own values or
+	//any of its parents'. Transforms made this frame count as changed
+	bool HasChangedThisFrame() const { return m_changedIndex != -1; }
+
+	//Clears the changed this frame list, call once at the start of each frame before anything moves
+	static void BeginFrame();
+	//Every transform that changed since the last BeginFrame, each only once
+	static const std::vector<Transform*>& GetChangedThisFrame();
+	static unsigned int GetFrame() { return s_frame; }
 
 };
 
@@ -0,0 +1,323 @@
+#include "TransformBenchmarks.h"
+#include "JobSystem.h"
+#include "Transform.h"
+#include "TransformStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock BenchClock;
+
+	const int BENCH_TRANSFORMS = 100000;
+	const int BENCH_FRAMES = 20;
+
+	double MillisecondsSince(BenchClock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+	}
+
+	//Nodes with their parent always earlier in the list, each spinning at its own rate
+	struct HierarchyScene
+	{
+		std::vector<int> l_parents;
+		std::vector<XMFLOAT3> l_positions;
+		std::vector<XMFLOAT3> l_scales;
+		std::vector<XMFLOAT3> l_spins;
+		//This frame's rotation of each node
+		std::vector<XMFLOAT4> l_rotations;
+
+		//chainLength 1 is all roots
+		HierarchyScene(int count, int chainLength, unsigned int seed, bool uniformScale = false)
+		{
+			std::mt19937 rng(seed);
+			std::uniform_real_distribution<float> posDist(-1.0f, 1.0f);
+			std::uniform_real_distribution<float> scaleDist(0.8f, 1.25f);
+			std::uniform_real_distribution<float> spinDist(-0.05f, 0.05f);
+
+			for (int i = 0; i < count; i++) {
+				bool root = i % chainLength == 0;
+				l_parents.push_back(root ? -1 : i - 1);
+				//Roots spread out, children a short step along from their parent
+				float spread = root ? 100.0f : 1.0f;
+				l_positions.push_back(XMFLOAT3(posDist(rng) * spread, posDist(rng) * spread, posDist(rng) * spread));
+				float scale = scaleDist(rng);
+				l_scales.push_back(uniformScale ? XMFLOAT3(scale, scale, scale) : XMFLOAT3(scale, scaleDist(rng), scaleDist(rng)));
+				l_spins.push_back(XMFLOAT3(spinDist(rng), spinDist(rng), spinDist(rng)));
+			}
+			l_rotations.resize(count);
+			Animate(0);
+		}
+
+		int Size() const { return static_cast<int>(l_parents.size()); }
+
+		void Animate(int frame)
+		{
+			for (int i = 0; i < Size(); i++) {
+				XMStoreFloat4(&l_rotations[i], XMQuaternionRotationRollPitchYaw(l_spins[i].x * frame, l_spins[i].y * frame, l_spins[i].z * frame));
+			}
+		}
+	};
+
+	//Largest difference between the two paths' world matrices, relative to how big the matrix is
+	float CompareWorlds(std::vector<Transform>& transforms, const TransformStore& store, const std::vector<int>& handles)
+	{
+		float maxError = 0.0f;
+		for (unsigned int i = 0; i < transforms.size(); i++) {
+			XMFLOAT4X4 objectWorld = transforms[i].GetWorldMatrix();
+			XMFLOAT4X4 storeWorld = store.GetWorldMatrix(handles[i]);
+
+			float size = 1.0f;
+			float error = 0.0f;
+			for (int r = 0; r < 4; r++) {
+				for (int c = 0; c < 4; c++) {
+					size = std::max(size, fabsf(objectWorld.m[r][c]));
+					error = std::max(error, fabsf(objectWorld.m[r][c] - storeWorld.m[r][c]));
+				}
+			}
+			maxError = std::max(maxError, error / size);
+		}
+		return maxError;
+	}
+
+	//Builds every world matrix and inverse transpose through the Transform objects, then times a
+	//general inverse of the same world matrices and checks the two agree
+	std::string RunInverseTranspose(int chainLength, bool uniformScale, const char* label)
+	{
+		HierarchyScene scene(BENCH_TRANSFORMS, chainLength, 11, uniformScale);
+		int count = scene.Size();
+
+		std::vector<Transform> transforms(count);
+		for (int i = 0; i < count; i++) {
+			transforms[i].SetPosition(scene.l_positions[i]);
+			transforms[i].SetScale(scene.l_scales[i]);
+			if (scene.l_parents[i] >= 0) {
+				transforms[scene.l_parents[i]].AddChild(&transforms[i], false);
+			}
+		}
+
+		std::vector<XMFLOAT4X4> general(count);
+		double transformMs = 0.0;
+		double generalMs = 0.0;
+		float checksum = 0.0f;
+		for (int frame = 1; frame <= BENCH_FRAMES; frame++) {
+			scene.Animate(frame);
+			for (int i = 0; i < count; i++) {
+				transforms[i].SetRotationQuat(scene.l_rotations[i]);
+			}
+
+			BenchClock::time_point start = BenchClock::now();
+			for (int i = 0; i < count; i++) {
+				checksum += transforms[i].GetWorldInverseTransposeMatrix()._11;
+			}
+			transformMs += MillisecondsSince(start);
+
+			start = BenchClock::now();
+			for (int i = 0; i < count; i++) {
+				XMFLOAT4X4 world = transforms[i].GetWorldMatrix();
+				XMStoreFloat4x4(&general[i], XMMatrixTranspose(XMMatrixInverse(nullptr, XMLoadFloat4x4(&world))));
+			}
+			generalMs += MillisecondsSince(start);
+		}
+
+		//Only the 3x3 part is kept, it's all normals use
+		float maxError = 0.0f;
+		for (int i = 0; i < count; i++) {
+			XMFLOAT4X4 invTranspose = transforms[i].GetWorldInverseTransposeMatrix();
+			float size = 1.0f;
+			float error = 0.0f;
+			for (int r = 0; r < 3; r++) {
+				for (int c = 0; c < 3; c++) {
+					size = std::max(size, fabsf(general[i].m[r][c]));
+					error = std::max(error, fabsf(invTranspose.m[r][c] - general[i].m[r][c]));
+				}
+			}
+			maxError = std::max(maxError, error / size);
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %-22s rebuild with inverse transpose %7.3f ms/frame, general inverse alone %7.3f ms/frame, max error %.2e%s\n",
+			label,
+			transformMs / BENCH_FRAMES,
+			generalMs / BENCH_FRAMES,
+			maxError,
+			checksum == checksum ? "" : " (nan)");
+		return line;
+	}
+
+	//Animates every moveEvery'th node each frame and gets every world matrix out both ways
+	std::string RunHierarchy(int chainLength, int moveEvery, const char* label)
+	{
+		HierarchyScene scene(BENCH_TRANSFORMS, chainLength, 11);
+		int count = scene.Size();
+
+		//Transforms hold pointers to each other so the vector can't move once they're linked
+		std::vector<Transform> transforms(count);
+		for (int i = 0; i < count; i++) {
+			transforms[i].SetPosition(scene.l_positions[i]);
+			transforms[i].SetScale(scene.l_scales[i]);
+			transforms[i].SetRotationQuat(scene.l_rotations[i]);
+			if (scene.l_parents[i] >= 0) {
+				transforms[scene.l_parents[i]].AddChild(&transforms[i], false);
+			}
+		}
+
+		TransformStore store;
+		std::vector<int> handles(count);
+		for (int i = 0; i < count; i++) {
+			handles[i] = store.Add(scene.l_parents[i] >= 0 ? handles[scene.l_parents[i]] : -1);
+			store.SetLocal(handles[i], scene.l_positions[i], scene.l_rotations[i], scene.l_scales[i]);
+		}
+
+		BenchClock::time_point start = BenchClock::now();
+		store.Update();
+		double buildMs = MillisecondsSince(start);
+
+		double objectMs = 0.0;
+		double storeMs = 0.0;
+		int updated = 0;
+		//Summed so the reads can't be thrown away
+		float checksum = 0.0f;
+		for (int frame = 1; frame <= BENCH_FRAMES; frame++) {
+			scene.Animate(frame);
+
+			start = BenchClock::now();
+			for (int i = 0; i < count; i += moveEvery) {
+				transforms[i].SetRotationQuat(scene.l_rotations[i]);
+			}
+			for (int i = 0; i < count; i++) {
+				checksum += transforms[i].GetWorldMatrix()._41;
+			}
+			objectMs += MillisecondsSince(start);
+
+			start = BenchClock::now();
+			for (int i = 0; i < count; i += moveEvery) {
+				store.SetRotation(handles[i], scene.l_rotations[i]);
+			}
+			store.Update();
+			const float* worldX = store.Get(TRANSFORM_WORLD_41);
+			for (int i = 0; i < count; i++) {
+				checksum += worldX[i];
+			}
+			storeMs += MillisecondsSince(start);
+			updated += store.NumUpdated();
+		}
+
+		char line[256];
+		snprintf(line, sizeof(line), "  %-22s objects %7.3f ms/frame, store %7.3f ms/frame (%.1fx), %6d rebuilt/frame, %d levels, first sort %.3f ms, max error %.2e%s\n",
+			label,
+			objectMs / BENCH_FRAMES,
+			storeMs / BENCH_FRAMES,
+			storeMs > 0.0 ? objectMs / storeMs : 0.0,
+			updated / BENCH_FRAMES,
+			store.NumLevels(),
+			buildMs,
+			CompareWorlds(transforms, store, handles),
+			checksum == checksum ? "" : " (nan)");
+		return line;
+	}
+
+	//Every node of the store moving each frame at 1 to 16 threads. Each node's matrix is built the
+	//same way on whichever thread gets it, so every thread count should match one thread bit for bit
+	std::string RunThreadScaling(int chainLength, const char* label)
+	{
+		const int threadCounts[] = { 1, 2, 4, 8, 16 };
+
+		HierarchyScene scene(BENCH_TRANSFORMS, chainLength, 11);
+		int count = scene.Size();
+
+		TransformStore store;
+		std::vector<int> handles(count);
+		for (int i = 0; i < count; i++) {
+			handles[i] = store.Add(scene.l_parents[i] >= 0 ? handles[scene.l_parents[i]] : -1);
+			store.SetLocal(handles[i], scene.l_positions[i], scene.l_rotations[i], scene.l_scales[i]);
+		}
+		store.Update();
+
+		std::string report;
+		std::vector<float> singleThreaded(count * 12);
+		double singleThreadedMs = 0.0;
+		for (int threads : threadCounts) {
+			JobSystem::GetInstance()->SetThreadCount(threads);
+
+			double updateMs = 0.0;
+			for (int frame = 1; frame <= BENCH_FRAMES; frame++) {
+				scene.Animate(frame);
+				for (int i = 0; i < count; i++) {
+					store.SetRotation(handles[i], scene.l_rotations[i]);
+				}
+
+				BenchClock::time_point start = BenchClock::now();
+				store.Update();
+				updateMs += MillisecondsSince(start);
+			}
+			updateMs /= BENCH_FRAMES;
+
+			//Every run ends on the same frame, so the world arrays should be identical
+			int differing = 0;
+			for (int component = 0; component < 12; component++) {
+				const float* world = store.Get(static_cast<eTransformComponent>(TRANSFORM_WORLD_11 + component));
+				float* expected = &singleThreaded[component * count];
+				if (threads == 1) {
+					singleThreadedMs = updateMs;
+					memcpy(expected, world, count * sizeof(float));
+				}
+				for (int i = 0; i < count; i++) {
+					if (memcmp(&world[i], &expected[i], sizeof(float)) != 0) {
+						differing++;
+					}
+				}
+			}
+
+			char line[256];
+			snprintf(line, sizeof(line), "  %-22s %2d threads: %7.3f ms/frame (x%.2f), %d levels, %d floats differ from 1 thread\n",
+				label,
+				threads,
+				updateMs,
+				updateMs > 0.0 ? singleThreadedMs / updateMs : 0.0,
+				store.NumLevels(),
+				differing);
+			report += line;
+		}
+		return report;
+	}
+}
+
+std::string TransformBenchmarks::RunHierarchyBenchmark()
+{
+	char header[128];
+	snprintf(header, sizeof(header), "World matrices for %d transforms over %d frames\n", BENCH_TRANSFORMS, BENCH_FRAMES);
+	std::string report = header;
+	report += RunHierarchy(1, 1, "Flat, all moving");
+	report += RunHierarchy(1, 10, "Flat, 10% moving");
+	report += RunHierarchy(100, 1, "100 deep, all moving");
+	//Only every 10th chain's root, everything under it has to follow
+	report += RunHierarchy(100, 1000, "100 deep, 10% chains");
+	report += "Inverse transposes from scale and rotation against XMMatrixInverse\n";
+	report += RunInverseTranspose(100, false, "100 deep, stretched");
+	report += RunInverseTranspose(100, true, "100 deep, uniform");
+	return report;
+}
+
+std::string TransformBenchmarks::RunThreadScalingBenchmark()
+{
+	int previousThreads = JobSystem::GetInstance()->GetThreadCount();
+
+	char header[128];
+	snprintf(header, sizeof(header), "Parallel store update of %d transforms (%d hardware threads)\n", BENCH_TRANSFORMS, JobSystem::GetHardwareThreads());
+	std::string report = header;
+	report += RunThreadScaling(1, "Flat");
+	report += RunThreadScaling(10, "10 deep");
+	report += RunThreadScaling(100, "100 deep");
+
+	JobSystem::GetInstance()->SetThreadCount(previousThreads);
+	return report;
+}
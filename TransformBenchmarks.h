@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+//Headless timing runs for world matrix updates, same idea as the physics benchmarks. Each builds
+//its own hierarchy both as Transform objects and in a TransformStore and returns a printable report
+class TransformBenchmarks
+{
+public:
+	//100k transforms as flat roots and as 1000 chains 100 deep, animated every frame. Times getting
+	//every world matrix out of Transform objects against one TransformStore update, and checks the
+	//two agree. The last case only moves some chain roots, so it also checks that a change reaches
+	//every descendant. Then checks the inverse transposes Transform works out from its scale and
+	//rotation against a general inverse, with stretched and uniformly scaled hierarchies
+	static std::string RunHierarchyBenchmark();
+	//The same 100k transforms flat, 10 deep and 100 deep with the store's update split across 1
+	//to 16 threads. Times each and checks every thread count gives the same matrices as one thread
+	static std::string RunThreadScalingBenchmark();
+};
@@ -0,0 +1,479 @@
+#include "TransformStore.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace DirectX;
+
+namespace
+{
+	//Levels are split across threads in blocks of this many slots counted from the start of the
+	//arrays. 64 dirty flags fill a cache line and 64 floats four, so chunks don't write to the same
+	//lines as each other as long as the arrays start on one
+	const int SLOTS_PER_BLOCK = 64;
+	//Fewest blocks per chunk, smaller levels than this are done on the calling thread
+	const int BLOCK_GRAIN = 8;
+}
+
+TransformStore::TransformStore()
+	: m_needsSort(false),
+	m_numUpdated(0)
+{
+	Clear();
+}
+
+TransformStore::~TransformStore()
+{
+}
+
+int TransformStore::Add(int parent)
+{
+	int handle;
+	if (!l_freeHandles.empty()) {
+		handle = l_freeHandles.back();
+		l_freeHandles.pop_back();
+	}
+	else {
+		handle = static_cast<int>(l_slots.size());
+		l_slots.push_back(-1);
+		l_parentHandles.push_back(-1);
+	}
+
+	int slot = Size();
+	for (int c = 0; c < TRANSFORM_COMPONENT_COUNT; c++) {
+		l_components[c].push_back(0.0f);
+	}
+
+	//Everything else starts at zero, which with these is the identity
+	l_components[TRANSFORM_ROTATION_W][slot] = 1.0f;
+	l_components[TRANSFORM_SCALE_X][slot] = 1.0f;
+	l_components[TRANSFORM_SCALE_Y][slot] = 1.0f;
+	l_components[TRANSFORM_SCALE_Z][slot] = 1.0f;
+	l_components[TRANSFORM_WORLD_11][slot] = 1.0f;
+	l_components[TRANSFORM_WORLD_22][slot] = 1.0f;
+	l_components[TRANSFORM_WORLD_33][slot] = 1.0f;
+	l_components[TRANSFORM_INVERSE_TRANSPOSE_11][slot] = 1.0f;
+	l_components[TRANSFORM_INVERSE_TRANSPOSE_22][slot] = 1.0f;
+	l_components[TRANSFORM_INVERSE_TRANSPOSE_33][slot] = 1.0f;
+	l_components[TRANSFORM_UNIFORM_SCALE][slot] = 1.0f;
+
+	//The end of the arrays is after any parent already, but the levels need working out again
+	l_parents.push_back(parent >= 0 ? l_slots[parent] : -1);
+	l_dirty.push_back(1);
+	l_handles.push_back(handle);
+	l_slots[handle] = slot;
+	l_parentHandles[handle] = parent;
+	m_needsSort = true;
+	return handle;
+}
+
+void TransformStore::Remove(int handle)
+{
+	if (handle < 0 || handle >= static_cast<int>(l_slots.size()) || l_slots[handle] == -1) {
+		return;
+	}
+
+	for (int i = 0; i < Size(); i++) {
+		int child = l_handles[i];
+		if (l_parentHandles[child] == handle) {
+			l_parentHandles[child] = -1;
+			l_dirty[i] = 1;
+		}
+	}
+
+	//Order is fixed by the sort on the next update, so the last node can just be moved into the gap
+	int slot = l_slots[handle];
+	int last = Size() - 1;
+	for (int c = 0; c < TRANSFORM_COMPONENT_COUNT; c++) {
+		l_components[c][slot] = l_components[c][last];
+		l_components[c].pop_back();
+	}
+	l_dirty[slot] = l_dirty[last];
+	l_dirty.pop_back();
+	l_parents[slot] = l_parents[last];
+	l_parents.pop_back();
+	l_handles[slot] = l_handles[last];
+	l_handles.pop_back();
+	if (slot != last) {
+		l_slots[l_handles[slot]] = slot;
+	}
+
+	l_slots[handle] = -1;
+	l_parentHandles[handle] = -1;
+	l_freeHandles.push_back(handle);
+	m_needsSort = true;
+}
+
+void TransformStore::SetParent(int handle, int parent)
+{
+	if (l_parentHandles[handle] == parent) {
+		return;
+	}
+
+	//Can't go under itself or anything below it
+	for (int ancestor = parent; ancestor != -1; ancestor = l_parentHandles[ancestor]) {
+		if (ancestor == handle) {
+			return;
+		}
+	}
+
+	l_parentHandles[handle] = parent;
+	l_dirty[l_slots[handle]] = 1;
+	m_needsSort = true;
+}
+
+void TransformStore::Clear()
+{
+	for (int c = 0; c < TRANSFORM_COMPONENT_COUNT; c++) {
+		l_components[c].clear();
+	}
+	l_parents.clear();
+	l_dirty.clear();
+	l_slots.clear();
+	l_handles.clear();
+	l_freeHandles.clear();
+	l_parentHandles.clear();
+
+	l_levelStarts.clear();
+	l_levelStarts.push_back(0);
+	m_needsSort = false;
+	m_numUpdated = 0;
+}
+
+void TransformStore::SetPosition(int handle, const XMFLOAT3& position)
+{
+	int slot = l_slots[handle];
+	l_components[TRANSFORM_POSITION_X][slot] = position.x;
+	l_components[TRANSFORM_POSITION_Y][slot] = position.y;
+	l_components[TRANSFORM_POSITION_Z][slot] = position.z;
+	l_dirty[slot] = 1;
+}
+
+void TransformStore::SetRotation(int handle, const XMFLOAT4& rotation)
+{
+	int slot = l_slots[handle];
+	l_components[TRANSFORM_ROTATION_X][slot] = rotation.x;
+	l_components[TRANSFORM_ROTATION_Y][slot] = rotation.y;
+	l_components[TRANSFORM_ROTATION_Z][slot] = rotation.z;
+	l_components[TRANSFORM_ROTATION_W][slot] = rotation.w;
+	l_dirty[slot] = 1;
+}
+
+void TransformStore::SetScale(int handle, const XMFLOAT3& scale)
+{
+	int slot = l_slots[handle];
+	l_components[TRANSFORM_SCALE_X][slot] = scale.x;
+	l_components[TRANSFORM_SCALE_Y][slot] = scale.y;
+	l_components[TRANSFORM_SCALE_Z][slot] = scale.z;
+	l_dirty[slot] = 1;
+}
+
+void TransformStore::SetLocal(int handle, const XMFLOAT3& position, const XMFLOAT4& rotation, const XMFLOAT3& scale)
+{
+	SetPosition(handle, position);
+	SetRotation(handle, rotation);
+	SetScale(handle, scale);
+}
+
+XMFLOAT3 TransformStore::GetPosition(int handle) const
+{
+	int slot = l_slots[handle];
+	return XMFLOAT3(l_components[TRANSFORM_POSITION_X][slot], l_components[TRANSFORM_POSITION_Y][slot], l_components[TRANSFORM_POSITION_Z][slot]);
+}
+
+XMFLOAT4 TransformStore::GetRotation(int handle) const
+{
+	int slot = l_slots[handle];
+	return XMFLOAT4(
+		l_components[TRANSFORM_ROTATION_X][slot],
+		l_components[TRANSFORM_ROTATION_Y][slot],
+		l_components[TRANSFORM_ROTATION_Z][slot],
+		l_components[TRANSFORM_ROTATION_W][slot]);
+}
+
+XMFLOAT3 TransformStore::GetScale(int handle) const
+{
+	int slot = l_slots[handle];
+	return XMFLOAT3(l_components[TRANSFORM_SCALE_X][slot], l_components[TRANSFORM_SCALE_Y][slot], l_components[TRANSFORM_SCALE_Z][slot]);
+}
+
+XMFLOAT4X4 TransformStore::GetWorldMatrix(int handle) const
+{
+	int slot = l_slots[handle];
+	const float* m[12];
+	for (int i = 0; i < 12; i++) {
+		m[i] = l_components[TRANSFORM_WORLD_11 + i].data() + slot;
+	}
+
+	return XMFLOAT4X4(
+		*m[0], *m[1], *m[2], 0.0f,
+		*m[3], *m[4], *m[5], 0.0f,
+		*m[6], *m[7], *m[8], 0.0f,
+		*m[9], *m[10], *m[11], 1.0f);
+}
+
+void TransformStore::GetWorldMatrices3x4(int handle, XMFLOAT3X4& outWorld, XMFLOAT3X4& outWorldInverseTranspose) const
+{
+	XMFLOAT4X4 world = GetWorldMatrix(handle);
+
+	int slot = l_slots[handle];
+	const float* n[9];
+	for (int i = 0; i < 9; i++) {
+		n[i] = l_components[TRANSFORM_INVERSE_TRANSPOSE_11 + i].data() + slot;
+	}
+	//Translation is left out, same as Transform's
+	XMFLOAT4X4 invTranspose(
+		*n[0], *n[1], *n[2], 0.0f,
+		*n[3], *n[4], *n[5], 0.0f,
+		*n[6], *n[7], *n[8], 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+
+	XMStoreFloat3x4(&outWorld, XMLoadFloat4x4(&world));
+	XMStoreFloat3x4(&outWorldInverseTranspose, XMLoadFloat4x4(&invTranspose));
+}
+
+void TransformStore::MarkAllDirty()
+{
+	std::fill(l_dirty.begin(), l_dirty.end(), static_cast<unsigned char>(1));
+}
+
+void TransformStore::Sort()
+{
+	int count = Size();
+
+	//Depth of every handle, walking up until something with a known depth is found
+	l_depths.assign(l_slots.size(), -1);
+	std::vector<int> chain;
+	int maxDepth = 0;
+	for (int i = 0; i < count; i++) {
+		chain.clear();
+		int handle = l_handles[i];
+		while (handle != -1 && l_depths[handle] == -1) {
+			chain.push_back(handle);
+			handle = l_parentHandles[handle];
+		}
+
+		int depth = handle == -1 ? -1 : l_depths[handle];
+		for (int j = static_cast<int>(chain.size()) - 1; j >= 0; j--) {
+			l_depths[chain[j]] = ++depth;
+		}
+		maxDepth = std::max(maxDepth, depth);
+	}
+
+	//Counting sort by depth, which keeps the old order within a level
+	l_levelStarts.assign(count > 0 ? maxDepth + 2 : 1, 0);
+	for (int i = 0; i < count; i++) {
+		l_levelStarts[l_depths[l_handles[i]] + 1]++;
+	}
+	for (unsigned int level = 1; level < l_levelStarts.size(); level++) {
+		l_levelStarts[level] += l_levelStarts[level - 1];
+	}
+
+	std::vector<int>& order = l_order;
+	order.resize(count);
+	std::vector<int> fill(l_levelStarts.begin(), l_levelStarts.end() - 1);
+	for (int i = 0; i < count; i++) {
+		order[fill[l_depths[l_handles[i]]]++] = i;
+	}
+
+	//New slot of each handle, filled in a level at a time so a level's parents are known before it's sorted
+	std::vector<int> newSlots(l_slots.size(), -1);
+	for (int level = 0; level < NumLevels(); level++) {
+		int begin = l_levelStarts[level];
+		int end = l_levelStarts[level + 1];
+		if (level > 0) {
+			std::stable_sort(order.begin() + begin, order.begin() + end, [&](int a, int b) {
+				return newSlots[l_parentHandles[l_handles[a]]] < newSlots[l_parentHandles[l_handles[b]]];
+			});
+		}
+		for (int i = begin; i < end; i++) {
+			newSlots[l_handles[order[i]]] = i;
+		}
+	}
+
+	l_sortScratch.resize(count);
+	for (int c = 0; c < TRANSFORM_COMPONENT_COUNT; c++) {
+		float* component = l_components[c].data();
+		for (int i = 0; i < count; i++) {
+			l_sortScratch[i] = component[order[i]];
+		}
+		std::copy(l_sortScratch.begin(), l_sortScratch.end(), component);
+	}
+
+	std::vector<unsigned char> dirty(count);
+	std::vector<int> handles(count);
+	for (int i = 0; i < count; i++) {
+		dirty[i] = l_dirty[order[i]];
+		handles[i] = l_handles[order[i]];
+	}
+	l_dirty.swap(dirty);
+	l_handles.swap(handles);
+
+	for (int i = 0; i < count; i++) {
+		int handle = l_handles[i];
+		int parent = l_parentHandles[handle];
+		l_slots[handle] = i;
+		l_parents[i] = parent >= 0 ? newSlots[parent] : -1;
+	}
+
+	m_needsSort = false;
+}
+
+int TransformStore::UpdateRange(int begin, int end)
+{
+	const float* px = Get(TRANSFORM_POSITION_X);
+	const float* py = Get(TRANSFORM_POSITION_Y);
+	const float* pz = Get(TRANSFORM_POSITION_Z);
+	const float* qx = Get(TRANSFORM_ROTATION_X);
+	const float* qy = Get(TRANSFORM_ROTATION_Y);
+	const float* qz = Get(TRANSFORM_ROTATION_Z);
+	const float* qw = Get(TRANSFORM_ROTATION_W);
+	const float* sx = Get(TRANSFORM_SCALE_X);
+	const float* sy = Get(TRANSFORM_SCALE_Y);
+	const float* sz = Get(TRANSFORM_SCALE_Z);
+	float* m[12];
+	for (int i = 0; i < 12; i++) {
+		m[i] = Get(static_cast<eTransformComponent>(TRANSFORM_WORLD_11 + i));
+	}
+	float* n[9];
+	for (int i = 0; i < 9; i++) {
+		n[i] = Get(static_cast<eTransformComponent>(TRANSFORM_INVERSE_TRANSPOSE_11 + i));
+	}
+	float* uniform = Get(TRANSFORM_UNIFORM_SCALE);
+	const int* parents = l_parents.data();
+	unsigned char* dirty = l_dirty.data();
+
+	int updated = 0;
+	for (int i = begin; i < end; i++) {
+		//The parent's flag is still up if it was rebuilt earlier in this Update
+		int parent = parents[i];
+		if (parent >= 0) {
+			dirty[i] |= dirty[parent];
+		}
+		if (!dirty[i]) {
+			continue;
+		}
+
+		//Rotation matrix, same as XMMatrixRotationQuaternion
+		float x2 = qx[i] + qx[i], y2 = qy[i] + qy[i], z2 = qz[i] + qz[i];
+		float xx = qx[i] * x2, yy = qy[i] * y2, zz = qz[i] * z2;
+		float xy = qx[i] * y2, xz = qx[i] * z2, yz = qy[i] * z2;
+		float wx = qw[i] * x2, wy = qw[i] * y2, wz = qw[i] * z2;
+
+		float r11 = 1.0f - yy - zz, r12 = xy + wz, r13 = xz - wy;
+		float r21 = xy - wz, r22 = 1.0f - xx - zz, r23 = yz + wx;
+		float r31 = xz + wy, r32 = yz - wx, r33 = 1.0f - xx - yy;
+
+		//Each row scaled
+		float l11 = r11 * sx[i], l12 = r12 * sx[i], l13 = r13 * sx[i];
+		float l21 = r21 * sy[i], l22 = r22 * sy[i], l23 = r23 * sy[i];
+		float l31 = r31 * sz[i], l32 = r32 * sz[i], l33 = r33 * sz[i];
+		float l41 = px[i], l42 = py[i], l43 = pz[i];
+
+		if (parent < 0) {
+			m[0][i] = l11; m[1][i] = l12; m[2][i] = l13;
+			m[3][i] = l21; m[4][i] = l22; m[5][i] = l23;
+			m[6][i] = l31; m[7][i] = l32; m[8][i] = l33;
+			m[9][i] = l41; m[10][i] = l42; m[11][i] = l43;
+		}
+		else {
+			//local * parent, the parent's last column is (0, 0, 0, 1)
+			float p11 = m[0][parent], p12 = m[1][parent], p13 = m[2][parent];
+			float p21 = m[3][parent], p22 = m[4][parent], p23 = m[5][parent];
+			float p31 = m[6][parent], p32 = m[7][parent], p33 = m[8][parent];
+			float p41 = m[9][parent], p42 = m[10][parent], p43 = m[11][parent];
+
+			m[0][i] = l11 * p11 + l12 * p21 + l13 * p31;
+			m[1][i] = l11 * p12 + l12 * p22 + l13 * p32;
+			m[2][i] = l11 * p13 + l12 * p23 + l13 * p33;
+			m[3][i] = l21 * p11 + l22 * p21 + l23 * p31;
+			m[4][i] = l21 * p12 + l22 * p22 + l23 * p32;
+			m[5][i] = l21 * p13 + l22 * p23 + l23 * p33;
+			m[6][i] = l31 * p11 + l32 * p21 + l33 * p31;
+			m[7][i] = l31 * p12 + l32 * p22 + l33 * p32;
+			m[8][i] = l31 * p13 + l32 * p23 + l33 * p33;
+			m[9][i] = l41 * p11 + l42 * p21 + l43 * p31 + p41;
+			m[10][i] = l41 * p12 + l42 * p22 + l43 * p32 + p42;
+			m[11][i] = l41 * p13 + l42 * p23 + l43 * p33 + p43;
+		}
+
+		//Inverse transpose the way Transform builds it
+		bool uniformScale = sx[i] == sy[i] && sy[i] == sz[i] && (parent < 0 || uniform[parent] != 0.0f);
+		uniform[i] = uniformScale ? 1.0f : 0.0f;
+		if (uniformScale) {
+			//World is s * R, so the inverse transpose is R / s, which is just the world over s^2
+			float scaleSq = m[0][i] * m[0][i] + m[1][i] * m[1][i] + m[2][i] * m[2][i];
+			float invScaleSq = scaleSq > 0.0f ? 1.0f / scaleSq : 0.0f;
+			for (int j = 0; j < 9; j++) {
+				n[j][i] = m[j][i] * invScaleSq;
+			}
+		}
+		else {
+			//The rotation rows over the scale, times the parent's under a parent
+			float ix = sx[i] != 0.0f ? 1.0f / sx[i] : 0.0f;
+			float iy = sy[i] != 0.0f ? 1.0f / sy[i] : 0.0f;
+			float iz = sz[i] != 0.0f ? 1.0f / sz[i] : 0.0f;
+			float t11 = r11 * ix, t12 = r12 * ix, t13 = r13 * ix;
+			float t21 = r21 * iy, t22 = r22 * iy, t23 = r23 * iy;
+			float t31 = r31 * iz, t32 = r32 * iz, t33 = r33 * iz;
+
+			if (parent < 0) {
+				n[0][i] = t11; n[1][i] = t12; n[2][i] = t13;
+				n[3][i] = t21; n[4][i] = t22; n[5][i] = t23;
+				n[6][i] = t31; n[7][i] = t32; n[8][i] = t33;
+			}
+			else {
+				float p11 = n[0][parent], p12 = n[1][parent], p13 = n[2][parent];
+				float p21 = n[3][parent], p22 = n[4][parent], p23 = n[5][parent];
+				float p31 = n[6][parent], p32 = n[7][parent], p33 = n[8][parent];
+
+				n[0][i] = t11 * p11 + t12 * p21 + t13 * p31;
+				n[1][i] = t11 * p12 + t12 * p22 + t13 * p32;
+				n[2][i] = t11 * p13 + t12 * p23 + t13 * p33;
+				n[3][i] = t21 * p11 + t22 * p21 + t23 * p31;
+				n[4][i] = t21 * p12 + t22 * p22 + t23 * p32;
+				n[5][i] = t21 * p13 + t22 * p23 + t23 * p33;
+				n[6][i] = t31 * p11 + t32 * p21 + t33 * p31;
+				n[7][i] = t31 * p12 + t32 * p22 + t33 * p32;
+				n[8][i] = t31 * p13 + t32 * p23 + t33 * p33;
+			}
+		}
+
+		updated++;
+	}
+
+	return updated;
+}
+
+void TransformStore::Update()
+{
+	if (m_needsSort) {
+		Sort();
+	}
+
+	//A level only reads its own nodes and the finished level above it, so each one is a
+	//parallel for over its slots. Chunks are done the same way whichever thread runs them,
+	//so the result is the same for any thread count
+	std::shared_ptr<JobSystem> jobs = JobSystem::GetInstance();
+	std::atomic<int> updated(0);
+	for (int level = 0; level < NumLevels(); level++) {
+		int levelStart = l_levelStarts[level];
+		int levelEnd = l_levelStarts[level + 1];
+		if (levelEnd <= levelStart) {
+			continue;
+		}
+
+		int firstBlock = levelStart / SLOTS_PER_BLOCK;
+		int numBlocks = (levelEnd - 1) / SLOTS_PER_BLOCK - firstBlock + 1;
+		jobs->ParallelFor(numBlocks, BLOCK_GRAIN, [&](int begin, int end) {
+			int rangeStart = std::max(levelStart, (firstBlock + begin) * SLOTS_PER_BLOCK);
+			int rangeEnd = std::min(levelEnd, (firstBlock + end) * SLOTS_PER_BLOCK);
+			updated += UpdateRange(rangeStart, rangeEnd);
+		});
+	}
+
+	//Flags stay up until every level is done so children can see their parent was rebuilt
+	std::fill(l_dirty.begin(), l_dirty.end(), static_cast<unsigned char>(0));
+	m_numUpdated = updated;
+}
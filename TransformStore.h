@@ -0,0 +1,151 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+//Every piece of transform state the update touches, one array per float
+enum eTransformComponent
+{
+	//Relative to the parent, or the world for roots
+	TRANSFORM_POSITION_X = 0,
+	TRANSFORM_POSITION_Y,
+	TRANSFORM_POSITION_Z,
+
+	TRANSFORM_ROTATION_X,
+	TRANSFORM_ROTATION_Y,
+	TRANSFORM_ROTATION_Z,
+	TRANSFORM_ROTATION_W,
+
+	TRANSFORM_SCALE_X,
+	TRANSFORM_SCALE_Y,
+	TRANSFORM_SCALE_Z,
+
+	//World matrix without its last column, which is always (0, 0, 0, 1) for a TRS. Same
+	//names as XMFLOAT4X4, so rows 1 to 3 are the scaled axes and row 4 the position
+	TRANSFORM_WORLD_11,
+	TRANSFORM_WORLD_12,
+	TRANSFORM_WORLD_13,
+	TRANSFORM_WORLD_21,
+	TRANSFORM_WORLD_22,
+	TRANSFORM_WORLD_23,
+	TRANSFORM_WORLD_31,
+	TRANSFORM_WORLD_32,
+	TRANSFORM_WORLD_33,
+	TRANSFORM_WORLD_41,
+	TRANSFORM_WORLD_42,
+	TRANSFORM_WORLD_43,
+
+	//3x3 part of the world matrix's inverse transpose, all normals need. Built the same way as
+	//Transform's from the rotation and one over the scale, not with a general inverse
+	TRANSFORM_INVERSE_TRANSPOSE_11,
+	TRANSFORM_INVERSE_TRANSPOSE_12,
+	TRANSFORM_INVERSE_TRANSPOSE_13,
+	TRANSFORM_INVERSE_TRANSPOSE_21,
+	TRANSFORM_INVERSE_TRANSPOSE_22,
+	TRANSFORM_INVERSE_TRANSPOSE_23,
+	TRANSFORM_INVERSE_TRANSPOSE_31,
+	TRANSFORM_INVERSE_TRANSPOSE_32,
+	TRANSFORM_INVERSE_TRANSPOSE_33,
+	//1 if the world matrix is scaled the same on every axis, parents included, otherwise 0.
+	//A float so it gets sorted along with everything else
+	TRANSFORM_UNIFORM_SCALE,
+
+	TRANSFORM_COMPONENT_COUNT,
+};
+
+//Transforms for big sets of animated objects stored as structure of arrays, instead of
+//Transform objects that each build their world matrix on demand by asking their parent for
+//its own. Every node's local position, rotation and scale and its world matrix live in one
+//float array each, sorted by depth in the hierarchy so a parent is always before its children.
+//Update then goes from front to back one depth level at a time: dirty flags are pushed down to
+//children and every dirty node's world matrix is rebuilt from its local values and its parent's
+//world matrix, which was finished with the level before. Nodes in a level don't depend on each
+//other, so each level is split across the JobSystem's threads in chunks of whole cache lines.
+//Building a matrix is straight float math on the arrays with no calls or matrix types, reading
+//the parent's world matrix, inverse transpose and uniform scale flag at most.
+//Nodes are referred to by handles that stay the same while the arrays get resorted,
+//adding, removing or reparenting nodes only resorts them on the next Update
+class TransformStore
+{
+private:
+	std::vector<float> l_components[TRANSFORM_COMPONENT_COUNT];
+	//Parent's slot in the arrays, -1 for roots
+	std::vector<int> l_parents;
+	//1 if the node's world matrix needs rebuilding, unsigned char so the flags pack tight
+	std::vector<unsigned char> l_dirty;
+
+	//Slot of each handle and handle in each slot, -1 for handles that have been removed
+	std::vector<int> l_slots;
+	std::vector<int> l_handles;
+	std::vector<int> l_freeHandles;
+	//Parent of each node by handle, the slots are only worked out from it when sorting
+	std::vector<int> l_parentHandles;
+
+	//First slot of each depth, plus one past the last node
+	std::vector<int> l_levelStarts;
+
+	bool m_needsSort;
+	int m_numUpdated;
+
+	//Scratch for the sort
+	std::vector<int> l_depths;
+	std::vector<int> l_order;
+	std::vector<float> l_sortScratch;
+
+	//Puts every node after its parent, grouped by depth and then by parent so siblings sit together
+	void Sort();
+
+	//Rebuilds the world matrix of every slot in [begin, end) that's dirty or has a dirty parent
+	//from its local values and its parent's world matrix, so the parents have to be done already.
+	//Leaves the flags up for the children. Returns how many it rebuilt
+	int UpdateRange(int begin, int end);
+
+public:
+	TransformStore();
+	~TransformStore();
+
+	//Identity node under parent (a handle, -1 for a root), returns its handle
+	int Add(int parent = -1);
+	//Its children become roots and keep their local values
+	void Remove(int handle);
+	//parent -1 makes it a root. Local values are kept, so the node moves with its new parent
+	void SetParent(int handle, int parent);
+	int GetParent(int handle) const { return l_parentHandles[handle]; }
+	//Nodes that haven't been removed
+	int Size() const { return static_cast<int>(l_handles.size()); }
+	void Clear();
+
+	void SetPosition(int handle, const DirectX::XMFLOAT3& position);
+	void SetRotation(int handle, const DirectX::XMFLOAT4& rotation);
+	void SetScale(int handle, const DirectX::XMFLOAT3& scale);
+	void SetLocal(int handle, const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT4& rotation, const DirectX::XMFLOAT3& scale);
+	DirectX::XMFLOAT3 GetPosition(int handle) const;
+	DirectX::XMFLOAT4 GetRotation(int handle) const;
+	DirectX::XMFLOAT3 GetScale(int handle) const;
+
+	//As of the last Update
+	DirectX::XMFLOAT4X4 GetWorldMatrix(int handle) const;
+	//Same matrix and its inverse transpose (as of the last Update too) in Transform's compact layout,
+	//ready for the vertex shaders
+	void GetWorldMatrices3x4(int handle, DirectX::XMFLOAT3X4& outWorld, DirectX::XMFLOAT3X4& outWorldInverseTranspose) const;
+
+	//Sorts if the hierarchy changed and rebuilds every world matrix that's out of date, using
+	//however many threads the JobSystem is set to
+	void Update();
+	//Marks every node dirty, for when the arrays were written directly
+	void MarkAllDirty();
+
+	//Raw arrays by slot for bulk edits, call MarkDirty on what was changed
+	float* Get(eTransformComponent component) { return l_components[component].data(); }
+	const float* Get(eTransformComponent component) const { return l_components[component].data(); }
+	int GetSlot(int handle) const { return l_slots[handle]; }
+	void MarkDirty(int handle) { l_dirty[l_slots[handle]] = 1; }
+	//Slots only stay put until the hierarchy changes and the next Update sorts them again
+	bool NeedsSort() const { return m_needsSort; }
+
+	//Depth levels as of the last Update, level 0 is the roots
+	int NumLevels() const { return static_cast<int>(l_levelStarts.size()) - 1; }
+	int GetLevelStart(int level) const { return l_levelStarts[level]; }
+	//World matrices rebuilt by the last Update
+	int NumUpdated() const { return m_numUpdated; }
+};
@@ -3,8 +3,9 @@
 //constant buffer. Can't be changed by shaders but
 // can be changed from C++
 cbuffer ExternalData : register(b0) {
-	matrix world;
-	matrix worldInvTranspose;
+	//Only the three columns an affine matrix needs, sent as rows so each is one register
+	row_major float3x4 world;
+	row_major float3x4 worldInvTranspose;
 	matrix view;
 	matrix proj;
 	matrix lightView;
@@ -26,16 +27,13 @@ VertexToPixel main( VertexShaderInput input )
 	// Set up output struct
 	VertexToPixel output;
 
-	// 'backwards' due to column major
-	matrix wvp = mul(mul(proj, view), world);
-	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
-
-	matrix swvp = mul(mul(lightProj, lightView), world);
-	output.shadowPos = mul(swvp, float4(input.localPosition, 1.0f));
-	
+	//multiply local pos by world mat, the missing bottom row is always (0, 0, 0, 1)
+	float4 worldPos = float4(mul(world, float4(input.localPosition, 1.0f)), 1.0f);
 
-	matrix spotswvp = mul(mul(spotLightProj, spotLightView), world);
-	output.spotShadowPos = mul(spotswvp, float4(input.localPosition, 1.0f));
+	// 'backwards' due to column major
+	output.screenPosition = mul(mul(proj, view), worldPos);
+	output.shadowPos = mul(mul(lightProj, lightView), worldPos);
+	output.spotShadowPos = mul(mul(spotLightProj, spotLightView), worldPos);
 	 
 	//rotate normal
 	//cast to 3x3 to only apply rotatation. Use inverse transpose to ignore non-uniform scale
@@ -43,8 +41,6 @@ VertexToPixel main( VertexShaderInput input )
 	output.tangent = mul((float3x3)worldInvTranspose, input.tangent);
 	//output.bitangent = mul((float3x3)worldInvTranspose, input.bitangent);
 
-	//multiply local pos by world mat and grab first three components
-	float4 worldPos = mul(world, float4(input.localPosition, 1));
 	output.worldPos = worldPos;
 
 